@@ -0,0 +1,176 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// accelerators/accelcache.cpp*
+#include "accelerators/accelcache.h"
+#include "stats.h"
+#include "stringprint.h"
+#include <stdio.h>
+#ifdef PBRT_IS_WINDOWS
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace pbrt {
+
+STAT_COUNTER("Accelerator cache/Structures loaded", cacheLoads);
+STAT_COUNTER("Accelerator cache/Structures written", cacheWrites);
+
+// AccelCache Local Declarations
+static PBRT_CONSTEXPR uint32_t accelCacheVersion = 1;
+static PBRT_CONSTEXPR int maxSections = 4;
+static PBRT_CONSTEXPR size_t sectionAlignment = 64;
+
+struct AccelCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nSections;
+    uint64_t key;
+    uint64_t offset[maxSections];
+    uint64_t bytes[maxSections];
+};
+
+static const char accelCacheMagic[8] = {'p', 'b', 'r', 't', 'a', 'c', 'c', '\0'};
+
+static std::string CacheFilename(const std::string &type, uint64_t key) {
+    return StringPrintf("%s/%s-%016" PRIx64 ".accel",
+                        PbrtOptions.accelCacheDir.c_str(), type.c_str(), key);
+}
+
+// AccelCache Method Definitions
+void AccelCacheKey::Add(const void *data, size_t bytes) {
+    // Mix in eight bytes at a time, following MurmurHash64A
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const uint8_t *p = (const uint8_t *)data;
+    while (bytes > 0) {
+        size_t n = std::min<size_t>(bytes, sizeof(uint64_t));
+        uint64_t k = n;
+        memcpy(&k, p, n);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        hash = (hash ^ k) * m;
+        p += n;
+        bytes -= n;
+    }
+}
+
+std::unique_ptr<AccelCacheFile> AccelCacheFile::Open(const std::string &type,
+                                                     uint64_t key) {
+    std::string filename = CacheFilename(type, key);
+    std::unique_ptr<MappedFile> file = MappedFile::Open(filename);
+    if (!file) return nullptr;
+
+    // Validate the header and section extents against the mapped file
+    AccelCacheHeader header;
+    if (file->Size() < sizeof(header)) return nullptr;
+    memcpy(&header, file->Data(), sizeof(header));
+    if (memcmp(header.magic, accelCacheMagic, sizeof(accelCacheMagic)) != 0 ||
+        header.version != accelCacheVersion || header.key != key ||
+        header.nSections > maxSections) {
+        Warning("Ignoring stale or corrupt acceleration structure cache "
+                "\"%s\".", filename.c_str());
+        return nullptr;
+    }
+    std::vector<AccelCacheSection> sections(header.nSections);
+    for (uint32_t i = 0; i < header.nSections; ++i) {
+        if (header.offset[i] % sectionAlignment != 0 ||
+            header.offset[i] > file->Size() ||
+            header.bytes[i] > file->Size() - header.offset[i]) {
+            Warning("Ignoring truncated acceleration structure cache \"%s\".",
+                    filename.c_str());
+            return nullptr;
+        }
+        sections[i] = {file->Data() + header.offset[i], header.bytes[i]};
+    }
+    ++cacheLoads;
+    LOG(INFO) << "Mapped acceleration structure cache " << filename;
+    return std::unique_ptr<AccelCacheFile>(
+        new AccelCacheFile(std::move(file), std::move(sections)));
+}
+
+bool AccelCacheFile::Write(const std::string &type, uint64_t key,
+                           const std::vector<AccelCacheSection> &sections) {
+    CHECK_LE(sections.size(), maxSections);
+    AccelCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, accelCacheMagic, sizeof(accelCacheMagic));
+    header.version = accelCacheVersion;
+    header.nSections = sections.size();
+    header.key = key;
+    uint64_t offset = sizeof(header);
+    for (size_t i = 0; i < sections.size(); ++i) {
+        offset = (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+        header.offset[i] = offset;
+        header.bytes[i] = sections[i].bytes;
+        offset += sections[i].bytes;
+    }
+
+    // Write to a temporary file first and rename it into place, so that
+    // concurrent renders never map a partially written cache
+    std::string filename = CacheFilename(type, key);
+#ifdef PBRT_IS_WINDOWS
+    std::string tempFilename = StringPrintf("%s.%d", filename.c_str(), _getpid());
+#else
+    std::string tempFilename = StringPrintf("%s.%d", filename.c_str(), getpid());
+#endif
+    FILE *f = fopen(tempFilename.c_str(), "wb");
+    if (!f) {
+        Warning("%s: unable to create acceleration structure cache file.",
+                tempFilename.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    uint64_t written = sizeof(header);
+    const char zeros[sectionAlignment] = {0};
+    for (size_t i = 0; i < sections.size() && ok; ++i) {
+        ok = fwrite(zeros, 1, header.offset[i] - written, f) ==
+                 header.offset[i] - written &&
+             fwrite(sections[i].data, 1, sections[i].bytes, f) ==
+                 sections[i].bytes;
+        written = header.offset[i] + sections[i].bytes;
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (ok && rename(tempFilename.c_str(), filename.c_str()) == 0) {
+        ++cacheWrites;
+        LOG(INFO) << "Wrote acceleration structure cache " << filename;
+        return true;
+    }
+    Warning("%s: unable to write acceleration structure cache file.",
+            filename.c_str());
+    remove(tempFilename.c_str());
+    return false;
+}
+
+}  // namespace pbrt
@@ -0,0 +1,105 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_ACCELERATORS_ACCELCACHE_H
+#define PBRT_ACCELERATORS_ACCELCACHE_H
+
+// accelerators/accelcache.h*
+#include "pbrt.h"
+#include "fileutil.h"
+
+namespace pbrt {
+
+// AccelCache Declarations
+
+// 64-bit hash of everything an accelerator build depends on: the type and
+// parameters of the accelerator and the bounds of all of its primitives.
+class AccelCacheKey {
+  public:
+    // AccelCacheKey Public Methods
+    AccelCacheKey(const std::string &type) { Add(type.data(), type.size()); }
+    void Add(const void *data, size_t bytes);
+    // _T_ must be plain data without padding, e.g. _Bounds3f_ or _int_
+    template <typename T>
+    void Add(const T &v) {
+        Add(&v, sizeof(T));
+    }
+    uint64_t Value() const { return hash; }
+
+  private:
+    // AccelCacheKey Private Data
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+};
+
+// One array of a cached accelerator
+struct AccelCacheSection {
+    const void *data;
+    size_t bytes;
+};
+
+// Flattened accelerator arrays stored in _PbrtOptions.accelCacheDir_ and
+// mapped back into memory when the same key is built again.  Each section
+// starts at a 64 byte aligned address, so node arrays can be used in place.
+class AccelCacheFile {
+  public:
+    // AccelCacheFile Public Methods
+    static bool Enabled() { return !PbrtOptions.accelCacheDir.empty(); }
+    // Maps the cache file of _type_ for _key_; returns _nullptr_ if there
+    // is none or it doesn't match the key
+    static std::unique_ptr<AccelCacheFile> Open(const std::string &type,
+                                                uint64_t key);
+    // Writes _sections_ to the cache file of _type_ for _key_
+    static bool Write(const std::string &type, uint64_t key,
+                      const std::vector<AccelCacheSection> &sections);
+    int NumSections() const { return (int)sections.size(); }
+    const AccelCacheSection &Section(int i) const { return sections[i]; }
+
+  private:
+    // AccelCacheFile Private Methods
+    AccelCacheFile(std::unique_ptr<MappedFile> file,
+                   std::vector<AccelCacheSection> sections)
+        : file(std::move(file)), sections(std::move(sections)) {}
+
+    // AccelCacheFile Private Data
+    std::unique_ptr<MappedFile> file;
+    std::vector<AccelCacheSection> sections;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_ACCELERATORS_ACCELCACHE_H
@@ -33,11 +33,26 @@
 
 // accelerators/bvh.cpp*
 #include "accelerators/bvh.h"
+#include "accelerators/accelcache.h"
 #include "interaction.h"
 #include "paramset.h"
 #include "stats.h"
 #include "parallel.h"
+#include "shapes/triangle.h"
 #include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+// SIMD child bounds tests for wide BVH nodes
+#if !defined(PBRT_FLOAT_AS_DOUBLE) && (defined(__SSE2__) || defined(_M_X64))
+#define PBRT_BVH_SSE
+#include <xmmintrin.h>
+#endif
+#if !defined(PBRT_FLOAT_AS_DOUBLE) && defined(__AVX__)
+#define PBRT_BVH_AVX
+#include <immintrin.h>
+#endif
 
 namespace pbrt {
 
@@ -45,6 +60,18 @@ STAT_MEMORY_COUNTER("Memory/BVH tree", treeBytes);
 STAT_RATIO("BVH/Primitives per leaf node", totalPrimitives, totalLeafNodes);
 STAT_COUNTER("BVH/Interior nodes", interiorNodes);
 STAT_COUNTER("BVH/Leaf nodes", leafNodes);
+STAT_COUNTER("BVH/Wide nodes", wideNodeCount);
+STAT_MEMORY_COUNTER("Memory/BVH triangle blocks", triangleBlockBytes);
+STAT_COUNTER("BVH/Refits", refitCount);
+STAT_COUNTER("BVH/Refits rejected", rejectedRefits);
+STAT_COUNTER("BVH/SBVH spatial splits", spatialSplits);
+STAT_COUNTER("BVH/SBVH duplicated references", duplicatedReferences);
+STAT_RATIO("BVH/Rays per packet", packetRays, rayPackets);
+STAT_RATIO("BVH/Active rays per packet node test", activePacketRays,
+           packetNodeTests);
+STAT_FLOAT_DISTRIBUTION("BVH/SAH cost", treeSAHCost);
+STAT_FLOAT_DISTRIBUTION("BVH/Child overlap (relative surface area)",
+                        treeOverlapArea);
 
 // BVHAccel Local Declarations
 struct BVHPrimitiveInfo {
@@ -82,6 +109,46 @@ struct BVHBuildNode {
     int splitAxis, firstPrimOffset, nPrimitives;
 };
 
+// Spatial split BVH Local Declarations
+// Spatial splits are only tried when the children of the best object
+// split overlap by more than this fraction of the root's surface area
+static PBRT_CONSTEXPR Float spatialSplitAlpha = 1e-5f;
+// Spatial splits are not considered below this depth, which bounds the
+// depth of the tree for the fixed-size traversal stacks
+static PBRT_CONSTEXPR int maxSpatialSplitDepth = 48;
+
+struct BVHReference {
+    int primitiveNumber;
+    Bounds3f bounds;
+};
+
+struct SpatialBin {
+    Bounds3f bounds;
+    int entries = 0, exits = 0;
+};
+
+static bool IsEmpty(const Bounds3f &b) {
+    return b.pMin.x > b.pMax.x || b.pMin.y > b.pMax.y || b.pMin.z > b.pMax.z;
+}
+
+// Accumulates the SAH cost of the subtree at _node_ and the surface area of
+// the overlap between the children of its interior nodes, both relative to
+// _rootArea_
+static void ComputeTreeCost(const BVHBuildNode *node, Float rootArea,
+                            double *sahCost, double *overlapArea) {
+    Float relativeArea = node->bounds.SurfaceArea() / rootArea;
+    if (node->nPrimitives > 0) {
+        *sahCost += relativeArea * node->nPrimitives;
+        return;
+    }
+    *sahCost += relativeArea;
+    Bounds3f overlap =
+        Intersect(node->children[0]->bounds, node->children[1]->bounds);
+    if (!IsEmpty(overlap)) *overlapArea += overlap.SurfaceArea() / rootArea;
+    ComputeTreeCost(node->children[0], rootArea, sahCost, overlapArea);
+    ComputeTreeCost(node->children[1], rootArea, sahCost, overlapArea);
+}
+
 struct MortonPrimitive {
     int primitiveIndex;
     uint32_t mortonCode;
@@ -95,7 +162,7 @@ struct LBVHTreelet {
 struct LinearBVHNode {
     Bounds3f bounds;
     union {
-        int primitivesOffset;   // leaf
+        int primitivesOffset;   // leaf; see _BVHAccel::triBlocks_
         int secondChildOffset;  // interior
     };
     uint16_t nPrimitives;  // 0 -> interior node
@@ -103,6 +170,148 @@ struct LinearBVHNode {
     uint8_t pad[1];        // ensure 32 byte total size
 };
 
+// Node of a BVH collapsed to _Width_ children per node; leaves are stored
+// directly in their parent's child slots.  Nodes are built in a
+// _std::vector_, so the type carries no extended alignment; the final array
+// comes from _AllocAligned()_ instead.
+template <int Width>
+struct WideBVHNode {
+    Float bounds[2][3][Width];        // [min/max][axis][child]
+    int childOffset[Width];           // interior: node index; leaf: prim offset
+    uint16_t nPrimitives[Width];      // 0 -> interior child
+    uint8_t nChildren;
+    uint8_t pad[2 * Width - 1];       // 32 * Width bytes with float _Float_
+};
+
+struct WideBVHStackEntry {
+    int offset;
+    int nPrimitives;
+    Float tEntry;
+};
+
+// Four triangles of BVH leaves: their vertices in SoA layout, their
+// indices in their meshes, and the indices of the
+// _BVHAccel::blockPrimitives_ whose triangles share their meshes
+struct TriangleBlock {
+    Float p[3][3][4];  // [vertex][axis][triangle]
+    int32_t triNumber[4];
+    int32_t primitive[4];  // 176 bytes with float _Float_
+};
+
+// Per-ray setup of the watertight ray--triangle test in
+// _Triangle::Intersect()_, shared by all triangle blocks a ray visits
+struct TriangleBlockRay {
+    TriangleBlockRay() {}
+    TriangleBlockRay(const Ray &ray) : o(ray.o) {
+        kz = MaxDimension(Abs(ray.d));
+        kx = kz + 1;
+        if (kx == 3) kx = 0;
+        ky = kx + 1;
+        if (ky == 3) ky = 0;
+        Vector3f d = Permute(ray.d, kx, ky, kz);
+        Sx = -d.x / d.z;
+        Sy = -d.y / d.z;
+        Sz = 1.f / d.z;
+    }
+    Point3f o;
+    int kx, ky, kz;
+    Float Sx, Sy, Sz;
+};
+
+// Distances this close to _tMax_ are still passed on to the exact test
+static PBRT_CONSTEXPR Float triangleBlockTMaxSlack = 1 + 1e-5f;
+
+// Tests a ray against the triangles of _block_ with the same arithmetic as
+// _Triangle::Intersect()_, but conservatively: the edge tests allow for the
+// rounding error of the edge functions, which also covers the double
+// precision fallback at edges, and the error bound on _t_ isn't checked.
+// Returns the mask of the triangles in _lanes_ the exact test may hit, with
+// approximate hit distances in _t_.
+static inline int IntersectTriangleBlock(const TriangleBlock &block,
+                                         int lanes, const TriangleBlockRay &r,
+                                         Float tMax, Float t[4]) {
+    const int k[3] = {r.kx, r.ky, r.kz};
+#ifdef PBRT_BVH_SSE
+    // Translate, permute and shear vertices into ray space
+    __m128 p[3][3];
+    for (int v = 0; v < 3; ++v) {
+        for (int a = 0; a < 3; ++a)
+            p[v][a] = _mm_sub_ps(_mm_load_ps(block.p[v][k[a]]),
+                                 _mm_set1_ps(r.o[k[a]]));
+        p[v][0] = _mm_add_ps(p[v][0], _mm_mul_ps(_mm_set1_ps(r.Sx), p[v][2]));
+        p[v][1] = _mm_add_ps(p[v][1], _mm_mul_ps(_mm_set1_ps(r.Sy), p[v][2]));
+    }
+
+    // Compute edge functions and their rounding error bounds
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 errScale = _mm_set1_ps(gamma(3));
+    __m128 e[3], err[3];
+    for (int i = 0; i < 3; ++i) {
+        const __m128 *pa = p[(i + 1) % 3], *pb = p[(i + 2) % 3];
+        __m128 ab = _mm_mul_ps(pa[0], pb[1]), ba = _mm_mul_ps(pa[1], pb[0]);
+        e[i] = _mm_sub_ps(ab, ba);
+        err[i] = _mm_mul_ps(errScale, _mm_add_ps(_mm_and_ps(ab, absMask),
+                                                 _mm_and_ps(ba, absMask)));
+    }
+    __m128 zero = _mm_setzero_ps();
+    __m128 nonNegative = _mm_and_ps(
+        _mm_cmpge_ps(_mm_add_ps(e[0], err[0]), zero),
+        _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(e[1], err[1]), zero),
+                   _mm_cmpge_ps(_mm_add_ps(e[2], err[2]), zero)));
+    __m128 nonPositive = _mm_and_ps(
+        _mm_cmple_ps(_mm_sub_ps(e[0], err[0]), zero),
+        _mm_and_ps(_mm_cmple_ps(_mm_sub_ps(e[1], err[1]), zero),
+                   _mm_cmple_ps(_mm_sub_ps(e[2], err[2]), zero)));
+
+    // Compute hit distances and test them against the ray's range
+    __m128 det = _mm_add_ps(_mm_add_ps(e[0], e[1]), e[2]);
+    __m128 Sz = _mm_set1_ps(r.Sz);
+    __m128 tScaled = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(e[0], _mm_mul_ps(p[0][2], Sz)),
+                   _mm_mul_ps(e[1], _mm_mul_ps(p[1][2], Sz))),
+        _mm_mul_ps(e[2], _mm_mul_ps(p[2][2], Sz)));
+    __m128 tHit = _mm_div_ps(tScaled, det);
+    __m128 inRange = _mm_and_ps(
+        _mm_cmpgt_ps(tHit, zero),
+        _mm_cmple_ps(tHit, _mm_set1_ps(tMax * triangleBlockTMaxSlack)));
+    _mm_storeu_ps(t, tHit);
+    return _mm_movemask_ps(
+               _mm_and_ps(_mm_or_ps(nonNegative, nonPositive), inRange)) &
+           lanes;
+#else
+    int mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (!(lanes & (1 << i))) continue;
+        Vector3f p[3];
+        for (int v = 0; v < 3; ++v) {
+            for (int a = 0; a < 3; ++a)
+                p[v][a] = block.p[v][k[a]][i] - r.o[k[a]];
+            p[v].x += r.Sx * p[v].z;
+            p[v].y += r.Sy * p[v].z;
+        }
+        Float e[3], err[3];
+        for (int j = 0; j < 3; ++j) {
+            const Vector3f &pa = p[(j + 1) % 3], &pb = p[(j + 2) % 3];
+            Float ab = pa.x * pb.y, ba = pa.y * pb.x;
+            e[j] = ab - ba;
+            err[j] = gamma(3) * (std::abs(ab) + std::abs(ba));
+        }
+        bool nonNegative = e[0] + err[0] >= 0 && e[1] + err[1] >= 0 &&
+                           e[2] + err[2] >= 0;
+        bool nonPositive = e[0] - err[0] <= 0 && e[1] - err[1] <= 0 &&
+                           e[2] - err[2] <= 0;
+        Float det = e[0] + e[1] + e[2];
+        Float tScaled = e[0] * (p[0].z * r.Sz) + e[1] * (p[1].z * r.Sz) +
+                        e[2] * (p[2].z * r.Sz);
+        t[i] = tScaled / det;
+        if ((nonNegative || nonPositive) && t[i] > 0 &&
+            t[i] <= tMax * triangleBlockTMaxSlack)
+            mask |= 1 << i;
+    }
+    return mask;
+#endif  // PBRT_BVH_SSE
+}
+
 // BVHAccel Utility Functions
 inline uint32_t LeftShift3(uint32_t x) {
     CHECK_LE(x, (1 << 10));
@@ -181,10 +390,14 @@ static void RadixSort(std::vector<MortonPrimitive> *v) {
 
 // BVHAccel Method Definitions
 BVHAccel::BVHAccel(const std::vector<std::shared_ptr<Primitive>> &p,
-                   int maxPrimsInNode, SplitMethod splitMethod)
+                   int maxPrimsInNode, SplitMethod splitMethod, int width,
+                   Float maxDuplication)
     : maxPrimsInNode(std::min(255, maxPrimsInNode)),
       splitMethod(splitMethod),
+      width(width),
+      maxDuplication(maxDuplication),
       primitives(p) {
+    CHECK(width == 2 || width == 4 || width == 8);
     ProfilePhase _(Prof::AccelConstruction);
     if (primitives.empty()) return;
     // Build BVH from _primitives_
@@ -194,81 +407,709 @@ BVHAccel::BVHAccel(const std::vector<std::shared_ptr<Primitive>> &p,
     for (size_t i = 0; i < primitives.size(); ++i)
         primitiveInfo[i] = {i, primitives[i]->WorldBound()};
 
-    // Build BVH tree for primitives using _primitiveInfo_
-    MemoryArena arena(1024 * 1024);
+    // Reuse a cached tree built for primitives with the same bounds.  Spatial
+    // splits also depend on the primitives' exact geometry, so SBVH builds
+    // aren't cached.
+    uint64_t cacheKey = 0;
+    bool useCache =
+        AccelCacheFile::Enabled() && splitMethod != SplitMethod::SBVH;
+    if (useCache) {
+        AccelCacheKey key("bvh");
+        key.Add(sizeof(Float));
+        key.Add(sizeof(LinearBVHNode));
+        key.Add(this->maxPrimsInNode);
+        key.Add(splitMethod);
+        key.Add(width);
+        key.Add(primitives.size());
+        for (const BVHPrimitiveInfo &info : primitiveInfo) {
+            key.Add(info.bounds);
+            bounds = Union(bounds, info.bounds);
+        }
+        cacheKey = key.Value();
+        if (loadCache(cacheKey)) return;
+    }
+
+    // Build BVH tree for primitives using _primitiveInfo_; each thread
+    // allocates build nodes from its own arena
+    std::unique_ptr<MemoryArena[]> arenas(new MemoryArena[MaxThreadIndex()]);
     int totalNodes = 0;
     std::vector<std::shared_ptr<Primitive>> orderedPrims;
-    orderedPrims.reserve(primitives.size());
     BVHBuildNode *root;
     if (splitMethod == SplitMethod::HLBVH)
-        root = HLBVHBuild(arena, primitiveInfo, &totalNodes, orderedPrims);
+        root = HLBVHBuild(arenas[ThreadIndex], primitiveInfo, &totalNodes,
+                          orderedPrims);
+    else if (splitMethod == SplitMethod::SBVH) {
+        // Build spatial split BVH from references to the primitives; up to
+        // _maxDuplication_ times as many extra references may be created
+        std::vector<BVHReference> refs(primitives.size());
+        Bounds3f rootBounds;
+        for (size_t i = 0; i < primitives.size(); ++i) {
+            refs[i] = {(int)i, primitiveInfo[i].bounds};
+            rootBounds = Union(rootBounds, primitiveInfo[i].bounds);
+        }
+        std::vector<BVHPrimitiveInfo>().swap(primitiveInfo);
+        int duplicationBudget = maxDuplication * primitives.size();
+        root = sbvhBuild(arenas[ThreadIndex], refs, rootBounds.SurfaceArea(),
+                         0, &totalNodes, &duplicationBudget, orderedPrims);
+    } else {
+        std::atomic<int> atomicTotal(0);
+        orderedPrims.resize(primitives.size());
+        root = parallelBuild(arenas.get(), primitiveInfo, &atomicTotal,
+                             orderedPrims);
+        totalNodes = atomicTotal;
+    }
+    primitives.swap(orderedPrims);
+    bounds = root->bounds;
+
+    // Report SAH cost and child overlap of the tree
+    if (bounds.SurfaceArea() > 0) {
+        double sahCost = 0, overlapArea = 0;
+        ComputeTreeCost(root, bounds.SurfaceArea(), &sahCost, &overlapArea);
+        ReportValue(treeSAHCost, sahCost);
+        ReportValue(treeOverlapArea, overlapArea);
+    }
+
+    // Collapse the binary tree into wide nodes, if requested
+    if (width == 4)
+        flattenWideBVHTree<4>(root);
+    else if (width == 8)
+        flattenWideBVHTree<8>(root);
+    else {
+        LOG(INFO) << StringPrintf("BVH created with %d nodes for %d "
+                                  "primitives (%.2f MB)", totalNodes,
+                                  (int)primitives.size(),
+                                  float(totalNodes * sizeof(LinearBVHNode)) /
+                                  (1024.f * 1024.f));
+
+        // Compute representation of depth-first traversal of BVH tree
+        treeBytes += totalNodes * sizeof(LinearBVHNode) + sizeof(*this) +
+                     primitives.size() * sizeof(primitives[0]);
+        nodes = AllocAligned<LinearBVHNode>(totalNodes);
+        nNodes = totalNodes;
+        int offset = 0;
+        flattenBVHTree(root, &offset);
+        CHECK_EQ(totalNodes, offset);
+    }
+    if (useCache) writeCache(cacheKey, p);
+    packTriangleLeaves();
+}
+
+// Checks that all child and primitive offsets of cached nodes are in range
+// and that children follow their parents, so traversal always terminates
+static bool ValidateNodes(const LinearBVHNode *nodes, int nNodes,
+                          int nPrimitives) {
+    for (int i = 0; i < nNodes; ++i) {
+        const LinearBVHNode &node = nodes[i];
+        if (node.nPrimitives > 0) {
+            if (node.primitivesOffset < 0 ||
+                node.primitivesOffset > nPrimitives - node.nPrimitives)
+                return false;
+        } else if (node.axis > 2 || i + 1 >= nNodes ||
+                   node.secondChildOffset <= i ||
+                   node.secondChildOffset >= nNodes)
+            return false;
+    }
+    return true;
+}
+
+template <int Width>
+static bool ValidateNodes(const WideBVHNode<Width> *nodes, int nNodes,
+                          int nPrimitives) {
+    for (int i = 0; i < nNodes; ++i) {
+        const WideBVHNode<Width> &node = nodes[i];
+        if (node.nChildren > Width) return false;
+        for (int c = 0; c < node.nChildren; ++c) {
+            int offset = node.childOffset[c];
+            if (node.nPrimitives[c] > 0) {
+                if (offset < 0 || offset > nPrimitives - node.nPrimitives[c])
+                    return false;
+            } else if (offset <= i || offset >= nNodes)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool BVHAccel::loadCache(uint64_t key) {
+    std::unique_ptr<AccelCacheFile> file = AccelCacheFile::Open("bvh", key);
+    if (!file || file->NumSections() != 2) return false;
+
+    // Reorder primitives as they were when the tree was built
+    const AccelCacheSection &order = file->Section(1);
+    if (order.bytes % sizeof(int32_t) != 0) return false;
+    const int32_t *primIndices = (const int32_t *)order.data;
+    std::vector<std::shared_ptr<Primitive>> orderedPrims(order.bytes /
+                                                         sizeof(int32_t));
+    for (size_t i = 0; i < orderedPrims.size(); ++i) {
+        if (primIndices[i] < 0 || primIndices[i] >= (int)primitives.size())
+            return false;
+        orderedPrims[i] = primitives[primIndices[i]];
+    }
+
+    // Use the mapped nodes in place
+    const AccelCacheSection &nodeData = file->Section(0);
+    size_t nodeSize = width == 4 ? sizeof(WideBVHNode<4>)
+                      : width == 8 ? sizeof(WideBVHNode<8>)
+                                   : sizeof(LinearBVHNode);
+    if (nodeData.bytes % nodeSize != 0 || nodeData.bytes == 0) return false;
+    int n = nodeData.bytes / nodeSize;
+    bool valid =
+        width == 4
+            ? ValidateNodes((const WideBVHNode<4> *)nodeData.data, n,
+                            orderedPrims.size())
+            : width == 8 ? ValidateNodes((const WideBVHNode<8> *)nodeData.data,
+                                         n, orderedPrims.size())
+                         : ValidateNodes((const LinearBVHNode *)nodeData.data,
+                                         n, orderedPrims.size());
+    if (!valid) {
+        Warning("Ignoring inconsistent cached BVH.");
+        return false;
+    }
+    if (width == 2)
+        nodes = (LinearBVHNode *)nodeData.data;
     else
-        root = recursiveBuild(arena, primitiveInfo, 0, primitives.size(),
-                              &totalNodes, orderedPrims);
+        wideNodes = (void *)nodeData.data;
+    nNodes = n;
     primitives.swap(orderedPrims);
-    LOG(INFO) << StringPrintf("BVH created with %d nodes for %d "
-                              "primitives (%.2f MB)", totalNodes,
-                              (int)primitives.size(),
-                              float(totalNodes * sizeof(LinearBVHNode)) /
-                              (1024.f * 1024.f));
+    cacheFile = std::move(file);
+    treeBytes += sizeof(*this) + primitives.size() * sizeof(primitives[0]);
+    // Triangle blocks hold the primitives' exact vertices, which the cache
+    // key doesn't cover, so they are always rebuilt
+    packTriangleLeaves();
+    return true;
+}
 
-    // Compute representation of depth-first traversal of BVH tree
-    treeBytes += totalNodes * sizeof(LinearBVHNode) + sizeof(*this) +
-                 primitives.size() * sizeof(primitives[0]);
-    nodes = AllocAligned<LinearBVHNode>(totalNodes);
-    int offset = 0;
-    flattenBVHTree(root, &offset);
-    CHECK_EQ(totalNodes, offset);
+void BVHAccel::writeCache(
+    uint64_t key,
+    const std::vector<std::shared_ptr<Primitive>> &unorderedPrims) const {
+    // Store the ordered primitives as indices into _unorderedPrims_
+    std::unordered_map<const Primitive *, int32_t> primIndex;
+    for (size_t i = 0; i < unorderedPrims.size(); ++i)
+        primIndex[unorderedPrims[i].get()] = i;
+    std::vector<int32_t> primIndices(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+        primIndices[i] = primIndex[primitives[i].get()];
+
+    size_t nodeSize = width == 4 ? sizeof(WideBVHNode<4>)
+                      : width == 8 ? sizeof(WideBVHNode<8>)
+                                   : sizeof(LinearBVHNode);
+    const void *nodeData = width == 2 ? (const void *)nodes : wideNodes;
+    AccelCacheFile::Write(
+        "bvh", key, {{nodeData, nNodes * nodeSize},
+                     {primIndices.data(), primIndices.size() * sizeof(int32_t)}});
 }
 
-Bounds3f BVHAccel::WorldBound() const {
-    return nodes ? nodes[0].bounds : Bounds3f();
+Bounds3f BVHAccel::WorldBound() const { return bounds; }
+
+// Returns the triangle shape of _prim_ if BVH leaves may store it as an
+// index into the triangle's mesh, with _prim_ completing its hits
+static const Triangle *CompactTriangle(const Primitive *prim) {
+    const GeometricPrimitive *geomPrim =
+        dynamic_cast<const GeometricPrimitive *>(prim);
+    if (!geomPrim || geomPrim->GetAreaLight()) return nullptr;
+    return dynamic_cast<const Triangle *>(geomPrim->GetShape());
 }
 
+void BVHAccel::packTriangleLeaves() {
+    if (std::none_of(primitives.begin(), primitives.end(),
+                     [](const std::shared_ptr<Primitive> &prim) {
+                         return CompactTriangle(prim.get()) != nullptr;
+                     }))
+        return;
+
+    // Copy nodes mapped from the cache, as the leaves' offsets change
+    if (cacheFile) {
+        if (width == 4) {
+            WideBVHNode<4> *copy = AllocAligned<WideBVHNode<4>>(nNodes);
+            memcpy(copy, wideNodes, nNodes * sizeof(WideBVHNode<4>));
+            wideNodes = copy;
+        } else if (width == 8) {
+            WideBVHNode<8> *copy = AllocAligned<WideBVHNode<8>>(nNodes);
+            memcpy(copy, wideNodes, nNodes * sizeof(WideBVHNode<8>));
+            wideNodes = copy;
+        } else {
+            LinearBVHNode *copy = AllocAligned<LinearBVHNode>(nNodes);
+            memcpy(copy, nodes, nNodes * sizeof(LinearBVHNode));
+            nodes = copy;
+        }
+        cacheFile.reset();
+        treeBytes += nNodes * (width == 4 ? sizeof(WideBVHNode<4>)
+                               : width == 8 ? sizeof(WideBVHNode<8>)
+                                            : sizeof(LinearBVHNode));
+    }
+
+    // Find the primitive offsets of the tree's leaves
+    std::vector<std::pair<int *, int>> leaves;
+    if (nodes) {
+        for (int i = 0; i < nNodes; ++i)
+            if (nodes[i].nPrimitives > 0)
+                leaves.push_back({&nodes[i].primitivesOffset,
+                                  nodes[i].nPrimitives});
+    } else if (wideNodes) {
+        for (int i = 0; i < nNodes; ++i) {
+            int *childOffset;
+            const uint16_t *nPrims;
+            int nChildren;
+            if (width == 4) {
+                WideBVHNode<4> &node = ((WideBVHNode<4> *)wideNodes)[i];
+                childOffset = node.childOffset;
+                nPrims = node.nPrimitives;
+                nChildren = node.nChildren;
+            } else {
+                WideBVHNode<8> &node = ((WideBVHNode<8> *)wideNodes)[i];
+                childOffset = node.childOffset;
+                nPrims = node.nPrimitives;
+                nChildren = node.nChildren;
+            }
+            for (int c = 0; c < nChildren; ++c)
+                if (nPrims[c] > 0)
+                    leaves.push_back({&childOffset[c], nPrims[c]});
+        }
+    }
+
+    // Find the first triangle of each leaf that only holds compact
+    // triangles, or -1 for leaves that keep their primitives; leaves with up
+    // to four triangles don't straddle blocks
+    std::vector<int> leafFirstTriangle(leaves.size(), -1);
+    int nTriangles = 0, nKept = 0;
+    for (size_t l = 0; l < leaves.size(); ++l) {
+        int offset = *leaves[l].first, nPrims = leaves[l].second;
+        bool allTriangles = true;
+        for (int i = 0; i < nPrims && allTriangles; ++i)
+            allTriangles = CompactTriangle(primitives[offset + i].get());
+        if (!allTriangles) {
+            nKept += nPrims;
+            continue;
+        }
+        if (nPrims <= 4 && nTriangles % 4 + nPrims > 4)
+            nTriangles = (nTriangles + 3) & ~3;
+        leafFirstTriangle[l] = nTriangles;
+        nTriangles += nPrims;
+    }
+
+    // Pack the triangles into blocks and keep the other leaves' primitives.
+    // The triangles of a mesh that share a material, medium interface and
+    // orientation share a block primitive.
+    nTriBlocks = (nTriangles + 3) / 4;
+    triBlocks = AllocAligned<TriangleBlock>(nTriBlocks);
+    std::fill(triBlocks, triBlocks + nTriBlocks, TriangleBlock());
+    std::vector<std::shared_ptr<Primitive>> keptPrims;
+    keptPrims.reserve(nKept);
+    typedef std::tuple<const TriangleMesh *, const Material *, const Medium *,
+                       const Medium *, bool>
+        BlockPrimitiveKey;
+    std::map<BlockPrimitiveKey, int> blockPrimIndex;
+    for (size_t l = 0; l < leaves.size(); ++l) {
+        int offset = *leaves[l].first, nPrims = leaves[l].second;
+        if (leafFirstTriangle[l] == -1) {
+            *leaves[l].first = keptPrims.size();
+            keptPrims.insert(keptPrims.end(), primitives.begin() + offset,
+                             primitives.begin() + offset + nPrims);
+            continue;
+        }
+        *leaves[l].first = -1 - leafFirstTriangle[l];
+        for (int i = 0; i < nPrims; ++i) {
+            int triangle = leafFirstTriangle[l] + i, lane = triangle % 4;
+            TriangleBlock &block = triBlocks[triangle / 4];
+            const std::shared_ptr<Primitive> &prim = primitives[offset + i];
+            const GeometricPrimitive *geomPrim =
+                (const GeometricPrimitive *)prim.get();
+            const Triangle *tri = (const Triangle *)geomPrim->GetShape();
+            Point3f p[3];
+            tri->GetTriangleVertices(p);
+            for (int v = 0; v < 3; ++v)
+                for (int a = 0; a < 3; ++a) block.p[v][a][lane] = p[v][a];
+            block.triNumber[lane] = tri->GetTriangleNumber();
+            const MediumInterface &mi = geomPrim->GetMediumInterface();
+            BlockPrimitiveKey key(
+                tri->GetMesh(), geomPrim->GetMaterial(), mi.inside, mi.outside,
+                tri->reverseOrientation ^ tri->transformSwapsHandedness);
+            auto iter = blockPrimIndex.find(key);
+            if (iter == blockPrimIndex.end()) {
+                iter =
+                    blockPrimIndex.insert({key, blockPrimitives.size()}).first;
+                blockPrimitives.push_back(prim);
+            }
+            block.primitive[lane] = iter->second;
+        }
+    }
+    treeBytes -= (primitives.size() - keptPrims.size()) * sizeof(primitives[0]);
+    primitives.swap(keptPrims);
+    triangleBlockBytes += nTriBlocks * sizeof(TriangleBlock) +
+                          blockPrimitives.size() * sizeof(blockPrimitives[0]);
+}
+
+// Returns the mask of the triangles of _block_ that belong to the leaf with
+// the given range of triangles
+static inline int BlockLanes(int block, int firstTriangle, int endTriangle) {
+    int first = std::max(firstTriangle - 4 * block, 0);
+    int end = std::min(endTriangle - 4 * block, 4);
+    return ((1 << end) - 1) & ~((1 << first) - 1);
+}
+
+inline bool BVHAccel::intersectLeaf(int offset, int nPrimitives,
+                                    const TriangleBlockRay &triRay,
+                                    const Ray &ray,
+                                    SurfaceInteraction *isect) const {
+    bool hit = false;
+    if (offset >= 0) {
+        for (int i = 0; i < nPrimitives; ++i)
+            if (primitives[offset + i]->Intersect(ray, isect)) hit = true;
+        return hit;
+    }
+    int firstTriangle = -1 - offset, endTriangle = firstTriangle + nPrimitives;
+    for (int b = firstTriangle / 4; b <= (endTriangle - 1) / 4; ++b) {
+        const TriangleBlock &block = triBlocks[b];
+        Float t[4];
+        int mask = IntersectTriangleBlock(
+            block, BlockLanes(b, firstTriangle, endTriangle), triRay,
+            ray.tMax, t);
+        // Run the exact test for the candidates in the leaf's order, so that
+        // ties at shared edges resolve as for the triangles' primitives
+        for (int i = 0; i < 4; ++i) {
+            if (!(mask & (1 << i)) || t[i] > ray.tMax * triangleBlockTMaxSlack)
+                continue;
+            const GeometricPrimitive *prim =
+                (const GeometricPrimitive *)blockPrimitives[block.primitive[i]]
+                    .get();
+            const Triangle *tri = (const Triangle *)prim->GetShape();
+            Float tHit;
+            if (tri->IntersectMeshTriangle(block.triNumber[i], ray, &tHit,
+                                           isect)) {
+                prim->CompleteIntersection(ray, tHit, isect);
+                hit = true;
+            }
+        }
+    }
+    return hit;
+}
+
+inline bool BVHAccel::intersectPLeaf(int offset, int nPrimitives,
+                                     const TriangleBlockRay &triRay,
+                                     const Ray &ray) const {
+    if (offset >= 0) {
+        for (int i = 0; i < nPrimitives; ++i)
+            if (primitives[offset + i]->IntersectP(ray)) return true;
+        return false;
+    }
+    int firstTriangle = -1 - offset, endTriangle = firstTriangle + nPrimitives;
+    for (int b = firstTriangle / 4; b <= (endTriangle - 1) / 4; ++b) {
+        const TriangleBlock &block = triBlocks[b];
+        Float t[4];
+        int mask = IntersectTriangleBlock(
+            block, BlockLanes(b, firstTriangle, endTriangle), triRay,
+            ray.tMax, t);
+        for (int i = 0; i < 4; ++i) {
+            if (!(mask & (1 << i))) continue;
+            const GeometricPrimitive *prim =
+                (const GeometricPrimitive *)blockPrimitives[block.primitive[i]]
+                    .get();
+            const Triangle *tri = (const Triangle *)prim->GetShape();
+            if (tri->IntersectPMeshTriangle(block.triNumber[i], ray))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Refit BVHs whose SAH cost grows beyond this factor of the cost they had
+// when built are rejected
+static PBRT_CONSTEXPR Float maxRefitCostIncrease = 1.5f;
+
+std::shared_ptr<BVHAccel> BVHAccel::Refit(
+    const std::vector<std::shared_ptr<Primitive>> &oldPrims,
+    const std::vector<std::shared_ptr<Primitive>> &newPrims) const {
+    ProfilePhase _(Prof::AccelConstruction);
+    CHECK_EQ(oldPrims.size(), newPrims.size());
+    // Triangles stored in blocks can't be matched to their replacements
+    if (nTriBlocks > 0) return nullptr;
+    // Find the replacement of each of the tree's primitives
+    std::unordered_map<const Primitive *, int> primIndex;
+    for (size_t i = 0; i < oldPrims.size(); ++i)
+        primIndex[oldPrims[i].get()] = i;
+    std::vector<std::shared_ptr<Primitive>> orderedPrims(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        auto iter = primIndex.find(primitives[i].get());
+        CHECK(iter != primIndex.end());
+        orderedPrims[i] = newPrims[iter->second];
+    }
+
+    std::shared_ptr<BVHAccel> refit(
+        new BVHAccel(*this, std::move(orderedPrims)));
+    refit->refitBounds();
+    refit->packTriangleLeaves();
+    refit->builtCost = builtCost > 0 ? builtCost : treeCost();
+    if (refit->treeCost() > maxRefitCostIncrease * refit->builtCost) {
+        ++rejectedRefits;
+        return nullptr;
+    }
+    ++refitCount;
+    return refit;
+}
+
+BVHAccel::BVHAccel(const BVHAccel &topology,
+                   std::vector<std::shared_ptr<Primitive>> orderedPrims)
+    : maxPrimsInNode(topology.maxPrimsInNode),
+      splitMethod(topology.splitMethod),
+      width(topology.width),
+      maxDuplication(topology.maxDuplication),
+      primitives(std::move(orderedPrims)),
+      bounds(topology.bounds),
+      nNodes(topology.nNodes) {
+    // Copy the nodes of _topology_; their bounds are recomputed by the caller
+    if (topology.nodes) {
+        nodes = AllocAligned<LinearBVHNode>(nNodes);
+        memcpy(nodes, topology.nodes, nNodes * sizeof(LinearBVHNode));
+    } else if (width == 4 && topology.wideNodes) {
+        wideNodes = AllocAligned<WideBVHNode<4>>(nNodes);
+        memcpy(wideNodes, topology.wideNodes, nNodes * sizeof(WideBVHNode<4>));
+    } else if (width == 8 && topology.wideNodes) {
+        wideNodes = AllocAligned<WideBVHNode<8>>(nNodes);
+        memcpy(wideNodes, topology.wideNodes, nNodes * sizeof(WideBVHNode<8>));
+    }
+    treeBytes += nNodes * (width == 4 ? sizeof(WideBVHNode<4>)
+                           : width == 8 ? sizeof(WideBVHNode<8>)
+                                        : sizeof(LinearBVHNode)) +
+                 sizeof(*this) + primitives.size() * sizeof(primitives[0]);
+}
+
+size_t BVHAccel::MemoryBytes() const {
+    size_t nodeBytes = width == 4 ? sizeof(WideBVHNode<4>)
+                       : width == 8 ? sizeof(WideBVHNode<8>)
+                                    : sizeof(LinearBVHNode);
+    return sizeof(*this) + nNodes * nodeBytes +
+           primitives.capacity() * sizeof(primitives[0]) +
+           nTriBlocks * sizeof(TriangleBlock) +
+           blockPrimitives.capacity() * sizeof(blockPrimitives[0]);
+}
+
+void BVHAccel::refitBounds() {
+    if (width == 4) {
+        refitWideBounds<4>();
+        return;
+    } else if (width == 8) {
+        refitWideBounds<8>();
+        return;
+    }
+    if (!nodes) return;
+    // Children always follow their parents, so sweeping the nodes backwards
+    // updates them before the nodes that contain them
+    for (int i = nNodes - 1; i >= 0; --i) {
+        LinearBVHNode &node = nodes[i];
+        if (node.nPrimitives > 0) {
+            node.bounds = Bounds3f();
+            for (int j = 0; j < node.nPrimitives; ++j)
+                node.bounds =
+                    Union(node.bounds,
+                          primitives[node.primitivesOffset + j]->WorldBound());
+        } else
+            node.bounds =
+                Union(nodes[i + 1].bounds, nodes[node.secondChildOffset].bounds);
+    }
+    bounds = nodes[0].bounds;
+}
+
+template <int Width>
+void BVHAccel::refitWideBounds() {
+    if (!wideNodes) return;
+    WideBVHNode<Width> *wide = (WideBVHNode<Width> *)wideNodes;
+    std::vector<Bounds3f> nodeBounds(nNodes);
+    for (int i = nNodes - 1; i >= 0; --i) {
+        WideBVHNode<Width> &node = wide[i];
+        for (int c = 0; c < node.nChildren; ++c) {
+            Bounds3f b;
+            if (node.nPrimitives[c] > 0) {
+                for (int j = 0; j < node.nPrimitives[c]; ++j)
+                    b = Union(b, primitives[node.childOffset[c] + j]
+                                     ->WorldBound());
+            } else
+                b = nodeBounds[node.childOffset[c]];
+            for (int axis = 0; axis < 3; ++axis) {
+                node.bounds[0][axis][c] = b.pMin[axis];
+                node.bounds[1][axis][c] = b.pMax[axis];
+            }
+            nodeBounds[i] = Union(nodeBounds[i], b);
+        }
+    }
+    bounds = nodeBounds[0];
+}
+
+// Returns the SAH cost of the flattened tree relative to the surface area of
+// its bounds
+Float BVHAccel::treeCost() const {
+    Float rootArea = bounds.SurfaceArea();
+    if (rootArea == 0) return 0;
+    double cost = 0;
+    if (nodes) {
+        for (int i = 0; i < nNodes; ++i)
+            cost += nodes[i].bounds.SurfaceArea() *
+                    std::max<int>(1, nodes[i].nPrimitives);
+    } else if (wideNodes) {
+        // Wide nodes store the bounds of their children
+        auto childBounds = [](const Float *b, int c, int width) {
+            return Bounds3f(Point3f(b[c], b[width + c], b[2 * width + c]),
+                            Point3f(b[3 * width + c], b[4 * width + c],
+                                    b[5 * width + c]));
+        };
+        for (int i = 0; i < nNodes; ++i) {
+            const Float *b;
+            const uint16_t *nPrims;
+            int nChildren;
+            if (width == 4) {
+                const WideBVHNode<4> &node = ((WideBVHNode<4> *)wideNodes)[i];
+                b = &node.bounds[0][0][0];
+                nPrims = node.nPrimitives;
+                nChildren = node.nChildren;
+            } else {
+                const WideBVHNode<8> &node = ((WideBVHNode<8> *)wideNodes)[i];
+                b = &node.bounds[0][0][0];
+                nPrims = node.nPrimitives;
+                nChildren = node.nChildren;
+            }
+            Bounds3f nodeBounds;
+            for (int c = 0; c < nChildren; ++c) {
+                Bounds3f cb = childBounds(b, c, width);
+                nodeBounds = Union(nodeBounds, cb);
+                if (nPrims[c] > 0) cost += cb.SurfaceArea() * nPrims[c];
+            }
+            cost += nodeBounds.SurfaceArea();
+        }
+    }
+    return cost / rootArea;
+}
+
+
 struct BucketInfo {
     int count = 0;
     Bounds3f bounds;
 };
 
-BVHBuildNode *BVHAccel::recursiveBuild(
-    MemoryArena &arena, std::vector<BVHPrimitiveInfo> &primitiveInfo, int start,
-    int end, int *totalNodes,
-    std::vector<std::shared_ptr<Primitive>> &orderedPrims) {
+// Nodes with at least this many primitives are split one level at a time,
+// in parallel with the other nodes of their level; smaller ones are the
+// roots of subtrees that are built serially, in parallel with each other
+static PBRT_CONSTEXPR int parallelBuildThreshold = 4096;
+// Nodes with at least this many primitives compute their bounds, SAH
+// buckets and partition in parallel, in chunks of _parallelChunkSize_
+static PBRT_CONSTEXPR int parallelBinningThreshold = 128 * 1024;
+static PBRT_CONSTEXPR int parallelChunkSize = 16 * 1024;
+
+// Partitions _primitiveInfo[start, end)_ so that the elements satisfying
+// _pred_ come first and returns the index of the first one that does not.
+// Large ranges use a stable chunked partition so that the resulting order
+// does not depend on the number of threads.
+template <typename Predicate>
+static int PartitionPrimitiveInfo(std::vector<BVHPrimitiveInfo> &primitiveInfo,
+                                  int start, int end, Predicate pred) {
+    int nPrimitives = end - start;
+    if (nPrimitives < parallelBinningThreshold) {
+        BVHPrimitiveInfo *pmid = std::partition(
+            &primitiveInfo[start], &primitiveInfo[end - 1] + 1, pred);
+        return pmid - &primitiveInfo[0];
+    }
+
+    // Count the elements satisfying _pred_ in each chunk
+    int nChunks = (nPrimitives + parallelChunkSize - 1) / parallelChunkSize;
+    std::vector<int> chunkCount(nChunks);
+    ParallelFor([&](int64_t c) {
+        int chunkStart = start + c * parallelChunkSize;
+        int chunkEnd = std::min(chunkStart + parallelChunkSize, end);
+        int count = 0;
+        for (int i = chunkStart; i < chunkEnd; ++i)
+            if (pred(primitiveInfo[i])) ++count;
+        chunkCount[c] = count;
+    }, nChunks, 1);
+
+    // Compute where each chunk's elements go on both sides of the split
+    std::vector<int> firstOffset(nChunks), secondOffset(nChunks);
+    int nFirst = 0;
+    for (int c = 0; c < nChunks; ++c) {
+        firstOffset[c] = nFirst;
+        nFirst += chunkCount[c];
+    }
+    for (int c = 0, nSecond = 0; c < nChunks; ++c) {
+        secondOffset[c] = nFirst + nSecond;
+        nSecond += std::min(parallelChunkSize,
+                            nPrimitives - c * parallelChunkSize) -
+                   chunkCount[c];
+    }
+
+    // Scatter elements to a temporary array and copy them back
+    std::vector<BVHPrimitiveInfo> scratch(nPrimitives);
+    ParallelFor([&](int64_t c) {
+        int chunkStart = start + c * parallelChunkSize;
+        int chunkEnd = std::min(chunkStart + parallelChunkSize, end);
+        int first = firstOffset[c], second = secondOffset[c];
+        for (int i = chunkStart; i < chunkEnd; ++i) {
+            if (pred(primitiveInfo[i]))
+                scratch[first++] = primitiveInfo[i];
+            else
+                scratch[second++] = primitiveInfo[i];
+        }
+    }, nChunks, 1);
+    ParallelFor([&](int64_t c) {
+        int chunkStart = c * parallelChunkSize;
+        int chunkEnd = std::min(chunkStart + parallelChunkSize, nPrimitives);
+        std::copy(&scratch[chunkStart], &scratch[chunkEnd - 1] + 1,
+                  &primitiveInfo[start + chunkStart]);
+    }, nChunks, 1);
+    return start + nFirst;
+}
+
+// Computes the bounds of _primitiveInfo[start, end)_ and either makes _node_
+// a leaf and returns false, or partitions the range at _*splitMid_ along
+// _*splitDim_ and returns true; the caller initializes the interior node
+bool BVHAccel::splitNode(
+    BVHBuildNode *node, std::vector<BVHPrimitiveInfo> &primitiveInfo,
+    int start, int end, int *splitDim, int *splitMid,
+    std::vector<std::shared_ptr<Primitive>> &orderedPrims) const {
     CHECK_NE(start, end);
-    BVHBuildNode *node = arena.Alloc<BVHBuildNode>();
-    (*totalNodes)++;
-    // Compute bounds of all primitives in BVH node
-    Bounds3f bounds;
-    for (int i = start; i < end; ++i)
-        bounds = Union(bounds, primitiveInfo[i].bounds);
     int nPrimitives = end - start;
-    if (nPrimitives == 1) {
-        // Create leaf _BVHBuildNode_
-        int firstPrimOffset = orderedPrims.size();
+
+    // Compute bounds of all primitives and of their centroids in BVH node
+    Bounds3f bounds, centroidBounds;
+    if (nPrimitives < parallelBinningThreshold) {
         for (int i = start; i < end; ++i) {
-            int primNum = primitiveInfo[i].primitiveNumber;
-            orderedPrims.push_back(primitives[primNum]);
+            bounds = Union(bounds, primitiveInfo[i].bounds);
+            centroidBounds = Union(centroidBounds, primitiveInfo[i].centroid);
         }
-        node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-        return node;
     } else {
-        // Compute bound of primitive centroids, choose split dimension _dim_
-        Bounds3f centroidBounds;
+        int nChunks = (nPrimitives + parallelChunkSize - 1) / parallelChunkSize;
+        std::vector<Bounds3f> chunkBounds(nChunks), chunkCentroidBounds(nChunks);
+        ParallelFor([&](int64_t c) {
+            int chunkStart = start + c * parallelChunkSize;
+            int chunkEnd = std::min(chunkStart + parallelChunkSize, end);
+            for (int i = chunkStart; i < chunkEnd; ++i) {
+                chunkBounds[c] = Union(chunkBounds[c], primitiveInfo[i].bounds);
+                chunkCentroidBounds[c] =
+                    Union(chunkCentroidBounds[c], primitiveInfo[i].centroid);
+            }
+        }, nChunks, 1);
+        for (int c = 0; c < nChunks; ++c) {
+            bounds = Union(bounds, chunkBounds[c]);
+            centroidBounds = Union(centroidBounds, chunkCentroidBounds[c]);
+        }
+    }
+
+    // Leaves reference _orderedPrims[start, end)_, which keeps the
+    // primitive order of the sequential depth-first build
+    if (nPrimitives == 1) {
+        // Create leaf _BVHBuildNode_
         for (int i = start; i < end; ++i)
-            centroidBounds = Union(centroidBounds, primitiveInfo[i].centroid);
+            orderedPrims[i] = primitives[primitiveInfo[i].primitiveNumber];
+        node->InitLeaf(start, nPrimitives, bounds);
+        return false;
+    } else {
+        // Choose split dimension _dim_
         int dim = centroidBounds.MaximumExtent();
 
         // Partition primitives into two sets and build children
         int mid = (start + end) / 2;
         if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) {
             // Create leaf _BVHBuildNode_
-            int firstPrimOffset = orderedPrims.size();
-            for (int i = start; i < end; ++i) {
-                int primNum = primitiveInfo[i].primitiveNumber;
-                orderedPrims.push_back(primitives[primNum]);
-            }
-            node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-            return node;
+            for (int i = start; i < end; ++i)
+                orderedPrims[i] = primitives[primitiveInfo[i].primitiveNumber];
+            node->InitLeaf(start, nPrimitives, bounds);
+            return false;
         } else {
             // Partition primitives based on _splitMethod_
             switch (splitMethod) {
@@ -276,12 +1117,11 @@ BVHBuildNode *BVHAccel::recursiveBuild(
                 // Partition primitives through node's midpoint
                 Float pmid =
                     (centroidBounds.pMin[dim] + centroidBounds.pMax[dim]) / 2;
-                BVHPrimitiveInfo *midPtr = std::partition(
-                    &primitiveInfo[start], &primitiveInfo[end - 1] + 1,
+                mid = PartitionPrimitiveInfo(
+                    primitiveInfo, start, end,
                     [dim, pmid](const BVHPrimitiveInfo &pi) {
                         return pi.centroid[dim] < pmid;
                     });
-                mid = midPtr - &primitiveInfo[0];
                 // For lots of prims with large overlapping bounding boxes, this
                 // may fail to partition; in that case don't break and fall
                 // through
@@ -316,18 +1156,48 @@ BVHBuildNode *BVHAccel::recursiveBuild(
                     // Allocate _BucketInfo_ for SAH partition buckets
                     PBRT_CONSTEXPR int nBuckets = 12;
                     BucketInfo buckets[nBuckets];
-
-                    // Initialize _BucketInfo_ for SAH partition buckets
-                    for (int i = start; i < end; ++i) {
-                        int b = nBuckets *
-                                centroidBounds.Offset(
-                                    primitiveInfo[i].centroid)[dim];
+                    auto bucketIndex = [&](const Point3f &centroid) {
+                        int b = nBuckets * centroidBounds.Offset(centroid)[dim];
                         if (b == nBuckets) b = nBuckets - 1;
                         CHECK_GE(b, 0);
                         CHECK_LT(b, nBuckets);
-                        buckets[b].count++;
-                        buckets[b].bounds =
-                            Union(buckets[b].bounds, primitiveInfo[i].bounds);
+                        return b;
+                    };
+
+                    // Initialize _BucketInfo_ for SAH partition buckets
+                    if (nPrimitives < parallelBinningThreshold) {
+                        for (int i = start; i < end; ++i) {
+                            int b = bucketIndex(primitiveInfo[i].centroid);
+                            buckets[b].count++;
+                            buckets[b].bounds = Union(buckets[b].bounds,
+                                                      primitiveInfo[i].bounds);
+                        }
+                    } else {
+                        // Bin chunks of primitives in parallel and merge
+                        // their buckets
+                        int nChunks = (nPrimitives + parallelChunkSize - 1) /
+                                      parallelChunkSize;
+                        std::vector<BucketInfo> chunkBuckets(nChunks * nBuckets);
+                        ParallelFor([&](int64_t c) {
+                            BucketInfo *cb = &chunkBuckets[c * nBuckets];
+                            int chunkStart = start + c * parallelChunkSize;
+                            int chunkEnd =
+                                std::min(chunkStart + parallelChunkSize, end);
+                            for (int i = chunkStart; i < chunkEnd; ++i) {
+                                int b = bucketIndex(primitiveInfo[i].centroid);
+                                cb[b].count++;
+                                cb[b].bounds =
+                                    Union(cb[b].bounds, primitiveInfo[i].bounds);
+                            }
+                        }, nChunks, 1);
+                        for (int c = 0; c < nChunks; ++c)
+                            for (int b = 0; b < nBuckets; ++b) {
+                                const BucketInfo &cb =
+                                    chunkBuckets[c * nBuckets + b];
+                                buckets[b].count += cb.count;
+                                buckets[b].bounds =
+                                    Union(buckets[b].bounds, cb.bounds);
+                            }
                     }
 
                     // Compute costs for splitting after each bucket
@@ -363,38 +1233,382 @@ BVHBuildNode *BVHAccel::recursiveBuild(
                     // bucket
                     Float leafCost = nPrimitives;
                     if (nPrimitives > maxPrimsInNode || minCost < leafCost) {
-                        BVHPrimitiveInfo *pmid = std::partition(
-                            &primitiveInfo[start], &primitiveInfo[end - 1] + 1,
-                            [=](const BVHPrimitiveInfo &pi) {
-                                int b = nBuckets *
-                                        centroidBounds.Offset(pi.centroid)[dim];
-                                if (b == nBuckets) b = nBuckets - 1;
-                                CHECK_GE(b, 0);
-                                CHECK_LT(b, nBuckets);
-                                return b <= minCostSplitBucket;
+                        mid = PartitionPrimitiveInfo(
+                            primitiveInfo, start, end,
+                            [&](const BVHPrimitiveInfo &pi) {
+                                return bucketIndex(pi.centroid) <=
+                                       minCostSplitBucket;
                             });
-                        mid = pmid - &primitiveInfo[0];
                     } else {
                         // Create leaf _BVHBuildNode_
-                        int firstPrimOffset = orderedPrims.size();
-                        for (int i = start; i < end; ++i) {
-                            int primNum = primitiveInfo[i].primitiveNumber;
-                            orderedPrims.push_back(primitives[primNum]);
-                        }
-                        node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-                        return node;
+                        for (int i = start; i < end; ++i)
+                            orderedPrims[i] =
+                                primitives[primitiveInfo[i].primitiveNumber];
+                        node->InitLeaf(start, nPrimitives, bounds);
+                        return false;
                     }
                 }
                 break;
             }
             }
-            node->InitInterior(dim,
-                               recursiveBuild(arena, primitiveInfo, start, mid,
-                                              totalNodes, orderedPrims),
-                               recursiveBuild(arena, primitiveInfo, mid, end,
-                                              totalNodes, orderedPrims));
+
+            *splitDim = dim;
+            *splitMid = mid;
+            return true;
         }
     }
+}
+
+BVHBuildNode *BVHAccel::recursiveBuild(
+    MemoryArena &arena, std::vector<BVHPrimitiveInfo> &primitiveInfo,
+    int start, int end, std::atomic<int> *totalNodes,
+    std::vector<std::shared_ptr<Primitive>> &orderedPrims) const {
+    BVHBuildNode *node = arena.Alloc<BVHBuildNode>();
+    ++*totalNodes;
+    int dim, mid;
+    if (splitNode(node, primitiveInfo, start, end, &dim, &mid, orderedPrims)) {
+        BVHBuildNode *c0 = recursiveBuild(arena, primitiveInfo, start, mid,
+                                          totalNodes, orderedPrims);
+        BVHBuildNode *c1 = recursiveBuild(arena, primitiveInfo, mid, end,
+                                          totalNodes, orderedPrims);
+        node->InitInterior(dim, c0, c1);
+    }
+    return node;
+}
+
+BVHBuildNode *BVHAccel::parallelBuild(
+    MemoryArena *arenas, std::vector<BVHPrimitiveInfo> &primitiveInfo,
+    std::atomic<int> *totalNodes,
+    std::vector<std::shared_ptr<Primitive>> &orderedPrims) const {
+    // Split the nodes with at least _parallelBuildThreshold_ primitives
+    // level by level, all nodes of a level at once; the rest of the tree is
+    // built as independent subtrees.  Each build task writes its node
+    // through _node_.
+    struct BuildTask {
+        int start, end;
+        BVHBuildNode **node;
+    };
+    int nPrimitives = primitiveInfo.size();
+    if (nPrimitives < parallelBuildThreshold)
+        return recursiveBuild(arenas[ThreadIndex], primitiveInfo, 0,
+                              nPrimitives, totalNodes, orderedPrims);
+    BVHBuildNode *root = nullptr;
+    std::vector<BuildTask> level = {{0, nPrimitives, &root}}, subtrees;
+    std::vector<BVHBuildNode *> interiorNodes;
+    while (!level.empty()) {
+        int nTasks = level.size();
+        for (const BuildTask &task : level) {
+            *task.node = arenas[ThreadIndex].Alloc<BVHBuildNode>();
+            ++*totalNodes;
+        }
+
+        // Split the level's nodes; the largest ones bin and partition
+        // their primitives in parallel, one at a time, and the others are
+        // split in parallel with each other
+        std::vector<int> dims(nTasks), mids(nTasks);
+        std::unique_ptr<bool[]> split(new bool[nTasks]);
+        auto splitTask = [&](int64_t i) {
+            split[i] = splitNode(*level[i].node, primitiveInfo, level[i].start,
+                                 level[i].end, &dims[i], &mids[i],
+                                 orderedPrims);
+        };
+        for (int i = 0; i < nTasks; ++i)
+            if (level[i].end - level[i].start >= parallelBinningThreshold)
+                splitTask(i);
+        ParallelFor([&](int64_t i) {
+            if (level[i].end - level[i].start < parallelBinningThreshold)
+                splitTask(i);
+        }, nTasks, 1);
+
+        // Queue the children of split nodes for the next level or as
+        // subtrees
+        std::vector<BuildTask> nextLevel;
+        for (int i = 0; i < nTasks; ++i) {
+            if (!split[i]) continue;
+            BVHBuildNode *node = *level[i].node;
+            node->splitAxis = dims[i];
+            interiorNodes.push_back(node);
+            BuildTask children[2] = {
+                {level[i].start, mids[i], &node->children[0]},
+                {mids[i], level[i].end, &node->children[1]}};
+            for (const BuildTask &child : children)
+                if (child.end - child.start >= parallelBuildThreshold)
+                    nextLevel.push_back(child);
+                else
+                    subtrees.push_back(child);
+        }
+        level.swap(nextLevel);
+    }
+
+    // Build the subtrees in parallel, largest first
+    std::sort(subtrees.begin(), subtrees.end(),
+              [](const BuildTask &a, const BuildTask &b) {
+                  return a.end - a.start > b.end - b.start;
+              });
+    ParallelFor([&](int64_t i) {
+        const BuildTask &task = subtrees[i];
+        *task.node = recursiveBuild(arenas[ThreadIndex], primitiveInfo,
+                                    task.start, task.end, totalNodes,
+                                    orderedPrims);
+    }, subtrees.size(), 1);
+
+    // Initialize the split nodes bottom-up now that their children exist
+    for (auto iter = interiorNodes.rbegin(); iter != interiorNodes.rend();
+         ++iter) {
+        BVHBuildNode *node = *iter;
+        node->InitInterior(node->splitAxis, node->children[0],
+                           node->children[1]);
+    }
+    return root;
+}
+
+BVHBuildNode *BVHAccel::sbvhBuild(
+    MemoryArena &arena, std::vector<BVHReference> &refs, Float rootArea,
+    int depth, int *totalNodes, int *duplicationBudget,
+    std::vector<std::shared_ptr<Primitive>> &orderedPrims) const {
+    CHECK(!refs.empty());
+    BVHBuildNode *node = arena.Alloc<BVHBuildNode>();
+    (*totalNodes)++;
+    int nRefs = refs.size();
+
+    // Compute bounds of all references and of their centroids
+    Bounds3f bounds, centroidBounds;
+    for (const BVHReference &ref : refs) {
+        bounds = Union(bounds, ref.bounds);
+        centroidBounds =
+            Union(centroidBounds, .5f * ref.bounds.pMin + .5f * ref.bounds.pMax);
+    }
+    auto createLeaf = [&]() {
+        int firstPrimOffset = orderedPrims.size();
+        for (const BVHReference &ref : refs)
+            orderedPrims.push_back(primitives[ref.primitiveNumber]);
+        node->InitLeaf(firstPrimOffset, nRefs, bounds);
+        return node;
+    };
+    if (nRefs == 1) return createLeaf();
+
+    // Find the best object split along all three axes with binned SAH
+    PBRT_CONSTEXPR int nBuckets = 12;
+    Float objectCost = Infinity;
+    int objectDim = -1, objectBucket = -1;
+    Bounds3f objectBounds[2];
+    auto bucketIndex = [&](const BVHReference &ref, int dim) {
+        Point3f centroid = .5f * ref.bounds.pMin + .5f * ref.bounds.pMax;
+        int b = nBuckets * centroidBounds.Offset(centroid)[dim];
+        return std::min(b, nBuckets - 1);
+    };
+    for (int dim = 0; dim < 3; ++dim) {
+        if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) continue;
+        BucketInfo buckets[nBuckets];
+        for (const BVHReference &ref : refs) {
+            int b = bucketIndex(ref, dim);
+            buckets[b].count++;
+            buckets[b].bounds = Union(buckets[b].bounds, ref.bounds);
+        }
+
+        // Sweep from the right, then evaluate splits from the left
+        Bounds3f rightBounds[nBuckets - 1];
+        int rightCount[nBuckets - 1];
+        Bounds3f b1;
+        for (int i = nBuckets - 1, count1 = 0; i > 0; --i) {
+            b1 = Union(b1, buckets[i].bounds);
+            count1 += buckets[i].count;
+            rightBounds[i - 1] = b1;
+            rightCount[i - 1] = count1;
+        }
+        Bounds3f b0;
+        for (int i = 0, count0 = 0; i < nBuckets - 1; ++i) {
+            b0 = Union(b0, buckets[i].bounds);
+            count0 += buckets[i].count;
+            if (count0 == 0 || rightCount[i] == 0) continue;
+            Float cost = 1 + (count0 * b0.SurfaceArea() +
+                              rightCount[i] * rightBounds[i].SurfaceArea()) /
+                                 bounds.SurfaceArea();
+            if (cost < objectCost) {
+                objectCost = cost;
+                objectDim = dim;
+                objectBucket = i;
+                objectBounds[0] = b0;
+                objectBounds[1] = rightBounds[i];
+            }
+        }
+    }
+
+    // Find the best spatial split if the object split children overlap
+    PBRT_CONSTEXPR int nBins = 32;
+    Float spatialCost = Infinity;
+    int spatialDim = -1;
+    Float spatialPlane = 0;
+    bool trySpatial = *duplicationBudget > 0 && depth < maxSpatialSplitDepth;
+    if (trySpatial && objectDim != -1) {
+        Bounds3f overlap = pbrt::Intersect(objectBounds[0], objectBounds[1]);
+        trySpatial = !IsEmpty(overlap) &&
+                     overlap.SurfaceArea() > spatialSplitAlpha * rootArea;
+    }
+    for (int dim = 0; trySpatial && dim < 3; ++dim) {
+        Float extent = bounds.pMax[dim] - bounds.pMin[dim];
+        if (extent <= 0) continue;
+        auto binPlane = [&](int b) {
+            return b == nBins ? bounds.pMax[dim]
+                              : bounds.pMin[dim] + extent * b / nBins;
+        };
+        auto binIndex = [&](Float x) {
+            return Clamp(int(nBins * (x - bounds.pMin[dim]) / extent), 0,
+                         nBins - 1);
+        };
+
+        // Add references to the spatial bins, clipping them to each bin
+        SpatialBin bins[nBins];
+        for (const BVHReference &ref : refs) {
+            int first = binIndex(ref.bounds.pMin[dim]);
+            int last = binIndex(ref.bounds.pMax[dim]);
+            bins[first].entries++;
+            bins[last].exits++;
+            if (first == last) {
+                bins[first].bounds = Union(bins[first].bounds, ref.bounds);
+                continue;
+            }
+            for (int b = first; b <= last; ++b) {
+                Bounds3f slab = ref.bounds;
+                slab.pMin[dim] = std::max(slab.pMin[dim], binPlane(b));
+                slab.pMax[dim] = std::min(slab.pMax[dim], binPlane(b + 1));
+                Bounds3f clipped =
+                    primitives[ref.primitiveNumber]->ClippedWorldBound(slab);
+                if (!IsEmpty(clipped))
+                    bins[b].bounds = Union(bins[b].bounds, clipped);
+            }
+        }
+
+        // Evaluate the SAH cost of splitting at each bin boundary
+        Bounds3f rightBounds[nBins - 1];
+        int rightCount[nBins - 1];
+        Bounds3f b1;
+        for (int i = nBins - 1, count1 = 0; i > 0; --i) {
+            b1 = Union(b1, bins[i].bounds);
+            count1 += bins[i].exits;
+            rightBounds[i - 1] = b1;
+            rightCount[i - 1] = count1;
+        }
+        Bounds3f b0;
+        for (int i = 0, count0 = 0; i < nBins - 1; ++i) {
+            b0 = Union(b0, bins[i].bounds);
+            count0 += bins[i].entries;
+            if (count0 == 0 || rightCount[i] == 0) continue;
+            Float cost = 1 + (count0 * b0.SurfaceArea() +
+                              rightCount[i] * rightBounds[i].SurfaceArea()) /
+                                 bounds.SurfaceArea();
+            if (cost < spatialCost) {
+                spatialCost = cost;
+                spatialDim = dim;
+                spatialPlane = binPlane(i + 1);
+            }
+        }
+    }
+
+    // Either create leaf or split references
+    if (objectDim == -1 && spatialDim == -1) return createLeaf();
+    Float leafCost = nRefs;
+    if (nRefs <= maxPrimsInNode &&
+        leafCost <= std::min(objectCost, spatialCost))
+        return createLeaf();
+
+    std::vector<BVHReference> left, right;
+    int dim = -1;
+    if (spatialCost < objectCost) {
+        // Split references at _spatialPlane_; references entirely on one
+        // side go there, and straddling ones are split or, if that is
+        // cheaper, moved to one side as a whole
+        dim = spatialDim;
+        std::vector<BVHReference> straddling;
+        Bounds3f lb, rb;
+        for (const BVHReference &ref : refs) {
+            if (ref.bounds.pMax[dim] <= spatialPlane) {
+                left.push_back(ref);
+                lb = Union(lb, ref.bounds);
+            } else if (ref.bounds.pMin[dim] >= spatialPlane) {
+                right.push_back(ref);
+                rb = Union(rb, ref.bounds);
+            } else
+                straddling.push_back(ref);
+        }
+        int nLeft = left.size() + straddling.size();
+        int nRight = right.size() + straddling.size();
+        for (const BVHReference &ref : straddling) {
+            Bounds3f leftClip = ref.bounds, rightClip = ref.bounds;
+            leftClip.pMax[dim] = spatialPlane;
+            rightClip.pMin[dim] = spatialPlane;
+            const Primitive &prim = *primitives[ref.primitiveNumber];
+            BVHReference leftRef{ref.primitiveNumber,
+                                 prim.ClippedWorldBound(leftClip)};
+            BVHReference rightRef{ref.primitiveNumber,
+                                  prim.ClippedWorldBound(rightClip)};
+            // The primitive itself may lie on one side only
+            if (IsEmpty(rightRef.bounds)) {
+                left.push_back(leftRef);
+                lb = Union(lb, leftRef.bounds);
+                --nRight;
+                continue;
+            } else if (IsEmpty(leftRef.bounds)) {
+                right.push_back(rightRef);
+                rb = Union(rb, rightRef.bounds);
+                --nLeft;
+                continue;
+            }
+
+            // Compare the costs of splitting and of unsplitting the reference
+            Float splitCost =
+                Union(lb, leftRef.bounds).SurfaceArea() * nLeft +
+                Union(rb, rightRef.bounds).SurfaceArea() * nRight;
+            Float leftCost = Union(lb, ref.bounds).SurfaceArea() * nLeft +
+                             rb.SurfaceArea() * (nRight - 1);
+            Float rightCost = lb.SurfaceArea() * (nLeft - 1) +
+                              Union(rb, ref.bounds).SurfaceArea() * nRight;
+            if (*duplicationBudget > 0 && splitCost < leftCost &&
+                splitCost < rightCost) {
+                left.push_back(leftRef);
+                right.push_back(rightRef);
+                lb = Union(lb, leftRef.bounds);
+                rb = Union(rb, rightRef.bounds);
+                --*duplicationBudget;
+                ++duplicatedReferences;
+            } else if (leftCost <= rightCost) {
+                left.push_back(ref);
+                lb = Union(lb, ref.bounds);
+                --nRight;
+            } else {
+                right.push_back(ref);
+                rb = Union(rb, ref.bounds);
+                --nLeft;
+            }
+        }
+
+        // Fall back to the object split if the spatial split made no progress
+        if (left.empty() || right.empty() ||
+            ((int)left.size() == nRefs && (int)right.size() == nRefs)) {
+            int nDuplicated = left.size() + right.size() - nRefs;
+            *duplicationBudget += nDuplicated;
+            duplicatedReferences -= nDuplicated;
+            left.clear();
+            right.clear();
+            if (objectDim == -1) return createLeaf();
+        } else
+            ++spatialSplits;
+    }
+    if (left.empty()) {
+        // Split references at the best object split bucket
+        dim = objectDim;
+        for (const BVHReference &ref : refs)
+            (bucketIndex(ref, dim) <= objectBucket ? left : right)
+                .push_back(ref);
+    }
+
+    // Release this node's references before building the children
+    std::vector<BVHReference>().swap(refs);
+    BVHBuildNode *c0 = sbvhBuild(arena, left, rootArea, depth + 1, totalNodes,
+                                 duplicationBudget, orderedPrims);
+    BVHBuildNode *c1 = sbvhBuild(arena, right, rootArea, depth + 1, totalNodes,
+                                 duplicationBudget, orderedPrims);
+    node->InitInterior(dim, c0, c1);
     return node;
 }
 
@@ -654,14 +1868,276 @@ int BVHAccel::flattenBVHTree(BVHBuildNode *node, int *offset) {
     return myOffset;
 }
 
-BVHAccel::~BVHAccel() { FreeAligned(nodes); }
+template <int Width>
+int BVHAccel::collapseBVHTree(
+    BVHBuildNode *node, std::vector<WideBVHNode<Width>> &collapsed) const {
+    // Gather up to _Width_ children, opening the largest interior ones first
+    BVHBuildNode *children[Width];
+    int nChildren = 0;
+    if (node->nPrimitives > 0)
+        children[nChildren++] = node;
+    else {
+        children[nChildren++] = node->children[0];
+        children[nChildren++] = node->children[1];
+        while (nChildren < Width) {
+            int largest = -1;
+            Float largestArea = -1;
+            for (int i = 0; i < nChildren; ++i)
+                if (children[i]->nPrimitives == 0 &&
+                    children[i]->bounds.SurfaceArea() > largestArea) {
+                    largest = i;
+                    largestArea = children[i]->bounds.SurfaceArea();
+                }
+            if (largest == -1) break;
+            BVHBuildNode *opened = children[largest];
+            children[largest] = opened->children[0];
+            children[nChildren++] = opened->children[1];
+        }
+    }
+
+    // Initialize wide node; unused slots get empty bounds
+    int myOffset = collapsed.size();
+    WideBVHNode<Width> wideNode;
+    wideNode.nChildren = nChildren;
+    for (int i = 0; i < Width; ++i) {
+        Bounds3f b = i < nChildren ? children[i]->bounds : Bounds3f();
+        for (int axis = 0; axis < 3; ++axis) {
+            wideNode.bounds[0][axis][i] = b.pMin[axis];
+            wideNode.bounds[1][axis][i] = b.pMax[axis];
+        }
+        wideNode.childOffset[i] = 0;
+        wideNode.nPrimitives[i] = 0;
+    }
+    collapsed.push_back(wideNode);
+
+    // Store leaf children in place and recursively collapse interior ones
+    for (int i = 0; i < nChildren; ++i) {
+        if (children[i]->nPrimitives > 0) {
+            CHECK_LT(children[i]->nPrimitives, 65536);
+            collapsed[myOffset].childOffset[i] = children[i]->firstPrimOffset;
+            collapsed[myOffset].nPrimitives[i] = children[i]->nPrimitives;
+        } else {
+            int childOffset = collapseBVHTree<Width>(children[i], collapsed);
+            collapsed[myOffset].childOffset[i] = childOffset;
+        }
+    }
+    return myOffset;
+}
+
+template <int Width>
+void BVHAccel::flattenWideBVHTree(BVHBuildNode *root) {
+    std::vector<WideBVHNode<Width>> collapsed;
+    collapseBVHTree<Width>(root, collapsed);
+    WideBVHNode<Width> *n = AllocAligned<WideBVHNode<Width>>(collapsed.size());
+    std::copy(collapsed.begin(), collapsed.end(), n);
+    wideNodes = n;
+    nNodes = collapsed.size();
+    wideNodeCount += collapsed.size();
+    treeBytes += collapsed.size() * sizeof(WideBVHNode<Width>) + sizeof(*this) +
+                 primitives.size() * sizeof(primitives[0]);
+    LOG(INFO) << StringPrintf("%d-wide BVH created with %d nodes for %d "
+                              "primitives (%.2f MB)", Width,
+                              (int)collapsed.size(), (int)primitives.size(),
+                              float(collapsed.size() *
+                                    sizeof(WideBVHNode<Width>)) /
+                              (1024.f * 1024.f));
+}
+
+// Tests _ray_ against the bounds of all children of _node_; returns the mask
+// of children hit and stores their entry distances in _tEntry_
+template <int Width>
+inline int IntersectChildBounds(const WideBVHNode<Width> &node, const Ray &ray,
+                                const Vector3f &invDir, const int dirIsNeg[3],
+                                Float tEntry[Width]) {
+    int mask = 0;
+#ifdef PBRT_BVH_SSE
+    const __m128 rayTMax = _mm_set1_ps(ray.tMax);
+    const __m128 scale = _mm_set1_ps(1 + 2 * gamma(3));
+    for (int g = 0; g < Width; g += 4) {
+        // Slab tests for four children at a time
+        __m128 tMin = _mm_mul_ps(
+            _mm_sub_ps(_mm_loadu_ps(&node.bounds[dirIsNeg[0]][0][g]),
+                       _mm_set1_ps(ray.o.x)),
+            _mm_set1_ps(invDir.x));
+        __m128 tMax = _mm_mul_ps(
+            _mm_sub_ps(_mm_loadu_ps(&node.bounds[1 - dirIsNeg[0]][0][g]),
+                       _mm_set1_ps(ray.o.x)),
+            _mm_set1_ps(invDir.x));
+        for (int axis = 1; axis < 3; ++axis) {
+            __m128 taMin = _mm_mul_ps(
+                _mm_sub_ps(_mm_loadu_ps(&node.bounds[dirIsNeg[axis]][axis][g]),
+                           _mm_set1_ps(ray.o[axis])),
+                _mm_set1_ps(invDir[axis]));
+            __m128 taMax = _mm_mul_ps(
+                _mm_sub_ps(
+                    _mm_loadu_ps(&node.bounds[1 - dirIsNeg[axis]][axis][g]),
+                    _mm_set1_ps(ray.o[axis])),
+                _mm_set1_ps(invDir[axis]));
+            // Operand order keeps the current value when the new one is NaN
+            tMin = _mm_max_ps(taMin, tMin);
+            tMax = _mm_min_ps(taMax, tMax);
+        }
+        tMax = _mm_mul_ps(tMax, scale);
+        __m128 hit = _mm_and_ps(
+            _mm_cmple_ps(tMin, tMax),
+            _mm_and_ps(_mm_cmplt_ps(tMin, rayTMax),
+                       _mm_cmpgt_ps(tMax, _mm_setzero_ps())));
+        _mm_storeu_ps(&tEntry[g], tMin);
+        mask |= _mm_movemask_ps(hit) << g;
+    }
+#else
+    for (int i = 0; i < Width; ++i) {
+        Float tMin = (node.bounds[dirIsNeg[0]][0][i] - ray.o.x) * invDir.x;
+        Float tMax = (node.bounds[1 - dirIsNeg[0]][0][i] - ray.o.x) * invDir.x;
+        for (int axis = 1; axis < 3; ++axis) {
+            Float taMin = (node.bounds[dirIsNeg[axis]][axis][i] - ray.o[axis]) *
+                          invDir[axis];
+            Float taMax =
+                (node.bounds[1 - dirIsNeg[axis]][axis][i] - ray.o[axis]) *
+                invDir[axis];
+            if (taMin > tMin) tMin = taMin;
+            if (taMax < tMax) tMax = taMax;
+        }
+        tMax *= 1 + 2 * gamma(3);
+        if (tMin <= tMax && tMin < ray.tMax && tMax > 0) mask |= 1 << i;
+        tEntry[i] = tMin;
+    }
+#endif  // PBRT_BVH_SSE
+    return mask & ((1 << node.nChildren) - 1);
+}
+
+#ifdef PBRT_BVH_AVX
+template <>
+inline int IntersectChildBounds<8>(const WideBVHNode<8> &node, const Ray &ray,
+                                   const Vector3f &invDir,
+                                   const int dirIsNeg[3], Float tEntry[8]) {
+    __m256 tMin = _mm256_mul_ps(
+        _mm256_sub_ps(_mm256_loadu_ps(node.bounds[dirIsNeg[0]][0]),
+                      _mm256_set1_ps(ray.o.x)),
+        _mm256_set1_ps(invDir.x));
+    __m256 tMax = _mm256_mul_ps(
+        _mm256_sub_ps(_mm256_loadu_ps(node.bounds[1 - dirIsNeg[0]][0]),
+                      _mm256_set1_ps(ray.o.x)),
+        _mm256_set1_ps(invDir.x));
+    for (int axis = 1; axis < 3; ++axis) {
+        __m256 taMin = _mm256_mul_ps(
+            _mm256_sub_ps(_mm256_loadu_ps(node.bounds[dirIsNeg[axis]][axis]),
+                          _mm256_set1_ps(ray.o[axis])),
+            _mm256_set1_ps(invDir[axis]));
+        __m256 taMax = _mm256_mul_ps(
+            _mm256_sub_ps(
+                _mm256_loadu_ps(node.bounds[1 - dirIsNeg[axis]][axis]),
+                _mm256_set1_ps(ray.o[axis])),
+            _mm256_set1_ps(invDir[axis]));
+        tMin = _mm256_max_ps(taMin, tMin);
+        tMax = _mm256_min_ps(taMax, tMax);
+    }
+    tMax = _mm256_mul_ps(tMax, _mm256_set1_ps(1 + 2 * gamma(3)));
+    __m256 hit = _mm256_and_ps(
+        _mm256_cmp_ps(tMin, tMax, _CMP_LE_OQ),
+        _mm256_and_ps(
+            _mm256_cmp_ps(tMin, _mm256_set1_ps(ray.tMax), _CMP_LT_OQ),
+            _mm256_cmp_ps(tMax, _mm256_setzero_ps(), _CMP_GT_OQ)));
+    _mm256_storeu_ps(tEntry, tMin);
+    return _mm256_movemask_ps(hit) & ((1 << node.nChildren) - 1);
+}
+#endif  // PBRT_BVH_AVX
+
+template <int Width>
+bool BVHAccel::IntersectWide(const Ray &ray, SurfaceInteraction *isect) const {
+    if (!wideNodes) return false;
+    ProfilePhase p(Prof::AccelIntersect);
+    const WideBVHNode<Width> *nodes = (const WideBVHNode<Width> *)wideNodes;
+    bool hit = false;
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    TriangleBlockRay triRay(ray);
+    // Follow ray through wide BVH nodes, nearest children first
+    WideBVHStackEntry toVisit[64 * (Width - 1) + 1];
+    int toVisitOffset = 0;
+    toVisit[toVisitOffset++] = {0, 0, -Infinity};
+    while (toVisitOffset > 0) {
+        const WideBVHStackEntry entry = toVisit[--toVisitOffset];
+        // Skip children entered beyond the closest intersection so far
+        if (entry.tEntry > ray.tMax) continue;
+        if (entry.nPrimitives > 0) {
+            if (intersectLeaf(entry.offset, entry.nPrimitives, triRay, ray,
+                              isect))
+                hit = true;
+            continue;
+        }
+
+        const WideBVHNode<Width> &node = nodes[entry.offset];
+        Float tEntry[Width];
+        int mask = IntersectChildBounds<Width>(node, ray, invDir, dirIsNeg,
+                                               tEntry);
+        // Sort hit children by decreasing entry distance and push them so
+        // that the nearest one is visited next
+        int order[Width], nHit = 0;
+        for (int i = 0; i < Width; ++i) {
+            if (!(mask & (1 << i))) continue;
+            int j = nHit++;
+            for (; j > 0 && tEntry[order[j - 1]] < tEntry[i]; --j)
+                order[j] = order[j - 1];
+            order[j] = i;
+        }
+        for (int k = 0; k < nHit; ++k) {
+            int c = order[k];
+            toVisit[toVisitOffset++] = {node.childOffset[c],
+                                        node.nPrimitives[c], tEntry[c]};
+        }
+    }
+    return hit;
+}
+
+template <int Width>
+bool BVHAccel::IntersectPWide(const Ray &ray) const {
+    if (!wideNodes) return false;
+    ProfilePhase p(Prof::AccelIntersectP);
+    const WideBVHNode<Width> *nodes = (const WideBVHNode<Width> *)wideNodes;
+    Vector3f invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    TriangleBlockRay triRay(ray);
+    WideBVHStackEntry toVisit[64 * (Width - 1) + 1];
+    int toVisitOffset = 0;
+    toVisit[toVisitOffset++] = {0, 0, -Infinity};
+    while (toVisitOffset > 0) {
+        const WideBVHStackEntry entry = toVisit[--toVisitOffset];
+        if (entry.nPrimitives > 0) {
+            if (intersectPLeaf(entry.offset, entry.nPrimitives, triRay, ray))
+                return true;
+            continue;
+        }
+
+        // Any hit ends traversal, so children are pushed in slot order
+        const WideBVHNode<Width> &node = nodes[entry.offset];
+        Float tEntry[Width];
+        int mask = IntersectChildBounds<Width>(node, ray, invDir, dirIsNeg,
+                                               tEntry);
+        for (int i = 0; i < Width; ++i)
+            if (mask & (1 << i))
+                toVisit[toVisitOffset++] = {node.childOffset[i],
+                                            node.nPrimitives[i], tEntry[i]};
+    }
+    return false;
+}
+
+BVHAccel::~BVHAccel() {
+    FreeAligned(triBlocks);
+    if (cacheFile) return;
+    FreeAligned(nodes);
+    FreeAligned(wideNodes);
+}
 
 bool BVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
+    if (width == 4) return IntersectWide<4>(ray, isect);
+    if (width == 8) return IntersectWide<8>(ray, isect);
     if (!nodes) return false;
     ProfilePhase p(Prof::AccelIntersect);
     bool hit = false;
     Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
     int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    TriangleBlockRay triRay(ray);
     // Follow ray through BVH nodes to find primitive intersections
     int toVisitOffset = 0, currentNodeIndex = 0;
     int nodesToVisit[64];
@@ -671,10 +2147,9 @@ bool BVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
         if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
             if (node->nPrimitives > 0) {
                 // Intersect ray with primitives in leaf BVH node
-                for (int i = 0; i < node->nPrimitives; ++i)
-                    if (primitives[node->primitivesOffset + i]->Intersect(
-                            ray, isect))
-                        hit = true;
+                if (intersectLeaf(node->primitivesOffset, node->nPrimitives,
+                                  triRay, ray, isect))
+                    hit = true;
                 if (toVisitOffset == 0) break;
                 currentNodeIndex = nodesToVisit[--toVisitOffset];
             } else {
@@ -697,10 +2172,13 @@ bool BVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
 }
 
 bool BVHAccel::IntersectP(const Ray &ray) const {
+    if (width == 4) return IntersectPWide<4>(ray);
+    if (width == 8) return IntersectPWide<8>(ray);
     if (!nodes) return false;
     ProfilePhase p(Prof::AccelIntersectP);
     Vector3f invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
     int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    TriangleBlockRay triRay(ray);
     int nodesToVisit[64];
     int toVisitOffset = 0, currentNodeIndex = 0;
     while (true) {
@@ -708,12 +2186,9 @@ bool BVHAccel::IntersectP(const Ray &ray) const {
         if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
             // Process BVH node _node_ for traversal
             if (node->nPrimitives > 0) {
-                for (int i = 0; i < node->nPrimitives; ++i) {
-                    if (primitives[node->primitivesOffset + i]->IntersectP(
-                            ray)) {
-                        return true;
-                    }
-                }
+                if (intersectPLeaf(node->primitivesOffset, node->nPrimitives,
+                                   triRay, ray))
+                    return true;
                 if (toVisitOffset == 0) break;
                 currentNodeIndex = nodesToVisit[--toVisitOffset];
             } else {
@@ -734,6 +2209,230 @@ bool BVHAccel::IntersectP(const Ray &ray) const {
     return false;
 }
 
+// Up to _maxPacketSize_ rays with the same direction signs in SoA layout;
+// _index_ maps lanes back to the caller's ray arrays
+static PBRT_CONSTEXPR int maxPacketSize = 16;
+struct RayPacket {
+    Float o[3][maxPacketSize], invDir[3][maxPacketSize], tMax[maxPacketSize];
+    int index[maxPacketSize];
+    TriangleBlockRay triRay[maxPacketSize];
+    int dirIsNeg[3];
+    int n = 0;
+};
+
+// Octant of the ray direction, with the sign convention of _dirIsNeg_
+static inline int DirectionOctant(const Ray &ray) {
+    return (1 / ray.d.x < 0) | ((1 / ray.d.y < 0) << 1) |
+           ((1 / ray.d.z < 0) << 2);
+}
+
+// Calls _trace_ for packets of the rays whose direction octant matches; all
+// rays of a packet share _dirIsNeg_, so they visit the children of every
+// node in the same order as a single ray would
+template <typename Func>
+static void ForEachRayPacket(const Ray *rays, int n, Func trace) {
+    RayPacket packet;
+    for (int octant = 0; octant < 8; ++octant) {
+        packet.n = 0;
+        for (int axis = 0; axis < 3; ++axis)
+            packet.dirIsNeg[axis] = (octant >> axis) & 1;
+        for (int i = 0; i < n; ++i) {
+            if (DirectionOctant(rays[i]) != octant) continue;
+            int lane = packet.n++;
+            for (int axis = 0; axis < 3; ++axis) {
+                packet.o[axis][lane] = rays[i].o[axis];
+                packet.invDir[axis][lane] = 1 / rays[i].d[axis];
+            }
+            packet.tMax[lane] = rays[i].tMax;
+            packet.index[lane] = i;
+            packet.triRay[lane] = TriangleBlockRay(rays[i]);
+            if (packet.n == maxPacketSize) {
+                trace(packet);
+                packet.n = 0;
+            }
+        }
+        if (packet.n > 0) trace(packet);
+    }
+}
+
+// Returns the subset of the rays in _active_ that hit _b_, with the same
+// arithmetic as _Bounds3::IntersectP()_ for each ray
+static inline int IntersectPacketBounds(const Bounds3f &b,
+                                        const RayPacket &packet, int active) {
+    ++packetNodeTests;
+    for (int m = active; m != 0; m &= m - 1) ++activePacketRays;
+    const int *dirIsNeg = packet.dirIsNeg;
+    int mask = 0;
+#ifdef PBRT_BVH_SSE
+    const __m128 scale = _mm_set1_ps(1 + 2 * gamma(3));
+    const __m128 zero = _mm_setzero_ps();
+    for (int g = 0; g < packet.n; g += 4) {
+        if (((active >> g) & 0xf) == 0) continue;
+        __m128 t[3][2];
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 o = _mm_loadu_ps(&packet.o[axis][g]);
+            __m128 invDir = _mm_loadu_ps(&packet.invDir[axis][g]);
+            t[axis][0] = _mm_mul_ps(
+                _mm_sub_ps(_mm_set1_ps(b[dirIsNeg[axis]][axis]), o), invDir);
+            t[axis][1] = _mm_mul_ps(
+                _mm_mul_ps(
+                    _mm_sub_ps(_mm_set1_ps(b[1 - dirIsNeg[axis]][axis]), o),
+                    invDir),
+                scale);
+        }
+        __m128 tMin = t[0][0], tMax = t[0][1];
+        __m128 miss = _mm_setzero_ps();
+        for (int axis = 1; axis < 3; ++axis) {
+            miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(tMin, t[axis][1]),
+                                             _mm_cmpgt_ps(t[axis][0], tMax)));
+            // _max_ and _min_ return their second operand for NaNs, like the
+            // comparisons in _Bounds3::IntersectP()_
+            tMin = _mm_max_ps(t[axis][0], tMin);
+            tMax = _mm_min_ps(t[axis][1], tMax);
+        }
+        __m128 hit = _mm_andnot_ps(
+            miss, _mm_and_ps(_mm_cmplt_ps(tMin, _mm_loadu_ps(&packet.tMax[g])),
+                             _mm_cmpgt_ps(tMax, zero)));
+        mask |= _mm_movemask_ps(hit) << g;
+    }
+#else
+    for (int i = 0; i < packet.n; ++i) {
+        Ray ray(Point3f(packet.o[0][i], packet.o[1][i], packet.o[2][i]),
+                Vector3f(0, 0, 0), packet.tMax[i]);
+        Vector3f invDir(packet.invDir[0][i], packet.invDir[1][i],
+                        packet.invDir[2][i]);
+        if (b.IntersectP(ray, invDir, dirIsNeg)) mask |= 1 << i;
+    }
+#endif  // PBRT_BVH_SSE
+    return mask & active;
+}
+
+void BVHAccel::IntersectN(const Ray *rays, SurfaceInteraction *isects,
+                          bool *hits, int n) const {
+    // The wide layouts already test a ray against all children of a node at
+    // once, so their rays are traced individually
+    if (width != 2 || !nodes) {
+        Aggregate::IntersectN(rays, isects, hits, n);
+        return;
+    }
+    for (int i = 0; i < n; ++i) hits[i] = false;
+    ForEachRayPacket(rays, n, [&](RayPacket &packet) {
+        if (packet.n == 1) {
+            int i = packet.index[0];
+            hits[i] = Intersect(rays[i], &isects[i]);
+            return;
+        }
+        ++rayPackets;
+        packetRays += packet.n;
+        intersectPacket(packet, rays, isects, hits);
+    });
+}
+
+void BVHAccel::IntersectPN(const Ray *rays, bool *occluded, int n) const {
+    if (width != 2 || !nodes) {
+        Aggregate::IntersectPN(rays, occluded, n);
+        return;
+    }
+    for (int i = 0; i < n; ++i) occluded[i] = false;
+    ForEachRayPacket(rays, n, [&](RayPacket &packet) {
+        if (packet.n == 1) {
+            int i = packet.index[0];
+            occluded[i] = IntersectP(rays[i]);
+            return;
+        }
+        ++rayPackets;
+        packetRays += packet.n;
+        intersectPPacket(packet, rays, occluded);
+    });
+}
+
+void BVHAccel::intersectPacket(RayPacket &packet, const Ray *rays,
+                               SurfaceInteraction *isects, bool *hits) const {
+    ProfilePhase p(Prof::AccelIntersect);
+    // Follow the packet through the BVH nodes; each stack entry records the
+    // rays that still have to visit the node
+    struct StackEntry {
+        int node, active;
+    };
+    StackEntry nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    int active = (1 << packet.n) - 1;
+    while (true) {
+        const LinearBVHNode *node = &nodes[currentNodeIndex];
+        int mask = IntersectPacketBounds(node->bounds, packet, active);
+        if (mask != 0 && node->nPrimitives > 0) {
+            // Intersect each ray that reached the leaf with its primitives
+            for (int lane = 0; lane < packet.n; ++lane) {
+                if (!(mask & (1 << lane))) continue;
+                int i = packet.index[lane];
+                if (intersectLeaf(node->primitivesOffset, node->nPrimitives,
+                                  packet.triRay[lane], rays[i], &isects[i])) {
+                    hits[i] = true;
+                    packet.tMax[lane] = rays[i].tMax;
+                }
+            }
+        } else if (mask != 0) {
+            // Put far BVH node on _nodesToVisit_ stack, advance to near node
+            if (packet.dirIsNeg[node->axis]) {
+                nodesToVisit[toVisitOffset++] = {currentNodeIndex + 1, mask};
+                currentNodeIndex = node->secondChildOffset;
+            } else {
+                nodesToVisit[toVisitOffset++] = {node->secondChildOffset, mask};
+                currentNodeIndex = currentNodeIndex + 1;
+            }
+            active = mask;
+            continue;
+        }
+        if (toVisitOffset == 0) break;
+        --toVisitOffset;
+        currentNodeIndex = nodesToVisit[toVisitOffset].node;
+        active = nodesToVisit[toVisitOffset].active;
+    }
+}
+
+void BVHAccel::intersectPPacket(RayPacket &packet, const Ray *rays,
+                                bool *occluded) const {
+    ProfilePhase p(Prof::AccelIntersectP);
+    struct StackEntry {
+        int node, active;
+    };
+    StackEntry nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    // Rays leave the packet as soon as they are found to be occluded
+    int unoccluded = (1 << packet.n) - 1;
+    int active = unoccluded;
+    while (true) {
+        const LinearBVHNode *node = &nodes[currentNodeIndex];
+        int mask = IntersectPacketBounds(node->bounds, packet, active);
+        if (mask != 0 && node->nPrimitives > 0) {
+            for (int lane = 0; lane < packet.n; ++lane) {
+                if (!(mask & (1 << lane))) continue;
+                int i = packet.index[lane];
+                if (intersectPLeaf(node->primitivesOffset, node->nPrimitives,
+                                   packet.triRay[lane], rays[i])) {
+                    occluded[i] = true;
+                    unoccluded &= ~(1 << lane);
+                }
+            }
+            if (unoccluded == 0) break;
+        } else if (mask != 0) {
+            if (packet.dirIsNeg[node->axis]) {
+                nodesToVisit[toVisitOffset++] = {currentNodeIndex + 1, mask};
+                currentNodeIndex = node->secondChildOffset;
+            } else {
+                nodesToVisit[toVisitOffset++] = {node->secondChildOffset, mask};
+                currentNodeIndex = currentNodeIndex + 1;
+            }
+            active = mask;
+            continue;
+        }
+        if (toVisitOffset == 0) break;
+        --toVisitOffset;
+        currentNodeIndex = nodesToVisit[toVisitOffset].node;
+        active = nodesToVisit[toVisitOffset].active & unoccluded;
+    }
+}
+
 std::shared_ptr<BVHAccel> CreateBVHAccelerator(
     const std::vector<std::shared_ptr<Primitive>> &prims, const ParamSet &ps) {
     std::string splitMethodName = ps.FindOneString("splitmethod", "sah");
@@ -746,6 +2445,8 @@ std::shared_ptr<BVHAccel> CreateBVHAccelerator(
         splitMethod = BVHAccel::SplitMethod::Middle;
     else if (splitMethodName == "equal")
         splitMethod = BVHAccel::SplitMethod::EqualCounts;
+    else if (splitMethodName == "sbvh")
+        splitMethod = BVHAccel::SplitMethod::SBVH;
     else {
         Warning("BVH split method \"%s\" unknown.  Using \"sah\".",
                 splitMethodName.c_str());
@@ -753,7 +2454,14 @@ std::shared_ptr<BVHAccel> CreateBVHAccelerator(
     }
 
     int maxPrimsInNode = ps.FindOneInt("maxnodeprims", 4);
-    return std::make_shared<BVHAccel>(prims, maxPrimsInNode, splitMethod);
+    int width = ps.FindOneInt("width", 2);
+    if (width != 2 && width != 4 && width != 8) {
+        Warning("BVH width %d unsupported.  Using 2.", width);
+        width = 2;
+    }
+    Float maxDuplication = ps.FindOneFloat("maxduplication", .3f);
+    return std::make_shared<BVHAccel>(prims, maxPrimsInNode, splitMethod,
+                                      width, maxDuplication);
 }
 
 }  // namespace pbrt
@@ -45,33 +45,76 @@
 
 namespace pbrt {
 struct BVHBuildNode;
+class AccelCacheFile;
 
 // BVHAccel Forward Declarations
 struct BVHPrimitiveInfo;
+struct BVHReference;
 struct MortonPrimitive;
 struct LinearBVHNode;
+template <int Width>
+struct WideBVHNode;
+struct TriangleBlock;
+struct TriangleBlockRay;
+struct RayPacket;
 
 // BVHAccel Declarations
 class BVHAccel : public Aggregate {
   public:
     // BVHAccel Public Types
-    enum class SplitMethod { SAH, HLBVH, Middle, EqualCounts };
+    enum class SplitMethod { SAH, HLBVH, Middle, EqualCounts, SBVH };
 
     // BVHAccel Public Methods
     BVHAccel(const std::vector<std::shared_ptr<Primitive>> &p,
              int maxPrimsInNode = 1,
-             SplitMethod splitMethod = SplitMethod::SAH);
+             SplitMethod splitMethod = SplitMethod::SAH, int width = 2,
+             Float maxDuplication = .3f);
     Bounds3f WorldBound() const;
     ~BVHAccel();
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
     bool IntersectP(const Ray &ray) const;
+    void IntersectN(const Ray *rays, SurfaceInteraction *isects, bool *hits,
+                    int n) const;
+    void IntersectPN(const Ray *rays, bool *occluded, int n) const;
+    // Returns a BVH with this tree's topology over _newPrims_, where
+    // _newPrims[i]_ replaces _oldPrims[i]_ of the primitives this BVH was
+    // built from, and only the node bounds are recomputed.  Returns
+    // _nullptr_ if refitting has degraded the tree too much since it was
+    // last built, or if the BVH stores triangles compactly and so no longer
+    // knows their primitives; the caller should build a new BVH instead.
+    std::shared_ptr<BVHAccel> Refit(
+        const std::vector<std::shared_ptr<Primitive>> &oldPrims,
+        const std::vector<std::shared_ptr<Primitive>> &newPrims) const;
+    // Returns the number of bytes the BVH holds, not counting the
+    // primitives themselves
+    size_t MemoryBytes() const;
+    // Returns the number of primitives the BVH holds references to; of the
+    // triangles it stores compactly, it keeps one primitive for each mesh,
+    // material and medium interface
+    size_t NumPrimitives() const {
+        return primitives.size() + blockPrimitives.size();
+    }
 
   private:
     // BVHAccel Private Methods
+    BVHAccel(const BVHAccel &topology,
+             std::vector<std::shared_ptr<Primitive>> orderedPrims);
+    BVHBuildNode *parallelBuild(
+        MemoryArena *arenas, std::vector<BVHPrimitiveInfo> &primitiveInfo,
+        std::atomic<int> *totalNodes,
+        std::vector<std::shared_ptr<Primitive>> &orderedPrims) const;
     BVHBuildNode *recursiveBuild(
         MemoryArena &arena, std::vector<BVHPrimitiveInfo> &primitiveInfo,
-        int start, int end, int *totalNodes,
-        std::vector<std::shared_ptr<Primitive>> &orderedPrims);
+        int start, int end, std::atomic<int> *totalNodes,
+        std::vector<std::shared_ptr<Primitive>> &orderedPrims) const;
+    bool splitNode(BVHBuildNode *node,
+                   std::vector<BVHPrimitiveInfo> &primitiveInfo, int start,
+                   int end, int *splitDim, int *splitMid,
+                   std::vector<std::shared_ptr<Primitive>> &orderedPrims) const;
+    BVHBuildNode *sbvhBuild(
+        MemoryArena &arena, std::vector<BVHReference> &refs, Float rootArea,
+        int depth, int *totalNodes, int *duplicationBudget,
+        std::vector<std::shared_ptr<Primitive>> &orderedPrims) const;
     BVHBuildNode *HLBVHBuild(
         MemoryArena &arena, const std::vector<BVHPrimitiveInfo> &primitiveInfo,
         int *totalNodes,
@@ -86,12 +129,56 @@ class BVHAccel : public Aggregate {
                                 std::vector<BVHBuildNode *> &treeletRoots,
                                 int start, int end, int *totalNodes) const;
     int flattenBVHTree(BVHBuildNode *node, int *offset);
+    template <int Width>
+    int collapseBVHTree(BVHBuildNode *node,
+                        std::vector<WideBVHNode<Width>> &collapsed) const;
+    template <int Width>
+    void flattenWideBVHTree(BVHBuildNode *root);
+    template <int Width>
+    bool IntersectWide(const Ray &ray, SurfaceInteraction *isect) const;
+    template <int Width>
+    bool IntersectPWide(const Ray &ray) const;
+    void packTriangleLeaves();
+    bool intersectLeaf(int offset, int nPrimitives,
+                       const TriangleBlockRay &triRay, const Ray &ray,
+                       SurfaceInteraction *isect) const;
+    bool intersectPLeaf(int offset, int nPrimitives,
+                        const TriangleBlockRay &triRay, const Ray &ray) const;
+    void intersectPacket(RayPacket &packet, const Ray *rays,
+                         SurfaceInteraction *isects, bool *hits) const;
+    void intersectPPacket(RayPacket &packet, const Ray *rays,
+                          bool *occluded) const;
+    void refitBounds();
+    template <int Width>
+    void refitWideBounds();
+    Float treeCost() const;
+    bool loadCache(uint64_t key);
+    void writeCache(
+        uint64_t key,
+        const std::vector<std::shared_ptr<Primitive>> &unorderedPrims) const;
 
     // BVHAccel Private Data
     const int maxPrimsInNode;
     const SplitMethod splitMethod;
+    const int width;
+    const Float maxDuplication;
     std::vector<std::shared_ptr<Primitive>> primitives;
+    Bounds3f bounds;
     LinearBVHNode *nodes = nullptr;
+    void *wideNodes = nullptr;
+    int nNodes = 0;
+    // SAH cost of the tree when it was built, if it has been refit since
+    Float builtCost = 0;
+    // Triangles of the leaves that only hold triangles without area lights,
+    // stored four to a block in place of their primitives; such leaves'
+    // primitive offsets are -1 minus the index of their first triangle.
+    // Hits are completed by the _blockPrimitives_, which the blocks index
+    // for each triangle.
+    TriangleBlock *triBlocks = nullptr;
+    int nTriBlocks = 0;
+    std::vector<std::shared_ptr<Primitive>> blockPrimitives;
+    // Holds the mapping _nodes_ or _wideNodes_ points into, if loaded
+    std::unique_ptr<AccelCacheFile> cacheFile;
 };
 
 std::shared_ptr<BVHAccel> CreateBVHAccelerator(
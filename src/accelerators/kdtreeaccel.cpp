@@ -33,13 +33,19 @@
 
 // accelerators/kdtreeaccel.cpp*
 #include "accelerators/kdtreeaccel.h"
+#include "accelerators/accelcache.h"
 #include "paramset.h"
 #include "interaction.h"
+#include "memory.h"
+#include "parallel.h"
 #include "stats.h"
 #include <algorithm>
 
 namespace pbrt {
 
+STAT_MEMORY_COUNTER("Memory/Kd-tree", treeBytes);
+STAT_RATIO("Kd-Tree/Padding nodes per node", paddingNodes, totalLinearNodes);
+
 // KdTreeAccel Local Declarations
 struct KdAccelNode {
     // KdAccelNode Methods
@@ -80,17 +86,136 @@ struct BoundEdge {
     EdgeType type;
 };
 
+// Edges are ordered by position, with starting edges before ending ones at
+// the same position.  Ties are broken by primitive number so that the
+// sorted order, and thus the tree, doesn't depend on how the sort is split
+// across threads.
+static auto EdgeLess = [](const BoundEdge &e0, const BoundEdge &e1) -> bool {
+    if (e0.t != e1.t) return e0.t < e1.t;
+    if (e0.type != e1.type) return (int)e0.type < (int)e1.type;
+    return e0.primNum < e1.primNum;
+};
+
+struct KdBuildNode {
+    // KdBuildNode Public Methods
+    void InitLeaf(MemoryArena &arena, const int *prims, int np) {
+        nPrimitives = np;
+        primNums = arena.Alloc<int>(np, false);
+        std::copy(prims, prims + np, primNums);
+    }
+    void InitInterior(int axis, Float s) {
+        splitAxis = axis;
+        split = s;
+    }
+    bool IsLeaf() const { return splitAxis == -1; }
+
+    KdBuildNode *children[2] = {nullptr, nullptr};
+    int splitAxis = -1;
+    Float split = 0;
+    int nPrimitives = 0;
+    int *primNums = nullptr;
+};
+
+// Per-thread working memory for kd-tree construction
+struct KdBuildScratch {
+    std::vector<BoundEdge> edges;
+    std::vector<int> prims0, prims1;
+};
+
+// Nodes with at least this many primitives are split one level at a time,
+// in parallel with the other nodes of their level; smaller ones are the
+// roots of subtrees that are built serially, in parallel with each other
+static PBRT_CONSTEXPR int parallelBuildThreshold = 4096;
+// Nodes with at least this many primitives initialize, sort and sweep
+// their edges in parallel, in chunks of _parallelChunkSize_ edges
+static PBRT_CONSTEXPR int parallelSweepThreshold = 64 * 1024;
+static PBRT_CONSTEXPR int parallelChunkSize = 16 * 1024;
+
+static void SortEdges(BoundEdge *edges, int64_t nEdges) {
+    if (nEdges < 2 * parallelSweepThreshold) {
+        std::sort(edges, edges + nEdges, EdgeLess);
+        return;
+    }
+    // Sort chunks of edges in parallel and merge pairs of sorted runs
+    // until a single one is left
+    int64_t nChunks = (nEdges + parallelChunkSize - 1) / parallelChunkSize;
+    ParallelFor([&](int64_t c) {
+        int64_t start = c * parallelChunkSize;
+        int64_t end = std::min(start + parallelChunkSize, nEdges);
+        std::sort(edges + start, edges + end, EdgeLess);
+    }, nChunks, 1);
+    for (int64_t runLength = parallelChunkSize; runLength < nEdges;
+         runLength *= 2) {
+        int64_t nMerges = (nEdges + 2 * runLength - 1) / (2 * runLength);
+        ParallelFor([&](int64_t m) {
+            int64_t start = 2 * m * runLength;
+            int64_t mid = std::min(start + runLength, nEdges);
+            int64_t end = std::min(start + 2 * runLength, nEdges);
+            if (mid < end)
+                std::inplace_merge(edges + start, edges + mid, edges + end,
+                                   EdgeLess);
+        }, nMerges, 1);
+    }
+}
+
+// Computes the cost of splitting at each of _edges[start, end)_ along
+// _axis_, given the number of primitives below and above the first one,
+// and updates _*bestCost_ and _*bestOffset_ with the lowest-cost split.
+static inline void SweepEdges(const BoundEdge *edges, int start, int end, int nBelow,
+                       int nAbove, int axis, const Bounds3f &nodeBounds,
+                       int isectCost, int traversalCost, Float emptyBonus,
+                       Float *bestCost, int *bestOffset) {
+    Float invTotalSA = 1 / nodeBounds.SurfaceArea();
+    Vector3f d = nodeBounds.pMax - nodeBounds.pMin;
+    int otherAxis0 = (axis + 1) % 3, otherAxis1 = (axis + 2) % 3;
+    Float tMin = nodeBounds.pMin[axis], tMax = nodeBounds.pMax[axis];
+    Float minCost = *bestCost;
+    int minOffset = *bestOffset;
+    for (int i = start; i < end; ++i) {
+        if (edges[i].type == EdgeType::End) --nAbove;
+        Float edgeT = edges[i].t;
+        if (edgeT > tMin && edgeT < tMax) {
+            // Compute cost for split at _i_th edge
+
+            // Compute child surface areas for split at _edgeT_
+            Float belowSA = 2 * (d[otherAxis0] * d[otherAxis1] +
+                                 (edgeT - tMin) *
+                                     (d[otherAxis0] + d[otherAxis1]));
+            Float aboveSA = 2 * (d[otherAxis0] * d[otherAxis1] +
+                                 (tMax - edgeT) *
+                                     (d[otherAxis0] + d[otherAxis1]));
+            Float pBelow = belowSA * invTotalSA;
+            Float pAbove = aboveSA * invTotalSA;
+            Float eb = (nAbove == 0 || nBelow == 0) ? emptyBonus : 0;
+            Float cost =
+                traversalCost +
+                isectCost * (1 - eb) * (pBelow * nBelow + pAbove * nAbove);
+
+            // Update best split if this is lowest cost so far
+            if (cost < minCost) {
+                minCost = cost;
+                minOffset = i;
+            }
+        }
+        if (edges[i].type == EdgeType::Start) ++nBelow;
+    }
+    *bestCost = minCost;
+    *bestOffset = minOffset;
+}
+
 // KdTreeAccel Method Definitions
 KdTreeAccel::KdTreeAccel(const std::vector<std::shared_ptr<Primitive>> &p,
                          int isectCost, int traversalCost, Float emptyBonus,
-                         int maxPrims, int maxDepth)
+                         int maxPrims, int maxDepth, Layout layout)
     : isectCost(isectCost),
       traversalCost(traversalCost),
       maxPrims(maxPrims),
       emptyBonus(emptyBonus),
+      layout(layout),
       primitives(p) {
     // Build kd-tree for accelerator
     ProfilePhase _(Prof::AccelConstruction);
+    nodes = nullptr;
     nextFreeNode = nAllocedNodes = 0;
     if (maxDepth <= 0)
         maxDepth = std::round(8 + 1.3f * Log2Int(int64_t(primitives.size())));
@@ -104,20 +229,111 @@ KdTreeAccel::KdTreeAccel(const std::vector<std::shared_ptr<Primitive>> &p,
         primBounds.push_back(b);
     }
 
-    // Allocate working memory for kd-tree construction
-    std::unique_ptr<BoundEdge[]> edges[3];
-    for (int i = 0; i < 3; ++i)
-        edges[i].reset(new BoundEdge[2 * primitives.size()]);
-    std::unique_ptr<int[]> prims0(new int[primitives.size()]);
-    std::unique_ptr<int[]> prims1(new int[(maxDepth + 1) * primitives.size()]);
+    // Reuse a cached tree built for primitives with the same bounds
+    uint64_t cacheKey = 0;
+    if (AccelCacheFile::Enabled()) {
+        AccelCacheKey key("kdtree");
+        key.Add(sizeof(Float));
+        key.Add(sizeof(KdAccelNode));
+        key.Add(isectCost);
+        key.Add(traversalCost);
+        key.Add(maxPrims);
+        key.Add(emptyBonus);
+        key.Add(maxDepth);
+        key.Add(layout);
+        key.Add(primitives.size());
+        for (const Bounds3f &b : primBounds) key.Add(b);
+        cacheKey = key.Value();
+        if (loadCache(cacheKey)) return;
+    }
 
     // Initialize _primNums_ for kd-tree construction
-    std::unique_ptr<int[]> primNums(new int[primitives.size()]);
+    std::vector<int> primNums(primitives.size());
     for (size_t i = 0; i < primitives.size(); ++i) primNums[i] = i;
 
-    // Start recursive construction of kd-tree
-    buildTree(0, bounds, primBounds, primNums.get(), primitives.size(),
-              maxDepth, edges, prims0.get(), prims1.get());
+    // Start recursive construction of kd-tree; each thread allocates build
+    // nodes from its own arena and uses its own working memory
+    std::unique_ptr<MemoryArena[]> arenas(new MemoryArena[MaxThreadIndex()]);
+    std::unique_ptr<KdBuildScratch[]> scratch(
+        new KdBuildScratch[MaxThreadIndex()]);
+    std::atomic<int> totalNodes(0);
+    KdBuildNode *root = buildTree(arenas.get(), scratch.get(), bounds,
+                                  primBounds, std::move(primNums), maxDepth,
+                                  &totalNodes);
+    scratch.reset();
+
+    // Compute representation of kd-tree for traversal
+    std::vector<KdAccelNode> linearNodes;
+    linearNodes.reserve(totalNodes);
+    if (layout == Layout::Clustered && !root->IsLeaf()) {
+        // The root is followed by an empty leaf so that child pairs start
+        // at even offsets and never straddle cache lines
+        linearNodes.resize(2);
+        linearNodes[1].InitLeaf(nullptr, 0, &primitiveIndices);
+        flattenClustered(root, 0, linearNodes);
+        paddingNodes += linearNodes.size() - totalNodes;
+    } else
+        flattenDepthFirst(root, linearNodes);
+    totalLinearNodes += linearNodes.size();
+    nodes = AllocAligned<KdAccelNode>(linearNodes.size());
+    std::copy(linearNodes.begin(), linearNodes.end(), nodes);
+    nAllocedNodes = nextFreeNode = linearNodes.size();
+    treeBytes += linearNodes.size() * sizeof(KdAccelNode) +
+                 primitiveIndices.size() * sizeof(int) + sizeof(*this);
+    if (AccelCacheFile::Enabled()) writeCache(cacheKey);
+}
+
+bool KdTreeAccel::loadCache(uint64_t key) {
+    std::unique_ptr<AccelCacheFile> file = AccelCacheFile::Open("kdtree", key);
+    if (!file || file->NumSections() != 2) return false;
+    const AccelCacheSection &nodeData = file->Section(0);
+    const AccelCacheSection &indexData = file->Section(1);
+    if (nodeData.bytes % sizeof(KdAccelNode) != 0 || nodeData.bytes == 0 ||
+        indexData.bytes % sizeof(int) != 0)
+        return false;
+    int nNodes = nodeData.bytes / sizeof(KdAccelNode);
+    const KdAccelNode *cachedNodes = (const KdAccelNode *)nodeData.data;
+    const int *indices = (const int *)indexData.data;
+    int nIndices = indexData.bytes / sizeof(int);
+
+    // Check that all offsets are in range and children follow their parents
+    int nPrimitives = primitives.size();
+    for (int i = 0; i < nNodes; ++i) {
+        const KdAccelNode &node = cachedNodes[i];
+        bool valid;
+        if (!node.IsLeaf() && layout == Layout::Clustered)
+            valid = node.AboveChild() - 1 > i && node.AboveChild() < nNodes;
+        else if (!node.IsLeaf())
+            valid = i + 1 < nNodes && node.AboveChild() > i &&
+                    node.AboveChild() < nNodes;
+        else if (node.nPrimitives() == 1)
+            valid = node.onePrimitive >= 0 && node.onePrimitive < nPrimitives;
+        else
+            valid = node.nPrimitives() == 0 ||
+                    (node.primitiveIndicesOffset >= 0 &&
+                     node.primitiveIndicesOffset <=
+                         nIndices - node.nPrimitives());
+        if (!valid) {
+            Warning("Ignoring inconsistent cached kd-tree.");
+            return false;
+        }
+    }
+    for (int i = 0; i < nIndices; ++i)
+        if (indices[i] < 0 || indices[i] >= nPrimitives) return false;
+
+    // Use the mapped nodes in place
+    nodes = (KdAccelNode *)cachedNodes;
+    nAllocedNodes = nextFreeNode = nNodes;
+    primitiveIndices.assign(indices, indices + nIndices);
+    cacheFile = std::move(file);
+    return true;
+}
+
+void KdTreeAccel::writeCache(uint64_t key) const {
+    AccelCacheFile::Write(
+        "kdtree", key,
+        {{nodes, nextFreeNode * sizeof(KdAccelNode)},
+         {primitiveIndices.data(), primitiveIndices.size() * sizeof(int)}});
 }
 
 void KdAccelNode::InitLeaf(int *primNums, int np,
@@ -135,131 +351,348 @@ void KdAccelNode::InitLeaf(int *primNums, int np,
     }
 }
 
-KdTreeAccel::~KdTreeAccel() { FreeAligned(nodes); }
+KdTreeAccel::~KdTreeAccel() {
+    if (!cacheFile) FreeAligned(nodes);
+}
 
-void KdTreeAccel::buildTree(int nodeNum, const Bounds3f &nodeBounds,
+bool KdTreeAccel::findSplit(const Bounds3f &nodeBounds,
                             const std::vector<Bounds3f> &allPrimBounds,
-                            int *primNums, int nPrimitives, int depth,
-                            const std::unique_ptr<BoundEdge[]> edges[3],
-                            int *prims0, int *prims1, int badRefines) {
-    CHECK_EQ(nodeNum, nextFreeNode);
-    // Get next free node from _nodes_ array
-    if (nextFreeNode == nAllocedNodes) {
-        int nNewAllocNodes = std::max(2 * nAllocedNodes, 512);
-        KdAccelNode *n = AllocAligned<KdAccelNode>(nNewAllocNodes);
-        if (nAllocedNodes > 0) {
-            memcpy(n, nodes, nAllocedNodes * sizeof(KdAccelNode));
-            FreeAligned(nodes);
-        }
-        nodes = n;
-        nAllocedNodes = nNewAllocNodes;
-    }
-    ++nextFreeNode;
-
-    // Initialize leaf node if termination criteria met
-    if (nPrimitives <= maxPrims || depth == 0) {
-        nodes[nodeNum].InitLeaf(primNums, nPrimitives, &primitiveIndices);
-        return;
-    }
-
-    // Initialize interior node and continue recursion
-
+                            const int *primNums, int nPrimitives,
+                            BoundEdge *edges, int *badRefines, int *bestAxis,
+                            int *bestOffset) const {
     // Choose split axis position for interior node
-    int bestAxis = -1, bestOffset = -1;
+    *bestAxis = -1;
+    *bestOffset = -1;
     Float bestCost = Infinity;
     Float oldCost = isectCost * Float(nPrimitives);
-    Float totalSA = nodeBounds.SurfaceArea();
-    Float invTotalSA = 1 / totalSA;
-    Vector3f d = nodeBounds.pMax - nodeBounds.pMin;
+    bool parallelSweep = nPrimitives >= parallelSweepThreshold;
+    int nChunks = (2 * nPrimitives + parallelChunkSize - 1) / parallelChunkSize;
 
-    // Choose which axis to split along
+    // Choose which axis to split along, trying the others if no split
+    // along it is found
     int axis = nodeBounds.MaximumExtent();
-    int retries = 0;
-retrySplit:
-
-    // Initialize edges for _axis_
-    for (int i = 0; i < nPrimitives; ++i) {
-        int pn = primNums[i];
-        const Bounds3f &bounds = allPrimBounds[pn];
-        edges[axis][2 * i] = BoundEdge(bounds.pMin[axis], pn, true);
-        edges[axis][2 * i + 1] = BoundEdge(bounds.pMax[axis], pn, false);
+    for (int retries = 0; retries < 3 && *bestAxis == -1; ++retries) {
+        // Initialize edges for _axis_
+        auto initEdges = [&](int start, int end) {
+            for (int i = start; i < end; ++i) {
+                int pn = primNums[i];
+                const Bounds3f &bounds = allPrimBounds[pn];
+                edges[2 * i] = BoundEdge(bounds.pMin[axis], pn, true);
+                edges[2 * i + 1] = BoundEdge(bounds.pMax[axis], pn, false);
+            }
+        };
+        if (!parallelSweep)
+            initEdges(0, nPrimitives);
+        else
+            ParallelFor([&](int64_t c) {
+                int start = c * parallelChunkSize / 2;
+                initEdges(start,
+                          std::min(start + parallelChunkSize / 2, nPrimitives));
+            }, nChunks, 1);
+
+        // Sort _edges_ for _axis_
+        SortEdges(edges, 2 * nPrimitives);
+
+        // Compute cost of all splits for _axis_ to find best
+        if (!parallelSweep)
+            SweepEdges(edges, 0, 2 * nPrimitives, 0, nPrimitives, axis,
+                       nodeBounds, isectCost, traversalCost, emptyBonus,
+                       &bestCost, bestOffset);
+        else {
+            // Count the edges of each chunk to find the number of
+            // primitives below and above its first edge, then sweep the
+            // chunks in parallel and take the first lowest-cost split
+            std::vector<int> nStarting(nChunks), nEnding(nChunks);
+            auto chunkRange = [&](int c, int *start, int *end) {
+                *start = c * parallelChunkSize;
+                *end = std::min(*start + parallelChunkSize, 2 * nPrimitives);
+            };
+            ParallelFor([&](int64_t c) {
+                int start, end;
+                chunkRange(c, &start, &end);
+                for (int i = start; i < end; ++i) {
+                    if (edges[i].type == EdgeType::Start)
+                        ++nStarting[c];
+                    else
+                        ++nEnding[c];
+                }
+            }, nChunks, 1);
+            std::vector<Float> chunkCost(nChunks, Infinity);
+            std::vector<int> chunkOffset(nChunks, -1);
+            ParallelFor([&](int64_t c) {
+                int nBelow = 0, nAbove = nPrimitives;
+                for (int prev = 0; prev < c; ++prev) {
+                    nBelow += nStarting[prev];
+                    nAbove -= nEnding[prev];
+                }
+                int start, end;
+                chunkRange(c, &start, &end);
+                SweepEdges(edges, start, end, nBelow, nAbove, axis,
+                           nodeBounds, isectCost, traversalCost, emptyBonus,
+                           &chunkCost[c], &chunkOffset[c]);
+            }, nChunks, 1);
+            for (int c = 0; c < nChunks; ++c)
+                if (chunkCost[c] < bestCost) {
+                    bestCost = chunkCost[c];
+                    *bestOffset = chunkOffset[c];
+                }
+        }
+        if (*bestOffset != -1)
+            *bestAxis = axis;
+        else
+            axis = (axis + 1) % 3;
     }
 
-    // Sort _edges_ for _axis_
-    std::sort(&edges[axis][0], &edges[axis][2 * nPrimitives],
-              [](const BoundEdge &e0, const BoundEdge &e1) -> bool {
-                  if (e0.t == e1.t)
-                      return (int)e0.type < (int)e1.type;
-                  else
-                      return e0.t < e1.t;
-              });
+    // Create leaf if no good splits were found
+    if (bestCost > oldCost) ++*badRefines;
+    return !((bestCost > 4 * oldCost && nPrimitives < 16) || *bestAxis == -1 ||
+             *badRefines == 3);
+}
 
-    // Compute cost of all splits for _axis_ to find best
-    int nBelow = 0, nAbove = nPrimitives;
-    for (int i = 0; i < 2 * nPrimitives; ++i) {
-        if (edges[axis][i].type == EdgeType::End) --nAbove;
-        Float edgeT = edges[axis][i].t;
-        if (edgeT > nodeBounds.pMin[axis] && edgeT < nodeBounds.pMax[axis]) {
-            // Compute cost for split at _i_th edge
+KdBuildNode *KdTreeAccel::buildTree(
+    MemoryArena *arenas, KdBuildScratch *scratch, const Bounds3f &rootBounds,
+    const std::vector<Bounds3f> &allPrimBounds, std::vector<int> primNums,
+    int maxDepth, std::atomic<int> *totalNodes) const {
+    // Each task builds the node or subtree for _primNums_ and stores it
+    // through _node_
+    struct BuildTask {
+        Bounds3f bounds;
+        std::vector<int> primNums;
+        int depth = 0, badRefines = 0;
+        KdBuildNode **node = nullptr;
+    };
 
-            // Compute child surface areas for split at _edgeT_
-            int otherAxis0 = (axis + 1) % 3, otherAxis1 = (axis + 2) % 3;
-            Float belowSA = 2 * (d[otherAxis0] * d[otherAxis1] +
-                                 (edgeT - nodeBounds.pMin[axis]) *
-                                     (d[otherAxis0] + d[otherAxis1]));
-            Float aboveSA = 2 * (d[otherAxis0] * d[otherAxis1] +
-                                 (nodeBounds.pMax[axis] - edgeT) *
-                                     (d[otherAxis0] + d[otherAxis1]));
-            Float pBelow = belowSA * invTotalSA;
-            Float pAbove = aboveSA * invTotalSA;
-            Float eb = (nAbove == 0 || nBelow == 0) ? emptyBonus : 0;
-            Float cost =
-                traversalCost +
-                isectCost * (1 - eb) * (pBelow * nBelow + pAbove * nAbove);
+    // Builds a small task's subtree serially using this thread's working
+    // memory
+    auto buildSerially = [&](BuildTask &task) {
+        int nPrimitives = task.primNums.size();
+        KdBuildScratch &s = scratch[ThreadIndex];
+        s.edges.resize(std::max<size_t>(s.edges.size(), 2 * nPrimitives));
+        s.prims0.resize(std::max<size_t>(s.prims0.size(), nPrimitives));
+        s.prims1.resize(std::max<size_t>(s.prims1.size(),
+                                         (task.depth + 1) * nPrimitives));
+        *task.node = buildSubtree(
+            arenas[ThreadIndex], task.bounds, allPrimBounds,
+            task.primNums.data(), nPrimitives, task.depth, task.badRefines,
+            s.edges.data(), s.prims0.data(), s.prims1.data(), totalNodes);
+    };
 
-            // Update best split if this is lowest cost so far
-            if (cost < bestCost) {
-                bestCost = cost;
-                bestAxis = axis;
-                bestOffset = i;
+    KdBuildNode *root = nullptr;
+    std::vector<BuildTask> level(1), subtrees;
+    level[0].bounds = rootBounds;
+    level[0].primNums = std::move(primNums);
+    level[0].depth = maxDepth;
+    level[0].node = &root;
+    if (level[0].primNums.size() < parallelBuildThreshold) {
+        buildSerially(level[0]);
+        return root;
+    }
+
+    // Split the nodes with at least _parallelBuildThreshold_ primitives
+    // level by level, all nodes of a level at once
+    while (!level.empty()) {
+        // Split the _i_th node of the level, leaving tasks for its children
+        // in _children[2 * i]_ and _children[2 * i + 1]_
+        int nTasks = level.size();
+        std::vector<BuildTask> children(2 * nTasks);
+        auto splitTask = [&](int64_t i) {
+            const BuildTask &task = level[i];
+            MemoryArena &arena = arenas[ThreadIndex];
+            KdBuildNode *node = arena.Alloc<KdBuildNode>();
+            *task.node = node;
+            ++*totalNodes;
+            int nPrimitives = task.primNums.size();
+            if (nPrimitives <= maxPrims || task.depth == 0) {
+                node->InitLeaf(arena, task.primNums.data(), nPrimitives);
+                return;
             }
+
+            // Find the split; the edges stay in this thread's buffer until
+            // the primitives have been classified
+            std::vector<BoundEdge> &edgeBuffer = scratch[ThreadIndex].edges;
+            edgeBuffer.resize(
+                std::max<size_t>(edgeBuffer.size(), 2 * nPrimitives));
+            BoundEdge *edges = edgeBuffer.data();
+            int badRefines = task.badRefines, bestAxis, bestOffset;
+            if (!findSplit(task.bounds, allPrimBounds, task.primNums.data(),
+                           nPrimitives, edges, &badRefines, &bestAxis,
+                           &bestOffset)) {
+                node->InitLeaf(arena, task.primNums.data(), nPrimitives);
+                return;
+            }
+
+            // Classify primitives with respect to split
+            Float tSplit = edges[bestOffset].t;
+            node->InitInterior(bestAxis, tSplit);
+            for (int c = 0; c < 2; ++c) {
+                BuildTask &child = children[2 * i + c];
+                child.bounds = task.bounds;
+                if (c == 0)
+                    child.bounds.pMax[bestAxis] = tSplit;
+                else
+                    child.bounds.pMin[bestAxis] = tSplit;
+                child.depth = task.depth - 1;
+                child.badRefines = badRefines;
+                child.node = &node->children[c];
+            }
+            std::vector<int> &prims0 = children[2 * i].primNums;
+            std::vector<int> &prims1 = children[2 * i + 1].primNums;
+            int n0 = 0, n1 = 0;
+            for (int e = 0; e < bestOffset; ++e)
+                n0 += edges[e].type == EdgeType::Start;
+            for (int e = bestOffset + 1; e < 2 * nPrimitives; ++e)
+                n1 += edges[e].type == EdgeType::End;
+            prims0.resize(n0);
+            prims1.resize(n1);
+            n0 = n1 = 0;
+            for (int e = 0; e < bestOffset; ++e)
+                if (edges[e].type == EdgeType::Start)
+                    prims0[n0++] = edges[e].primNum;
+            for (int e = bestOffset + 1; e < 2 * nPrimitives; ++e)
+                if (edges[e].type == EdgeType::End)
+                    prims1[n1++] = edges[e].primNum;
+        };
+
+        // The largest nodes sort and sweep their edges in parallel, one at a
+        // time; the others are split in parallel with each other
+        for (int i = 0; i < nTasks; ++i)
+            if (level[i].primNums.size() >= parallelSweepThreshold)
+                splitTask(i);
+        ParallelFor([&](int64_t i) {
+            if (level[i].primNums.size() < parallelSweepThreshold)
+                splitTask(i);
+        }, nTasks, 1);
+
+        // Queue the children for the next level or as subtrees
+        std::vector<BuildTask> nextLevel;
+        for (BuildTask &child : children) {
+            if (!child.node) continue;
+            if (child.primNums.size() >= parallelBuildThreshold)
+                nextLevel.push_back(std::move(child));
+            else
+                subtrees.push_back(std::move(child));
         }
-        if (edges[axis][i].type == EdgeType::Start) ++nBelow;
+        level.swap(nextLevel);
     }
-    CHECK(nBelow == nPrimitives && nAbove == 0);
 
-    // Create leaf if no good splits were found
-    if (bestAxis == -1 && retries < 2) {
-        ++retries;
-        axis = (axis + 1) % 3;
-        goto retrySplit;
+    // Build the subtrees in parallel, largest first
+    std::sort(subtrees.begin(), subtrees.end(),
+              [](const BuildTask &a, const BuildTask &b) {
+                  return a.primNums.size() > b.primNums.size();
+              });
+    ParallelFor([&](int64_t i) { buildSerially(subtrees[i]); },
+                subtrees.size(), 1);
+    return root;
+}
+
+KdBuildNode *KdTreeAccel::buildSubtree(
+    MemoryArena &arena, const Bounds3f &nodeBounds,
+    const std::vector<Bounds3f> &allPrimBounds, int *primNums,
+    int nPrimitives, int depth, int badRefines, BoundEdge *edges, int *prims0,
+    int *prims1, std::atomic<int> *totalNodes) const {
+    KdBuildNode *node = arena.Alloc<KdBuildNode>();
+    ++*totalNodes;
+
+    // Initialize leaf node if termination criteria met
+    if (nPrimitives <= maxPrims || depth == 0) {
+        node->InitLeaf(arena, primNums, nPrimitives);
+        return node;
     }
-    if (bestCost > oldCost) ++badRefines;
-    if ((bestCost > 4 * oldCost && nPrimitives < 16) || bestAxis == -1 ||
-        badRefines == 3) {
-        nodes[nodeNum].InitLeaf(primNums, nPrimitives, &primitiveIndices);
-        return;
+
+    // Initialize interior node and continue recursion
+    int bestAxis, bestOffset;
+    if (!findSplit(nodeBounds, allPrimBounds, primNums, nPrimitives, edges,
+                   &badRefines, &bestAxis, &bestOffset)) {
+        node->InitLeaf(arena, primNums, nPrimitives);
+        return node;
     }
 
     // Classify primitives with respect to split
     int n0 = 0, n1 = 0;
     for (int i = 0; i < bestOffset; ++i)
-        if (edges[bestAxis][i].type == EdgeType::Start)
-            prims0[n0++] = edges[bestAxis][i].primNum;
+        if (edges[i].type == EdgeType::Start)
+            prims0[n0++] = edges[i].primNum;
     for (int i = bestOffset + 1; i < 2 * nPrimitives; ++i)
-        if (edges[bestAxis][i].type == EdgeType::End)
-            prims1[n1++] = edges[bestAxis][i].primNum;
+        if (edges[i].type == EdgeType::End)
+            prims1[n1++] = edges[i].primNum;
 
     // Recursively initialize children nodes
-    Float tSplit = edges[bestAxis][bestOffset].t;
+    Float tSplit = edges[bestOffset].t;
     Bounds3f bounds0 = nodeBounds, bounds1 = nodeBounds;
     bounds0.pMax[bestAxis] = bounds1.pMin[bestAxis] = tSplit;
-    buildTree(nodeNum + 1, bounds0, allPrimBounds, prims0, n0, depth - 1, edges,
-              prims0, prims1 + nPrimitives, badRefines);
-    int aboveChild = nextFreeNode;
-    nodes[nodeNum].InitInterior(bestAxis, aboveChild, tSplit);
-    buildTree(aboveChild, bounds1, allPrimBounds, prims1, n1, depth - 1, edges,
-              prims0, prims1 + nPrimitives, badRefines);
+    node->InitInterior(bestAxis, tSplit);
+    node->children[0] = buildSubtree(arena, bounds0, allPrimBounds, prims0, n0,
+                                     depth - 1, badRefines, edges, prims0,
+                                     prims1 + nPrimitives, totalNodes);
+    node->children[1] = buildSubtree(arena, bounds1, allPrimBounds, prims1, n1,
+                                     depth - 1, badRefines, edges, prims0,
+                                     prims1 + nPrimitives, totalNodes);
+    return node;
+}
+
+int KdTreeAccel::flattenDepthFirst(const KdBuildNode *node,
+                                   std::vector<KdAccelNode> &linearNodes) {
+    int offset = linearNodes.size();
+    linearNodes.push_back(KdAccelNode());
+    if (node->IsLeaf())
+        linearNodes[offset].InitLeaf(node->primNums, node->nPrimitives,
+                                     &primitiveIndices);
+    else {
+        flattenDepthFirst(node->children[0], linearNodes);
+        int aboveChild = flattenDepthFirst(node->children[1], linearNodes);
+        linearNodes[offset].InitInterior(node->splitAxis, aboveChild,
+                                         node->split);
+    }
+    return offset;
+}
+
+void KdTreeAccel::flattenClustered(const KdBuildNode *parent, int parentOffset,
+                                   std::vector<KdAccelNode> &linearNodes) {
+    PBRT_CONSTEXPR int nodesPerLine = 64 / sizeof(KdAccelNode);
+    PBRT_CONSTEXPR int pairsPerLine = nodesPerLine / 2;
+    // Choose the interior nodes whose child pairs go in this cache line,
+    // breadth-first from _parent_
+    std::vector<const KdBuildNode *> queue(1, parent);
+    std::vector<int> queueOffsets(1, parentOffset);
+    int nPairs = 0;
+    while (nPairs < (int)queue.size() && nPairs < pairsPerLine) {
+        const KdBuildNode *node = queue[nPairs++];
+        for (const KdBuildNode *child : node->children)
+            if (!child->IsLeaf()) queue.push_back(child);
+    }
+    queueOffsets.resize(queue.size(), -1);
+
+    // Pad with empty leaves if the pairs would straddle a cache line
+    int lineOffset = linearNodes.size() % nodesPerLine;
+    if (lineOffset + 2 * nPairs > nodesPerLine) {
+        int nPadding = nodesPerLine - lineOffset;
+        for (int i = 0; i < nPadding; ++i) {
+            linearNodes.push_back(KdAccelNode());
+            linearNodes.back().InitLeaf(nullptr, 0, &primitiveIndices);
+        }
+    }
+
+    // Emit the child pairs; interior children are the next ones queued
+    int nextQueued = 1;
+    for (int p = 0; p < nPairs; ++p) {
+        const KdBuildNode *node = queue[p];
+        int firstChild = linearNodes.size();
+        linearNodes.resize(firstChild + 2);
+        linearNodes[queueOffsets[p]].InitInterior(node->splitAxis,
+                                                  firstChild + 1, node->split);
+        for (int c = 0; c < 2; ++c) {
+            const KdBuildNode *child = node->children[c];
+            if (child->IsLeaf())
+                linearNodes[firstChild + c].InitLeaf(
+                    child->primNums, child->nPrimitives, &primitiveIndices);
+            else
+                queueOffsets[nextQueued++] = firstChild + c;
+        }
+    }
+
+    // Lay out the subtrees below this cache line depth-first
+    for (size_t i = nPairs; i < queue.size(); ++i)
+        flattenClustered(queue[i], queueOffsets[i], linearNodes);
 }
 
 bool KdTreeAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
@@ -290,16 +723,19 @@ bool KdTreeAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
             Float tPlane = (node->SplitPos() - ray.o[axis]) * invDir[axis];
 
             // Get node children pointers for ray
+            const KdAccelNode *aboveChild = &nodes[node->AboveChild()];
+            const KdAccelNode *belowChild =
+                layout == Layout::Clustered ? aboveChild - 1 : node + 1;
             const KdAccelNode *firstChild, *secondChild;
             int belowFirst =
                 (ray.o[axis] < node->SplitPos()) ||
                 (ray.o[axis] == node->SplitPos() && ray.d[axis] <= 0);
             if (belowFirst) {
-                firstChild = node + 1;
-                secondChild = &nodes[node->AboveChild()];
+                firstChild = belowChild;
+                secondChild = aboveChild;
             } else {
-                firstChild = &nodes[node->AboveChild()];
-                secondChild = node + 1;
+                firstChild = aboveChild;
+                secondChild = belowChild;
             }
 
             // Advance to next child node, possibly enqueue other child
@@ -399,16 +835,19 @@ bool KdTreeAccel::IntersectP(const Ray &ray) const {
             Float tPlane = (node->SplitPos() - ray.o[axis]) * invDir[axis];
 
             // Get node children pointers for ray
+            const KdAccelNode *aboveChild = &nodes[node->AboveChild()];
+            const KdAccelNode *belowChild =
+                layout == Layout::Clustered ? aboveChild - 1 : node + 1;
             const KdAccelNode *firstChild, *secondChild;
             int belowFirst =
                 (ray.o[axis] < node->SplitPos()) ||
                 (ray.o[axis] == node->SplitPos() && ray.d[axis] <= 0);
             if (belowFirst) {
-                firstChild = node + 1;
-                secondChild = &nodes[node->AboveChild()];
+                firstChild = belowChild;
+                secondChild = aboveChild;
             } else {
-                firstChild = &nodes[node->AboveChild()];
-                secondChild = node + 1;
+                firstChild = aboveChild;
+                secondChild = belowChild;
             }
 
             // Advance to next child node, possibly enqueue other child
@@ -437,8 +876,15 @@ std::shared_ptr<KdTreeAccel> CreateKdTreeAccelerator(
     Float emptyBonus = ps.FindOneFloat("emptybonus", 0.5f);
     int maxPrims = ps.FindOneInt("maxprims", 1);
     int maxDepth = ps.FindOneInt("maxdepth", -1);
+    std::string layoutName = ps.FindOneString("layout", "depthfirst");
+    KdTreeAccel::Layout layout = KdTreeAccel::Layout::DepthFirst;
+    if (layoutName == "clustered")
+        layout = KdTreeAccel::Layout::Clustered;
+    else if (layoutName != "depthfirst")
+        Warning("Kd-tree layout \"%s\" unknown.  Using \"depthfirst\".",
+                layoutName.c_str());
     return std::make_shared<KdTreeAccel>(prims, isectCost, travCost, emptyBonus,
-                                         maxPrims, maxDepth);
+                                         maxPrims, maxDepth, layout);
 }
 
 }  // namespace pbrt
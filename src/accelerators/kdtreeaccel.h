@@ -41,18 +41,30 @@
 // accelerators/kdtreeaccel.h*
 #include "pbrt.h"
 #include "primitive.h"
+#include <atomic>
 
 namespace pbrt {
 
 // KdTreeAccel Declarations
+class AccelCacheFile;
 struct KdAccelNode;
+struct KdBuildNode;
+struct KdBuildScratch;
 struct BoundEdge;
 class KdTreeAccel : public Aggregate {
   public:
+    // In the _DepthFirst_ layout, an interior node's below child directly
+    // follows it and its above child follows the below child's subtree.
+    // The _Clustered_ layout stores the two children next to each other and
+    // packs small subtrees into single cache lines, which are in turn laid
+    // out depth-first.
+    enum class Layout { DepthFirst, Clustered };
+
     // KdTreeAccel Public Methods
     KdTreeAccel(const std::vector<std::shared_ptr<Primitive>> &p,
                 int isectCost = 80, int traversalCost = 1,
-                Float emptyBonus = 0.5, int maxPrims = 1, int maxDepth = -1);
+                Float emptyBonus = 0.5, int maxPrims = 1, int maxDepth = -1,
+                Layout layout = Layout::DepthFirst);
     Bounds3f WorldBound() const { return bounds; }
     ~KdTreeAccel();
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
@@ -60,20 +72,39 @@ class KdTreeAccel : public Aggregate {
 
   private:
     // KdTreeAccel Private Methods
-    void buildTree(int nodeNum, const Bounds3f &bounds,
-                   const std::vector<Bounds3f> &primBounds, int *primNums,
-                   int nprims, int depth,
-                   const std::unique_ptr<BoundEdge[]> edges[3], int *prims0,
-                   int *prims1, int badRefines = 0);
+    bool findSplit(const Bounds3f &nodeBounds,
+                   const std::vector<Bounds3f> &allPrimBounds,
+                   const int *primNums, int nPrimitives, BoundEdge *edges,
+                   int *badRefines, int *bestAxis, int *bestOffset) const;
+    KdBuildNode *buildTree(MemoryArena *arenas, KdBuildScratch *scratch,
+                           const Bounds3f &rootBounds,
+                           const std::vector<Bounds3f> &allPrimBounds,
+                           std::vector<int> primNums, int maxDepth,
+                           std::atomic<int> *totalNodes) const;
+    KdBuildNode *buildSubtree(MemoryArena &arena, const Bounds3f &nodeBounds,
+                              const std::vector<Bounds3f> &allPrimBounds,
+                              int *primNums, int nPrimitives, int depth,
+                              int badRefines, BoundEdge *edges, int *prims0,
+                              int *prims1,
+                              std::atomic<int> *totalNodes) const;
+    int flattenDepthFirst(const KdBuildNode *node,
+                          std::vector<KdAccelNode> &linearNodes);
+    void flattenClustered(const KdBuildNode *parent, int parentOffset,
+                          std::vector<KdAccelNode> &linearNodes);
+    bool loadCache(uint64_t key);
+    void writeCache(uint64_t key) const;
 
     // KdTreeAccel Private Data
     const int isectCost, traversalCost, maxPrims;
     const Float emptyBonus;
+    const Layout layout;
     std::vector<std::shared_ptr<Primitive>> primitives;
     std::vector<int> primitiveIndices;
     KdAccelNode *nodes;
     int nAllocedNodes, nextFreeNode;
     Bounds3f bounds;
+    // Holds the mapping _nodes_ points into, if loaded
+    std::unique_ptr<AccelCacheFile> cacheFile;
 };
 
 struct KdToDo {
@@ -0,0 +1,250 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+// accelerators/pagedmesh.cpp*
+#include "accelerators/pagedmesh.h"
+#include "accelerators/bvh.h"
+#include "shapes/plymesh.h"
+#include "shapes/triangle.h"
+#include "paramset.h"
+#include "stats.h"
+#include <algorithm>
+
+namespace pbrt {
+
+STAT_COUNTER("Geometry paging/Meshes loaded", nMeshLoads);
+STAT_COUNTER("Geometry paging/Meshes evicted", nMeshEvictions);
+STAT_INT_DISTRIBUTION("Geometry paging/Resident megabytes after load",
+                      residentMegabytes);
+
+// PagedMeshPrimitive Local Declarations
+
+// Bytes that _std::make_shared()_ allocates along with an object for its
+// control block: a virtual function table pointer and two reference counts
+static PBRT_CONSTEXPR size_t sharedControlBytes =
+    sizeof(void *) + 2 * sizeof(int);
+
+struct PagedGeometry {
+    std::shared_ptr<BVHAccel> bvh;
+    size_t bytes = 0;
+};
+
+// Keeps track of the resident paged meshes and evicts the least recently
+// used ones when they exceed the geometry budget.  Recency is measured in
+// loads: each load advances the epoch, and meshes record the epoch they
+// were last hit in, which only writes to them once per load.
+class GeometryPager {
+  public:
+    static GeometryPager &Get() {
+        static GeometryPager pager;
+        return pager;
+    }
+    uint64_t Epoch() const { return epoch.load(std::memory_order_relaxed); }
+    void Loaded(const PagedMeshPrimitive *mesh, size_t bytes);
+    void Destroyed(const PagedMeshPrimitive *mesh);
+
+  private:
+    std::mutex mutex;
+    std::vector<const PagedMeshPrimitive *> resident;
+    size_t residentBytes = 0;
+    std::atomic<uint64_t> epoch{0};
+};
+
+void GeometryPager::Loaded(const PagedMeshPrimitive *mesh, size_t bytes) {
+    // Evicted geometry is freed after _mutex_ is released
+    std::vector<std::shared_ptr<const PagedGeometry>> evicted;
+    std::lock_guard<std::mutex> lock(mutex);
+    mesh->lastUse.store(++epoch, std::memory_order_relaxed);
+    resident.push_back(mesh);
+    residentBytes += bytes;
+
+    size_t budget = size_t(PbrtOptions.geometryBudget * (1 << 20));
+    while (budget > 0 && residentBytes > budget && resident.size() > 1) {
+        // Evict the least recently used mesh other than _mesh_
+        size_t lru = 0;
+        uint64_t lruEpoch = ~uint64_t(0);
+        for (size_t i = 0; i < resident.size(); ++i) {
+            uint64_t e = resident[i]->lastUse.load(std::memory_order_relaxed);
+            if (resident[i] != mesh && e < lruEpoch) {
+                lru = i;
+                lruEpoch = e;
+            }
+        }
+        const PagedMeshPrimitive *victim = resident[lru];
+        std::shared_ptr<const PagedGeometry> g =
+            std::atomic_load(&victim->geometry);
+        std::atomic_store(&victim->geometry,
+                          std::shared_ptr<const PagedGeometry>());
+        residentBytes -= g->bytes;
+        evicted.push_back(std::move(g));
+        resident[lru] = resident.back();
+        resident.pop_back();
+        ++nMeshEvictions;
+    }
+    ReportValue(residentMegabytes, residentBytes >> 20);
+}
+
+void GeometryPager::Destroyed(const PagedMeshPrimitive *mesh) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iter = std::find(resident.begin(), resident.end(), mesh);
+    if (iter == resident.end()) return;
+    residentBytes -= std::atomic_load(&mesh->geometry)->bytes;
+    *iter = resident.back();
+    resident.pop_back();
+}
+
+// PagedMeshPrimitive Method Definitions
+PagedMeshPrimitive::PagedMeshPrimitive(
+    const Bounds3f &worldBound, Loader loader,
+    const std::shared_ptr<Material> &material,
+    const MediumInterface &mediumInterface)
+    : worldBound(worldBound),
+      loader(std::move(loader)),
+      material(material),
+      mediumInterface(mediumInterface),
+      lastUse(0) {}
+
+PagedMeshPrimitive::~PagedMeshPrimitive() {
+    GeometryPager::Get().Destroyed(this);
+}
+
+std::shared_ptr<const PagedGeometry> PagedMeshPrimitive::Acquire() const {
+    GeometryPager &pager = GeometryPager::Get();
+    std::shared_ptr<const PagedGeometry> g = std::atomic_load(&geometry);
+    if (g) {
+        uint64_t epoch = pager.Epoch();
+        if (lastUse.load(std::memory_order_relaxed) != epoch)
+            lastUse.store(epoch, std::memory_order_relaxed);
+        return g;
+    }
+
+    // Load the mesh unless another thread has done so in the meantime
+    std::lock_guard<std::mutex> lock(loadMutex);
+    g = std::atomic_load(&geometry);
+    if (g) return g;
+    std::shared_ptr<PagedGeometry> loaded = std::make_shared<PagedGeometry>();
+    std::vector<std::shared_ptr<Shape>> shapes = loader(&loaded->bytes);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    prims.reserve(shapes.size());
+    for (const auto &s : shapes)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            s, material, nullptr, mediumInterface));
+    // A mesh that fails to load stays resident without any primitives so
+    // that it isn't read again for every ray
+    if (!prims.empty()) loaded->bvh = std::make_shared<BVHAccel>(prims, 4);
+    // Each shape, primitive, the BVH and _loaded_ itself are allocated with
+    // a _make_shared()_ control block.  The BVH holds the only references
+    // to the primitives that are kept; as it stores triangles compactly,
+    // only a few of them and their triangles remain of those _loader_
+    // counted.
+    size_t nKept = loaded->bvh ? loaded->bvh->NumPrimitives() : 0;
+    loaded->bytes -= shapes.size() * sizeof(Triangle);
+    loaded->bytes += sizeof(PagedGeometry) +
+                     (2 * nKept + 2) * sharedControlBytes +
+                     nKept * (sizeof(GeometricPrimitive) + sizeof(Triangle));
+    if (loaded->bvh) loaded->bytes += loaded->bvh->MemoryBytes();
+    ++nMeshLoads;
+    std::atomic_store(&geometry,
+                      std::shared_ptr<const PagedGeometry>(loaded));
+    pager.Loaded(this, loaded->bytes);
+    return loaded;
+}
+
+bool PagedMeshPrimitive::IsResident() const {
+    return std::atomic_load(&geometry) != nullptr;
+}
+
+bool PagedMeshPrimitive::Intersect(const Ray &r,
+                                   SurfaceInteraction *isect) const {
+    // Don't load the mesh for rays that only pass through the node bounds
+    if (!worldBound.IntersectP(r)) return false;
+    std::shared_ptr<const PagedGeometry> g = Acquire();
+    if (!g->bvh || !g->bvh->Intersect(r, isect)) return false;
+    // The mesh may be evicted before the intersection is shaded, so point
+    // it at this primitive, which handles shading for all of its triangles
+    isect->primitive = this;
+    isect->shape = nullptr;
+    return true;
+}
+
+bool PagedMeshPrimitive::IntersectP(const Ray &r) const {
+    if (!worldBound.IntersectP(r)) return false;
+    std::shared_ptr<const PagedGeometry> g = Acquire();
+    return g->bvh && g->bvh->IntersectP(r);
+}
+
+void PagedMeshPrimitive::ComputeScatteringFunctions(
+    SurfaceInteraction *isect, MemoryArena &arena, TransportMode mode,
+    bool allowMultipleLobes) const {
+    ProfilePhase p(Prof::ComputeScatteringFuncs);
+    if (material)
+        material->ComputeScatteringFunctions(isect, arena, mode,
+                                             allowMultipleLobes);
+    CHECK_GE(Dot(isect->n, isect->shading.n), 0.);
+}
+
+std::shared_ptr<Primitive> CreatePagedPLYMesh(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    const std::shared_ptr<Material> &material,
+    const MediumInterface &mediumInterface) {
+    const std::string filename = params.FindOneFilename("filename", "");
+    Bounds3f objectBounds;
+    int nBounds;
+    const Float *b = params.FindFloat("bounds", &nBounds);
+    if (b && nBounds == 6)
+        objectBounds =
+            Bounds3f(Point3f(b[0], b[1], b[2]), Point3f(b[3], b[4], b[5]));
+    else {
+        if (b)
+            Warning("\"bounds\" for PLY file \"%s\" needs 6 values, %d given. "
+                    "Reading the bounds from the file.",
+                    filename.c_str(), nBounds);
+        if (!ReadPLYBounds(filename, &objectBounds)) return nullptr;
+    }
+
+    std::shared_ptr<Texture<Float>> alphaTex, shadowAlphaTex;
+    FindPLYAlphaTextures(params, floatTextures, &alphaTex, &shadowAlphaTex);
+    // The loaded triangles refer to the loader's copies of the transforms
+    Transform objectToWorld = *o2w, worldToObject = *w2o;
+    PagedMeshPrimitive::Loader loader = [=](size_t *bytes) {
+        return ReadPLYMesh(filename, &objectToWorld, &worldToObject,
+                           reverseOrientation, alphaTex, shadowAlphaTex,
+                           bytes);
+    };
+    return std::make_shared<PagedMeshPrimitive>(
+        objectToWorld(objectBounds), std::move(loader), material,
+        mediumInterface);
+}
+
+}  // namespace pbrt
@@ -0,0 +1,113 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_ACCELERATORS_PAGEDMESH_H
+#define PBRT_ACCELERATORS_PAGEDMESH_H
+
+// accelerators/pagedmesh.h*
+#include "pbrt.h"
+#include "primitive.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace pbrt {
+
+struct PagedGeometry;
+
+// PagedMeshPrimitive Declarations
+
+// A triangle mesh whose bounds are known up front but whose shapes and BVH
+// are only created when a ray first reaches its bounds.  The geometry of all
+// paged meshes is kept under the budget given by _Options::geometryBudget_;
+// when loading a mesh exceeds it, the least recently used meshes are
+// evicted and loaded again if rays reach them later.
+class PagedMeshPrimitive : public Primitive {
+  public:
+    // PagedMeshPrimitive Public Types
+
+    // Creates the mesh's shapes and sets _*bytes_ to the size of their
+    // vertex and index data
+    typedef std::function<std::vector<std::shared_ptr<Shape>>(size_t *bytes)>
+        Loader;
+
+    // PagedMeshPrimitive Public Methods
+    PagedMeshPrimitive(const Bounds3f &worldBound, Loader loader,
+                       const std::shared_ptr<Material> &material,
+                       const MediumInterface &mediumInterface);
+    ~PagedMeshPrimitive();
+    Bounds3f WorldBound() const { return worldBound; }
+    bool Intersect(const Ray &r, SurfaceInteraction *isect) const;
+    bool IntersectP(const Ray &r) const;
+    const AreaLight *GetAreaLight() const { return nullptr; }
+    const Material *GetMaterial() const { return material.get(); }
+    void ComputeScatteringFunctions(SurfaceInteraction *isect,
+                                    MemoryArena &arena, TransportMode mode,
+                                    bool allowMultipleLobes) const;
+    bool IsResident() const;
+
+  private:
+    // PagedMeshPrimitive Private Methods
+    std::shared_ptr<const PagedGeometry> Acquire() const;
+    friend class GeometryPager;
+
+    // PagedMeshPrimitive Private Data
+    const Bounds3f worldBound;
+    const Loader loader;
+    std::shared_ptr<Material> material;
+    MediumInterface mediumInterface;
+    mutable std::mutex loadMutex;
+    // Only accessed with _std::atomic_load()_ and _std::atomic_store()_
+    mutable std::shared_ptr<const PagedGeometry> geometry;
+    mutable std::atomic<uint64_t> lastUse;
+};
+
+// Creates a _PagedMeshPrimitive_ for a "plymesh" shape.  Its bounds are
+// given by the optional "float bounds" parameter, (xmin, ymin, zmin, xmax,
+// ymax, zmax) in object space, or else found by reading the file's vertex
+// positions once.
+std::shared_ptr<Primitive> CreatePagedPLYMesh(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    const std::shared_ptr<Material> &material,
+    const MediumInterface &mediumInterface);
+
+}  // namespace pbrt
+
+#endif  // PBRT_ACCELERATORS_PAGEDMESH_H
@@ -32,6 +32,7 @@
 
 // core/api.cpp*
 #include "api.h"
+#include "binaryscene.h"
 #include "parallel.h"
 #include "paramset.h"
 #include "spectrum.h"
@@ -43,6 +44,7 @@
 // API Additional Headers
 #include "accelerators/bvh.h"
 #include "accelerators/kdtreeaccel.h"
+#include "accelerators/pagedmesh.h"
 #include "cameras/environment.h"
 #include "cameras/orthographic.h"
 #include "cameras/perspective.h"
@@ -59,6 +61,7 @@
 #include "integrators/path.h"
 #include "integrators/sppm.h"
 #include "integrators/volpath.h"
+#include "integrators/wavefrontpath.h"
 #include "integrators/whitted.h"
 #include "lights/diffuse.h"
 #include "lights/distant.h"
@@ -183,6 +186,14 @@ struct RenderOptions {
     std::vector<std::shared_ptr<Primitive>> primitives;
     std::map<std::string, std::vector<std::shared_ptr<Primitive>>> instances;
     std::vector<std::shared_ptr<Primitive>> *currentInstance = nullptr;
+    // Object instances of the current frame and the objects they refer to
+    std::vector<std::shared_ptr<Primitive>> instancePrimitives;
+    std::vector<const Primitive *> instancedObjects;
+    // Top-level BVH over the previous frame's instances, which is refit
+    // when the same objects are instanced again
+    std::shared_ptr<BVHAccel> instanceAccel;
+    std::vector<std::shared_ptr<Primitive>> accelInstancePrimitives;
+    std::vector<const Primitive *> accelInstancedObjects;
     bool haveScatteringMedia = false;
 };
 
@@ -244,14 +255,54 @@ static std::vector<GraphicsState> pushedGraphicsStates;
 static std::vector<TransformSet> pushedTransforms;
 static std::vector<uint32_t> pushedActiveTransformBits;
 static TransformCache transformCache;
+// Transformations of shapes in named objects, which may be instanced again
+// after the world block they were defined in
+static TransformCache objectTransformCache;
+
+// Shapes that are read from files or tessellated are created in parallel
+// once the scene or an object instance needs them.  _PendingShape_ holds
+// the graphics state of the Shape directive and where its primitives and
+// area lights go.
+struct PendingShape {
+    std::string name;
+    ParamSet params;
+    // Where the Shape directive is, for warnings and errors reported while
+    // the shape is created
+    std::string file;
+    int line;
+    // The float textures the shape's parameters refer to
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    bool reverseOrientation;
+    Transform *ObjToWorld, *WorldToObj;
+    std::shared_ptr<Material> material;
+    MediumInterface mediumInterface;
+    std::string areaLight;
+    ParamSet areaLightParams;
+    Transform lightToWorld;
+    bool animated;
+    Transform *animatedObjToWorld[2];
+    Float startTime, endTime;
+    // The vector the primitives are added to, and the number of primitives
+    // and lights there were when the shape was declared
+    std::vector<std::shared_ptr<Primitive>> *target;
+    size_t primitiveOffset, lightOffset;
+
+    std::vector<std::shared_ptr<Shape>> shapes;
+    std::vector<std::shared_ptr<Primitive>> prims;
+    std::vector<std::shared_ptr<AreaLight>> areaLights;
+};
+
+static std::vector<PendingShape> pendingShapes;
+
 int catIndentCount = 0;
+static std::unique_ptr<BinarySceneWriter> binarySceneWriter;
 
 // API Forward Declarations
-std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
-                                               const Transform *ObjectToWorld,
-                                               const Transform *WorldToObject,
-                                               bool reverseOrientation,
-                                               const ParamSet &paramSet);
+std::vector<std::shared_ptr<Shape>> MakeShapes(
+    const std::string &name, const Transform *ObjectToWorld,
+    const Transform *WorldToObject, bool reverseOrientation,
+    const ParamSet &paramSet,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures);
 
 // API Macros
 #define VERIFY_INITIALIZED(func)                           \
@@ -288,6 +339,12 @@ std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
         if (activeTransformBits & (1 << i)) { \
             expr                              \
         }
+// With --tobinary, API calls are only recorded to the binary scene file
+#define WRITE_BINARY_SCENE(...)                    \
+    if (binarySceneWriter) {                       \
+        binarySceneWriter->Write(__VA_ARGS__);     \
+        return;                                    \
+    } else /* swallow trailing semicolon */
 #define WARN_IF_ANIMATED_TRANSFORM(func)                             \
     do {                                                             \
         if (curTransform.IsAnimated())                               \
@@ -298,11 +355,11 @@ std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
     } while (false) /* swallow trailing semicolon */
 
 // Object Creation Function Definitions
-std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
-                                               const Transform *object2world,
-                                               const Transform *world2object,
-                                               bool reverseOrientation,
-                                               const ParamSet &paramSet) {
+std::vector<std::shared_ptr<Shape>> MakeShapes(
+    const std::string &name, const Transform *object2world,
+    const Transform *world2object, bool reverseOrientation,
+    const ParamSet &paramSet,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures) {
     std::vector<std::shared_ptr<Shape>> shapes;
     std::shared_ptr<Shape> s;
     if (name == "sphere")
@@ -390,10 +447,10 @@ std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
         } else
             shapes = CreateTriangleMeshShape(object2world, world2object,
                                              reverseOrientation, paramSet,
-                                             &graphicsState.floatTextures);
+                                             floatTextures);
     } else if (name == "plymesh")
         shapes = CreatePLYMesh(object2world, world2object, reverseOrientation,
-                               paramSet, &graphicsState.floatTextures);
+                               paramSet, floatTextures);
     else if (name == "heightfield")
         shapes = CreateHeightfield(object2world, world2object,
                                    reverseOrientation, paramSet);
@@ -793,6 +850,14 @@ void pbrtInit(const Options &opt) {
     renderOptions.reset(new RenderOptions);
     graphicsState = GraphicsState();
     catIndentCount = 0;
+    if (!PbrtOptions.toBinary.empty()) {
+        binarySceneWriter = BinarySceneWriter::Create(PbrtOptions.toBinary);
+        if (!binarySceneWriter) {
+            Error("%s: unable to open binary scene file for writing",
+                  PbrtOptions.toBinary.c_str());
+            exit(1);
+        }
+    }
 
     // General \pbrt Initialization
     SampledSpectrum::Init();
@@ -809,11 +874,15 @@ void pbrtCleanup() {
         Error("pbrtCleanup() called while inside world block.");
     currentApiState = APIState::Uninitialized;
     ParallelCleanup();
+    pendingShapes.clear();
+    binarySceneWriter.reset();
     renderOptions.reset(nullptr);
+    objectTransformCache.Clear();
     CleanupProfiler();
 }
 
 void pbrtIdentity() {
+    WRITE_BINARY_SCENE(SceneCall::Identity);
     VERIFY_INITIALIZED("Identity");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] = Transform();)
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -821,6 +890,7 @@ void pbrtIdentity() {
 }
 
 void pbrtTranslate(Float dx, Float dy, Float dz) {
+    WRITE_BINARY_SCENE(SceneCall::Translate, {}, {dx, dy, dz});
     VERIFY_INITIALIZED("Translate");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] = curTransform[i] *
                                             Translate(Vector3f(dx, dy, dz));)
@@ -830,6 +900,7 @@ void pbrtTranslate(Float dx, Float dy, Float dz) {
 }
 
 void pbrtTransform(Float tr[16]) {
+    WRITE_BINARY_SCENE(SceneCall::Transform, {}, std::vector<Float>(tr, tr + 16));
     VERIFY_INITIALIZED("Transform");
     FOR_ACTIVE_TRANSFORMS(
         curTransform[i] = Transform(Matrix4x4(
@@ -843,6 +914,8 @@ void pbrtTransform(Float tr[16]) {
 }
 
 void pbrtConcatTransform(Float tr[16]) {
+    WRITE_BINARY_SCENE(SceneCall::ConcatTransform, {},
+                        std::vector<Float>(tr, tr + 16));
     VERIFY_INITIALIZED("ConcatTransform");
     FOR_ACTIVE_TRANSFORMS(
         curTransform[i] =
@@ -858,6 +931,7 @@ void pbrtConcatTransform(Float tr[16]) {
 }
 
 void pbrtRotate(Float angle, Float dx, Float dy, Float dz) {
+    WRITE_BINARY_SCENE(SceneCall::Rotate, {}, {angle, dx, dy, dz});
     VERIFY_INITIALIZED("Rotate");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] =
                               curTransform[i] *
@@ -868,6 +942,7 @@ void pbrtRotate(Float angle, Float dx, Float dy, Float dz) {
 }
 
 void pbrtScale(Float sx, Float sy, Float sz) {
+    WRITE_BINARY_SCENE(SceneCall::Scale, {}, {sx, sy, sz});
     VERIFY_INITIALIZED("Scale");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] =
                               curTransform[i] * Scale(sx, sy, sz);)
@@ -877,6 +952,8 @@ void pbrtScale(Float sx, Float sy, Float sz) {
 
 void pbrtLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz,
                 Float ux, Float uy, Float uz) {
+    WRITE_BINARY_SCENE(SceneCall::LookAt, {},
+                        {ex, ey, ez, lx, ly, lz, ux, uy, uz});
     VERIFY_INITIALIZED("LookAt");
     Transform lookAt =
         LookAt(Point3f(ex, ey, ez), Point3f(lx, ly, lz), Vector3f(ux, uy, uz));
@@ -890,6 +967,7 @@ void pbrtLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz,
 }
 
 void pbrtCoordinateSystem(const std::string &name) {
+    WRITE_BINARY_SCENE(SceneCall::CoordinateSystem, {name});
     VERIFY_INITIALIZED("CoordinateSystem");
     namedCoordinateSystems[name] = curTransform;
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -898,6 +976,7 @@ void pbrtCoordinateSystem(const std::string &name) {
 }
 
 void pbrtCoordSysTransform(const std::string &name) {
+    WRITE_BINARY_SCENE(SceneCall::CoordSysTransform, {name});
     VERIFY_INITIALIZED("CoordSysTransform");
     if (namedCoordinateSystems.find(name) != namedCoordinateSystems.end())
         curTransform = namedCoordinateSystems[name];
@@ -909,24 +988,28 @@ void pbrtCoordSysTransform(const std::string &name) {
 }
 
 void pbrtActiveTransformAll() {
+    WRITE_BINARY_SCENE(SceneCall::ActiveTransformAll);
     activeTransformBits = AllTransformsBits;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sActiveTransform All\n", catIndentCount, "");
 }
 
 void pbrtActiveTransformEndTime() {
+    WRITE_BINARY_SCENE(SceneCall::ActiveTransformEndTime);
     activeTransformBits = EndTransformBits;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sActiveTransform EndTime\n", catIndentCount, "");
 }
 
 void pbrtActiveTransformStartTime() {
+    WRITE_BINARY_SCENE(SceneCall::ActiveTransformStartTime);
     activeTransformBits = StartTransformBits;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sActiveTransform StartTime\n", catIndentCount, "");
 }
 
 void pbrtTransformTimes(Float start, Float end) {
+    WRITE_BINARY_SCENE(SceneCall::TransformTimes, {}, {start, end});
     VERIFY_OPTIONS("TransformTimes");
     renderOptions->transformStartTime = start;
     renderOptions->transformEndTime = end;
@@ -936,6 +1019,7 @@ void pbrtTransformTimes(Float start, Float end) {
 }
 
 void pbrtPixelFilter(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::PixelFilter, {name}, {}, &params);
     VERIFY_OPTIONS("PixelFilter");
     renderOptions->FilterName = name;
     renderOptions->FilterParams = params;
@@ -947,6 +1031,7 @@ void pbrtPixelFilter(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtFilm(const std::string &type, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Film, {type}, {}, &params);
     VERIFY_OPTIONS("Film");
     renderOptions->FilmParams = params;
     renderOptions->FilmName = type;
@@ -958,6 +1043,7 @@ void pbrtFilm(const std::string &type, const ParamSet &params) {
 }
 
 void pbrtSampler(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Sampler, {name}, {}, &params);
     VERIFY_OPTIONS("Sampler");
     renderOptions->SamplerName = name;
     renderOptions->SamplerParams = params;
@@ -969,6 +1055,7 @@ void pbrtSampler(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtAccelerator(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Accelerator, {name}, {}, &params);
     VERIFY_OPTIONS("Accelerator");
     renderOptions->AcceleratorName = name;
     renderOptions->AcceleratorParams = params;
@@ -980,6 +1067,7 @@ void pbrtAccelerator(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtIntegrator(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Integrator, {name}, {}, &params);
     VERIFY_OPTIONS("Integrator");
     renderOptions->IntegratorName = name;
     renderOptions->IntegratorParams = params;
@@ -991,6 +1079,7 @@ void pbrtIntegrator(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtCamera(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Camera, {name}, {}, &params);
     VERIFY_OPTIONS("Camera");
     renderOptions->CameraName = name;
     renderOptions->CameraParams = params;
@@ -1004,6 +1093,7 @@ void pbrtCamera(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtExtractor(const std::string &name, const ParamSet &params) {
+  WRITE_BINARY_SCENE(SceneCall::Extractor, {name}, {}, &params);
   VERIFY_OPTIONS("Extractor");
   renderOptions->extractors.push_back({name, params});
   if (PbrtOptions.cat || PbrtOptions.toPly) {
@@ -1014,6 +1104,7 @@ void pbrtExtractor(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtMakeNamedMedium(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::MakeNamedMedium, {name}, {}, &params);
     VERIFY_INITIALIZED("MakeNamedMedium");
     WARN_IF_ANIMATED_TRANSFORM("MakeNamedMedium");
     std::string type = params.FindOneString("type", "");
@@ -1033,6 +1124,7 @@ void pbrtMakeNamedMedium(const std::string &name, const ParamSet &params) {
 
 void pbrtMediumInterface(const std::string &insideName,
                          const std::string &outsideName) {
+    WRITE_BINARY_SCENE(SceneCall::MediumInterface, {insideName, outsideName});
     VERIFY_INITIALIZED("MediumInterface");
     graphicsState.currentInsideMedium = insideName;
     graphicsState.currentOutsideMedium = outsideName;
@@ -1043,6 +1135,7 @@ void pbrtMediumInterface(const std::string &insideName,
 }
 
 void pbrtWorldBegin() {
+    WRITE_BINARY_SCENE(SceneCall::WorldBegin);
     VERIFY_OPTIONS("WorldBegin");
     currentApiState = APIState::WorldBlock;
     for (int i = 0; i < MaxTransforms; ++i) curTransform[i] = Transform();
@@ -1053,6 +1146,7 @@ void pbrtWorldBegin() {
 }
 
 void pbrtAttributeBegin() {
+    WRITE_BINARY_SCENE(SceneCall::AttributeBegin);
     VERIFY_WORLD("AttributeBegin");
     pushedGraphicsStates.push_back(graphicsState);
     pushedTransforms.push_back(curTransform);
@@ -1064,6 +1158,7 @@ void pbrtAttributeBegin() {
 }
 
 void pbrtAttributeEnd() {
+    WRITE_BINARY_SCENE(SceneCall::AttributeEnd);
     VERIFY_WORLD("AttributeEnd");
     if (!pushedGraphicsStates.size()) {
         Error(
@@ -1084,6 +1179,7 @@ void pbrtAttributeEnd() {
 }
 
 void pbrtTransformBegin() {
+    WRITE_BINARY_SCENE(SceneCall::TransformBegin);
     VERIFY_WORLD("TransformBegin");
     pushedTransforms.push_back(curTransform);
     pushedActiveTransformBits.push_back(activeTransformBits);
@@ -1094,6 +1190,7 @@ void pbrtTransformBegin() {
 }
 
 void pbrtTransformEnd() {
+    WRITE_BINARY_SCENE(SceneCall::TransformEnd);
     VERIFY_WORLD("TransformEnd");
     if (!pushedTransforms.size()) {
         Error(
@@ -1113,6 +1210,7 @@ void pbrtTransformEnd() {
 
 void pbrtTexture(const std::string &name, const std::string &type,
                  const std::string &texname, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Texture, {name, type, texname}, {}, &params);
     VERIFY_WORLD("Texture");
     TextureParams tp(params, params, graphicsState.floatTextures,
                      graphicsState.spectrumTextures);
@@ -1145,6 +1243,7 @@ void pbrtTexture(const std::string &name, const std::string &type,
 }
 
 void pbrtMaterial(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Material, {name}, {}, &params);
     VERIFY_WORLD("Material");
     graphicsState.material = name;
     graphicsState.materialParams = params;
@@ -1157,6 +1256,7 @@ void pbrtMaterial(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtMakeNamedMaterial(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::MakeNamedMaterial, {name}, {}, &params);
     VERIFY_WORLD("MakeNamedMaterial");
     // error checking, warning if replace, what to use for transform?
     ParamSet emptyParams;
@@ -1182,6 +1282,7 @@ void pbrtMakeNamedMaterial(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtNamedMaterial(const std::string &name) {
+    WRITE_BINARY_SCENE(SceneCall::NamedMaterial, {name});
     VERIFY_WORLD("NamedMaterial");
     graphicsState.currentNamedMaterial = name;
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -1189,6 +1290,7 @@ void pbrtNamedMaterial(const std::string &name) {
 }
 
 void pbrtLightSource(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::LightSource, {name}, {}, &params);
     VERIFY_WORLD("LightSource");
     WARN_IF_ANIMATED_TRANSFORM("LightSource");
     MediumInterface mi = graphicsState.CreateMediumInterface();
@@ -1205,6 +1307,7 @@ void pbrtLightSource(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtAreaLightSource(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::AreaLightSource, {name}, {}, &params);
     VERIFY_WORLD("AreaLightSource");
     graphicsState.areaLight = name;
     graphicsState.areaLightParams = params;
@@ -1215,7 +1318,158 @@ void pbrtAreaLightSource(const std::string &name, const ParamSet &params) {
     }
 }
 
+// Creates a primitive for each shape and, if _areaLightName_ is set, an
+// area light for each of them.
+static void MakeShapePrimitives(
+    const std::vector<std::shared_ptr<Shape>> &shapes,
+    const std::shared_ptr<Material> &mtl, const MediumInterface &mi,
+    const std::string &areaLightName, const ParamSet &areaLightParams,
+    const Transform &lightToWorld,
+    std::vector<std::shared_ptr<Primitive>> *prims,
+    std::vector<std::shared_ptr<AreaLight>> *areaLights) {
+    for (auto s : shapes) {
+        // Possibly create area light for shape
+        std::shared_ptr<AreaLight> area;
+        if (areaLightName != "") {
+            area = MakeAreaLight(areaLightName, lightToWorld, mi,
+                                 areaLightParams, s);
+            if (area) areaLights->push_back(area);
+        }
+        prims->push_back(std::make_shared<GeometricPrimitive>(s, mtl, area, mi));
+    }
+}
+
+// Replaces the primitives of an animated shape with a single
+// _TransformedPrimitive_ for all of them.
+static void MakeAnimatedPrimitive(
+    std::vector<std::shared_ptr<Primitive>> *prims,
+    const AnimatedTransform &animatedObjectToWorld) {
+    if (prims->size() > 1) {
+        std::shared_ptr<Primitive> bvh = std::make_shared<BVHAccel>(*prims);
+        prims->clear();
+        prims->push_back(bvh);
+    }
+    (*prims)[0] = std::make_shared<TransformedPrimitive>(
+        (*prims)[0], animatedObjectToWorld);
+}
+
+STAT_COUNTER("Scene/Shapes created in parallel", nPendingShapes);
+
+static void DeferShape(const std::string &name, const ParamSet &params,
+                       TransformCache &shapeTransformCache) {
+    PendingShape ps;
+    ps.name = name;
+    extern int line_num;
+    extern std::string current_file;
+    ps.file = current_file;
+    ps.line = line_num;
+    ps.reverseOrientation = graphicsState.reverseOrientation;
+    ps.animated = curTransform.IsAnimated();
+    if (ps.animated) {
+        if (graphicsState.areaLight != "")
+            Warning(
+                "Ignoring currently set area light when creating "
+                "animated shape");
+        shapeTransformCache.Lookup(Transform(), &ps.ObjToWorld,
+                                   &ps.WorldToObj);
+        shapeTransformCache.Lookup(curTransform[0], &ps.animatedObjToWorld[0],
+                                   nullptr);
+        shapeTransformCache.Lookup(curTransform[1], &ps.animatedObjToWorld[1],
+                                   nullptr);
+        ps.startTime = renderOptions->transformStartTime;
+        ps.endTime = renderOptions->transformEndTime;
+    } else {
+        shapeTransformCache.Lookup(curTransform[0], &ps.ObjToWorld,
+                                   &ps.WorldToObj);
+        ps.areaLight = graphicsState.areaLight;
+        ps.areaLightParams = graphicsState.areaLightParams;
+        ps.lightToWorld = curTransform[0];
+    }
+    if (name == "plymesh")
+        for (const char *alpha : {"alpha", "shadowalpha"}) {
+            std::string texName = params.FindTexture(alpha);
+            auto iter = graphicsState.floatTextures.find(texName);
+            if (iter != graphicsState.floatTextures.end())
+                ps.floatTextures[texName] = iter->second;
+        }
+    // Look up the material parameters before the shape's parameters are
+    // checked for unused ones after the shape has been created
+    ps.material = graphicsState.CreateMaterial(params);
+    ps.mediumInterface = graphicsState.CreateMediumInterface();
+    ps.params = params;
+    ps.target = renderOptions->currentInstance ? renderOptions->currentInstance
+                                               : &renderOptions->primitives;
+    ps.primitiveOffset = ps.target->size();
+    ps.lightOffset = renderOptions->lights.size();
+    pendingShapes.push_back(std::move(ps));
+}
+
+// Inserts the given runs of elements into _*v_; each one is inserted
+// before the element at the given index of the original vector.
+template <typename T, typename U>
+static void SpliceRuns(std::vector<T> *v,
+                       const std::vector<std::pair<size_t, const U *>> &runs) {
+    if (runs.empty()) return;
+    std::vector<T> result;
+    size_t next = 0;
+    for (const auto &run : runs) {
+        result.insert(result.end(), v->begin() + next, v->begin() + run.first);
+        result.insert(result.end(), run.second->begin(), run.second->end());
+        next = run.first;
+    }
+    result.insert(result.end(), v->begin() + next, v->end());
+    v->swap(result);
+}
+
+static void ResolvePendingShapes() {
+    if (pendingShapes.empty()) return;
+    nPendingShapes += pendingShapes.size();
+    ParallelFor([](int64_t i) {
+        PendingShape &ps = pendingShapes[i];
+        ErrorLocation location(ps.file, ps.line);
+        ps.shapes = MakeShapes(ps.name, ps.ObjToWorld, ps.WorldToObj,
+                               ps.reverseOrientation, ps.params,
+                               &ps.floatTextures);
+        if (ps.shapes.empty() || ps.areaLight != "") return;
+        MakeShapePrimitives(ps.shapes, ps.material, ps.mediumInterface, "",
+                            ParamSet(), Transform(), &ps.prims,
+                            &ps.areaLights);
+        if (ps.animated)
+            MakeAnimatedPrimitive(
+                &ps.prims,
+                AnimatedTransform(ps.animatedObjToWorld[0], ps.startTime,
+                                  ps.animatedObjToWorld[1], ps.endTime));
+    }, pendingShapes.size(), 1);
+
+    // Area lights share their parameters, so they're created here, and then
+    // everything goes where it would have if the shapes had been created
+    // right away
+    std::map<std::vector<std::shared_ptr<Primitive>> *,
+             std::vector<std::pair<size_t,
+                                   const std::vector<std::shared_ptr<Primitive>> *>>>
+        primitiveRuns;
+    std::vector<std::pair<size_t, const std::vector<std::shared_ptr<AreaLight>> *>>
+        lightRuns;
+    for (PendingShape &ps : pendingShapes) {
+        ErrorLocation location(ps.file, ps.line);
+        if (ps.areaLight != "")
+            MakeShapePrimitives(ps.shapes, ps.material, ps.mediumInterface,
+                                ps.areaLight, ps.areaLightParams,
+                                ps.lightToWorld, &ps.prims, &ps.areaLights);
+        primitiveRuns[ps.target].push_back({ps.primitiveOffset, &ps.prims});
+        if (ps.areaLights.empty()) continue;
+        if (ps.target != &renderOptions->primitives)
+            Warning("Area lights not supported with object instancing");
+        else
+            lightRuns.push_back({ps.lightOffset, &ps.areaLights});
+    }
+    for (const auto &runs : primitiveRuns) SpliceRuns(runs.first, runs.second);
+    SpliceRuns(&renderOptions->lights, lightRuns);
+    pendingShapes.clear();
+}
+
 void pbrtShape(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY_SCENE(SceneCall::Shape, {name}, {}, &params);
     VERIFY_WORLD("Shape");
     std::vector<std::shared_ptr<Primitive>> prims;
     std::vector<std::shared_ptr<AreaLight>> areaLights;
@@ -1225,30 +1479,62 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
         printf("\n");
     }
 
-    if (!curTransform.IsAnimated()) {
+    TransformCache &shapeTransformCache =
+        renderOptions->currentInstance ? objectTransformCache : transformCache;
+    bool paged = name == "plymesh" &&
+                 params.FindOneBool("paged", PbrtOptions.geometryBudget > 0) &&
+                 !PbrtOptions.cat && !PbrtOptions.toPly;
+    if (paged && graphicsState.areaLight != "") {
+        Warning("Area lights can't be paged; loading \"%s\" up front",
+                params.FindOneFilename("filename", "").c_str());
+        paged = false;
+    }
+    if (paged) {
+        // Create a _PagedMeshPrimitive_ that loads the mesh on demand
+        Transform *ObjToWorld[2], *WorldToObj;
+        shapeTransformCache.Lookup(
+            curTransform.IsAnimated() ? Transform() : curTransform[0],
+            &ObjToWorld[0], &WorldToObj);
+        std::shared_ptr<Material> mtl = graphicsState.CreateMaterial(params);
+        MediumInterface mi = graphicsState.CreateMediumInterface();
+        std::shared_ptr<Primitive> prim = CreatePagedPLYMesh(
+            ObjToWorld[0], WorldToObj, graphicsState.reverseOrientation,
+            params, &graphicsState.floatTextures, mtl, mi);
+        params.ReportUnused();
+        if (!prim) return;
+        if (curTransform.IsAnimated()) {
+            shapeTransformCache.Lookup(curTransform[0], &ObjToWorld[0],
+                                       nullptr);
+            shapeTransformCache.Lookup(curTransform[1], &ObjToWorld[1],
+                                       nullptr);
+            AnimatedTransform animatedObjectToWorld(
+                ObjToWorld[0], renderOptions->transformStartTime,
+                ObjToWorld[1], renderOptions->transformEndTime);
+            prim = std::make_shared<TransformedPrimitive>(
+                prim, animatedObjectToWorld);
+        }
+        prims.push_back(prim);
+    } else if ((name == "plymesh" || name == "loopsubdiv" ||
+                name == "nurbs") &&
+               !PbrtOptions.cat && !PbrtOptions.toPly) {
+        DeferShape(name, params, shapeTransformCache);
+        return;
+    } else if (!curTransform.IsAnimated()) {
         // Initialize _prims_ and _areaLights_ for static shape
 
         // Create shapes for shape _name_
         Transform *ObjToWorld, *WorldToObj;
-        transformCache.Lookup(curTransform[0], &ObjToWorld, &WorldToObj);
-        std::vector<std::shared_ptr<Shape>> shapes =
-            MakeShapes(name, ObjToWorld, WorldToObj,
-                       graphicsState.reverseOrientation, params);
+        shapeTransformCache.Lookup(curTransform[0], &ObjToWorld, &WorldToObj);
+        std::vector<std::shared_ptr<Shape>> shapes = MakeShapes(
+            name, ObjToWorld, WorldToObj, graphicsState.reverseOrientation,
+            params, &graphicsState.floatTextures);
         if (shapes.empty()) return;
         std::shared_ptr<Material> mtl = graphicsState.CreateMaterial(params);
         params.ReportUnused();
         MediumInterface mi = graphicsState.CreateMediumInterface();
-        for (auto s : shapes) {
-            // Possibly create area light for shape
-            std::shared_ptr<AreaLight> area;
-            if (graphicsState.areaLight != "") {
-                area = MakeAreaLight(graphicsState.areaLight, curTransform[0],
-                                     mi, graphicsState.areaLightParams, s);
-                if (area) areaLights.push_back(area);
-            }
-            prims.push_back(
-                std::make_shared<GeometricPrimitive>(s, mtl, area, mi));
-        }
+        MakeShapePrimitives(shapes, mtl, mi, graphicsState.areaLight,
+                            graphicsState.areaLightParams, curTransform[0],
+                            &prims, &areaLights);
     } else {
         // Initialize _prims_ and _areaLights_ for animated shape
 
@@ -1258,18 +1544,19 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
                 "Ignoring currently set area light when creating "
                 "animated shape");
         Transform *identity;
-        transformCache.Lookup(Transform(), &identity, nullptr);
-        std::vector<std::shared_ptr<Shape>> shapes = MakeShapes(
-            name, identity, identity, graphicsState.reverseOrientation, params);
+        shapeTransformCache.Lookup(Transform(), &identity, nullptr);
+        std::vector<std::shared_ptr<Shape>> shapes =
+            MakeShapes(name, identity, identity,
+                       graphicsState.reverseOrientation, params,
+                       &graphicsState.floatTextures);
         if (shapes.empty()) return;
 
         // Create _GeometricPrimitive_(s) for animated shape
         std::shared_ptr<Material> mtl = graphicsState.CreateMaterial(params);
         params.ReportUnused();
         MediumInterface mi = graphicsState.CreateMediumInterface();
-        for (auto s : shapes)
-            prims.push_back(
-                std::make_shared<GeometricPrimitive>(s, mtl, nullptr, mi));
+        MakeShapePrimitives(shapes, mtl, mi, "", ParamSet(), Transform(),
+                            &prims, &areaLights);
 
         // Create single _TransformedPrimitive_ for _prims_
 
@@ -1277,18 +1564,12 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
         static_assert(MaxTransforms == 2,
                       "TransformCache assumes only two transforms");
         Transform *ObjToWorld[2];
-        transformCache.Lookup(curTransform[0], &ObjToWorld[0], nullptr);
-        transformCache.Lookup(curTransform[1], &ObjToWorld[1], nullptr);
+        shapeTransformCache.Lookup(curTransform[0], &ObjToWorld[0], nullptr);
+        shapeTransformCache.Lookup(curTransform[1], &ObjToWorld[1], nullptr);
         AnimatedTransform animatedObjectToWorld(
             ObjToWorld[0], renderOptions->transformStartTime, ObjToWorld[1],
             renderOptions->transformEndTime);
-        if (prims.size() > 1) {
-            std::shared_ptr<Primitive> bvh = std::make_shared<BVHAccel>(prims);
-            prims.clear();
-            prims.push_back(bvh);
-        }
-        prims[0] = std::make_shared<TransformedPrimitive>(
-            prims[0], animatedObjectToWorld);
+        MakeAnimatedPrimitive(&prims, animatedObjectToWorld);
     }
     // Add _prims_ and _areaLights_ to scene or current instance
     if (renderOptions->currentInstance) {
@@ -1347,6 +1628,7 @@ MediumInterface GraphicsState::CreateMediumInterface() {
 }
 
 void pbrtReverseOrientation() {
+    WRITE_BINARY_SCENE(SceneCall::ReverseOrientation);
     VERIFY_WORLD("ReverseOrientation");
     graphicsState.reverseOrientation = !graphicsState.reverseOrientation;
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -1354,10 +1636,15 @@ void pbrtReverseOrientation() {
 }
 
 void pbrtObjectBegin(const std::string &name) {
+    WRITE_BINARY_SCENE(SceneCall::ObjectBegin, {name});
     VERIFY_WORLD("ObjectBegin");
     pbrtAttributeBegin();
     if (renderOptions->currentInstance)
         Error("ObjectBegin called inside of instance definition");
+    // Pending shapes of an earlier definition with the same name refer to
+    // its primitives
+    if (renderOptions->instances.find(name) != renderOptions->instances.end())
+        ResolvePendingShapes();
     renderOptions->instances[name] = std::vector<std::shared_ptr<Primitive>>();
     renderOptions->currentInstance = &renderOptions->instances[name];
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -1367,6 +1654,7 @@ void pbrtObjectBegin(const std::string &name) {
 STAT_COUNTER("Scene/Object instances created", nObjectInstancesCreated);
 
 void pbrtObjectEnd() {
+    WRITE_BINARY_SCENE(SceneCall::ObjectEnd);
     VERIFY_WORLD("ObjectEnd");
     if (!renderOptions->currentInstance)
         Error("ObjectEnd called outside of instance definition");
@@ -1380,6 +1668,7 @@ void pbrtObjectEnd() {
 STAT_COUNTER("Scene/Object instances used", nObjectInstancesUsed);
 
 void pbrtObjectInstance(const std::string &name) {
+    WRITE_BINARY_SCENE(SceneCall::ObjectInstance, {name});
     VERIFY_WORLD("ObjectInstance");
     // Perform object instance error checking
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -1392,6 +1681,7 @@ void pbrtObjectInstance(const std::string &name) {
         Error("Unable to find instance named \"%s\"", name.c_str());
         return;
     }
+    ResolvePendingShapes();
     std::vector<std::shared_ptr<Primitive>> &in =
         renderOptions->instances[name];
     if (in.empty()) return;
@@ -1416,10 +1706,12 @@ void pbrtObjectInstance(const std::string &name) {
         InstanceToWorld[1], renderOptions->transformEndTime);
     std::shared_ptr<Primitive> prim(
         std::make_shared<TransformedPrimitive>(in[0], animatedInstanceToWorld));
-    renderOptions->primitives.push_back(prim);
+    renderOptions->instancePrimitives.push_back(prim);
+    renderOptions->instancedObjects.push_back(in[0].get());
 }
 
 void pbrtWorldEnd() {
+    WRITE_BINARY_SCENE(SceneCall::WorldEnd);
     VERIFY_WORLD("WorldEnd");
     // Ensure there are no pushed graphics states
     while (pushedGraphicsStates.size()) {
@@ -1436,6 +1728,7 @@ void pbrtWorldEnd() {
     if (PbrtOptions.cat || PbrtOptions.toPly) {
         printf("%*sWorldEnd\n", catIndentCount, "");
     } else {
+        ResolvePendingShapes();
         std::unique_ptr<Integrator> integrator(renderOptions->MakeIntegrator());
         std::unique_ptr<Scene> scene(renderOptions->MakeScene());
         VLOG(0) << "Scene bounds : " << scene->WorldBound() ;
@@ -1482,9 +1775,42 @@ void pbrtWorldEnd() {
 }
 
 Scene *RenderOptions::MakeScene() {
-    std::shared_ptr<Primitive> accelerator =
-        MakeAccelerator(AcceleratorName, primitives, AcceleratorParams);
-    if (!accelerator) accelerator = std::make_shared<BVHAccel>(primitives);
+    std::shared_ptr<Primitive> accelerator;
+    if (AcceleratorName == "bvh" && !instancePrimitives.empty()) {
+        // Build two-level BVH: the per-object BVHs are shared by all of
+        // their instances and kept across frames, and the top-level BVH over
+        // the instances is refit from the previous frame's if only their
+        // transformations have changed
+        std::shared_ptr<BVHAccel> topLevel;
+        if (instanceAccel && instancedObjects == accelInstancedObjects)
+            topLevel = instanceAccel->Refit(accelInstancePrimitives,
+                                            instancePrimitives);
+        bool built = !topLevel;
+        if (built)
+            topLevel =
+                CreateBVHAccelerator(instancePrimitives, AcceleratorParams);
+        accelerator = topLevel;
+        if (!primitives.empty()) {
+            std::shared_ptr<Primitive> rest =
+                MakeAccelerator(AcceleratorName, primitives, AcceleratorParams);
+            accelerator = std::make_shared<BVHAccel>(
+                std::vector<std::shared_ptr<Primitive>>{topLevel, rest});
+        } else if (built)
+            // A refit BVH doesn't look at the parameters, so they are only
+            // checked once they have been used to build one
+            AcceleratorParams.ReportUnused();
+        instanceAccel = topLevel;
+        accelInstancePrimitives.swap(instancePrimitives);
+        accelInstancedObjects.swap(instancedObjects);
+    } else {
+        primitives.insert(primitives.end(), instancePrimitives.begin(),
+                          instancePrimitives.end());
+        accelerator =
+            MakeAccelerator(AcceleratorName, primitives, AcceleratorParams);
+        if (!accelerator) accelerator = std::make_shared<BVHAccel>(primitives);
+    }
+    instancePrimitives.clear();
+    instancedObjects.clear();
     Scene *scene = new Scene(accelerator, lights);
     // Erase primitives and lights from _RenderOptions_
     primitives.erase(primitives.begin(), primitives.end());
@@ -1522,7 +1848,13 @@ Integrator *RenderOptions::MakeIntegrator() const {
         integrator = CreatePathIntegrator(IntegratorParams, sampler, camera, extractor);
     else if (IntegratorName == "volpath")
         integrator = CreateVolPathIntegrator(IntegratorParams, sampler, camera, extractor);
-    else if (IntegratorName == "bdpt") {
+    else if (IntegratorName == "wavefrontpath") {
+        if (!extractors.empty())
+            Warning("\"wavefrontpath\" integrator doesn't support extractors; "
+                    "ignoring them.");
+        integrator =
+            CreateWavefrontPathIntegrator(IntegratorParams, sampler, camera);
+    } else if (IntegratorName == "bdpt") {
         integrator = CreateBDPTIntegrator(IntegratorParams, sampler, camera, extractor);
     } else if (IntegratorName == "mlt") {
         integrator = CreateMLTIntegrator(IntegratorParams, camera, extractor);
@@ -0,0 +1,492 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+// core/binaryscene.cpp*
+#include "binaryscene.h"
+#include "api.h"
+#include "fileutil.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace pbrt {
+
+// Binary Scene Local Definitions
+
+// Files start with the magic string, a version number, a byte order mark
+// and the size of _Float_ and _Spectrum_ in the build that wrote them.  Each
+// call follows as its _SceneCall_, its string arguments, its numeric
+// arguments and its parameter list.
+static const char binarySceneMagic[8] = "PBRTBIN";
+static const uint32_t binarySceneVersion = 1;
+static const uint32_t binarySceneByteOrder = 0x01020304;
+
+enum ParamType : uint8_t {
+    ParamBool,
+    ParamInt,
+    ParamFloat,
+    ParamPoint2f,
+    ParamVector2f,
+    ParamPoint3f,
+    ParamVector3f,
+    ParamNormal3f,
+    ParamSpectrum,
+    ParamString,
+    ParamTexture
+};
+
+// Number of string and numeric arguments of each _SceneCall_
+static const struct {
+    uint8_t nStrings, nValues;
+} sceneCallArgs[] = {
+    {0, 0},  {0, 3},  {0, 4},  {0, 3}, {0, 9}, {0, 16}, {0, 16},  // Transform
+    {1, 0},  {1, 0},                                             // CoordSys
+    {0, 0},  {0, 0},  {0, 0},  {0, 2},            // ActiveTransform, Times
+    {1, 0},  {1, 0},  {1, 0},  {1, 0}, {1, 0}, {1, 0}, {1, 0},  // Options
+    {1, 0},  {2, 0},                                            // Media
+    {0, 0},  {0, 0},  {0, 0},  {0, 0}, {0, 0},  // WorldBegin, Attribute...
+    {3, 0},  {1, 0},  {1, 0},  {1, 0},          // Texture, Material...
+    {1, 0},  {1, 0},  {1, 0},  {0, 0},          // Lights, Shape, Reverse...
+    {1, 0},  {0, 0},  {1, 0},  {0, 0}};         // Object..., WorldEnd
+static_assert(sizeof(sceneCallArgs) / sizeof(sceneCallArgs[0]) ==
+                  int(SceneCall::NumCalls),
+              "sceneCallArgs must have an entry for each SceneCall");
+static_assert(sizeof(int) == sizeof(int32_t), "Unexpected int size");
+static_assert(sizeof(Point2f) == 2 * sizeof(Float) &&
+                  sizeof(Point3f) == 3 * sizeof(Float) &&
+                  sizeof(Normal3f) == 3 * sizeof(Float),
+              "Unexpected padding in point types");
+
+// Reads values from a memory-mapped binary scene file, checking each read
+// against the end of the file
+class BinarySceneReader {
+  public:
+    BinarySceneReader(const char *ptr, const char *end)
+        : ptr(ptr), end(end) {}
+    bool AtEnd() const { return ptr == end; }
+    bool Read(void *dst, size_t size) {
+        if (size_t(end - ptr) < size) return false;
+        memcpy(dst, ptr, size);
+        ptr += size;
+        return true;
+    }
+    template <typename T>
+    bool Read(T *v) {
+        return Read(v, sizeof(T));
+    }
+    bool ReadString(std::string *s) {
+        uint32_t length;
+        if (!Read(&length) || size_t(end - ptr) < length) return false;
+        s->assign(ptr, length);
+        ptr += length;
+        return true;
+    }
+    template <typename T>
+    std::unique_ptr<T[]> ReadArray(int n) {
+        if (size_t(end - ptr) / sizeof(T) < size_t(n)) return nullptr;
+        std::unique_ptr<T[]> v(new T[n]);
+        Read(static_cast<void *>(v.get()), n * sizeof(T));
+        return v;
+    }
+    bool ReadParams(ParamSet *params);
+    bool ReadCall(SceneCallRecord *record);
+
+  private:
+    const char *ptr, *end;
+};
+
+// BinarySceneWriter Method Definitions
+std::unique_ptr<BinarySceneWriter> BinarySceneWriter::Create(
+    const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (!f) return nullptr;
+    std::unique_ptr<BinarySceneWriter> writer(
+        new BinarySceneWriter(filename, f));
+    fwrite(binarySceneMagic, sizeof(binarySceneMagic), 1, f);
+    writer->WriteValue<uint32_t>(binarySceneVersion);
+    writer->WriteValue<uint32_t>(binarySceneByteOrder);
+    writer->WriteValue<uint32_t>(sizeof(Float));
+    writer->WriteValue<uint32_t>(Spectrum::nSamples);
+    return writer;
+}
+
+BinarySceneWriter::~BinarySceneWriter() {
+    bool failed = ferror(f) != 0;
+    if (fclose(f) != 0) failed = true;
+    if (failed)
+        Error("%s: error writing binary scene file", filename.c_str());
+}
+
+void BinarySceneWriter::WriteString(const std::string &s) {
+    WriteValue<uint32_t>(s.size());
+    fwrite(s.data(), 1, s.size(), f);
+}
+
+void BinarySceneWriter::Write(SceneCall call,
+                              const std::vector<std::string> &strings,
+                              const std::vector<Float> &values,
+                              const ParamSet *params) {
+    CHECK_EQ(strings.size(), sceneCallArgs[int(call)].nStrings);
+    CHECK_EQ(values.size(), sceneCallArgs[int(call)].nValues);
+    WriteValue<uint8_t>(uint8_t(call));
+    for (const std::string &s : strings) WriteString(s);
+    if (!values.empty())
+        fwrite(values.data(), sizeof(Float), values.size(), f);
+    if (params)
+        WriteParams(*params);
+    else
+        WriteValue<uint32_t>(0);
+}
+
+template <typename T, typename U>
+void BinarySceneWriter::WriteItems(
+    const std::vector<std::shared_ptr<ParamSetItem<T>>> &items, uint8_t type,
+    U writeValues) {
+    for (const auto &item : items) {
+        WriteValue<uint8_t>(type);
+        WriteString(item->name);
+        WriteValue<int32_t>(item->nValues);
+        writeValues(item->values.get(), item->nValues);
+    }
+}
+
+void BinarySceneWriter::WriteParams(const ParamSet &ps) {
+    WriteValue<uint32_t>(ps.bools.size() + ps.ints.size() + ps.floats.size() +
+                         ps.point2fs.size() + ps.vector2fs.size() +
+                         ps.point3fs.size() + ps.vector3fs.size() +
+                         ps.normals.size() + ps.spectra.size() +
+                         ps.strings.size() + ps.textures.size());
+    auto writeRaw = [&](const void *v, int n, size_t size) {
+        fwrite(v, size, n, f);
+    };
+    auto writeStrings = [&](const std::string *v, int n) {
+        for (int i = 0; i < n; ++i) WriteString(v[i]);
+    };
+    WriteItems(ps.bools, ParamBool, [&](const bool *v, int n) {
+        for (int i = 0; i < n; ++i) WriteValue<uint8_t>(v[i]);
+    });
+    WriteItems(ps.ints, ParamInt, [&](const int *v, int n) {
+        writeRaw(v, n, sizeof(int));
+    });
+    WriteItems(ps.floats, ParamFloat, [&](const Float *v, int n) {
+        writeRaw(v, n, sizeof(Float));
+    });
+    WriteItems(ps.point2fs, ParamPoint2f, [&](const Point2f *v, int n) {
+        writeRaw(v, n, sizeof(Point2f));
+    });
+    WriteItems(ps.vector2fs, ParamVector2f, [&](const Vector2f *v, int n) {
+        writeRaw(v, n, sizeof(Vector2f));
+    });
+    WriteItems(ps.point3fs, ParamPoint3f, [&](const Point3f *v, int n) {
+        writeRaw(v, n, sizeof(Point3f));
+    });
+    WriteItems(ps.vector3fs, ParamVector3f, [&](const Vector3f *v, int n) {
+        writeRaw(v, n, sizeof(Vector3f));
+    });
+    WriteItems(ps.normals, ParamNormal3f, [&](const Normal3f *v, int n) {
+        writeRaw(v, n, sizeof(Normal3f));
+    });
+    WriteItems(ps.spectra, ParamSpectrum, [&](const Spectrum *v, int n) {
+        for (int i = 0; i < n; ++i)
+            for (int c = 0; c < Spectrum::nSamples; ++c)
+                WriteValue<Float>(v[i][c]);
+    });
+    WriteItems(ps.strings, ParamString, writeStrings);
+    WriteItems(ps.textures, ParamTexture, writeStrings);
+}
+
+// BinarySceneReader Method Definitions
+bool BinarySceneReader::ReadParams(ParamSet *params) {
+    uint32_t nItems;
+    if (!Read(&nItems)) return false;
+    for (uint32_t item = 0; item < nItems; ++item) {
+        uint8_t type;
+        std::string name;
+        int32_t n;
+        if (!Read(&type) || !ReadString(&name) || !Read(&n) || n < 0)
+            return false;
+        switch (type) {
+        case ParamBool: {
+            std::unique_ptr<uint8_t[]> b = ReadArray<uint8_t>(n);
+            if (!b) return false;
+            std::unique_ptr<bool[]> v(new bool[n]);
+            for (int i = 0; i < n; ++i) v[i] = b[i] != 0;
+            params->AddBool(name, std::move(v), n);
+            break;
+        }
+#define READ_PARAM_ARRAY(T, Add)                         \
+    {                                                    \
+        std::unique_ptr<T[]> v = ReadArray<T>(n);        \
+        if (!v) return false;                            \
+        params->Add(name, std::move(v), n);              \
+        break;                                           \
+    }
+        case ParamInt:
+            READ_PARAM_ARRAY(int, AddInt)
+        case ParamFloat:
+            READ_PARAM_ARRAY(Float, AddFloat)
+        case ParamPoint2f:
+            READ_PARAM_ARRAY(Point2f, AddPoint2f)
+        case ParamVector2f:
+            READ_PARAM_ARRAY(Vector2f, AddVector2f)
+        case ParamPoint3f:
+            READ_PARAM_ARRAY(Point3f, AddPoint3f)
+        case ParamVector3f:
+            READ_PARAM_ARRAY(Vector3f, AddVector3f)
+        case ParamNormal3f:
+            READ_PARAM_ARRAY(Normal3f, AddNormal3f)
+#undef READ_PARAM_ARRAY
+        case ParamSpectrum: {
+            std::unique_ptr<Float[]> c =
+                ReadArray<Float>(n * Spectrum::nSamples);
+            if (!c) return false;
+            std::unique_ptr<Spectrum[]> v(new Spectrum[n]);
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < Spectrum::nSamples; ++j)
+                    v[i][j] = c[i * Spectrum::nSamples + j];
+            params->AddSpectrum(name, std::move(v), n);
+            break;
+        }
+        case ParamString:
+        case ParamTexture: {
+            if (size_t(end - ptr) / sizeof(uint32_t) < size_t(n))
+                return false;
+            std::unique_ptr<std::string[]> v(new std::string[n]);
+            for (int i = 0; i < n; ++i)
+                if (!ReadString(&v[i])) return false;
+            if (type == ParamString)
+                params->AddString(name, std::move(v), n);
+            else if (n == 1)
+                params->AddTexture(name, v[0]);
+            else
+                return false;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BinarySceneReader::ReadCall(SceneCallRecord *record) {
+    uint8_t call;
+    if (!Read(&call) || call >= uint8_t(SceneCall::NumCalls)) return false;
+    record->call = SceneCall(call);
+    record->strings.resize(sceneCallArgs[call].nStrings);
+    for (std::string &s : record->strings)
+        if (!ReadString(&s)) return false;
+    record->values.resize(sceneCallArgs[call].nValues);
+    if (!record->values.empty() &&
+        !Read(record->values.data(), record->values.size() * sizeof(Float)))
+        return false;
+    record->params.Clear();
+    return ReadParams(&record->params);
+}
+
+// Binary Scene Function Definitions
+bool IsBinarySceneFile(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) return false;
+    char magic[sizeof(binarySceneMagic)];
+    bool isBinary = fread(magic, sizeof(magic), 1, f) == 1 &&
+                    memcmp(magic, binarySceneMagic, sizeof(magic)) == 0;
+    fclose(f);
+    return isBinary;
+}
+
+bool ReadBinaryScene(const std::string &filename,
+                     const std::function<void(const SceneCallRecord &)> &func) {
+    std::unique_ptr<MappedFile> file = MappedFile::Open(filename);
+    if (!file) return false;
+    BinarySceneReader reader(file->Data(), file->Data() + file->Size());
+    char magic[sizeof(binarySceneMagic)];
+    uint32_t version, byteOrder, floatSize, spectrumSamples;
+    if (!reader.Read(magic, sizeof(magic)) ||
+        memcmp(magic, binarySceneMagic, sizeof(magic)) != 0 ||
+        !reader.Read(&version) || !reader.Read(&byteOrder) ||
+        !reader.Read(&floatSize) || !reader.Read(&spectrumSamples)) {
+        Error("%s: not a binary scene file", filename.c_str());
+        return false;
+    }
+    if (version != binarySceneVersion || byteOrder != binarySceneByteOrder ||
+        floatSize != sizeof(Float) || spectrumSamples != Spectrum::nSamples) {
+        Error(
+            "%s: binary scene file was written by an incompatible build of "
+            "pbrt. Recreate it with --tobinary.",
+            filename.c_str());
+        return false;
+    }
+
+    SceneCallRecord record;
+    while (!reader.AtEnd()) {
+        if (!reader.ReadCall(&record)) {
+            Error("%s: corrupt or truncated binary scene file",
+                  filename.c_str());
+            return false;
+        }
+        func(record);
+    }
+    return true;
+}
+
+bool ParseBinarySceneFile(const std::string &filename) {
+    return ReadBinaryScene(filename, [](const SceneCallRecord &r) {
+        const std::vector<std::string> &s = r.strings;
+        const Float *v = r.values.data();
+        Float tr[16];
+        switch (r.call) {
+        case SceneCall::Identity:
+            pbrtIdentity();
+            break;
+        case SceneCall::Translate:
+            pbrtTranslate(v[0], v[1], v[2]);
+            break;
+        case SceneCall::Rotate:
+            pbrtRotate(v[0], v[1], v[2], v[3]);
+            break;
+        case SceneCall::Scale:
+            pbrtScale(v[0], v[1], v[2]);
+            break;
+        case SceneCall::LookAt:
+            pbrtLookAt(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8]);
+            break;
+        case SceneCall::ConcatTransform:
+            std::copy(v, v + 16, tr);
+            pbrtConcatTransform(tr);
+            break;
+        case SceneCall::Transform:
+            std::copy(v, v + 16, tr);
+            pbrtTransform(tr);
+            break;
+        case SceneCall::CoordinateSystem:
+            pbrtCoordinateSystem(s[0]);
+            break;
+        case SceneCall::CoordSysTransform:
+            pbrtCoordSysTransform(s[0]);
+            break;
+        case SceneCall::ActiveTransformAll:
+            pbrtActiveTransformAll();
+            break;
+        case SceneCall::ActiveTransformEndTime:
+            pbrtActiveTransformEndTime();
+            break;
+        case SceneCall::ActiveTransformStartTime:
+            pbrtActiveTransformStartTime();
+            break;
+        case SceneCall::TransformTimes:
+            pbrtTransformTimes(v[0], v[1]);
+            break;
+        case SceneCall::PixelFilter:
+            pbrtPixelFilter(s[0], r.params);
+            break;
+        case SceneCall::Film:
+            pbrtFilm(s[0], r.params);
+            break;
+        case SceneCall::Sampler:
+            pbrtSampler(s[0], r.params);
+            break;
+        case SceneCall::Extractor:
+            pbrtExtractor(s[0], r.params);
+            break;
+        case SceneCall::Accelerator:
+            pbrtAccelerator(s[0], r.params);
+            break;
+        case SceneCall::Integrator:
+            pbrtIntegrator(s[0], r.params);
+            break;
+        case SceneCall::Camera:
+            pbrtCamera(s[0], r.params);
+            break;
+        case SceneCall::MakeNamedMedium:
+            pbrtMakeNamedMedium(s[0], r.params);
+            break;
+        case SceneCall::MediumInterface:
+            pbrtMediumInterface(s[0], s[1]);
+            break;
+        case SceneCall::WorldBegin:
+            pbrtWorldBegin();
+            break;
+        case SceneCall::AttributeBegin:
+            pbrtAttributeBegin();
+            break;
+        case SceneCall::AttributeEnd:
+            pbrtAttributeEnd();
+            break;
+        case SceneCall::TransformBegin:
+            pbrtTransformBegin();
+            break;
+        case SceneCall::TransformEnd:
+            pbrtTransformEnd();
+            break;
+        case SceneCall::Texture:
+            pbrtTexture(s[0], s[1], s[2], r.params);
+            break;
+        case SceneCall::Material:
+            pbrtMaterial(s[0], r.params);
+            break;
+        case SceneCall::MakeNamedMaterial:
+            pbrtMakeNamedMaterial(s[0], r.params);
+            break;
+        case SceneCall::NamedMaterial:
+            pbrtNamedMaterial(s[0]);
+            break;
+        case SceneCall::LightSource:
+            pbrtLightSource(s[0], r.params);
+            break;
+        case SceneCall::AreaLightSource:
+            pbrtAreaLightSource(s[0], r.params);
+            break;
+        case SceneCall::Shape:
+            pbrtShape(s[0], r.params);
+            break;
+        case SceneCall::ReverseOrientation:
+            pbrtReverseOrientation();
+            break;
+        case SceneCall::ObjectBegin:
+            pbrtObjectBegin(s[0]);
+            break;
+        case SceneCall::ObjectEnd:
+            pbrtObjectEnd();
+            break;
+        case SceneCall::ObjectInstance:
+            pbrtObjectInstance(s[0]);
+            break;
+        case SceneCall::WorldEnd:
+            pbrtWorldEnd();
+            break;
+        default:
+            LOG(FATAL) << "Unexpected scene call " << int(r.call);
+        }
+    });
+}
+
+}  // namespace pbrt
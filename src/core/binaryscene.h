@@ -0,0 +1,152 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_BINARYSCENE_H
+#define PBRT_CORE_BINARYSCENE_H
+
+// core/binaryscene.h*
+#include "pbrt.h"
+#include "paramset.h"
+#include <functional>
+
+namespace pbrt {
+
+// Binary scene files hold the flattened stream of scene description calls,
+// with parameter arrays stored as raw binary values.  They are written with
+// _--tobinary_ and are memory-mapped and replayed by _ParseFile()_ without
+// tokenizing any text, which matters for scenes dominated by large mesh
+// arrays.  Files are only readable by builds with the same _Float_ type,
+// _Spectrum_ representation and byte order as the one that wrote them.
+enum class SceneCall : uint8_t {
+    Identity,
+    Translate,
+    Rotate,
+    Scale,
+    LookAt,
+    ConcatTransform,
+    Transform,
+    CoordinateSystem,
+    CoordSysTransform,
+    ActiveTransformAll,
+    ActiveTransformEndTime,
+    ActiveTransformStartTime,
+    TransformTimes,
+    PixelFilter,
+    Film,
+    Sampler,
+    Extractor,
+    Accelerator,
+    Integrator,
+    Camera,
+    MakeNamedMedium,
+    MediumInterface,
+    WorldBegin,
+    AttributeBegin,
+    AttributeEnd,
+    TransformBegin,
+    TransformEnd,
+    Texture,
+    Material,
+    MakeNamedMaterial,
+    NamedMaterial,
+    LightSource,
+    AreaLightSource,
+    Shape,
+    ReverseOrientation,
+    ObjectBegin,
+    ObjectEnd,
+    ObjectInstance,
+    WorldEnd,
+    NumCalls
+};
+
+// One scene description call: its string arguments (names and types), its
+// numeric arguments (e.g. the matrix of _Transform_) and its parameters.
+struct SceneCallRecord {
+    SceneCall call;
+    std::vector<std::string> strings;
+    std::vector<Float> values;
+    ParamSet params;
+};
+
+// BinarySceneWriter Declarations
+class BinarySceneWriter {
+  public:
+    // BinarySceneWriter Public Methods
+
+    // Returns _nullptr_ if _filename_ can't be opened for writing
+    static std::unique_ptr<BinarySceneWriter> Create(
+        const std::string &filename);
+    ~BinarySceneWriter();
+    void Write(SceneCall call, const std::vector<std::string> &strings = {},
+               const std::vector<Float> &values = {},
+               const ParamSet *params = nullptr);
+
+  private:
+    // BinarySceneWriter Private Methods
+    BinarySceneWriter(const std::string &filename, FILE *f)
+        : filename(filename), f(f) {}
+    template <typename T>
+    void WriteValue(T v) {
+        fwrite(&v, sizeof(T), 1, f);
+    }
+    void WriteString(const std::string &s);
+    template <typename T, typename U>
+    void WriteItems(const std::vector<std::shared_ptr<ParamSetItem<T>>> &items,
+                    uint8_t type, U writeValues);
+    void WriteParams(const ParamSet &params);
+
+    // BinarySceneWriter Private Data
+    const std::string filename;
+    FILE *f;
+};
+
+// Binary Scene Function Declarations
+bool IsBinarySceneFile(const std::string &filename);
+
+// Calls _func_ for each call recorded in _filename_, in order; returns false
+// if the file couldn't be read or is corrupt.
+bool ReadBinaryScene(const std::string &filename,
+                     const std::function<void(const SceneCallRecord &)> &func);
+
+// Replays the calls recorded in _filename_ through the scene description
+// API.
+bool ParseBinarySceneFile(const std::string &filename);
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_BINARYSCENE_H
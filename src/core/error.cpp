@@ -46,6 +46,10 @@ const char *findWordEnd(const char *buf) {
     return buf;
 }
 
+// Error Reporting Local Declarations
+static PBRT_THREAD_LOCAL const char *locationFile;
+static PBRT_THREAD_LOCAL int locationLine;
+
 // Error Reporting Functions
 template <typename... Args>
 static std::string StringVaprintf(const std::string &fmt, va_list args) {
@@ -70,7 +74,10 @@ static void processError(const char *format, va_list args,
 
     // Print line and position in input file, if available
     extern int line_num;
-    if (line_num != 0) {
+    if (locationFile) {
+        errorString += locationFile;
+        errorString += StringPrintf("(%d): ", locationLine);
+    } else if (line_num != 0) {
         extern std::string current_file;
         errorString += current_file;
         errorString += StringPrintf("(%d): ", line_num);
@@ -106,4 +113,16 @@ void Error(const char *format, ...) {
     va_end(args);
 }
 
+ErrorLocation::ErrorLocation(const std::string &file, int line)
+    : prevFile(locationFile), prevLine(locationLine) {
+    // Without a line there's no location to report, as with _line_num_
+    locationFile = line != 0 ? file.c_str() : nullptr;
+    locationLine = line;
+}
+
+ErrorLocation::~ErrorLocation() {
+    locationFile = prevFile;
+    locationLine = prevLine;
+}
+
 }  // namespace pbrt
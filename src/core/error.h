@@ -54,6 +54,19 @@ namespace pbrt {
 void Warning(const char *, ...) PRINTF_FUNC;
 void Error(const char *, ...) PRINTF_FUNC;
 
+// Warnings and errors reported by the calling thread while an
+// _ErrorLocation_ is in scope refer to the given line of the given input
+// file instead of to the parser's current position.
+class ErrorLocation {
+  public:
+    ErrorLocation(const std::string &file, int line);
+    ~ErrorLocation();
+
+  private:
+    const char *prevFile;
+    int prevLine;
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_ERROR_H
@@ -35,8 +35,14 @@
 #include "fileutil.h"
 #include <cstdlib>
 #include <climits>
-#ifndef PBRT_IS_WINDOWS
+#ifdef PBRT_IS_WINDOWS
+#include <windows.h>
+#else
 #include <libgen.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace pbrt {
@@ -122,6 +128,49 @@ std::string DirectoryContaining(const std::string &filename) {
 
 #endif
 
+#ifdef PBRT_IS_WINDOWS
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string &filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return nullptr;
+    // The view keeps the mapping alive after its handle is closed
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) return nullptr;
+    return std::unique_ptr<MappedFile>(
+        new MappedFile((const char *)data, size_t(fileSize.QuadPart)));
+}
+
+MappedFile::~MappedFile() { UnmapViewOfFile(data); }
+#else
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    return std::unique_ptr<MappedFile>(
+        new MappedFile((const char *)data, size_t(st.st_size)));
+}
+
+MappedFile::~MappedFile() { munmap((void *)data, size); }
+#endif
+
 void SetSearchDirectory(const std::string &dirname) {
     searchDirectory = dirname;
 }
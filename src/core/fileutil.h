@@ -43,6 +43,7 @@
 #include <string>
 #include <cctype>
 #include <string.h>
+#include <memory>
 
 namespace pbrt {
 
@@ -53,6 +54,23 @@ std::string ResolveFilename(const std::string &filename);
 std::string DirectoryContaining(const std::string &filename);
 void SetSearchDirectory(const std::string &dirname);
 
+// Read-only memory mapping of an entire file
+class MappedFile {
+  public:
+    // Maps _filename_; returns _nullptr_ if it can't be opened or mapped
+    static std::unique_ptr<MappedFile> Open(const std::string &filename);
+    ~MappedFile();
+    const char *Data() const { return data; }
+    size_t Size() const { return size; }
+
+  private:
+    MappedFile(const char *data, size_t size) : data(data), size(size) {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    const char *data;
+    size_t size;
+};
+
 inline bool HasExtension(const std::string &value, const std::string &ending) {
     if (ending.size() > value.size()) return false;
     return std::equal(
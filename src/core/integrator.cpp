@@ -51,37 +51,207 @@ namespace pbrt {
 
 STAT_COUNTER("Integrator/Camera rays traced", nCameraRays);
 
+// Maximum number of a pixel's camera rays that are traced together
+static PBRT_CONSTEXPR int primaryBatchSize = 64;
+
 // Integrator Method Definitions
 Integrator::~Integrator() {}
 
 // Integrator Utility Functions
+
+// Light sampling half of _EstimateDirect()_'s two strategies, before the
+// light sample's visibility is known; its contribution is
+// _f * Li * weight / lightPdf_ if the sample turns out to be unoccluded
+struct DirectLightSample {
+    Spectrum f, Li;
+    Float weight = 1, lightPdf = 0;
+    VisibilityTester visibility;
+};
+
+static bool SampleLightStrategy(const Interaction &it, const Light &light,
+                                const Point2f &uLight, BxDFType bsdfFlags,
+                                DirectLightSample *ls) {
+    Vector3f wi;
+    Float scatteringPdf = 0;
+    ls->Li = light.Sample_Li(it, uLight, &wi, &ls->lightPdf, &ls->visibility);
+    VLOG(2) << "EstimateDirect uLight:" << uLight << " -> Li: " << ls->Li
+            << ", wi: " << wi << ", pdf: " << ls->lightPdf;
+    if (ls->lightPdf == 0 || ls->Li.IsBlack()) return false;
+
+    // Compute BSDF or phase function's value for light sample
+    if (it.IsSurfaceInteraction()) {
+        // Evaluate BSDF for light sampling strategy
+        const SurfaceInteraction &isect = (const SurfaceInteraction &)it;
+        ls->f = isect.bsdf->f(isect.wo, wi, bsdfFlags) *
+                AbsDot(wi, isect.shading.n);
+        scatteringPdf = isect.bsdf->Pdf(isect.wo, wi, bsdfFlags);
+        VLOG(2) << "  surf f*dot :" << ls->f
+                << ", scatteringPdf: " << scatteringPdf;
+    } else {
+        // Evaluate phase function for light sampling strategy
+        const MediumInteraction &mi = (const MediumInteraction &)it;
+        Float p = mi.phase->p(mi.wo, wi);
+        ls->f = Spectrum(p);
+        scatteringPdf = p;
+        VLOG(2) << "  medium p: " << p;
+    }
+    if (ls->f.IsBlack()) return false;
+    if (!IsDeltaLight(light.flags))
+        ls->weight = PowerHeuristic(1, ls->lightPdf, 1, scatteringPdf);
+    return true;
+}
+
+// BSDF sampling half of _EstimateDirect()_; returns its contribution
+static Spectrum SampleScatteringStrategy(const Interaction &it,
+                                         const Point2f &uScattering,
+                                         const Light &light,
+                                         const Scene &scene, Sampler &sampler,
+                                         bool handleMedia, BxDFType bsdfFlags) {
+    if (IsDeltaLight(light.flags)) return Spectrum(0.f);
+    Vector3f wi;
+    Float scatteringPdf = 0;
+    Spectrum f;
+    bool sampledSpecular = false;
+    if (it.IsSurfaceInteraction()) {
+        // Sample scattered direction for surface interactions
+        BxDFType sampledType;
+        const SurfaceInteraction &isect = (const SurfaceInteraction &)it;
+        f = isect.bsdf->Sample_f(isect.wo, &wi, uScattering, &scatteringPdf,
+                                 bsdfFlags, &sampledType);
+        f *= AbsDot(wi, isect.shading.n);
+        sampledSpecular = (sampledType & BSDF_SPECULAR) != 0;
+    } else {
+        // Sample scattered direction for medium interactions
+        const MediumInteraction &mi = (const MediumInteraction &)it;
+        Float p = mi.phase->Sample_p(mi.wo, &wi, uScattering);
+        f = Spectrum(p);
+        scatteringPdf = p;
+    }
+    VLOG(2) << "  BSDF / phase sampling f: " << f << ", scatteringPdf: " <<
+        scatteringPdf;
+    if (f.IsBlack() || scatteringPdf <= 0) return Spectrum(0.f);
+
+    // Account for light contributions along sampled direction _wi_
+    Float weight = 1;
+    if (!sampledSpecular) {
+        Float lightPdf = light.Pdf_Li(it, wi);
+        if (lightPdf == 0) return Spectrum(0.f);
+        weight = PowerHeuristic(1, scatteringPdf, 1, lightPdf);
+    }
+
+    // Find intersection and compute transmittance
+    SurfaceInteraction lightIsect;
+    Ray ray = it.SpawnRay(wi);
+    Spectrum Tr(1.f);
+    bool foundSurfaceInteraction =
+        handleMedia ? scene.IntersectTr(ray, sampler, &lightIsect, &Tr)
+                    : scene.Intersect(ray, &lightIsect);
+
+    // Add light contribution from material sampling
+    Spectrum Li(0.f);
+    if (foundSurfaceInteraction) {
+        if (lightIsect.primitive->GetAreaLight() == &light)
+            Li = lightIsect.Le(-wi);
+    } else
+        Li = light.Le(ray);
+    if (Li.IsBlack()) return Spectrum(0.f);
+    return f * Li * Tr * weight / scatteringPdf;
+}
+
 Spectrum UniformSampleAllLights(const Interaction &it, const Scene &scene,
                                 MemoryArena &arena, Sampler &sampler,
                                 const std::vector<int> &nLightSamples,
                                 bool handleMedia) {
     ProfilePhase p(Prof::DirectLighting);
     Spectrum L(0.f);
-    for (size_t j = 0; j < scene.lights.size(); ++j) {
-        // Accumulate contribution of _j_th light to _L_
-        const std::shared_ptr<Light> &light = scene.lights[j];
-        int nSamples = nLightSamples[j];
-        const Point2f *uLightArray = sampler.Get2DArray(nSamples);
-        const Point2f *uScatteringArray = sampler.Get2DArray(nSamples);
-        if (!uLightArray || !uScatteringArray) {
-            // Use a single sample for illumination from _light_
-            Point2f uLight = sampler.Get2D();
-            Point2f uScattering = sampler.Get2D();
-            L += EstimateDirect(it, uScattering, *light, uLight, scene, sampler,
-                                arena, handleMedia);
-        } else {
-            // Estimate direct lighting using sample arrays
-            Spectrum Ld(0.f);
-            for (int k = 0; k < nSamples; ++k)
-                Ld += EstimateDirect(it, uScatteringArray[k], *light,
-                                     uLightArray[k], scene, sampler, arena,
-                                     handleMedia);
-            L += Ld / nSamples;
+    if (handleMedia) {
+        // Transmittance estimates consume sample values, so estimate each
+        // light sample in turn
+        for (size_t j = 0; j < scene.lights.size(); ++j) {
+            // Accumulate contribution of _j_th light to _L_
+            const std::shared_ptr<Light> &light = scene.lights[j];
+            int nSamples = nLightSamples[j];
+            const Point2f *uLightArray = sampler.Get2DArray(nSamples);
+            const Point2f *uScatteringArray = sampler.Get2DArray(nSamples);
+            if (!uLightArray || !uScatteringArray) {
+                // Use a single sample for illumination from _light_
+                Point2f uLight = sampler.Get2D();
+                Point2f uScattering = sampler.Get2D();
+                L += EstimateDirect(it, uScattering, *light, uLight, scene,
+                                    sampler, arena, handleMedia);
+            } else {
+                // Estimate direct lighting using sample arrays
+                Spectrum Ld(0.f);
+                for (int k = 0; k < nSamples; ++k)
+                    Ld += EstimateDirect(it, uScatteringArray[k], *light,
+                                         uLightArray[k], scene, sampler, arena,
+                                         handleMedia);
+                L += Ld / nSamples;
+            }
+        }
+        return L;
+    }
+
+    // Otherwise sample all lights first and trace the shadow rays of the
+    // light samples that can contribute together; the sample values are
+    // consumed in the same order as above, so the estimate doesn't change
+    size_t nLights = scene.lights.size();
+    const Point2f **uLights = arena.Alloc<const Point2f *>(nLights, false);
+    const Point2f **uScatterings = arena.Alloc<const Point2f *>(nLights, false);
+    int *nSamples = arena.Alloc<int>(nLights, false);
+    int nTotal = 0;
+    for (size_t j = 0; j < nLights; ++j) {
+        nSamples[j] = nLightSamples[j];
+        uLights[j] = sampler.Get2DArray(nSamples[j]);
+        uScatterings[j] = sampler.Get2DArray(nSamples[j]);
+        if (!uLights[j] || !uScatterings[j]) {
+            // Use a single sample for illumination from the light; a zero
+            // count tells the loop below not to average
+            Point2f *u = arena.Alloc<Point2f>(2, false);
+            u[0] = sampler.Get2D();
+            u[1] = sampler.Get2D();
+            uLights[j] = &u[0];
+            uScatterings[j] = &u[1];
+            nSamples[j] = 0;
+        }
+        nTotal += std::max(nSamples[j], 1);
+    }
+
+    BxDFType bsdfFlags = BxDFType(BSDF_ALL & ~BSDF_SPECULAR);
+    DirectLightSample *lightSamples = arena.Alloc<DirectLightSample>(nTotal);
+    bool *contributes = arena.Alloc<bool>(nTotal, false);
+    Ray *shadowRays = arena.Alloc<Ray>(nTotal);
+    int *shadowRaySample = arena.Alloc<int>(nTotal, false);
+    int nShadowRays = 0;
+    for (size_t j = 0, s = 0; j < nLights; ++j)
+        for (int k = 0; k < std::max(nSamples[j], 1); ++k, ++s) {
+            DirectLightSample &ls = lightSamples[s];
+            contributes[s] = SampleLightStrategy(it, *scene.lights[j],
+                                                 uLights[j][k], bsdfFlags, &ls);
+            if (contributes[s]) {
+                shadowRays[nShadowRays] =
+                    ls.visibility.P0().SpawnRayTo(ls.visibility.P1());
+                shadowRaySample[nShadowRays++] = s;
+            }
+        }
+    bool *occluded = arena.Alloc<bool>(nShadowRays, false);
+    scene.IntersectPN(shadowRays, occluded, nShadowRays);
+    for (int i = 0; i < nShadowRays; ++i)
+        if (occluded[i]) contributes[shadowRaySample[i]] = false;
+
+    // Add each light's estimate with its BSDF samples
+    for (size_t j = 0, s = 0; j < nLights; ++j) {
+        const Light &light = *scene.lights[j];
+        Spectrum Ld(0.f);
+        for (int k = 0; k < std::max(nSamples[j], 1); ++k, ++s) {
+            const DirectLightSample &ls = lightSamples[s];
+            Spectrum Lk(0.f);
+            if (contributes[s]) Lk += ls.f * ls.Li * ls.weight / ls.lightPdf;
+            Lk += SampleScatteringStrategy(it, uScatterings[j][k], light,
+                                           scene, sampler, false, bsdfFlags);
+            Ld += Lk;
         }
+        L += nSamples[j] > 0 ? Ld / nSamples[j] : Ld;
     }
     return L;
 }
@@ -117,104 +287,27 @@ Spectrum EstimateDirect(const Interaction &it, const Point2f &uScattering,
         specular ? BSDF_ALL : BxDFType(BSDF_ALL & ~BSDF_SPECULAR);
     Spectrum Ld(0.f);
     // Sample light source with multiple importance sampling
-    Vector3f wi;
-    Float lightPdf = 0, scatteringPdf = 0;
-    VisibilityTester visibility;
-    Spectrum Li = light.Sample_Li(it, uLight, &wi, &lightPdf, &visibility);
-    VLOG(2) << "EstimateDirect uLight:" << uLight << " -> Li: " << Li << ", wi: "
-            << wi << ", pdf: " << lightPdf;
-    if (lightPdf > 0 && !Li.IsBlack()) {
-        // Compute BSDF or phase function's value for light sample
-        Spectrum f;
-        if (it.IsSurfaceInteraction()) {
-            // Evaluate BSDF for light sampling strategy
-            const SurfaceInteraction &isect = (const SurfaceInteraction &)it;
-            f = isect.bsdf->f(isect.wo, wi, bsdfFlags) *
-                AbsDot(wi, isect.shading.n);
-            scatteringPdf = isect.bsdf->Pdf(isect.wo, wi, bsdfFlags);
-            VLOG(2) << "  surf f*dot :" << f << ", scatteringPdf: " << scatteringPdf;
+    DirectLightSample ls;
+    if (SampleLightStrategy(it, light, uLight, bsdfFlags, &ls)) {
+        // Compute effect of visibility for light source sample
+        if (handleMedia) {
+            ls.Li *= ls.visibility.Tr(scene, sampler);
+            VLOG(2) << "  after Tr, Li: " << ls.Li;
         } else {
-            // Evaluate phase function for light sampling strategy
-            const MediumInteraction &mi = (const MediumInteraction &)it;
-            Float p = mi.phase->p(mi.wo, wi);
-            f = Spectrum(p);
-            scatteringPdf = p;
-            VLOG(2) << "  medium p: " << p;
+          if (!ls.visibility.Unoccluded(scene)) {
+            VLOG(2) << "  shadow ray blocked";
+            ls.Li = Spectrum(0.f);
+          } else
+            VLOG(2) << "  shadow ray unoccluded";
         }
-        if (!f.IsBlack()) {
-            // Compute effect of visibility for light source sample
-            if (handleMedia) {
-                Li *= visibility.Tr(scene, sampler);
-                VLOG(2) << "  after Tr, Li: " << Li;
-            } else {
-              if (!visibility.Unoccluded(scene)) {
-                VLOG(2) << "  shadow ray blocked";
-                Li = Spectrum(0.f);
-              } else
-                VLOG(2) << "  shadow ray unoccluded";
-            }
 
-            // Add light's contribution to reflected radiance
-            if (!Li.IsBlack()) {
-                if (IsDeltaLight(light.flags))
-                    Ld += f * Li / lightPdf;
-                else {
-                    Float weight =
-                        PowerHeuristic(1, lightPdf, 1, scatteringPdf);
-                    Ld += f * Li * weight / lightPdf;
-                }
-            }
-        }
+        // Add light's contribution to reflected radiance
+        if (!ls.Li.IsBlack()) Ld += ls.f * ls.Li * ls.weight / ls.lightPdf;
     }
 
     // Sample BSDF with multiple importance sampling
-    if (!IsDeltaLight(light.flags)) {
-        Spectrum f;
-        bool sampledSpecular = false;
-        if (it.IsSurfaceInteraction()) {
-            // Sample scattered direction for surface interactions
-            BxDFType sampledType;
-            const SurfaceInteraction &isect = (const SurfaceInteraction &)it;
-            f = isect.bsdf->Sample_f(isect.wo, &wi, uScattering, &scatteringPdf,
-                                     bsdfFlags, &sampledType);
-            f *= AbsDot(wi, isect.shading.n);
-            sampledSpecular = (sampledType & BSDF_SPECULAR) != 0;
-        } else {
-            // Sample scattered direction for medium interactions
-            const MediumInteraction &mi = (const MediumInteraction &)it;
-            Float p = mi.phase->Sample_p(mi.wo, &wi, uScattering);
-            f = Spectrum(p);
-            scatteringPdf = p;
-        }
-        VLOG(2) << "  BSDF / phase sampling f: " << f << ", scatteringPdf: " <<
-            scatteringPdf;
-        if (!f.IsBlack() && scatteringPdf > 0) {
-            // Account for light contributions along sampled direction _wi_
-            Float weight = 1;
-            if (!sampledSpecular) {
-                lightPdf = light.Pdf_Li(it, wi);
-                if (lightPdf == 0) return Ld;
-                weight = PowerHeuristic(1, scatteringPdf, 1, lightPdf);
-            }
-
-            // Find intersection and compute transmittance
-            SurfaceInteraction lightIsect;
-            Ray ray = it.SpawnRay(wi);
-            Spectrum Tr(1.f);
-            bool foundSurfaceInteraction =
-                handleMedia ? scene.IntersectTr(ray, sampler, &lightIsect, &Tr)
-                            : scene.Intersect(ray, &lightIsect);
-
-            // Add light contribution from material sampling
-            Spectrum Li(0.f);
-            if (foundSurfaceInteraction) {
-                if (lightIsect.primitive->GetAreaLight() == &light)
-                    Li = lightIsect.Le(-wi);
-            } else
-                Li = light.Le(ray);
-            if (!Li.IsBlack()) Ld += f * Li * Tr * weight / scatteringPdf;
-        }
-    }
+    Ld += SampleScatteringStrategy(it, uScattering, light, scene, sampler,
+                                   handleMedia, bsdfFlags);
     return Ld;
 }
 
@@ -229,6 +322,14 @@ std::unique_ptr<Distribution1D> ComputeLightPowerDistribution(
 }
 
 // SamplerIntegrator Method Definitions
+bool SamplerIntegrator::IntersectPrimary(const Scene &scene, const Ray &ray,
+                                         SurfaceInteraction *isect,
+                                         const PrimaryHit *primary) {
+    if (!primary) return scene.Intersect(ray, isect);
+    if (primary->hit) *isect = primary->isect;
+    return primary->hit;
+}
+
 void SamplerIntegrator::Render(const Scene &scene) {
     Preprocess(scene, *sampler);
     // Render image tiles in parallel
@@ -240,6 +341,19 @@ void SamplerIntegrator::Render(const Scene &scene) {
     Point2i nTiles((sampleExtent.x + tileSize - 1) / tileSize,
                    (sampleExtent.y + tileSize - 1) / tileSize);
     ProgressReporter reporter(nTiles.x * nTiles.y, "Rendering");
+
+    // Batching camera rays rewinds the sampler to each sample of a batch, so
+    // it needs a sampler that gives the same camera sample every time.  A
+    // _PixelSampler_ takes the camera sample's one 1D and two 2D dimensions
+    // from its stratified arrays only if it samples two or more dimensions;
+    // otherwise, like the _RandomSampler_, it would draw them from its
+    // _RNG_ again, so each sample's camera ray is traced on its own
+    int batchSize = primaryBatchSize;
+    const PixelSampler *pixelSampler =
+        dynamic_cast<const PixelSampler *>(sampler.get());
+    if ((pixelSampler && pixelSampler->SampledDimensions() < 2) ||
+        (!pixelSampler && !dynamic_cast<const GlobalSampler *>(sampler.get())))
+        batchSize = 1;
     {
         ParallelFor2D([&](Point2i tile) {
             // Render section of image corresponding to _tile_
@@ -266,6 +380,21 @@ void SamplerIntegrator::Render(const Scene &scene) {
             // Get tiles for extractors
             std::unique_ptr<Extractor> extractorTile = extractor->BeginTile(tileBounds);
 
+            // Allocate storage for a batch of camera rays and their hits;
+            // _arena_ is reset after every sample, so it can't hold them
+            std::unique_ptr<CameraSample[]> cameraSamples(
+                new CameraSample[primaryBatchSize]);
+            std::unique_ptr<RayDifferential[]> rays(
+                new RayDifferential[primaryBatchSize]);
+            std::unique_ptr<Float[]> rayWeights(new Float[primaryBatchSize]);
+            std::unique_ptr<Ray[]> batchRays(new Ray[primaryBatchSize]);
+            std::unique_ptr<int[]> batchIndex(new int[primaryBatchSize]);
+            std::unique_ptr<SurfaceInteraction[]> batchIsects(
+                new SurfaceInteraction[primaryBatchSize]);
+            std::unique_ptr<bool[]> batchHits(new bool[primaryBatchSize]);
+            std::unique_ptr<PrimaryHit[]> primaryHits(
+                new PrimaryHit[primaryBatchSize]);
+
             // Loop over pixels in tile to render them
             for (Point2i pixel : tileBounds) {
                 {
@@ -282,63 +411,105 @@ void SamplerIntegrator::Render(const Scene &scene) {
 
                 extractorTile->BeginPixel(pixel);
 
-                do {
-
-                    // Initialize _CameraSample_ for current sample
-                    CameraSample cameraSample =
-                        tileSampler->GetCameraSample(pixel);
-
-                    // Generate camera ray for current sample
-                    RayDifferential ray;
-                    Float rayWeight =
-                        camera->GenerateRayDifferential(cameraSample, &ray);
-                    ray.ScaleDifferentials(
-                        1 / std::sqrt((Float)tileSampler->samplesPerPixel));
-                    ++nCameraRays;
-
-                    // begin sample
-                    extractorTile->BeginSample(cameraSample.pFilm);
-
-                    // Evaluate radiance along camera ray
-                    Spectrum L(0.f);
-
-                    extractorTile->BeginPath(cameraSample.pFilm);
-                    if (rayWeight > 0) L = Li(ray, scene, *tileSampler, arena, *extractorTile);
-
-                    // Issue warning if unexpected radiance value returned
-                    if (L.HasNaNs()) {
-                        LOG(ERROR) << StringPrintf(
-                            "Not-a-number radiance value returned "
-                            "for pixel (%d, %d), sample %d. Setting to black.",
-                            pixel.x, pixel.y,
-                            (int)tileSampler->CurrentSampleNumber());
-                        L = Spectrum(0.f);
-                    } else if (L.y() < -1e-5) {
-                        LOG(ERROR) << StringPrintf(
-                            "Negative luminance value, %f, returned "
-                            "for pixel (%d, %d), sample %d. Setting to black.",
-                            L.y(), pixel.x, pixel.y,
-                            (int)tileSampler->CurrentSampleNumber());
-                        L = Spectrum(0.f);
-                    } else if (std::isinf(L.y())) {
-                          LOG(ERROR) << StringPrintf(
-                            "Infinite luminance value returned "
-                            "for pixel (%d, %d), sample %d. Setting to black.",
-                            pixel.x, pixel.y,
-                            (int)tileSampler->CurrentSampleNumber());
-                        L = Spectrum(0.f);
+                // Render the pixel's samples in batches whose camera rays
+                // are traced together; the sampler is rewound to each
+                // sample of the batch before its radiance is computed
+                for (int64_t firstSample = 0;
+                     firstSample < tileSampler->samplesPerPixel;
+                     firstSample += batchSize) {
+                    int nBatch = (int)std::min<int64_t>(
+                        batchSize,
+                        tileSampler->samplesPerPixel - firstSample);
+                    int nTraced = 0;
+                    for (int i = 0; i < nBatch; ++i) {
+                        tileSampler->SetSampleNumber(firstSample + i);
+                        // Initialize _CameraSample_ for current sample
+                        cameraSamples[i] =
+                            tileSampler->GetCameraSample(pixel);
+
+                        // Generate camera ray for current sample
+                        rayWeights[i] = camera->GenerateRayDifferential(
+                            cameraSamples[i], &rays[i]);
+                        rays[i].ScaleDifferentials(
+                            1 /
+                            std::sqrt((Float)tileSampler->samplesPerPixel));
+                        ++nCameraRays;
+                        if (rayWeights[i] > 0) {
+                            batchRays[nTraced] = rays[i];
+                            batchIndex[nTraced++] = i;
+                        }
+                    }
+                    scene.IntersectN(batchRays.get(), batchIsects.get(),
+                                     batchHits.get(), nTraced);
+                    for (int j = 0; j < nTraced; ++j) {
+                        int i = batchIndex[j];
+                        rays[i].tMax = batchRays[j].tMax;
+                        primaryHits[i].hit = batchHits[j];
+                        if (batchHits[j])
+                            primaryHits[i].isect = batchIsects[j];
+                    }
+
+                    for (int i = 0; i < nBatch; ++i) {
+                        // Consume the camera sample dimensions again so that
+                        // _Li()_ sees the sampler state it would have
+                        // without batching
+                        if (nBatch > 1) {
+                            tileSampler->SetSampleNumber(firstSample + i);
+                            tileSampler->GetCameraSample(pixel);
+                        }
+                        const CameraSample &cameraSample = cameraSamples[i];
+                        const RayDifferential &ray = rays[i];
+                        Float rayWeight = rayWeights[i];
+
+                        // begin sample
+                        extractorTile->BeginSample(cameraSample.pFilm);
+
+                        // Evaluate radiance along camera ray
+                        Spectrum L(0.f);
+
+                        extractorTile->BeginPath(cameraSample.pFilm);
+                        if (rayWeight > 0)
+                            L = Li(ray, scene, *tileSampler, arena,
+                                   *extractorTile, 0, &primaryHits[i]);
+
+                        // Issue warning if unexpected radiance value returned
+                        if (L.HasNaNs()) {
+                            LOG(ERROR) << StringPrintf(
+                                "Not-a-number radiance value returned "
+                                "for pixel (%d, %d), sample %d. Setting to "
+                                "black.",
+                                pixel.x, pixel.y,
+                                (int)tileSampler->CurrentSampleNumber());
+                            L = Spectrum(0.f);
+                        } else if (L.y() < -1e-5) {
+                            LOG(ERROR) << StringPrintf(
+                                "Negative luminance value, %f, returned "
+                                "for pixel (%d, %d), sample %d. Setting to "
+                                "black.",
+                                L.y(), pixel.x, pixel.y,
+                                (int)tileSampler->CurrentSampleNumber());
+                            L = Spectrum(0.f);
+                        } else if (std::isinf(L.y())) {
+                            LOG(ERROR) << StringPrintf(
+                                "Infinite luminance value returned "
+                                "for pixel (%d, %d), sample %d. Setting to "
+                                "black.",
+                                pixel.x, pixel.y,
+                                (int)tileSampler->CurrentSampleNumber());
+                            L = Spectrum(0.f);
+                        }
+                        VLOG(1) << "Camera sample: " << cameraSample
+                                << " -> ray: " << ray << " -> L = " << L;
+                        extractorTile->EndPath(L, rayWeight);
+                        extractorTile->EndSample(L, rayWeight);
+                        // Add camera ray's contribution to image
+                        filmTile->AddSample(cameraSample.pFilm, L, rayWeight);
+
+                        // Free _MemoryArena_ memory from computing image
+                        // sample value
+                        arena.Reset();
                     }
-                    VLOG(1) << "Camera sample: " << cameraSample << " -> ray: " <<
-                        ray << " -> L = " << L;
-                    extractorTile->EndPath(L, rayWeight);
-                    extractorTile->EndSample(L, rayWeight);
-                    // Add camera ray's contribution to image
-                    filmTile->AddSample(cameraSample.pFilm, L, rayWeight);
-
-                    // Free _MemoryArena_ memory from computing image sample
-                    // value
-                    arena.Reset();
-                } while (tileSampler->StartNextSample());
+                }
 
                 extractorTile->EndPixel();
             }
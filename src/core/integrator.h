@@ -74,6 +74,14 @@ Spectrum EstimateDirect(const Interaction &it, const Point2f &uShading,
 std::unique_ptr<Distribution1D> ComputeLightPowerDistribution(
     const Scene &scene);
 
+// Closest intersection of a camera ray, found before
+// _SamplerIntegrator::Li()_ is called so that the camera rays of a pixel can
+// be traced together
+struct PrimaryHit {
+    bool hit = false;
+    SurfaceInteraction isect;
+};
+
 // SamplerIntegrator Declarations
 class SamplerIntegrator : public Integrator {
   public:
@@ -93,9 +101,12 @@ class SamplerIntegrator : public Integrator {
                             return Spectrum(0.f);
                         }
 
+    // _primary_, if given, holds the intersection of _ray_, which then
+    // has its _tMax_ set accordingly
     virtual Spectrum Li(const RayDifferential &ray, const Scene &scene,
                         Sampler &sampler, MemoryArena &arena,
-                        Extractor &extractor, int depth = 0) const = 0;
+                        Extractor &extractor, int depth = 0,
+                        const PrimaryHit *primary = nullptr) const = 0;
 
     Spectrum SpecularReflect(const RayDifferential &ray,
                              const SurfaceInteraction &isect,
@@ -107,6 +118,11 @@ class SamplerIntegrator : public Integrator {
                               MemoryArena &arena, Extractor &container, int depth) const;
 
   protected:
+    // SamplerIntegrator Protected Methods
+    static bool IntersectPrimary(const Scene &scene, const Ray &ray,
+                                 SurfaceInteraction *isect,
+                                 const PrimaryHit *primary);
+
     // SamplerIntegrator Protected Data
     std::shared_ptr<const Camera> camera;
 
@@ -44,6 +44,17 @@
 #include "texture.h"
 #include "stats.h"
 #include "parallel.h"
+#include "texcache.h"
+#include "mipmapfile.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+// SIMD evaluation of the EWA filter
+#if !defined(PBRT_FLOAT_AS_DOUBLE) && (defined(__SSE2__) || defined(_M_X64))
+#define PBRT_MIPMAP_SSE
+#include <emmintrin.h>
+#endif
 
 namespace pbrt {
 
@@ -63,14 +74,47 @@ template <typename T>
 class MIPMap {
   public:
     // MIPMap Public Methods
+    // Levels are filtered in _T_ and then stored in _format_; texels stored
+    // as half floats or sRGB8 are converted back to _T_ when they're looked
+    // up.
     MIPMap(const Point2i &resolution, const T *data, bool doTri = false,
-           Float maxAniso = 8.f, ImageWrap wrapMode = ImageWrap::Repeat);
-    int Width() const { return resolution[0]; }
-    int Height() const { return resolution[1]; }
-    int Levels() const { return pyramid.size(); }
-    const T &Texel(int level, int s, int t) const;
+           Float maxAniso = 8.f, ImageWrap wrapMode = ImageWrap::Repeat,
+           TexelFormat format = TexelFormat::Float);
+    // Creates a MIPMap from levels filtered by an earlier render
+    MIPMap(const MIPMapFile &file, bool doTri = false, Float maxAniso = 8.f,
+           ImageWrap wrapMode = ImageWrap::Repeat);
+    // Creates a MIPMap whose image is only read and filtered when it's
+    // first needed, after which its levels are paged in and out of the
+    // _TextureCache_ in tiles.  If _fileKey_ names a file, the levels are
+    // read from it instead if it exists, and written to it if it doesn't.
+    MIPMap(std::function<std::unique_ptr<T[]>(Point2i *resolution)> readImage,
+           bool doTri = false, Float maxAniso = 8.f,
+           ImageWrap wrapMode = ImageWrap::Repeat,
+           TexelFormat format = TexelFormat::Float,
+           const MIPMapFileKey &fileKey = MIPMapFileKey());
+    int Width() const {
+        return Tiles() ? tiles->LevelResolution(0).x : resolution[0];
+    }
+    int Height() const {
+        return Tiles() ? tiles->LevelResolution(0).y : resolution[1];
+    }
+    int Levels() const {
+        if (Tiles()) return tiles->Levels();
+        return pyramid.empty() ? encodedPyramid.size() : pyramid.size();
+    }
+    // For MIPMaps paged through the _TextureCache_, texels are only valid
+    // inside a _TextureCache::ReadGuard_
+    T Texel(int level, int s, int t) const;
     T Lookup(const Point2f &st, Float width = 0.f) const;
     T Lookup(const Point2f &st, Vector2f dstdx, Vector2f dstdy) const;
+    // Writes the levels of a MIPMap that's kept in memory to a _MIPMapFile_
+    bool Write(const MIPMapFileKey &key) const;
+
+    // MIPMap Public Data
+    // Whether EWA filtering evaluates four texels at a time with SSE where
+    // it's available; tests and benchmarks clear it to compare against the
+    // scalar filter.
+    static bool simdEWA;
 
   private:
     // MIPMap Private Methods
@@ -99,6 +143,37 @@ class MIPMap {
     SampledSpectrum clamp(const SampledSpectrum &v) {
         return v.Clamp(0.f, Infinity);
     }
+    const TiledPyramid *Tiles() const {
+        if (tiles && !tilesBuilt.load(std::memory_order_acquire)) BuildTiles();
+        return tiles.get();
+    }
+    void BuildTiles() const;
+    static void InitializeWeightLut();
+    static PBRT_CONSTEXPR int nChannels = sizeof(T) / sizeof(Float);
+    Point2i LevelResolution(int level) const {
+        if (tiles) return tiles->LevelResolution(level);
+        if (pyramid.empty()) return encodedPyramid[level].layout.resolution;
+        return Point2i(pyramid[level]->uSize(), pyramid[level]->vSize());
+    }
+    // Returns texel $(s,t)$ of _level_, which must be inside the level
+    T TexelInside(int level, int s, int t) const {
+        if (tiles) return DecodeTexel(tiles->Texel(level, s, t));
+        if (pyramid.empty()) {
+            const EncodedLevel &l = encodedPyramid[level];
+            return DecodeTexel(l.tiles.get() +
+                               l.layout.TileIndex(s, t) * l.layout.tileBytes +
+                               l.layout.TexelIndex(s, t) * l.layout.texelBytes);
+        }
+        return (*pyramid[level])(s, t);
+    }
+    T DecodeTexel(const void *encoded) const {
+        T texel;
+        DecodeTexelChannels(format, encoded, nChannels, (Float *)&texel);
+        return texel;
+    }
+    // Writes the row-major texels of _level_, encoded as in memory
+    void GetLevel(int level, void *texels) const;
+    size_t BytesUsed() const;
     T triangle(int level, const Point2f &st) const;
     T EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const;
 
@@ -106,8 +181,23 @@ class MIPMap {
     const bool doTrilinear;
     const Float maxAnisotropy;
     const ImageWrap wrapMode;
+    const TexelFormat format;
     Point2i resolution;
     std::vector<std::unique_ptr<BlockedArray<T>>> pyramid;
+    // Set instead of _pyramid_ when texels are stored in a more compact
+    // _format_; each level is cut into tiles like the ones that are paged
+    // through the _TextureCache_
+    struct EncodedLevel {
+        TileLayout layout;
+        std::unique_ptr<char[]> tiles;
+    };
+    std::vector<EncodedLevel> encodedPyramid;
+    // Set instead of _pyramid_ for MIPMaps paged through the _TextureCache_
+    std::function<std::unique_ptr<T[]>(Point2i *)> readImage;
+    MIPMapFileKey fileKey;
+    std::unique_ptr<TiledPyramid> tiles;
+    mutable std::mutex tilesMutex;
+    mutable std::atomic<bool> tilesBuilt{false};
     static PBRT_CONSTEXPR int WeightLUTSize = 128;
     static Float weightLut[WeightLUTSize];
 };
@@ -115,10 +205,11 @@ class MIPMap {
 // MIPMap Method Definitions
 template <typename T>
 MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
-                  Float maxAnisotropy, ImageWrap wrapMode)
+                  Float maxAnisotropy, ImageWrap wrapMode, TexelFormat format)
     : doTrilinear(doTrilinear),
       maxAnisotropy(maxAnisotropy),
       wrapMode(wrapMode),
+      format(format),
       resolution(res) {
     ProfilePhase _(Prof::MIPMapCreation);
 
@@ -206,43 +297,199 @@ MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
         }, tRes, 16);
     }
 
+    // Encode the levels in _format_ if it's more compact than _T_
+    if (format != TexelFormat::Float) {
+        bool inRange = true;
+        for (int i = 0; i < nLevels; ++i) {
+            Point2i res(pyramid[i]->uSize(), pyramid[i]->vSize());
+            std::unique_ptr<T[]> texels(new T[res.x * res.y]);
+            pyramid[i]->GetLinearArray(texels.get());
+            TileLayout layout(res, nChannels * TexelChannelBytes(format));
+            std::unique_ptr<char[]> encoded(
+                new char[size_t(res.x) * res.y * layout.texelBytes]);
+            inRange &= EncodeTexelChannels(
+                format, (const Float *)texels.get(),
+                size_t(res.x) * res.y * nChannels, encoded.get());
+            EncodedLevel level{layout,
+                               std::unique_ptr<char[]>(new char[layout.Bytes()])};
+            layout.Tile(encoded.get(), level.tiles.get());
+            encodedPyramid.push_back(std::move(level));
+            pyramid[i].reset();
+        }
+        pyramid.clear();
+        if (!inRange)
+            Warning("Texel values outside of [0,1] clamped to store them "
+                    "as sRGB8.");
+    }
+
+    InitializeWeightLut();
+    mipMapMemory += BytesUsed();
+}
+
+template <typename T>
+MIPMap<T>::MIPMap(const MIPMapFile &file, bool doTrilinear,
+                  Float maxAnisotropy, ImageWrap wrapMode)
+    : doTrilinear(doTrilinear),
+      maxAnisotropy(maxAnisotropy),
+      wrapMode(wrapMode),
+      format(file.Format()),
+      resolution(file.Layout(0).resolution) {
+    ProfilePhase _(Prof::MIPMapCreation);
+    CHECK_EQ(file.Layout(0).texelBytes, nChannels * TexelChannelBytes(format));
+    for (int i = 0; i < file.Levels(); ++i) {
+        // Keep texels in their compact encoding; only _Float_ levels are
+        // rearranged into a _BlockedArray_
+        const TileLayout &layout = file.Layout(i);
+        EncodedLevel level{layout,
+                           std::unique_ptr<char[]>(new char[layout.Bytes()])};
+        file.ReadLevel(i, level.tiles.get());
+        if (format != TexelFormat::Float) {
+            encodedPyramid.push_back(std::move(level));
+            continue;
+        }
+        Point2i res = layout.resolution;
+        std::unique_ptr<T[]> texels(new T[res.x * res.y]);
+        layout.Untile(level.tiles.get(), texels.get());
+        pyramid.push_back(std::unique_ptr<BlockedArray<T>>(
+            new BlockedArray<T>(res.x, res.y, texels.get())));
+    }
+    InitializeWeightLut();
+    mipMapMemory += BytesUsed();
+}
+
+template <typename T>
+void MIPMap<T>::InitializeWeightLut() {
     // Initialize EWA filter weights if needed
-    if (weightLut[0] == 0.) {
+    static std::once_flag initialized;
+    std::call_once(initialized, []() {
         for (int i = 0; i < WeightLUTSize; ++i) {
             Float alpha = 2;
             Float r2 = Float(i) / Float(WeightLUTSize - 1);
             weightLut[i] = std::exp(-alpha * r2) - std::exp(-alpha);
         }
+    });
+}
+
+template <typename T>
+void MIPMap<T>::GetLevel(int level, void *texels) const {
+    if (pyramid.empty()) {
+        const EncodedLevel &l = encodedPyramid[level];
+        l.layout.Untile(l.tiles.get(), texels);
+    } else
+        pyramid[level]->GetLinearArray((T *)texels);
+}
+
+template <typename T>
+size_t MIPMap<T>::BytesUsed() const {
+    if (pyramid.empty()) {
+        size_t bytes = 0;
+        for (const EncodedLevel &l : encodedPyramid) bytes += l.layout.Bytes();
+        return bytes;
+    }
+    return (4 * resolution[0] * resolution[1] * sizeof(T)) / 3;
+}
+
+template <typename T>
+bool MIPMap<T>::Write(const MIPMapFileKey &key) const {
+    CHECK(!tiles);
+    std::vector<Point2i> resolutions;
+    std::vector<std::unique_ptr<T[]>> levels;
+    std::vector<const Float *> levelTexels;
+    for (int i = 0; i < Levels(); ++i) {
+        Point2i res = LevelResolution(i);
+        resolutions.push_back(res);
+        levels.push_back(std::unique_ptr<T[]>(new T[res.x * res.y]));
+        if (format == TexelFormat::Float)
+            GetLevel(i, levels.back().get());
+        else {
+            // Decode compact texels; _MIPMapFile::Write()_ encodes them in
+            // the key's format again
+            size_t nValues = size_t(res.x) * res.y * nChannels;
+            std::unique_ptr<char[]> encoded(
+                new char[nValues * TexelChannelBytes(format)]);
+            GetLevel(i, encoded.get());
+            DecodeTexelChannels(format, encoded.get(), nValues,
+                                (Float *)levels.back().get());
+        }
+        levelTexels.push_back((const Float *)levels.back().get());
     }
-    mipMapMemory += (4 * resolution[0] * resolution[1] * sizeof(T)) / 3;
+    return MIPMapFile::Write(key, nChannels, resolutions, levelTexels);
 }
 
 template <typename T>
-const T &MIPMap<T>::Texel(int level, int s, int t) const {
-    CHECK_LT(level, pyramid.size());
-    const BlockedArray<T> &l = *pyramid[level];
+MIPMap<T>::MIPMap(
+    std::function<std::unique_ptr<T[]>(Point2i *resolution)> readImage,
+    bool doTrilinear, Float maxAnisotropy, ImageWrap wrapMode,
+    TexelFormat format, const MIPMapFileKey &fileKey)
+    : doTrilinear(doTrilinear),
+      maxAnisotropy(maxAnisotropy),
+      wrapMode(wrapMode),
+      format(format),
+      readImage(std::move(readImage)),
+      fileKey(fileKey),
+      tiles(new TiledPyramid(nChannels * TexelChannelBytes(format))) {
+    CHECK(fileKey.filename.empty() || fileKey.format == format);
+}
+
+template <typename T>
+void MIPMap<T>::BuildTiles() const {
+    std::lock_guard<std::mutex> lock(tilesMutex);
+    if (tilesBuilt.load(std::memory_order_relaxed)) return;
+    InitializeWeightLut();
+    std::unique_ptr<MIPMapFile> file;
+    if (!fileKey.filename.empty()) file = MIPMapFile::Open(fileKey, nChannels);
+    if (!file) {
+        // Filter the image in memory and write out each level's tiles, to
+        // the MIP map file if there is one
+        Point2i res;
+        std::unique_ptr<T[]> image = readImage(&res);
+        MIPMap<T> mipmap(res, image.get(), doTrilinear, maxAnisotropy,
+                         wrapMode, format);
+        image.reset();
+        if (!fileKey.filename.empty() && mipmap.Write(fileKey))
+            file = MIPMapFile::Open(fileKey, nChannels);
+        if (!file)
+            for (int i = 0; i < mipmap.Levels(); ++i) {
+                Point2i res = mipmap.LevelResolution(i);
+                std::unique_ptr<char[]> texels(
+                    new char[size_t(res.x) * res.y * nChannels *
+                             TexelChannelBytes(format)]);
+                mipmap.GetLevel(i, texels.get());
+                tiles->AddLevel(res, texels.get());
+            }
+        // Only the tiles that are in the cache take up memory
+        mipMapMemory -= mipmap.BytesUsed();
+    }
+    if (file) tiles->SetFile(std::move(file));
+    tilesBuilt.store(true, std::memory_order_release);
+}
+
+template <typename T>
+T MIPMap<T>::Texel(int level, int s, int t) const {
+    CHECK_LT(level, Levels());
+    Point2i res = LevelResolution(level);
     // Compute texel $(s,t)$ accounting for boundary conditions
     switch (wrapMode) {
     case ImageWrap::Repeat:
-        s = Mod(s, l.uSize());
-        t = Mod(t, l.vSize());
+        s = Mod(s, res.x);
+        t = Mod(t, res.y);
         break;
     case ImageWrap::Clamp:
-        s = Clamp(s, 0, l.uSize() - 1);
-        t = Clamp(t, 0, l.vSize() - 1);
+        s = Clamp(s, 0, res.x - 1);
+        t = Clamp(t, 0, res.y - 1);
         break;
     case ImageWrap::Black: {
         static const T black = 0.f;
-        if (s < 0 || s >= (int)l.uSize() || t < 0 || t >= (int)l.vSize())
-            return black;
+        if (s < 0 || s >= res.x || t < 0 || t >= res.y) return black;
         break;
     }
     }
-    return l(s, t);
+    return TexelInside(level, s, t);
 }
 
 template <typename T>
 T MIPMap<T>::Lookup(const Point2f &st, Float width) const {
+    TextureCache::ReadGuard guard(Tiles() != nullptr);
     ++nTrilerpLookups;
     ProfilePhase p(Prof::TexFiltTrilerp);
     // Compute MIPMap level for trilinear filtering
@@ -263,8 +510,9 @@ T MIPMap<T>::Lookup(const Point2f &st, Float width) const {
 template <typename T>
 T MIPMap<T>::triangle(int level, const Point2f &st) const {
     level = Clamp(level, 0, Levels() - 1);
-    Float s = st[0] * pyramid[level]->uSize() - 0.5f;
-    Float t = st[1] * pyramid[level]->vSize() - 0.5f;
+    Point2i res = LevelResolution(level);
+    Float s = st[0] * res.x - 0.5f;
+    Float t = st[1] * res.y - 0.5f;
     int s0 = std::floor(s), t0 = std::floor(t);
     Float ds = s - s0, dt = t - t0;
     return (1 - ds) * (1 - dt) * Texel(level, s0, t0) +
@@ -275,6 +523,7 @@ T MIPMap<T>::triangle(int level, const Point2f &st) const {
 
 template <typename T>
 T MIPMap<T>::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
+    TextureCache::ReadGuard guard(Tiles() != nullptr);
     if (doTrilinear) {
         Float width = std::max(std::max(std::abs(dst0[0]), std::abs(dst0[1])),
                                std::max(std::abs(dst1[0]), std::abs(dst1[1])));
@@ -306,12 +555,13 @@ template <typename T>
 T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     if (level >= Levels()) return Texel(Levels() - 1, 0, 0);
     // Convert EWA coordinates to appropriate scale for level
-    st[0] = st[0] * pyramid[level]->uSize() - 0.5f;
-    st[1] = st[1] * pyramid[level]->vSize() - 0.5f;
-    dst0[0] *= pyramid[level]->uSize();
-    dst0[1] *= pyramid[level]->vSize();
-    dst1[0] *= pyramid[level]->uSize();
-    dst1[1] *= pyramid[level]->vSize();
+    Point2i res = LevelResolution(level);
+    st[0] = st[0] * res.x - 0.5f;
+    st[1] = st[1] * res.y - 0.5f;
+    dst0[0] *= res.x;
+    dst0[1] *= res.y;
+    dst1[0] *= res.x;
+    dst1[1] *= res.y;
 
     // Compute ellipse coefficients to bound EWA filter region
     Float A = dst0[1] * dst0[1] + dst1[1] * dst1[1] + 1;
@@ -334,12 +584,74 @@ T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     // Scan over ellipse bound and compute quadratic equation
     T sum(0.f);
     Float sumWts = 0;
+#ifdef PBRT_MIPMAP_SSE
+    if (simdEWA) {
+        // Compute the squared radii and filter weights of four texels of a
+        // row at a time.  The radii are computed with the same operations
+        // as below and texels are accumulated in the same order, so both
+        // paths give the same result.  Rows are wrapped once rather than
+        // for every texel when the ellipse doesn't cross the $s$ edges.
+        bool sInside = s0 >= 0 && s1 < res.x;
+        const __m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+        const __m128 vA = _mm_set1_ps(A), vB = _mm_set1_ps(B);
+        const __m128 vs = _mm_set1_ps(st[0]), one = _mm_set1_ps(1);
+        const __m128 lutScale = _mm_set1_ps(WeightLUTSize);
+        const __m128 lutMax = _mm_set1_ps(WeightLUTSize - 1);
+        for (int it = t0; it <= t1; ++it) {
+            Float tt = it - st[1];
+            const __m128 vtt = _mm_set1_ps(tt), vCtt = _mm_set1_ps(C * tt * tt);
+            int t = it;
+            bool rowBlack = false;
+            switch (wrapMode) {
+            case ImageWrap::Repeat:
+                t = Mod(it, res.y);
+                break;
+            case ImageWrap::Clamp:
+                t = Clamp(it, 0, res.y - 1);
+                break;
+            case ImageWrap::Black:
+                rowBlack = it < 0 || it >= res.y;
+                break;
+            }
+            for (int is = s0; is <= s1; is += 4) {
+                __m128 ss = _mm_sub_ps(
+                    _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(is), lanes)),
+                    vs);
+                __m128 r2 = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_mul_ps(vA, ss), ss),
+                               _mm_mul_ps(_mm_mul_ps(vB, ss), vtt)),
+                    vCtt);
+                int inside = _mm_movemask_ps(_mm_cmplt_ps(r2, one)) &
+                             ((1 << std::min(4, s1 - is + 1)) - 1);
+                if (!inside) continue;
+                int32_t index[4];
+                _mm_storeu_si128(
+                    (__m128i *)index,
+                    _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(r2, lutScale),
+                                                lutMax)));
+                for (int j = 0; j < 4; ++j)
+                    if (inside & (1 << j)) {
+                        Float weight = weightLut[index[j]];
+                        if (!sInside)
+                            sum += Texel(level, is + j, it) * weight;
+                        else if (rowBlack)
+                            sum += T(0.f) * weight;
+                        else
+                            sum += TexelInside(level, is + j, t) * weight;
+                        sumWts += weight;
+                    }
+            }
+        }
+        return sum / sumWts;
+    }
+#endif  // PBRT_MIPMAP_SSE
     for (int it = t0; it <= t1; ++it) {
         Float tt = it - st[1];
+        Float Ctt = C * tt * tt;
         for (int is = s0; is <= s1; ++is) {
             Float ss = is - st[0];
             // Compute squared radius and filter texel if inside ellipse
-            Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+            Float r2 = A * ss * ss + B * ss * tt + Ctt;
             if (r2 < 1) {
                 int index =
                     std::min((int)(r2 * WeightLUTSize), WeightLUTSize - 1);
@@ -355,6 +667,9 @@ T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
 template <typename T>
 Float MIPMap<T>::weightLut[WeightLUTSize];
 
+template <typename T>
+bool MIPMap<T>::simdEWA = true;
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_MIPMAP_H
@@ -0,0 +1,330 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// core/mipmapfile.cpp*
+#include "mipmapfile.h"
+#include "stats.h"
+#include "stringprint.h"
+#include <atomic>
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef PBRT_IS_WINDOWS
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace pbrt {
+
+STAT_COUNTER("Texture/MIP map files loaded", nMIPMapFileLoads);
+STAT_COUNTER("Texture/MIP map files written", nMIPMapFileWrites);
+
+// MIPMapFile Local Declarations
+static PBRT_CONSTEXPR uint32_t mipmapFileVersion = 1;
+static PBRT_CONSTEXPR int maxLevels = 32;
+static PBRT_CONSTEXPR size_t levelAlignment = 64;
+
+struct MIPMapFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint32_t nChannels;
+    uint32_t nLevels;
+    uint64_t key;
+    int32_t resolution[maxLevels][2];
+    uint64_t offset[maxLevels];
+};
+
+static const char mipmapFileMagic[8] = {'p', 'b', 'r', 't',
+                                        'm', 'i', 'p', '\0'};
+
+// Channels are stored in files as they are in memory, except that _Float_
+// channels are always stored as _float_s
+static size_t ChannelBytes(TexelFormat format) {
+    return format == TexelFormat::Float ? sizeof(float)
+                                        : TexelChannelBytes(format);
+}
+
+static void DecodeChannels(TexelFormat format, const char *data, size_t n,
+                           void *texels) {
+    if (format == TexelFormat::Float)
+        for (size_t i = 0; i < n; ++i) {
+            float f;
+            memcpy(&f, data + i * sizeof(float), sizeof(float));
+            ((Float *)texels)[i] = f;
+        }
+    else
+        memcpy(texels, data, n * ChannelBytes(format));
+}
+
+static void EncodeChannels(TexelFormat format, const Float *values, size_t n,
+                           char *data) {
+    if (format == TexelFormat::Float)
+        for (size_t i = 0; i < n; ++i) {
+            float f = values[i];
+            memcpy(data + i * sizeof(float), &f, sizeof(float));
+        }
+    else
+        EncodeTexelChannels(format, values, n, data);
+}
+
+// Texel Format Definitions
+const Float SRGB8ToLinear[256] = {
+    0, 0.000303526991, 0.000607053982, 0.000910580973, 0.00121410796,
+    0.00151763496, 0.00182116195, 0.00212468882, 0.00242821593, 0.00273174304,
+    0.00303526991, 0.00334653561, 0.00367650692, 0.00402471703, 0.00439144205,
+    0.00477695325, 0.00518151699, 0.00560539169, 0.00604883255, 0.00651209103,
+    0.00699541019, 0.00749903172, 0.00802319217, 0.00856812485, 0.00913405698,
+    0.00972121768, 0.010329823, 0.0109600937, 0.0116122449, 0.012286487,
+    0.0129830306, 0.0137020806, 0.0144438436, 0.0152085144, 0.0159962922,
+    0.0168073755, 0.0176419523, 0.0185002182, 0.0193823613, 0.0202885624,
+    0.0212190095, 0.0221738834, 0.0231533647, 0.0241576303, 0.0251868572,
+    0.0262412224, 0.0273208916, 0.0284260381, 0.0295568332, 0.0307134409,
+    0.0318960287, 0.0331047624, 0.0343398079, 0.0356013142, 0.036889445,
+    0.0382043645, 0.0395462364, 0.0409151986, 0.0423114114, 0.0437350273,
+    0.045186203, 0.0466650836, 0.048171822, 0.0497065634, 0.0512694679,
+    0.0528606549, 0.0544802807, 0.0561284944, 0.0578054339, 0.0595112406,
+    0.061246071, 0.0630100295, 0.0648032799, 0.0666259527, 0.068478182,
+    0.0703601092, 0.0722718611, 0.0742135793, 0.0761853904, 0.0781874284,
+    0.0802198276, 0.0822827145, 0.0843762159, 0.0865004659, 0.0886556059,
+    0.0908417329, 0.093058981, 0.0953074843, 0.0975873619, 0.0998987406,
+    0.102241747, 0.104616493, 0.107023112, 0.109461717, 0.111932434,
+    0.114435382, 0.116970673, 0.119538434, 0.122138798, 0.124771841,
+    0.127437696, 0.13013649, 0.132868335, 0.135633349, 0.138431624,
+    0.141263306, 0.144128487, 0.147027284, 0.149959803, 0.152926162,
+    0.155926466, 0.158960864, 0.1620294, 0.165132225, 0.168269396,
+    0.171441093, 0.174647391, 0.177888408, 0.181164235, 0.18447499,
+    0.187820762, 0.191201672, 0.194617808, 0.198069304, 0.201556236,
+    0.205078706, 0.20863685, 0.212230727, 0.215860531, 0.219526231,
+    0.223227978, 0.226965889, 0.23074007, 0.234550655, 0.238397658,
+    0.242281199, 0.246201396, 0.25015837, 0.254152179, 0.258182913,
+    0.262250721, 0.266355664, 0.270497859, 0.274677366, 0.278894335,
+    0.283148795, 0.287440896, 0.291770697, 0.296138316, 0.300543845,
+    0.304987371, 0.309468955, 0.313988745, 0.318546832, 0.323143244,
+    0.327778131, 0.332451582, 0.337163657, 0.341914445, 0.346704096,
+    0.351532698, 0.356400251, 0.361306876, 0.366252691, 0.371237785,
+    0.376262218, 0.381326109, 0.386429518, 0.391572565, 0.396755308,
+    0.401977867, 0.407240301, 0.412542701, 0.417885154, 0.423267752,
+    0.428690553, 0.434153706, 0.439657241, 0.445201248, 0.450785846,
+    0.456411064, 0.462077051, 0.467783839, 0.473531544, 0.479320228,
+    0.48514998, 0.491020888, 0.496933043, 0.502886593, 0.50888145,
+    0.514917791, 0.520995677, 0.527115226, 0.533276498, 0.539479613,
+    0.545724571, 0.55201149, 0.55834049, 0.56471163, 0.571124911,
+    0.577580512, 0.584078491, 0.590618908, 0.597201884, 0.603827417,
+    0.610495627, 0.617206633, 0.623960435, 0.630757213, 0.637596965,
+    0.644479752, 0.651405692, 0.658374846, 0.665387332, 0.672443211,
+    0.679542542, 0.686685443, 0.693871915, 0.701102018, 0.708375931,
+    0.715693653, 0.723055243, 0.730460882, 0.737910569, 0.745404363,
+    0.752942324, 0.760524631, 0.768151283, 0.775822341, 0.783537924,
+    0.791298032, 0.799102843, 0.806952357, 0.814846694, 0.822785854,
+    0.830769956, 0.838799119, 0.846873283, 0.854992688, 0.863157272,
+    0.871367216, 0.87962234, 0.887923181, 0.896269381, 0.904661357,
+    0.913098693, 0.921582043, 0.930110872, 0.938685894, 0.947306573,
+    0.955973506, 0.964686275, 0.973445475, 0.982250571, 0.991102219,
+    1
+};
+
+bool EncodeTexelChannels(TexelFormat format, const Float *values, size_t n,
+                         void *encoded) {
+    bool inRange = true;
+    switch (format) {
+    case TexelFormat::Half:
+        for (size_t i = 0; i < n; ++i)
+            ((uint16_t *)encoded)[i] = FloatToHalf(values[i]);
+        break;
+    case TexelFormat::SRGB8:
+        for (size_t i = 0; i < n; ++i) {
+            if (values[i] < 0 || values[i] > 1) inRange = false;
+            ((uint8_t *)encoded)[i] = LinearToSRGB8(values[i]);
+        }
+        break;
+    default:
+        memcpy(encoded, values, n * sizeof(Float));
+        break;
+    }
+    return inRange;
+}
+
+// MIPMapFile Method Definitions
+MIPMapFileKey MIPMapFile::Key(const std::string &imageFilename,
+                              const std::string &settings,
+                              TexelFormat format) {
+    MIPMapFileKey key;
+    struct stat st;
+    if (stat(imageFilename.c_str(), &st) != 0) return key;
+
+    // Hash the image's path, size and modification time along with the
+    // settings, following FNV-1a
+    std::string id = StringPrintf(
+        "%s %lld %lld %s %d %d", AbsolutePath(imageFilename).c_str(),
+        (long long)st.st_size, (long long)st.st_mtime, settings.c_str(),
+        int(format), int(mipmapFileVersion));
+    key.key = 0xcbf29ce484222325ull;
+    for (unsigned char c : id) key.key = (key.key ^ c) * 0x100000001b3ull;
+    key.format = format;
+
+    // Name the file after the image so that the cache is easy to browse
+    size_t slash = imageFilename.find_last_of("/\\");
+    std::string base = slash == std::string::npos
+                           ? imageFilename
+                           : imageFilename.substr(slash + 1);
+    key.filename =
+        StringPrintf("%s/%s-%016" PRIx64 ".mip",
+                     PbrtOptions.mipmapCacheDir.c_str(), base.c_str(), key.key);
+    return key;
+}
+
+std::unique_ptr<MIPMapFile> MIPMapFile::Open(const MIPMapFileKey &key,
+                                             int nChannels) {
+    std::unique_ptr<MappedFile> file = MappedFile::Open(key.filename);
+    if (!file) return nullptr;
+
+    // Validate the header and level extents against the mapped file
+    MIPMapFileHeader header;
+    if (file->Size() < sizeof(header)) return nullptr;
+    memcpy(&header, file->Data(), sizeof(header));
+    if (memcmp(header.magic, mipmapFileMagic, sizeof(mipmapFileMagic)) != 0 ||
+        header.version != mipmapFileVersion || header.key != key.key ||
+        header.format != uint32_t(key.format) ||
+        header.nChannels != uint32_t(nChannels) || header.nLevels == 0 ||
+        header.nLevels > maxLevels) {
+        Warning("Ignoring stale or corrupt MIP map file \"%s\".",
+                key.filename.c_str());
+        return nullptr;
+    }
+    const char *data = file->Data();
+    size_t size = file->Size();
+    std::unique_ptr<MIPMapFile> mipmapFile(
+        new MIPMapFile(std::move(file), key.format, nChannels));
+    for (uint32_t i = 0; i < header.nLevels; ++i) {
+        Point2i res(header.resolution[i][0], header.resolution[i][1]);
+        if (res.x <= 0 || res.y <= 0 || header.offset[i] % levelAlignment ||
+            header.offset[i] > size ||
+            TileLayout(res, nChannels * ChannelBytes(key.format)).Bytes() >
+                size - header.offset[i]) {
+            Warning("Ignoring truncated MIP map file \"%s\".",
+                    key.filename.c_str());
+            return nullptr;
+        }
+        mipmapFile->layouts.push_back(
+            TileLayout(res, nChannels * TexelChannelBytes(key.format)));
+        mipmapFile->levelData.push_back(data + header.offset[i]);
+    }
+    ++nMIPMapFileLoads;
+    LOG(INFO) << "Mapped MIP map file " << key.filename;
+    return mipmapFile;
+}
+
+bool MIPMapFile::Write(const MIPMapFileKey &key, int nChannels,
+                       const std::vector<Point2i> &resolutions,
+                       const std::vector<const Float *> &levels) {
+    CHECK_EQ(resolutions.size(), levels.size());
+    if (levels.empty() || levels.size() > maxLevels) return false;
+    size_t texelBytes = nChannels * ChannelBytes(key.format);
+    MIPMapFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, mipmapFileMagic, sizeof(mipmapFileMagic));
+    header.version = mipmapFileVersion;
+    header.format = uint32_t(key.format);
+    header.nChannels = nChannels;
+    header.nLevels = levels.size();
+    header.key = key.key;
+    uint64_t offset = sizeof(header);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        offset = (offset + levelAlignment - 1) & ~(levelAlignment - 1);
+        header.resolution[i][0] = resolutions[i].x;
+        header.resolution[i][1] = resolutions[i].y;
+        header.offset[i] = offset;
+        offset += TileLayout(resolutions[i], texelBytes).Bytes();
+    }
+
+    // Write to a temporary file first and rename it into place, so that
+    // concurrent renders never map a partially written file
+    static std::atomic<int> nTempFiles{0};
+#ifdef PBRT_IS_WINDOWS
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+    std::string tempFilename =
+        StringPrintf("%s.%d.%d", key.filename.c_str(), pid, nTempFiles++);
+    FILE *f = fopen(tempFilename.c_str(), "wb");
+    if (!f) {
+        Warning("%s: unable to create MIP map file.", tempFilename.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    uint64_t written = sizeof(header);
+    const char zeros[levelAlignment] = {0};
+    for (size_t i = 0; i < levels.size() && ok; ++i) {
+        // Encode the level's texels and cut them into tiles
+        TileLayout layout(resolutions[i], texelBytes);
+        size_t nValues =
+            size_t(resolutions[i].x) * resolutions[i].y * nChannels;
+        std::unique_ptr<char[]> encoded(
+            new char[nValues * ChannelBytes(key.format)]);
+        EncodeChannels(key.format, levels[i], nValues, encoded.get());
+        std::unique_ptr<char[]> tiles(new char[layout.Bytes()]);
+        layout.Tile(encoded.get(), tiles.get());
+        ok = fwrite(zeros, 1, header.offset[i] - written, f) ==
+                 header.offset[i] - written &&
+             fwrite(tiles.get(), 1, layout.Bytes(), f) == layout.Bytes();
+        written = header.offset[i] + layout.Bytes();
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (ok && rename(tempFilename.c_str(), key.filename.c_str()) == 0) {
+        ++nMIPMapFileWrites;
+        LOG(INFO) << "Wrote MIP map file " << key.filename;
+        return true;
+    }
+    Warning("%s: unable to write MIP map file.", key.filename.c_str());
+    remove(tempFilename.c_str());
+    return false;
+}
+
+void MIPMapFile::ReadTile(int level, int index, void *texels) const {
+    const TileLayout &layout = layouts[level];
+    size_t nValues =
+        size_t(layout.tileResolution.x) * layout.tileResolution.y * nChannels;
+    DecodeChannels(format,
+                   levelData[level] + index * nValues * ChannelBytes(format),
+                   nValues, texels);
+}
+
+void MIPMapFile::ReadLevel(int level, void *tiles) const {
+    const TileLayout &layout = layouts[level];
+    DecodeChannels(format, levelData[level],
+                   layout.Bytes() / TexelChannelBytes(format), tiles);
+}
+
+}  // namespace pbrt
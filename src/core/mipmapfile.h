@@ -0,0 +1,152 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_MIPMAPFILE_H
+#define PBRT_CORE_MIPMAPFILE_H
+
+// core/mipmapfile.h*
+#include "pbrt.h"
+#include "fileutil.h"
+#include "texcache.h"
+#include <string.h>
+
+namespace pbrt {
+
+// How the channels of texels are stored in a _MIPMap_ and its _MIPMapFile_:
+// as _Float_s, as half floats, or as 8-bit sRGB-encoded values in $[0,1]$
+enum class TexelFormat { Float, Half, SRGB8 };
+
+extern const Float SRGB8ToLinear[256];
+
+// Returns the number of bytes that each channel of a texel takes in memory
+inline size_t TexelChannelBytes(TexelFormat format) {
+    switch (format) {
+    case TexelFormat::Half:
+        return sizeof(uint16_t);
+    case TexelFormat::SRGB8:
+        return sizeof(uint8_t);
+    default:
+        return sizeof(Float);
+    }
+}
+
+inline uint8_t LinearToSRGB8(Float value) {
+    if (value <= 0) return 0;
+    if (value >= 1) return 255;
+    return uint8_t(GammaCorrect(value) * 255 + 0.5f);
+}
+
+// Converts _n_ channel values to and from their in-memory encoding in
+// _format_; _EncodeTexelChannels()_ returns false if any were clamped.
+bool EncodeTexelChannels(TexelFormat format, const Float *values, size_t n,
+                         void *encoded);
+inline void DecodeTexelChannels(TexelFormat format, const void *encoded,
+                                size_t n, Float *values) {
+    switch (format) {
+    case TexelFormat::Half:
+        for (size_t i = 0; i < n; ++i)
+            values[i] = HalfToFloat(((const uint16_t *)encoded)[i]);
+        break;
+    case TexelFormat::SRGB8:
+        for (size_t i = 0; i < n; ++i)
+            values[i] = SRGB8ToLinear[((const uint8_t *)encoded)[i]];
+        break;
+    default:
+        memcpy(values, encoded, n * sizeof(Float));
+        break;
+    }
+}
+
+// MIPMapFileKey Declarations
+
+// The cache file for the filtered levels of one image texture and a hash of
+// everything they depend on.  An empty filename means the levels aren't
+// cached.
+struct MIPMapFileKey {
+    std::string filename;
+    uint64_t key = 0;
+    TexelFormat format = TexelFormat::Float;
+};
+
+// MIPMapFile Declarations
+
+// The filtered levels of a MIPMap, stored in _PbrtOptions.mipmapCacheDir_
+// as tiles laid out as in a _TiledPyramid_ and mapped back into memory by
+// later renders, so that images don't need to be read and filtered again.
+class MIPMapFile {
+  public:
+    // MIPMapFile Public Methods
+    static bool Enabled() { return !PbrtOptions.mipmapCacheDir.empty(); }
+    // Returns the key for filtering the image _imageFilename_ with the
+    // given _settings_; the key changes whenever the image file does.
+    static MIPMapFileKey Key(const std::string &imageFilename,
+                             const std::string &settings, TexelFormat format);
+    // Maps the file for _key_; returns _nullptr_ if there is none or it
+    // doesn't match the key or _nChannels_
+    static std::unique_ptr<MIPMapFile> Open(const MIPMapFileKey &key,
+                                            int nChannels);
+    // Writes the given levels, each an array of row-major texels of
+    // _nChannels_ values
+    static bool Write(const MIPMapFileKey &key, int nChannels,
+                      const std::vector<Point2i> &resolutions,
+                      const std::vector<const Float *> &levels);
+    TexelFormat Format() const { return format; }
+    int Levels() const { return layouts.size(); }
+    // Returns the layout of the tiles of _level_ once they're read, with
+    // texels encoded in memory as given by _Format()_
+    const TileLayout &Layout(int level) const { return layouts[level]; }
+    void ReadTile(int level, int index, void *texels) const;
+    // Reads all tiles of _level_
+    void ReadLevel(int level, void *tiles) const;
+
+  private:
+    // MIPMapFile Private Methods
+    MIPMapFile(std::unique_ptr<MappedFile> file, TexelFormat format,
+               int nChannels)
+        : file(std::move(file)), format(format), nChannels(nChannels) {}
+
+    // MIPMapFile Private Data
+    std::unique_ptr<MappedFile> file;
+    const TexelFormat format;
+    const int nChannels;
+    std::vector<TileLayout> layouts;
+    std::vector<const char *> levelData;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_MIPMAPFILE_H
@@ -94,6 +94,16 @@ class ParallelForLoop {
     }
 };
 
+// Removes _loop_ from _workList_ once all of its iterations have been
+// handed out.  A thread finishing its own loop may run into it anywhere in
+// the list, since nested loops started by its iterations are added in front
+// of it.  Must be called with _workListMutex_ held.
+static void UnlinkLoop(ParallelForLoop *loop) {
+    ParallelForLoop **prev = &workList;
+    while (*prev && *prev != loop) prev = &(*prev)->next;
+    if (*prev) *prev = loop->next;
+}
+
 void Barrier::Wait() {
     std::unique_lock<std::mutex> lock(mutex);
     CHECK_GT(count, 0);
@@ -152,7 +162,7 @@ static void workerThreadFunc(int tIndex, std::shared_ptr<Barrier> barrier) {
 
             // Update _loop_ to reflect iterations this thread will run
             loop.nextIndex = indexEnd;
-            if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+            if (loop.nextIndex == loop.maxIndex) UnlinkLoop(&loop);
             loop.activeWorkers++;
 
             // Run loop indices in _[indexStart, indexEnd)_
@@ -213,7 +223,7 @@ void ParallelFor(std::function<void(int64_t)> func, int64_t count,
 
         // Update _loop_ to reflect iterations this thread will run
         loop.nextIndex = indexEnd;
-        if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+        if (loop.nextIndex == loop.maxIndex) UnlinkLoop(&loop);
         loop.activeWorkers++;
 
         // Run loop indices in _[indexStart, indexEnd)_
@@ -273,7 +283,7 @@ void ParallelFor2D(std::function<void(Point2i)> func, const Point2i &count) {
 
         // Update _loop_ to reflect iterations this thread will run
         loop.nextIndex = indexEnd;
-        if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+        if (loop.nextIndex == loop.maxIndex) UnlinkLoop(&loop);
         loop.activeWorkers++;
 
         // Run loop indices in _[indexStart, indexEnd)_
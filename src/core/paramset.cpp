@@ -35,27 +35,79 @@
 #include "paramset.h"
 #include "floatfile.h"
 #include "textures/constant.h"
+#include <atomic>
 
 namespace pbrt {
 
+// ParamSymbol Local Definitions
+
+// Interned symbols live in singly-linked chains hanging off a fixed
+// number of buckets; new symbols are only ever pushed onto the front of a
+// chain, which a compare-and-swap makes safe without a lock.
+static PBRT_CONSTEXPR int nSymbolBuckets = 4096;
+static std::atomic<const ParamSymbol *> symbolBuckets[nSymbolBuckets];
+
+// ParamSymbol Method Definitions
+const ParamSymbol *ParamSymbol::Find(const std::string &name, size_t hash,
+                                     const ParamSymbol *chain) {
+    for (const ParamSymbol *s = chain; s; s = s->next)
+        if (s->hash == hash && s->name == name) return s;
+    return nullptr;
+}
+
+const ParamSymbol *ParamSymbol::Find(const std::string &name) {
+    size_t hash = std::hash<std::string>()(name);
+    const std::atomic<const ParamSymbol *> &bucket =
+        symbolBuckets[hash & (nSymbolBuckets - 1)];
+    return Find(name, hash, bucket.load(std::memory_order_acquire));
+}
+
+const ParamSymbol *ParamSymbol::Intern(const std::string &name) {
+    size_t hash = std::hash<std::string>()(name);
+    std::atomic<const ParamSymbol *> &bucket =
+        symbolBuckets[hash & (nSymbolBuckets - 1)];
+    const ParamSymbol *head = bucket.load(std::memory_order_acquire);
+    ParamSymbol *symbol = nullptr;
+    while (true) {
+        // Another thread may have interned _name_ since the last attempt
+        if (const ParamSymbol *s = Find(name, hash, head)) {
+            delete symbol;
+            return s;
+        }
+        if (!symbol) symbol = new ParamSymbol(name, hash);
+        symbol->next = head;
+        if (bucket.compare_exchange_weak(head, symbol,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire))
+            return symbol;
+    }
+}
+
 // ParamSet Macros
 #define ADD_PARAM_TYPE(T, vec) \
     (vec).emplace_back(new ParamSetItem<T>(name, std::move(values), nValues));
-#define LOOKUP_PTR(vec)             \
+#define LOOKUP_PTR(vec, matches)    \
     for (const auto &v : vec)       \
-        if (v->name == name) {      \
+        if (matches) {              \
             *nValues = v->nValues;  \
             v->lookedUp = true;     \
             return v->values.get(); \
         }                           \
     return nullptr
-#define LOOKUP_ONE(vec)                           \
+#define LOOKUP_ONE(vec, matches)                  \
     for (const auto &v : vec)                     \
-        if (v->name == name && v->nValues == 1) { \
+        if ((matches) && v->nValues == 1) {       \
             v->lookedUp = true;                   \
             return v->values[0];                  \
         }                                         \
     return d
+#define ERASE_PARAM(vec)                        \
+    for (size_t i = 0; i < (vec).size(); ++i)   \
+        if ((vec)[i]->name == n) {              \
+            (vec).erase((vec).begin() + i);     \
+            return true;                        \
+        }                                       \
+    return false
 
 // ParamSet Methods
 void ParamSet::AddFloat(const std::string &name,
@@ -168,6 +220,12 @@ void ParamSet::AddSampledSpectrum(const std::string &name,
     spectra.push_back(psi);
 }
 
+void ParamSet::AddSpectrum(const std::string &name,
+                           std::unique_ptr<Spectrum[]> values, int nValues) {
+    EraseSpectrum(name);
+    ADD_PARAM_TYPE(Spectrum, spectra);
+}
+
 void ParamSet::AddSampledSpectrumFiles(const std::string &name,
                                        const char **names, int nValues) {
     EraseSpectrum(name);
@@ -224,207 +282,142 @@ void ParamSet::AddTexture(const std::string &name, const std::string &value) {
 }
 
 bool ParamSet::EraseInt(const std::string &n) {
-    for (size_t i = 0; i < ints.size(); ++i)
-        if (ints[i]->name == n) {
-            ints.erase(ints.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(ints);
 }
 
 bool ParamSet::EraseBool(const std::string &n) {
-    for (size_t i = 0; i < bools.size(); ++i)
-        if (bools[i]->name == n) {
-            bools.erase(bools.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(bools);
 }
 
 bool ParamSet::EraseFloat(const std::string &n) {
-    for (size_t i = 0; i < floats.size(); ++i)
-        if (floats[i]->name == n) {
-            floats.erase(floats.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(floats);
 }
 
 bool ParamSet::ErasePoint2f(const std::string &n) {
-    for (size_t i = 0; i < point2fs.size(); ++i)
-        if (point2fs[i]->name == n) {
-            point2fs.erase(point2fs.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(point2fs);
 }
 
 bool ParamSet::EraseVector2f(const std::string &n) {
-    for (size_t i = 0; i < vector2fs.size(); ++i)
-        if (vector2fs[i]->name == n) {
-            vector2fs.erase(vector2fs.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(vector2fs);
 }
 
 bool ParamSet::ErasePoint3f(const std::string &n) {
-    for (size_t i = 0; i < point3fs.size(); ++i)
-        if (point3fs[i]->name == n) {
-            point3fs.erase(point3fs.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(point3fs);
 }
 
 bool ParamSet::EraseVector3f(const std::string &n) {
-    for (size_t i = 0; i < vector3fs.size(); ++i)
-        if (vector3fs[i]->name == n) {
-            vector3fs.erase(vector3fs.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(vector3fs);
 }
 
 bool ParamSet::EraseNormal3f(const std::string &n) {
-    for (size_t i = 0; i < normals.size(); ++i)
-        if (normals[i]->name == n) {
-            normals.erase(normals.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(normals);
 }
 
 bool ParamSet::EraseSpectrum(const std::string &n) {
-    for (size_t i = 0; i < spectra.size(); ++i)
-        if (spectra[i]->name == n) {
-            spectra.erase(spectra.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(spectra);
 }
 
 bool ParamSet::EraseString(const std::string &n) {
-    for (size_t i = 0; i < strings.size(); ++i)
-        if (strings[i]->name == n) {
-            strings.erase(strings.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(strings);
 }
 
 bool ParamSet::EraseTexture(const std::string &n) {
-    for (size_t i = 0; i < textures.size(); ++i)
-        if (textures[i]->name == n) {
-            textures.erase(textures.begin() + i);
-            return true;
-        }
-    return false;
+    ERASE_PARAM(textures);
 }
 
 Float ParamSet::FindOneFloat(const std::string &name, Float d) const {
-    for (const auto &f : floats)
-        if (f->name == name && f->nValues == 1) {
-            f->lookedUp = true;
-            return f->values[0];
-        }
-    return d;
+    LOOKUP_ONE(floats, v->name == name);
 }
 
 const Float *ParamSet::FindFloat(const std::string &name, int *n) const {
-    for (const auto &f : floats)
-        if (f->name == name) {
-            *n = f->nValues;
-            f->lookedUp = true;
-            return f->values.get();
-        }
-    return nullptr;
+    int *nValues = n;
+    LOOKUP_PTR(floats, v->name == name);
 }
 
 const int *ParamSet::FindInt(const std::string &name, int *nValues) const {
-    LOOKUP_PTR(ints);
+    LOOKUP_PTR(ints, v->name == name);
 }
 
 const bool *ParamSet::FindBool(const std::string &name, int *nValues) const {
-    LOOKUP_PTR(bools);
+    LOOKUP_PTR(bools, v->name == name);
 }
 
 int ParamSet::FindOneInt(const std::string &name, int d) const {
-    LOOKUP_ONE(ints);
+    LOOKUP_ONE(ints, v->name == name);
 }
 
 bool ParamSet::FindOneBool(const std::string &name, bool d) const {
-    LOOKUP_ONE(bools);
+    LOOKUP_ONE(bools, v->name == name);
 }
 
 const Point2f *ParamSet::FindPoint2f(const std::string &name,
                                      int *nValues) const {
-    LOOKUP_PTR(point2fs);
+    LOOKUP_PTR(point2fs, v->name == name);
 }
 
 Point2f ParamSet::FindOnePoint2f(const std::string &name,
                                  const Point2f &d) const {
-    LOOKUP_ONE(point2fs);
+    LOOKUP_ONE(point2fs, v->name == name);
 }
 
 const Vector2f *ParamSet::FindVector2f(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(vector2fs);
+    LOOKUP_PTR(vector2fs, v->name == name);
 }
 
 Vector2f ParamSet::FindOneVector2f(const std::string &name,
                                    const Vector2f &d) const {
-    LOOKUP_ONE(vector2fs);
+    LOOKUP_ONE(vector2fs, v->name == name);
 }
 
 const Point3f *ParamSet::FindPoint3f(const std::string &name,
                                      int *nValues) const {
-    LOOKUP_PTR(point3fs);
+    LOOKUP_PTR(point3fs, v->name == name);
 }
 
 Point3f ParamSet::FindOnePoint3f(const std::string &name,
                                  const Point3f &d) const {
-    LOOKUP_ONE(point3fs);
+    LOOKUP_ONE(point3fs, v->name == name);
 }
 
 const Vector3f *ParamSet::FindVector3f(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(vector3fs);
+    LOOKUP_PTR(vector3fs, v->name == name);
 }
 
 Vector3f ParamSet::FindOneVector3f(const std::string &name,
                                    const Vector3f &d) const {
-    LOOKUP_ONE(vector3fs);
+    LOOKUP_ONE(vector3fs, v->name == name);
 }
 
 const Normal3f *ParamSet::FindNormal3f(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(normals);
+    LOOKUP_PTR(normals, v->name == name);
 }
 
 Normal3f ParamSet::FindOneNormal3f(const std::string &name,
                                    const Normal3f &d) const {
-    LOOKUP_ONE(normals);
+    LOOKUP_ONE(normals, v->name == name);
 }
 
 const Spectrum *ParamSet::FindSpectrum(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(spectra);
+    LOOKUP_PTR(spectra, v->name == name);
 }
 
 Spectrum ParamSet::FindOneSpectrum(const std::string &name,
                                    const Spectrum &d) const {
-    LOOKUP_ONE(spectra);
+    LOOKUP_ONE(spectra, v->name == name);
 }
 
 const std::string *ParamSet::FindString(const std::string &name,
                                         int *nValues) const {
-    LOOKUP_PTR(strings);
+    LOOKUP_PTR(strings, v->name == name);
 }
 
 std::string ParamSet::FindOneString(const std::string &name,
                                     const std::string &d) const {
-    LOOKUP_ONE(strings);
+    LOOKUP_ONE(strings, v->name == name);
 }
 
 std::string ParamSet::FindOneFilename(const std::string &name,
@@ -437,7 +430,115 @@ std::string ParamSet::FindOneFilename(const std::string &name,
 
 std::string ParamSet::FindTexture(const std::string &name) const {
     std::string d = "";
-    LOOKUP_ONE(textures);
+    LOOKUP_ONE(textures, v->name == name);
+}
+
+Float ParamSet::FindOneFloat(const ParamSymbol *symbol, Float d) const {
+    LOOKUP_ONE(floats, v->symbol == symbol);
+}
+
+const Float *ParamSet::FindFloat(const ParamSymbol *symbol, int *n) const {
+    int *nValues = n;
+    LOOKUP_PTR(floats, v->symbol == symbol);
+}
+
+const int *ParamSet::FindInt(const ParamSymbol *symbol, int *nValues) const {
+    LOOKUP_PTR(ints, v->symbol == symbol);
+}
+
+const bool *ParamSet::FindBool(const ParamSymbol *symbol, int *nValues) const {
+    LOOKUP_PTR(bools, v->symbol == symbol);
+}
+
+int ParamSet::FindOneInt(const ParamSymbol *symbol, int d) const {
+    LOOKUP_ONE(ints, v->symbol == symbol);
+}
+
+bool ParamSet::FindOneBool(const ParamSymbol *symbol, bool d) const {
+    LOOKUP_ONE(bools, v->symbol == symbol);
+}
+
+const Point2f *ParamSet::FindPoint2f(const ParamSymbol *symbol,
+                                     int *nValues) const {
+    LOOKUP_PTR(point2fs, v->symbol == symbol);
+}
+
+Point2f ParamSet::FindOnePoint2f(const ParamSymbol *symbol,
+                                 const Point2f &d) const {
+    LOOKUP_ONE(point2fs, v->symbol == symbol);
+}
+
+const Vector2f *ParamSet::FindVector2f(const ParamSymbol *symbol,
+                                       int *nValues) const {
+    LOOKUP_PTR(vector2fs, v->symbol == symbol);
+}
+
+Vector2f ParamSet::FindOneVector2f(const ParamSymbol *symbol,
+                                   const Vector2f &d) const {
+    LOOKUP_ONE(vector2fs, v->symbol == symbol);
+}
+
+const Point3f *ParamSet::FindPoint3f(const ParamSymbol *symbol,
+                                     int *nValues) const {
+    LOOKUP_PTR(point3fs, v->symbol == symbol);
+}
+
+Point3f ParamSet::FindOnePoint3f(const ParamSymbol *symbol,
+                                 const Point3f &d) const {
+    LOOKUP_ONE(point3fs, v->symbol == symbol);
+}
+
+const Vector3f *ParamSet::FindVector3f(const ParamSymbol *symbol,
+                                       int *nValues) const {
+    LOOKUP_PTR(vector3fs, v->symbol == symbol);
+}
+
+Vector3f ParamSet::FindOneVector3f(const ParamSymbol *symbol,
+                                   const Vector3f &d) const {
+    LOOKUP_ONE(vector3fs, v->symbol == symbol);
+}
+
+const Normal3f *ParamSet::FindNormal3f(const ParamSymbol *symbol,
+                                       int *nValues) const {
+    LOOKUP_PTR(normals, v->symbol == symbol);
+}
+
+Normal3f ParamSet::FindOneNormal3f(const ParamSymbol *symbol,
+                                   const Normal3f &d) const {
+    LOOKUP_ONE(normals, v->symbol == symbol);
+}
+
+const Spectrum *ParamSet::FindSpectrum(const ParamSymbol *symbol,
+                                       int *nValues) const {
+    LOOKUP_PTR(spectra, v->symbol == symbol);
+}
+
+Spectrum ParamSet::FindOneSpectrum(const ParamSymbol *symbol,
+                                   const Spectrum &d) const {
+    LOOKUP_ONE(spectra, v->symbol == symbol);
+}
+
+const std::string *ParamSet::FindString(const ParamSymbol *symbol,
+                                        int *nValues) const {
+    LOOKUP_PTR(strings, v->symbol == symbol);
+}
+
+std::string ParamSet::FindOneString(const ParamSymbol *symbol,
+                                    const std::string &d) const {
+    LOOKUP_ONE(strings, v->symbol == symbol);
+}
+
+std::string ParamSet::FindOneFilename(const ParamSymbol *symbol,
+                                      const std::string &d) const {
+    std::string filename = FindOneString(symbol, "");
+    if (filename == "") return d;
+    filename = AbsolutePath(ResolveFilename(filename));
+    return filename;
+}
+
+std::string ParamSet::FindTexture(const ParamSymbol *symbol) const {
+    std::string d = "";
+    LOOKUP_ONE(textures, v->symbol == symbol);
 }
 
 void ParamSet::ReportUnused() const {
@@ -720,16 +821,37 @@ void ParamSet::Print(int indent) const {
 // TextureParams Method Definitions
 std::shared_ptr<Texture<Spectrum>> TextureParams::GetSpectrumTexture(
     const std::string &n, const Spectrum &def) const {
+    return GetSpectrumTexture(ParamSymbol::Find(n), def);
+}
+
+std::shared_ptr<Texture<Spectrum>> TextureParams::GetSpectrumTextureOrNull(
+    const std::string &n) const {
+    return GetSpectrumTextureOrNull(ParamSymbol::Find(n));
+}
+
+std::shared_ptr<Texture<Float>> TextureParams::GetFloatTexture(
+    const std::string &n, Float def) const {
+    return GetFloatTexture(ParamSymbol::Find(n), def);
+}
+
+std::shared_ptr<Texture<Float>> TextureParams::GetFloatTextureOrNull(
+    const std::string &n) const {
+    return GetFloatTextureOrNull(ParamSymbol::Find(n));
+}
+
+std::shared_ptr<Texture<Spectrum>> TextureParams::GetSpectrumTexture(
+    const ParamSymbol *n, const Spectrum &def) const {
     std::string name = geomParams.FindTexture(n);
     if (name == "") name = materialParams.FindTexture(n);
     if (name != "") {
-        if (spectrumTextures.find(name) != spectrumTextures.end())
-            return spectrumTextures[name];
+        auto iter = spectrumTextures.find(name);
+        if (iter != spectrumTextures.end())
+            return iter->second;
         else
             Error(
                 "Couldn't find spectrum texture named \"%s\" "
                 "for parameter \"%s\"",
-                name.c_str(), n.c_str());
+                name.c_str(), n->name.c_str());
     }
     Spectrum val = materialParams.FindOneSpectrum(n, def);
     val = geomParams.FindOneSpectrum(n, val);
@@ -737,16 +859,17 @@ std::shared_ptr<Texture<Spectrum>> TextureParams::GetSpectrumTexture(
 }
 
 std::shared_ptr<Texture<Spectrum>> TextureParams::GetSpectrumTextureOrNull(
-    const std::string &n) const {
+    const ParamSymbol *n) const {
     std::string name = geomParams.FindTexture(n);
     if (name == "") name = materialParams.FindTexture(n);
     if (name != "") {
-        if (spectrumTextures.find(name) != spectrumTextures.end())
-            return spectrumTextures[name];
+        auto iter = spectrumTextures.find(name);
+        if (iter != spectrumTextures.end())
+            return iter->second;
         else {
             Error(
                 "Couldn't find spectrum texture named \"%s\" for parameter \"%s\"",
-                name.c_str(), n.c_str());
+                name.c_str(), n->name.c_str());
             return nullptr;
         }
     }
@@ -756,33 +879,36 @@ std::shared_ptr<Texture<Spectrum>> TextureParams::GetSpectrumTextureOrNull(
     if (val) return std::make_shared<ConstantTexture<Spectrum>>(*val);
     return nullptr;
 }
+
 std::shared_ptr<Texture<Float>> TextureParams::GetFloatTexture(
-    const std::string &n, Float def) const {
+    const ParamSymbol *n, Float def) const {
     std::string name = geomParams.FindTexture(n);
     if (name == "") name = materialParams.FindTexture(n);
     if (name != "") {
-        if (floatTextures.find(name) != floatTextures.end())
-            return floatTextures[name];
+        auto iter = floatTextures.find(name);
+        if (iter != floatTextures.end())
+            return iter->second;
         else
             Error(
                 "Couldn't find float texture named \"%s\" for parameter \"%s\"",
-                name.c_str(), n.c_str());
+                name.c_str(), n->name.c_str());
     }
     Float val = geomParams.FindOneFloat(n, materialParams.FindOneFloat(n, def));
     return std::make_shared<ConstantTexture<Float>>(val);
 }
 
 std::shared_ptr<Texture<Float>> TextureParams::GetFloatTextureOrNull(
-    const std::string &n) const {
+    const ParamSymbol *n) const {
     std::string name = geomParams.FindTexture(n);
     if (name == "") name = materialParams.FindTexture(n);
     if (name != "") {
-        if (floatTextures.find(name) != floatTextures.end())
-            return floatTextures[name];
+        auto iter = floatTextures.find(name);
+        if (iter != floatTextures.end())
+            return iter->second;
         else {
             Error(
                 "Couldn't find float texture named \"%s\" for parameter \"%s\"",
-                name.c_str(), n.c_str());
+                name.c_str(), n->name.c_str());
             return nullptr;
         }
     }
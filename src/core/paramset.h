@@ -49,6 +49,37 @@
 
 namespace pbrt {
 
+// ParamSymbol Declarations
+
+// Parameter names are interned: each distinct name maps to a single
+// ParamSymbol, so that looking up a parameter hashes the name once and then
+// compares pointers rather than strings.  Symbols are never freed; the table
+// can be read and extended from multiple threads without locking.
+class ParamSymbol {
+  public:
+    // ParamSymbol Public Methods
+
+    // Returns the symbol for _name_, creating it if there isn't one yet
+    static const ParamSymbol *Intern(const std::string &name);
+    // Returns the symbol for _name_ or _nullptr_ if it hasn't been interned,
+    // in which case no parameter can have that name
+    static const ParamSymbol *Find(const std::string &name);
+
+    // ParamSymbol Public Data
+    const std::string name;
+
+  private:
+    // ParamSymbol Private Methods
+    ParamSymbol(const std::string &name, size_t hash)
+        : name(name), hash(hash) {}
+    static const ParamSymbol *Find(const std::string &name, size_t hash,
+                                   const ParamSymbol *chain);
+
+    // ParamSymbol Private Data
+    const size_t hash;
+    const ParamSymbol *next = nullptr;
+};
+
 // ParamSet Declarations
 class ParamSet {
   public:
@@ -81,6 +112,8 @@ class ParamSet {
                                  int nValues);
     void AddSampledSpectrum(const std::string &, std::unique_ptr<Float[]> v,
                             int nValues);
+    void AddSpectrum(const std::string &, std::unique_ptr<Spectrum[]> v,
+                     int nValues);
     bool EraseInt(const std::string &);
     bool EraseBool(const std::string &);
     bool EraseFloat(const std::string &);
@@ -115,12 +148,40 @@ class ParamSet {
     const Normal3f *FindNormal3f(const std::string &, int *nValues) const;
     const Spectrum *FindSpectrum(const std::string &, int *nValues) const;
     const std::string *FindString(const std::string &, int *nValues) const;
+
+    // Lookups by interned name compare pointers instead of strings; they
+    // pay off for callers that intern the name once, e.g. in a static
+    Float FindOneFloat(const ParamSymbol *, Float d) const;
+    int FindOneInt(const ParamSymbol *, int d) const;
+    bool FindOneBool(const ParamSymbol *, bool d) const;
+    Point2f FindOnePoint2f(const ParamSymbol *, const Point2f &d) const;
+    Vector2f FindOneVector2f(const ParamSymbol *, const Vector2f &d) const;
+    Point3f FindOnePoint3f(const ParamSymbol *, const Point3f &d) const;
+    Vector3f FindOneVector3f(const ParamSymbol *, const Vector3f &d) const;
+    Normal3f FindOneNormal3f(const ParamSymbol *, const Normal3f &d) const;
+    Spectrum FindOneSpectrum(const ParamSymbol *, const Spectrum &d) const;
+    std::string FindOneString(const ParamSymbol *, const std::string &d) const;
+    std::string FindOneFilename(const ParamSymbol *,
+                                const std::string &d) const;
+    std::string FindTexture(const ParamSymbol *) const;
+    const Float *FindFloat(const ParamSymbol *, int *n) const;
+    const int *FindInt(const ParamSymbol *, int *nValues) const;
+    const bool *FindBool(const ParamSymbol *, int *nValues) const;
+    const Point2f *FindPoint2f(const ParamSymbol *, int *nValues) const;
+    const Vector2f *FindVector2f(const ParamSymbol *, int *nValues) const;
+    const Point3f *FindPoint3f(const ParamSymbol *, int *nValues) const;
+    const Vector3f *FindVector3f(const ParamSymbol *, int *nValues) const;
+    const Normal3f *FindNormal3f(const ParamSymbol *, int *nValues) const;
+    const Spectrum *FindSpectrum(const ParamSymbol *, int *nValues) const;
+    const std::string *FindString(const ParamSymbol *, int *nValues) const;
     void ReportUnused() const;
     void Clear();
     std::string ToString() const;
     void Print(int indent) const;
 
   private:
+    friend class BinarySceneWriter;
+
     // ParamSet Private Data
     std::vector<std::shared_ptr<ParamSetItem<bool>>> bools;
     std::vector<std::shared_ptr<ParamSetItem<int>>> ints;
@@ -144,6 +205,7 @@ struct ParamSetItem {
 
     // ParamSetItem Data
     const std::string name;
+    const ParamSymbol *symbol;
     const std::unique_ptr<T[]> values;
     const int nValues;
     mutable bool lookedUp = false;
@@ -153,7 +215,10 @@ struct ParamSetItem {
 template <typename T>
 ParamSetItem<T>::ParamSetItem(const std::string &name, std::unique_ptr<T[]> v,
                               int nValues)
-    : name(name), values(std::move(v)), nValues(nValues) {}
+    : name(name),
+      symbol(ParamSymbol::Intern(name)),
+      values(std::move(v)),
+      nValues(nValues) {}
 
 // TextureParams Declarations
 class TextureParams {
@@ -175,6 +240,17 @@ class TextureParams {
                                                     Float def) const;
     std::shared_ptr<Texture<Float>> GetFloatTextureOrNull(
         const std::string &name) const;
+    // The texture lookups above find the name's symbol once and then search
+    // both ParamSets by symbol; callers that create many objects can pass a
+    // symbol interned up front instead
+    std::shared_ptr<Texture<Spectrum>> GetSpectrumTexture(
+        const ParamSymbol *name, const Spectrum &def) const;
+    std::shared_ptr<Texture<Spectrum>> GetSpectrumTextureOrNull(
+        const ParamSymbol *name) const;
+    std::shared_ptr<Texture<Float>> GetFloatTexture(const ParamSymbol *name,
+                                                    Float def) const;
+    std::shared_ptr<Texture<Float>> GetFloatTextureOrNull(
+        const ParamSymbol *name) const;
     Float FindFloat(const std::string &n, Float d) const {
         return geomParams.FindOneFloat(n, materialParams.FindOneFloat(n, d));
     }
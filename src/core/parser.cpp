@@ -33,29 +33,435 @@
 
 // core/parser.cpp*
 #include "parser.h"
+#include "binaryscene.h"
 #include "fileutil.h"
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
+namespace pbrt {
+struct ParamArray;
+}
+
+#include "pbrtparse.h"
 
 extern FILE *yyin;
 extern int yyparse(void);
 extern int yydebug;
+extern int yylex();
 
 namespace pbrt {
 
+extern int line_num;
+extern std::string current_file;
+extern int catIndentCount;
+extern void include_push(char *filename);
+extern ParamArray *NewNumArray(double *values, int nValues);
+
+// Parsing Local Definitions
+
+// Scene files being tokenized directly from memory-mapped data rather than
+// by the flex scanner; the last one is the innermost _Include_d file.
+struct MappedSceneFile {
+    std::unique_ptr<MappedFile> file;
+    const char *pos, *end;
+    // _current_file_ and _line_num_ of the file that included this one
+    std::string parentFile;
+    int parentLineNum;
+    // The contents of included files that can't be mapped, like empty
+    // files and pipes, which are read into memory instead
+    std::vector<char> contents;
+};
+
+static std::vector<MappedSceneFile> mappedFiles;
+
+static const struct {
+    const char *name;
+    int token;
+} sceneKeywords[] = {
+    {"Accelerator", ACCELERATOR},
+    {"ActiveTransform", ACTIVETRANSFORM},
+    {"All", ALL},
+    {"AreaLightSource", AREALIGHTSOURCE},
+    {"AttributeBegin", ATTRIBUTEBEGIN},
+    {"AttributeEnd", ATTRIBUTEEND},
+    {"Camera", CAMERA},
+    {"ConcatTransform", CONCATTRANSFORM},
+    {"CoordinateSystem", COORDINATESYSTEM},
+    {"CoordSysTransform", COORDSYSTRANSFORM},
+    {"EndTime", ENDTIME},
+    {"Extractor", EXTRACTOR},
+    {"Film", FILM},
+    {"Identity", IDENTITY},
+    {"Include", INCLUDE},
+    {"LightSource", LIGHTSOURCE},
+    {"LookAt", LOOKAT},
+    {"MakeNamedMedium", MAKENAMEDMEDIUM},
+    {"MakeNamedMaterial", MAKENAMEDMATERIAL},
+    {"Material", MATERIAL},
+    {"MediumInterface", MEDIUMINTERFACE},
+    {"NamedMaterial", NAMEDMATERIAL},
+    {"ObjectBegin", OBJECTBEGIN},
+    {"ObjectEnd", OBJECTEND},
+    {"ObjectInstance", OBJECTINSTANCE},
+    {"PixelFilter", PIXELFILTER},
+    {"ReverseOrientation", REVERSEORIENTATION},
+    {"Rotate", ROTATE},
+    {"Sampler", SAMPLER},
+    {"Scale", SCALE},
+    {"Shape", SHAPE},
+    {"StartTime", STARTTIME},
+    {"Integrator", INTEGRATOR},
+    {"Texture", TEXTURE},
+    {"TransformBegin", TRANSFORMBEGIN},
+    {"TransformEnd", TRANSFORMEND},
+    {"TransformTimes", TRANSFORMTIMES},
+    {"Transform", TRANSFORM},
+    {"Translate", TRANSLATE},
+    {"WorldBegin", WORLDBEGIN},
+    {"WorldEnd", WORLDEND}};
+
+// Powers of ten that are exactly representable as doubles
+static const double exactPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool IsIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline uint64_t LoadEightChars(const char *p) {
+    // Assemble the word in little-endian order regardless of the host's,
+    // which compilers turn into a single load on little-endian machines
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | uint8_t(p[i]);
+    return v;
+}
+
+// Checks and converts eight ASCII digits at a time, with a handful of
+// 64-bit operations in place of eight compare/multiply-add steps.
+static inline bool IsEightDigits(uint64_t v) {
+    return !(((v + 0x4646464646464646) | (v - 0x3030303030303030)) &
+             0x8080808080808080);
+}
+
+static inline uint32_t ParseEightDigits(uint64_t v) {
+    const uint64_t mask = 0x000000FF000000FF;
+    const uint64_t mul1 = 100 + (1000000ull << 32);
+    const uint64_t mul2 = 1 + (10000ull << 32);
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return uint32_t(v);
+}
+
+static inline const char *ParseDigits(const char *p, const char *end,
+                                      uint64_t *mantissa) {
+    while (end - p >= 8) {
+        uint64_t v = LoadEightChars(p);
+        if (!IsEightDigits(v)) break;
+        *mantissa = *mantissa * 100000000 + ParseEightDigits(v);
+        p += 8;
+    }
+    while (p < end && IsDigit(*p)) *mantissa = *mantissa * 10 + (*p++ - '0');
+    return p;
+}
+
+static void SetTokenString(const char *s, size_t length) {
+    length = std::min(length, sizeof(yylval.string) - 1);
+    memcpy(yylval.string, s, length);
+    yylval.string[length] = '\0';
+}
+
+static int ScanString(MappedSceneFile &f) {
+    const char *&p = f.pos;
+    size_t length = 0;
+    const size_t maxLength = sizeof(yylval.string) - 1;
+    auto addChar = [&](char c) {
+        if (length < maxLength) yylval.string[length++] = c;
+    };
+    for (++p; p < f.end;) {
+        char c = *p++;
+        if (c == '"') {
+            yylval.string[length] = '\0';
+            return STRING;
+        } else if (c == '\n')
+            Error("Unterminated string!");
+        else if (c != '\\')
+            addChar(c);
+        else if (p < f.end) {
+            c = *p++;
+            switch (c) {
+            case 'n': addChar('\n'); break;
+            case 't': addChar('\t'); break;
+            case 'r': addChar('\r'); break;
+            case 'b': addChar('\b'); break;
+            case 'f': addChar('\f'); break;
+            case '\n': ++line_num; break;
+            default:
+                // Three digits give a decimal character code, as in the
+                // flex scanner; anything else is kept as is
+                if (IsDigit(c) && f.end - p >= 2 && IsDigit(p[0]) &&
+                    IsDigit(p[1])) {
+                    int val = 100 * (c - '0') + 10 * (p[0] - '0') + (p[1] - '0');
+                    while (val > 256) val -= 256;
+                    addChar(val);
+                    p += 2;
+                } else
+                    addChar(c);
+            }
+        }
+    }
+    Error("Unterminated string!");
+    yylval.string[length] = '\0';
+    return STRING;
+}
+
+// Scans an entire bracketed array of numbers into a single _NUM_ARRAY_
+// token, which spares the parser from handling each value as a separate
+// token.  Returns 0 if the array holds anything else (strings, comments),
+// in which case it is left to be tokenized one value at a time.
+static int ScanNumArray(MappedSceneFile &f) {
+    const char *p = f.pos + 1, *end = f.end;
+    const char *close = (const char *)memchr(p, ']', end - p);
+    if (!close) return 0;
+
+    // Size the array for short numbers up front so that few arrays need
+    // to grow
+    size_t allocated = (close - p) / 4 + 1, nValues = 0;
+    double *values = (double *)malloc(allocated * sizeof(double));
+    int nLines = 0;
+    while (true) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            nLines += (*p++ == '\n');
+        if (p == close) break;
+        if (nValues == allocated) {
+            allocated *= 2;
+            values = (double *)realloc(values, allocated * sizeof(double));
+        }
+        const char *next = ParseNumber(p, close, &values[nValues]);
+        if (next == p || nValues == std::numeric_limits<int>::max()) {
+            free(values);
+            return 0;
+        }
+        p = next;
+        ++nValues;
+    }
+    if (nValues == 0) {
+        free(values);
+        return 0;
+    }
+    line_num += nLines;
+    f.pos = close + 1;
+    yylval.ribarray = NewNumArray(values, nValues);
+    return NUM_ARRAY;
+}
+
+static int NextMappedToken() {
+    while (true) {
+        MappedSceneFile &f = mappedFiles.back();
+        const char *&p = f.pos;
+        if (p == f.end) {
+            // Return to the including file at the end of an included one
+            if (mappedFiles.size() == 1) return 0;
+            current_file = f.parentFile;
+            line_num = f.parentLineNum;
+            mappedFiles.pop_back();
+            continue;
+        }
+        switch (*p) {
+        case ' ':
+        case '\t':
+        case '\r':
+            ++p;
+            continue;
+        case '\n':
+            ++line_num;
+            ++p;
+            continue;
+        case '#': {
+            const char *eol = (const char *)memchr(p, '\n', f.end - p);
+            if (!eol) eol = f.end;
+            if (PbrtOptions.cat || PbrtOptions.toPly) {
+                printf("%*s", catIndentCount, "");
+                fwrite(p, 1, eol - p, stdout);
+                if (eol != f.end) putchar('\n');
+            }
+            if (eol != f.end) ++line_num;
+            p = eol == f.end ? eol : eol + 1;
+            continue;
+        }
+        case '[': {
+            if (int token = ScanNumArray(f)) return token;
+            ++p;
+            return LBRACK;
+        }
+        case ']':
+            ++p;
+            return RBRACK;
+        case '"':
+            return ScanString(f);
+        }
+
+        if (IsDigit(*p) || *p == '.' || *p == '+' || *p == '-') {
+            const char *next = ParseNumber(p, f.end, &yylval.num);
+            if (next != p) {
+                p = next;
+                return NUM;
+            }
+        } else if (IsIdentifierStart(*p)) {
+            const char *start = p;
+            while (p < f.end && (IsIdentifierStart(*p) || IsDigit(*p))) ++p;
+            size_t length = p - start;
+            for (const auto &keyword : sceneKeywords)
+                if (strlen(keyword.name) == length &&
+                    memcmp(keyword.name, start, length) == 0)
+                    return keyword.token;
+            SetTokenString(start, length);
+            return ID;
+        }
+        Error("Illegal character: %c (0x%x)", *p, int(*p));
+        ++p;
+    }
+}
+
 // Parsing Global Interface
-bool ParseFile(const std::string &filename) {
-    extern std::string current_file;
-    extern int line_num;
+const char *ParseNumber(const char *p, const char *end, double *value) {
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+
+    // Accumulate the digits before and after the decimal point in one
+    // integer mantissa
+    uint64_t mantissa = 0;
+    const char *intStart = p;
+    p = ParseDigits(p, end, &mantissa);
+    int nDigits = p - intStart, exponent = 0;
+    if (p < end && *p == '.') {
+        const char *fracStart = ++p;
+        p = ParseDigits(p, end, &mantissa);
+        exponent = -int(p - fracStart);
+        nDigits += p - fracStart;
+    }
+    if (nDigits == 0) return start;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '+' || *e == '-'))
+            negativeExponent = (*e++ == '-');
+        if (e < end && IsDigit(*e)) {
+            int exp = 0;
+            for (; e < end && IsDigit(*e); ++e)
+                if (exp < 100000) exp = 10 * exp + (*e - '0');
+            exponent += negativeExponent ? -exp : exp;
+            p = e;
+        }
+    }
+
+    if (nDigits <= 15 && exponent >= -22 && exponent <= 22) {
+        // Both the mantissa and the power of ten are exact doubles, so a
+        // single multiply or divide gives the correctly rounded value
+        double v = double(mantissa);
+        if (exponent < 0)
+            v /= exactPowersOfTen[-exponent];
+        else
+            v *= exactPowersOfTen[exponent];
+        *value = negative ? -v : v;
+    } else
+        *value = strtod(std::string(start, p).c_str(), nullptr);
+    return p;
+}
+
+int NextToken() {
+    if (mappedFiles.empty()) return yylex();
+    return NextMappedToken();
+}
+
+void IncludeFile(char *filename) {
+    if (mappedFiles.empty()) {
+        include_push(filename);
+        return;
+    }
+    if (mappedFiles.size() > 32) {
+        Error("Only 32 levels of nested Include allowed in scene files.");
+        exit(1);
+    }
+    std::string newFile = AbsolutePath(ResolveFilename(filename));
+    std::unique_ptr<MappedFile> file = MappedFile::Open(newFile);
+    std::vector<char> contents;
+    const char *data = nullptr;
+    size_t size = 0;
+    if (file) {
+        data = file->Data();
+        size = file->Size();
+    } else {
+        FILE *f = fopen(newFile.c_str(), "rb");
+        if (!f) {
+            Error("Unable to open included scene file \"%s\"",
+                  newFile.c_str());
+            return;
+        }
+        char buf[65536];
+        size_t nRead;
+        while ((nRead = fread(buf, 1, sizeof(buf), f)) > 0)
+            contents.insert(contents.end(), buf, buf + nRead);
+        bool failed = ferror(f);
+        fclose(f);
+        if (failed) {
+            Error("Unable to read included scene file \"%s\"",
+                  newFile.c_str());
+            return;
+        }
+        data = contents.data();
+        size = contents.size();
+    }
+    // Moving _contents_ into _mappedFiles_ keeps _data_ valid
+    mappedFiles.push_back(MappedSceneFile{std::move(file), data, data + size,
+                                          current_file, line_num,
+                                          std::move(contents)});
+    current_file = newFile;
+    line_num = 1;
+}
 
+bool ParseFile(const std::string &filename) {
     LOG(INFO) << "Starting to parse input file " << filename;
 
+    if (filename != "-" && IsBinarySceneFile(filename)) {
+        SetSearchDirectory(DirectoryContaining(filename));
+        bool success = ParseBinarySceneFile(filename);
+        LOG(INFO) << "Done replaying binary scene file " << filename;
+        return success;
+    }
+
     if (getenv("PBRT_YYDEBUG") != nullptr) yydebug = 1;
 
+    // Tokenize regular files from a memory mapping; standard input and
+    // empty files go through the flex scanner.
+    std::unique_ptr<MappedFile> file;
+    if (filename != "-") {
+        SetSearchDirectory(DirectoryContaining(filename));
+        file = MappedFile::Open(filename);
+    }
+    if (file) {
+        const char *data = file->Data();
+        size_t size = file->Size();
+        mappedFiles.push_back(
+            MappedSceneFile{std::move(file), data, data + size, "", 0});
+        current_file = filename;
+        line_num = 1;
+        yyparse();
+        mappedFiles.clear();
+        current_file = "";
+        line_num = 0;
+        LOG(INFO) << "Done parsing input file " << filename;
+        return true;
+    }
+
     if (filename == "-")
         yyin = stdin;
-    else {
+    else
         yyin = fopen(filename.c_str(), "r");
-        SetSearchDirectory(DirectoryContaining(filename));
-    }
     if (yyin != nullptr) {
         current_file = filename;
         if (yyin == stdin) current_file = "<standard input>";
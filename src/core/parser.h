@@ -45,6 +45,11 @@ namespace pbrt {
 
 bool ParseFile(const std::string &filename);
 
+// Parses a number with the syntax used in scene files from the start of
+// [p, end); returns a pointer to the character following it, or _p_ if the
+// text doesn't start with a number.  The result matches _strtod()_.
+const char *ParseNumber(const char *p, const char *end, double *value);
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_PARSER_H
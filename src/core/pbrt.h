@@ -168,7 +168,22 @@ struct Options {
     bool quickRender = false;
     bool quiet = false;
     bool cat = false, toPly = false;
+    // Binary scene file to record the scene description to instead of
+    // rendering it.
+    std::string toBinary;
     std::string imageFile;
+    std::string accelCacheDir;
+    // Directory that filtered image texture MIP maps are cached in.
+    std::string mipmapCacheDir;
+    // Megabytes of paged mesh geometry to keep resident; 0 for no limit.
+    Float geometryBudget = 0;
+    // Megabytes of image texture tiles to keep resident; 0 to keep all
+    // image textures fully in memory.
+    Float textureBudget = 0;
+    // Limits of the Ptex texture cache: megabytes of texture data to keep
+    // resident, with 0 for no limit, and the number of files kept open.
+    Float ptexBudget = 0;
+    int ptexMaxFiles = 100;
 };
 
 extern Options PbrtOptions;
@@ -253,6 +268,46 @@ inline double BitsToFloat(uint64_t ui) {
     return f;
 }
 
+// Converts to IEEE half precision, rounding to nearest even; values too
+// large for a half become infinity
+inline uint16_t FloatToHalf(float f) {
+    uint32_t ui = FloatToBits(f);
+    uint32_t sign = ui & 0x80000000u;
+    ui ^= sign;
+    uint16_t h;
+    if (ui >= (143u << 23))
+        // Infinity and NaN, and finite values that overflow
+        h = ui > (255u << 23) ? 0x7e00 : 0x7c00;
+    else if (ui < (113u << 23)) {
+        // Denormalized halves are rounded by a float addition
+        const uint32_t denormMagic = 126u << 23;
+        h = FloatToBits(BitsToFloat(ui) + BitsToFloat(denormMagic)) -
+            denormMagic;
+    } else {
+        // Rebias the exponent and round the mantissa
+        uint32_t mantissaOdd = (ui >> 13) & 1;
+        ui += 0xc8000fffu + mantissaOdd;
+        h = ui >> 13;
+    }
+    return h | (sign >> 16);
+}
+
+inline float HalfToFloat(uint16_t h) {
+    const uint32_t shiftedExp = 0x7c00u << 13;
+    uint32_t ui = (h & 0x7fffu) << 13;
+    uint32_t exp = ui & shiftedExp;
+    ui += (127u - 15u) << 23;
+    if (exp == shiftedExp)
+        // Infinity and NaN
+        ui += (128u - 16u) << 23;
+    else if (exp == 0) {
+        // Zero and denormalized halves
+        ui += 1u << 23;
+        ui = FloatToBits(BitsToFloat(ui) - BitsToFloat(113u << 23));
+    }
+    return BitsToFloat(ui | (uint32_t(h & 0x8000u) << 16));
+}
+
 inline float NextFloatUp(float v) {
     // Handle infinity and negative zero for _NextFloatUp()_
     if (std::isinf(v) && v > 0.) return v;
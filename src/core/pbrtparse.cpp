@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton implementation for Bison's Yacc-like parsers in C
+/* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -36,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -43,11 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "2.3"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -55,118 +57,17 @@
 /* Pure parsers.  */
 #define YYPURE 0
 
-/* Using locations.  */
-#define YYLSP_NEEDED 0
-
-
-
-/* Tokens.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     STRING = 258,
-     ID = 259,
-     NUM = 260,
-     LBRACK = 261,
-     RBRACK = 262,
-     ACCELERATOR = 263,
-     ACTIVETRANSFORM = 264,
-     ALL = 265,
-     AREALIGHTSOURCE = 266,
-     ATTRIBUTEBEGIN = 267,
-     ATTRIBUTEEND = 268,
-     CAMERA = 269,
-     CONCATTRANSFORM = 270,
-     COORDINATESYSTEM = 271,
-     COORDSYSTRANSFORM = 272,
-     ENDTIME = 273,
-     FILM = 274,
-     IDENTITY = 275,
-     INCLUDE = 276,
-     LIGHTSOURCE = 277,
-     LOOKAT = 278,
-     MAKENAMEDMATERIAL = 279,
-     MAKENAMEDMEDIUM = 280,
-     MATERIAL = 281,
-     MEDIUMINTERFACE = 282,
-     NAMEDMATERIAL = 283,
-     OBJECTBEGIN = 284,
-     OBJECTEND = 285,
-     OBJECTINSTANCE = 286,
-     PIXELFILTER = 287,
-     REVERSEORIENTATION = 288,
-     ROTATE = 289,
-     SAMPLER = 290,
-     SCALE = 291,
-     SHAPE = 292,
-     STARTTIME = 293,
-     INTEGRATOR = 294,
-     TEXTURE = 295,
-     TRANSFORMBEGIN = 296,
-     TRANSFORMEND = 297,
-     TRANSFORMTIMES = 298,
-     TRANSFORM = 299,
-     TRANSLATE = 300,
-     WORLDBEGIN = 301,
-     WORLDEND = 302,
-     HIGH_PRECEDENCE = 303
-   };
-#endif
-/* Tokens.  */
-#define STRING 258
-#define ID 259
-#define NUM 260
-#define LBRACK 261
-#define RBRACK 262
-#define ACCELERATOR 263
-#define ACTIVETRANSFORM 264
-#define ALL 265
-#define AREALIGHTSOURCE 266
-#define ATTRIBUTEBEGIN 267
-#define ATTRIBUTEEND 268
-#define CAMERA 269
-#define CONCATTRANSFORM 270
-#define COORDINATESYSTEM 271
-#define COORDSYSTRANSFORM 272
-#define ENDTIME 273
-#define FILM 274
-#define IDENTITY 275
-#define INCLUDE 276
-#define LIGHTSOURCE 277
-#define LOOKAT 278
-#define MAKENAMEDMATERIAL 279
-#define MAKENAMEDMEDIUM 280
-#define MATERIAL 281
-#define MEDIUMINTERFACE 282
-#define NAMEDMATERIAL 283
-#define OBJECTBEGIN 284
-#define OBJECTEND 285
-#define OBJECTINSTANCE 286
-#define PIXELFILTER 287
-#define REVERSEORIENTATION 288
-#define ROTATE 289
-#define SAMPLER 290
-#define SCALE 291
-#define SHAPE 292
-#define STARTTIME 293
-#define INTEGRATOR 294
-#define TEXTURE 295
-#define TRANSFORMBEGIN 296
-#define TRANSFORMEND 297
-#define TRANSFORMTIMES 298
-#define TRANSFORM 299
-#define TRANSLATE 300
-#define WORLDBEGIN 301
-#define WORLDEND 302
-#define HIGH_PRECEDENCE 303
-
-
-
-
-/* Copy the first part of user declarations.  */
-#line 33 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
+
+
+
+/* First part of user prologue.  */
+#line 33 "pbrtparse.y"
 
 #include "api.h"
 #include "pbrt.h"
@@ -183,11 +84,13 @@ void yyerror(const char *str) {
     pbrt::Error("Parsing error: %s", str);
     exit(1);
 }
-extern int yylex();
 
 namespace pbrt {
 
-extern void include_push(char *filename);
+// Returns the next token from the mapped scene file tokenizer or the flex
+// scanner, depending on where the file being parsed came from
+extern int NextToken();
+extern void IncludeFile(char *filename);
 int line_num = 0;
 std::string current_file;
 
@@ -292,79 +195,199 @@ static bool lookupType(const char *name, int *type, std::string &sname);
 
 }  // namespace pbrt
 
+#define yylex pbrt::NextToken
 
 
-/* Enabling traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 1
-#endif
-
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
+#line 202 "pbrtparse.c"
 
-/* Enabling the token table.  */
-#ifndef YYTOKEN_TABLE
-# define YYTOKEN_TABLE 0
-#endif
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
 
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 160 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
+#include "pbrtparse.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
 {
-char string[1024];
-double num;
-pbrt::ParamArray *ribarray;
-}
-/* Line 193 of yacc.c.  */
-#line 325 "/Users/mmp/build/pbrt-v3/pbrtparse.c"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
-# define YYSTYPE_IS_TRIVIAL 1
-#endif
-
-
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_STRING = 3,                     /* STRING  */
+  YYSYMBOL_ID = 4,                         /* ID  */
+  YYSYMBOL_NUM = 5,                        /* NUM  */
+  YYSYMBOL_NUM_ARRAY = 6,                  /* NUM_ARRAY  */
+  YYSYMBOL_LBRACK = 7,                     /* LBRACK  */
+  YYSYMBOL_RBRACK = 8,                     /* RBRACK  */
+  YYSYMBOL_ACCELERATOR = 9,                /* ACCELERATOR  */
+  YYSYMBOL_ACTIVETRANSFORM = 10,           /* ACTIVETRANSFORM  */
+  YYSYMBOL_ALL = 11,                       /* ALL  */
+  YYSYMBOL_AREALIGHTSOURCE = 12,           /* AREALIGHTSOURCE  */
+  YYSYMBOL_ATTRIBUTEBEGIN = 13,            /* ATTRIBUTEBEGIN  */
+  YYSYMBOL_ATTRIBUTEEND = 14,              /* ATTRIBUTEEND  */
+  YYSYMBOL_CAMERA = 15,                    /* CAMERA  */
+  YYSYMBOL_CONCATTRANSFORM = 16,           /* CONCATTRANSFORM  */
+  YYSYMBOL_COORDINATESYSTEM = 17,          /* COORDINATESYSTEM  */
+  YYSYMBOL_COORDSYSTRANSFORM = 18,         /* COORDSYSTRANSFORM  */
+  YYSYMBOL_ENDTIME = 19,                   /* ENDTIME  */
+  YYSYMBOL_EXTRACTOR = 20,                 /* EXTRACTOR  */
+  YYSYMBOL_FILM = 21,                      /* FILM  */
+  YYSYMBOL_IDENTITY = 22,                  /* IDENTITY  */
+  YYSYMBOL_INCLUDE = 23,                   /* INCLUDE  */
+  YYSYMBOL_LIGHTSOURCE = 24,               /* LIGHTSOURCE  */
+  YYSYMBOL_LOOKAT = 25,                    /* LOOKAT  */
+  YYSYMBOL_MAKENAMEDMATERIAL = 26,         /* MAKENAMEDMATERIAL  */
+  YYSYMBOL_MAKENAMEDMEDIUM = 27,           /* MAKENAMEDMEDIUM  */
+  YYSYMBOL_MATERIAL = 28,                  /* MATERIAL  */
+  YYSYMBOL_MEDIUMINTERFACE = 29,           /* MEDIUMINTERFACE  */
+  YYSYMBOL_NAMEDMATERIAL = 30,             /* NAMEDMATERIAL  */
+  YYSYMBOL_OBJECTBEGIN = 31,               /* OBJECTBEGIN  */
+  YYSYMBOL_OBJECTEND = 32,                 /* OBJECTEND  */
+  YYSYMBOL_OBJECTINSTANCE = 33,            /* OBJECTINSTANCE  */
+  YYSYMBOL_PIXELFILTER = 34,               /* PIXELFILTER  */
+  YYSYMBOL_REVERSEORIENTATION = 35,        /* REVERSEORIENTATION  */
+  YYSYMBOL_ROTATE = 36,                    /* ROTATE  */
+  YYSYMBOL_SAMPLER = 37,                   /* SAMPLER  */
+  YYSYMBOL_SCALE = 38,                     /* SCALE  */
+  YYSYMBOL_SHAPE = 39,                     /* SHAPE  */
+  YYSYMBOL_STARTTIME = 40,                 /* STARTTIME  */
+  YYSYMBOL_INTEGRATOR = 41,                /* INTEGRATOR  */
+  YYSYMBOL_TEXTURE = 42,                   /* TEXTURE  */
+  YYSYMBOL_TRANSFORMBEGIN = 43,            /* TRANSFORMBEGIN  */
+  YYSYMBOL_TRANSFORMEND = 44,              /* TRANSFORMEND  */
+  YYSYMBOL_TRANSFORMTIMES = 45,            /* TRANSFORMTIMES  */
+  YYSYMBOL_TRANSFORM = 46,                 /* TRANSFORM  */
+  YYSYMBOL_TRANSLATE = 47,                 /* TRANSLATE  */
+  YYSYMBOL_WORLDBEGIN = 48,                /* WORLDBEGIN  */
+  YYSYMBOL_WORLDEND = 49,                  /* WORLDEND  */
+  YYSYMBOL_HIGH_PRECEDENCE = 50,           /* HIGH_PRECEDENCE  */
+  YYSYMBOL_YYACCEPT = 51,                  /* $accept  */
+  YYSYMBOL_start = 52,                     /* start  */
+  YYSYMBOL_array_init = 53,                /* array_init  */
+  YYSYMBOL_string_array_init = 54,         /* string_array_init  */
+  YYSYMBOL_num_array_init = 55,            /* num_array_init  */
+  YYSYMBOL_array = 56,                     /* array  */
+  YYSYMBOL_string_array = 57,              /* string_array  */
+  YYSYMBOL_single_element_string_array = 58, /* single_element_string_array  */
+  YYSYMBOL_string_list = 59,               /* string_list  */
+  YYSYMBOL_string_list_entry = 60,         /* string_list_entry  */
+  YYSYMBOL_num_array = 61,                 /* num_array  */
+  YYSYMBOL_single_element_num_array = 62,  /* single_element_num_array  */
+  YYSYMBOL_num_list = 63,                  /* num_list  */
+  YYSYMBOL_num_list_entry = 64,            /* num_list_entry  */
+  YYSYMBOL_paramlist = 65,                 /* paramlist  */
+  YYSYMBOL_paramlist_init = 66,            /* paramlist_init  */
+  YYSYMBOL_paramlist_contents = 67,        /* paramlist_contents  */
+  YYSYMBOL_paramlist_entry = 68,           /* paramlist_entry  */
+  YYSYMBOL_pbrt_stmt_list = 69,            /* pbrt_stmt_list  */
+  YYSYMBOL_pbrt_stmt = 70                  /* pbrt_stmt  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-/* Copy the second part of user declarations.  */
 
 
-/* Line 216 of yacc.c.  */
-#line 338 "/Users/mmp/build/pbrt-v3/pbrtparse.c"
 
 #ifdef short
 # undef short
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
-#else
-typedef unsigned char yytype_uint8;
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
 #endif
 
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
-#elif (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
 typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
 #else
-typedef short int yytype_int8;
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
 #else
-typedef unsigned short int yytype_uint16;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef short int yytype_int16;
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
@@ -372,55 +395,106 @@ typedef short int yytype_int16;
 #  define YYSIZE_T __SIZE_TYPE__
 # elif defined size_t
 #  define YYSIZE_T size_t
-# elif ! defined YYSIZE_T && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
 #  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
 #  define YYSIZE_T size_t
 # else
-#  define YYSIZE_T unsigned int
+#  define YYSIZE_T unsigned
 # endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) -1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
 # if defined YYENABLE_NLS && YYENABLE_NLS
 #  if ENABLE_NLS
 #   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
-#   define YY_(msgid) dgettext ("bison-runtime", msgid)
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
 #  endif
 # endif
 # ifndef YY_
-#  define YY_(msgid) msgid
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
 # endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(e) ((void) (e))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(e) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-/* Identity function, used to suppress warnings about constant conditions.  */
-#ifndef lint
-# define YYID(n) (n)
-#else
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static int
-YYID (int i)
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
 #else
-static int
-YYID (i)
-    int i;
+# define YY_INITIAL_VALUE(Value) Value
 #endif
-{
-  return i;
-}
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
 #endif
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -437,11 +511,11 @@ YYID (i)
 #    define alloca _alloca
 #   else
 #    define YYSTACK_ALLOC alloca
-#    if ! defined _ALLOCA_H && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
 #     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#     ifndef _STDLIB_H
-#      define _STDLIB_H 1
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
 #     endif
 #    endif
 #   endif
@@ -449,8 +523,8 @@ YYID (i)
 # endif
 
 # ifdef YYSTACK_ALLOC
-   /* Pacify GCC's `empty if-body' warning.  */
-#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (YYID (0))
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
     /* The OS might guarantee only one guard page at the bottom of the stack,
        and a page size can be as small as 4096 bytes.  So we cannot safely
@@ -464,111 +538,117 @@ YYID (i)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
 #   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
 #  endif
-#  if (defined __cplusplus && ! defined _STDLIB_H \
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
        && ! ((defined YYMALLOC || defined malloc) \
-	     && (defined YYFREE || defined free)))
+             && (defined YYFREE || defined free)))
 #   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#   ifndef _STDLIB_H
-#    define _STDLIB_H 1
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
 #   endif
 #  endif
 #  ifndef YYMALLOC
 #   define YYMALLOC malloc
-#   if ! defined malloc && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined malloc && ! defined EXIT_SUCCESS
 void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 #  ifndef YYFREE
 #   define YYFREE free
-#   if ! defined free && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined free && ! defined EXIT_SUCCESS
 void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* !defined yyoverflow */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
-	 || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
-  yytype_int16 yyss;
-  YYSTYPE yyvs;
-  };
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-# define YYSTACK_GAP_MAXIMUM (sizeof (union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (sizeof (yytype_int16) + sizeof (YYSTYPE)) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
       + YYSTACK_GAP_MAXIMUM)
 
-/* Copy COUNT objects from FROM to TO.  The source and destination do
-   not overlap.  */
-# ifndef YYCOPY
-#  if defined __GNUC__ && 1 < __GNUC__
-#   define YYCOPY(To, From, Count) \
-      __builtin_memcpy (To, From, (Count) * sizeof (*(From)))
-#  else
-#   define YYCOPY(To, From, Count)		\
-      do					\
-	{					\
-	  YYSIZE_T yyi;				\
-	  for (yyi = 0; yyi < (Count); yyi++)	\
-	    (To)[yyi] = (From)[yyi];		\
-	}					\
-      while (YYID (0))
-#  endif
-# endif
+# define YYCOPY_NEEDED 1
 
 /* Relocate STACK from its old location to the new one.  The
    local variables YYSIZE and YYSTACKSIZE give the old and new number of
    elements in the stack, and YYPTR gives the new location of the
    stack.  Advance YYPTR to a properly aligned location for the next
    stack.  */
-# define YYSTACK_RELOCATE(Stack)					\
-    do									\
-      {									\
-	YYSIZE_T yynewbytes;						\
-	YYCOPY (&yyptr->Stack, Stack, yysize);				\
-	Stack = &yyptr->Stack;						\
-	yynewbytes = yystacksize * sizeof (*Stack) + YYSTACK_GAP_MAXIMUM; \
-	yyptr += yynewbytes / sizeof (*yyptr);				\
-      }									\
-    while (YYID (0))
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
 
 #endif
 
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  73
+#define YYFINAL  76
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   115
+#define YYLAST   120
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  49
+#define YYNTOKENS  51
 /* YYNNTS -- Number of nonterminals.  */
 #define YYNNTS  20
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  66
-/* YYNRULES -- Number of states.  */
-#define YYNSTATES  133
+#define YYNRULES  68
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  137
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   305
 
-/* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
-#define YYUNDEFTOK  2
-#define YYMAXUTOK   303
 
-#define YYTRANSLATE(YYX)						\
-  ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
-/* YYTRANSLATE[YYLEX] -- Bison symbol number corresponding to YYLEX.  */
-static const yytype_uint8 yytranslate[] =
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
 {
        0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -600,325 +680,241 @@ static const yytype_uint8 yytranslate[] =
       15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
       25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
       35,    36,    37,    38,    39,    40,    41,    42,    43,    44,
-      45,    46,    47,    48
+      45,    46,    47,    48,    49,    50
 };
 
 #if YYDEBUG
-/* YYPRHS[YYN] -- Index of the first RHS symbol of rule number YYN in
-   YYRHS.  */
-static const yytype_uint8 yyprhs[] =
-{
-       0,     0,     3,     5,     6,     7,     8,    10,    12,    17,
-      19,    22,    25,    27,    30,    35,    37,    40,    43,    45,
-      48,    51,    52,    55,    56,    59,    62,    64,    68,    71,
-      74,    77,    81,    83,    85,    89,    92,    95,    98,   102,
-     104,   107,   111,   122,   126,   130,   134,   137,   141,   144,
-     147,   149,   152,   156,   158,   164,   168,   173,   177,   181,
-     187,   189,   191,   195,   198,   203,   205
-};
-
-/* YYRHS -- A `-1'-separated list of the rules' RHS.  */
-static const yytype_int8 yyrhs[] =
-{
-      50,     0,    -1,    67,    -1,    -1,    -1,    -1,    55,    -1,
-      59,    -1,    51,     6,    57,     7,    -1,    56,    -1,    51,
-      58,    -1,    57,    58,    -1,    58,    -1,    52,     3,    -1,
-      51,     6,    61,     7,    -1,    60,    -1,    51,    62,    -1,
-      61,    62,    -1,    62,    -1,    53,     5,    -1,    64,    65,
-      -1,    -1,    66,    65,    -1,    -1,     3,    54,    -1,    67,
-      68,    -1,    68,    -1,     8,     3,    63,    -1,     9,    10,
-      -1,     9,    18,    -1,     9,    38,    -1,    11,     3,    63,
-      -1,    12,    -1,    13,    -1,    14,     3,    63,    -1,    15,
-      59,    -1,    16,     3,    -1,    17,     3,    -1,    19,     3,
-      63,    -1,    20,    -1,    21,     3,    -1,    22,     3,    63,
-      -1,    23,     5,     5,     5,     5,     5,     5,     5,     5,
-       5,    -1,    24,     3,    63,    -1,    25,     3,    63,    -1,
-      26,     3,    63,    -1,    27,     3,    -1,    27,     3,     3,
-      -1,    28,     3,    -1,    29,     3,    -1,    30,    -1,    31,
-       3,    -1,    32,     3,    63,    -1,    33,    -1,    34,     5,
-       5,     5,     5,    -1,    35,     3,    63,    -1,    36,     5,
-       5,     5,    -1,    37,     3,    63,    -1,    39,     3,    63,
-      -1,    40,     3,     3,     3,    63,    -1,    41,    -1,    42,
-      -1,    43,     5,     5,    -1,    44,    59,    -1,    45,     5,
-       5,     5,    -1,    46,    -1,    47,    -1
-};
-
-/* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
-static const yytype_uint16 yyrline[] =
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
 {
-       0,   184,   184,   190,   198,   206,   214,   220,   227,   234,
-     242,   248,   253,   259,   267,   274,   282,   288,   293,   299,
-     307,   313,   326,   332,   337,   345,   350,   356,   365,   371,
-     377,   383,   392,   398,   404,   413,   425,   431,   437,   446,
-     452,   458,   467,   473,   482,   491,   500,   506,   512,   518,
-     524,   530,   536,   545,   551,   557,   566,   572,   581,   590,
-     599,   605,   611,   617,   629,   635,   641
+       0,   189,   189,   195,   203,   211,   219,   225,   232,   239,
+     247,   253,   258,   264,   272,   279,   286,   293,   299,   304,
+     310,   318,   324,   337,   343,   348,   356,   361,   367,   376,
+     382,   388,   394,   403,   409,   415,   425,   437,   443,   449,
+     458,   464,   470,   479,   485,   494,   503,   512,   518,   524,
+     530,   536,   542,   548,   557,   563,   569,   577,   585,   591,
+     600,   609,   618,   624,   630,   636,   648,   654,   660
 };
 #endif
 
-#if YYDEBUG || YYERROR_VERBOSE || YYTOKEN_TABLE
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "STRING", "ID", "NUM", "LBRACK",
-  "RBRACK", "ACCELERATOR", "ACTIVETRANSFORM", "ALL", "AREALIGHTSOURCE",
-  "ATTRIBUTEBEGIN", "ATTRIBUTEEND", "CAMERA", "CONCATTRANSFORM",
-  "COORDINATESYSTEM", "COORDSYSTRANSFORM", "ENDTIME", "FILM", "IDENTITY",
-  "INCLUDE", "LIGHTSOURCE", "LOOKAT", "MAKENAMEDMATERIAL",
-  "MAKENAMEDMEDIUM", "MATERIAL", "MEDIUMINTERFACE", "NAMEDMATERIAL",
-  "OBJECTBEGIN", "OBJECTEND", "OBJECTINSTANCE", "PIXELFILTER",
-  "REVERSEORIENTATION", "ROTATE", "SAMPLER", "SCALE", "SHAPE", "STARTTIME",
-  "INTEGRATOR", "TEXTURE", "TRANSFORMBEGIN", "TRANSFORMEND",
-  "TRANSFORMTIMES", "TRANSFORM", "TRANSLATE", "WORLDBEGIN", "WORLDEND",
-  "HIGH_PRECEDENCE", "$accept", "start", "array_init", "string_array_init",
-  "num_array_init", "array", "string_array", "single_element_string_array",
-  "string_list", "string_list_entry", "num_array",
-  "single_element_num_array", "num_list", "num_list_entry", "paramlist",
-  "paramlist_init", "paramlist_contents", "paramlist_entry",
-  "pbrt_stmt_list", "pbrt_stmt", 0
+  "\"end of file\"", "error", "\"invalid token\"", "STRING", "ID", "NUM",
+  "NUM_ARRAY", "LBRACK", "RBRACK", "ACCELERATOR", "ACTIVETRANSFORM", "ALL",
+  "AREALIGHTSOURCE", "ATTRIBUTEBEGIN", "ATTRIBUTEEND", "CAMERA",
+  "CONCATTRANSFORM", "COORDINATESYSTEM", "COORDSYSTRANSFORM", "ENDTIME",
+  "EXTRACTOR", "FILM", "IDENTITY", "INCLUDE", "LIGHTSOURCE", "LOOKAT",
+  "MAKENAMEDMATERIAL", "MAKENAMEDMEDIUM", "MATERIAL", "MEDIUMINTERFACE",
+  "NAMEDMATERIAL", "OBJECTBEGIN", "OBJECTEND", "OBJECTINSTANCE",
+  "PIXELFILTER", "REVERSEORIENTATION", "ROTATE", "SAMPLER", "SCALE",
+  "SHAPE", "STARTTIME", "INTEGRATOR", "TEXTURE", "TRANSFORMBEGIN",
+  "TRANSFORMEND", "TRANSFORMTIMES", "TRANSFORM", "TRANSLATE", "WORLDBEGIN",
+  "WORLDEND", "HIGH_PRECEDENCE", "$accept", "start", "array_init",
+  "string_array_init", "num_array_init", "array", "string_array",
+  "single_element_string_array", "string_list", "string_list_entry",
+  "num_array", "single_element_num_array", "num_list", "num_list_entry",
+  "paramlist", "paramlist_init", "paramlist_contents", "paramlist_entry",
+  "pbrt_stmt_list", "pbrt_stmt", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[YYLEX-NUM] -- Internal token number corresponding to
-   token YYLEX-NUM.  */
-static const yytype_uint16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279,   280,   281,   282,   283,   284,
-     285,   286,   287,   288,   289,   290,   291,   292,   293,   294,
-     295,   296,   297,   298,   299,   300,   301,   302,   303
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
 
-/* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
+#define YYPACT_NINF (-112)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-6)
+
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int8 yypact[] =
 {
-       0,    49,    50,    51,    52,    53,    54,    54,    55,    55,
-      56,    57,    57,    58,    59,    59,    60,    61,    61,    62,
-      63,    64,    65,    65,    66,    67,    67,    68,    68,    68,
-      68,    68,    68,    68,    68,    68,    68,    68,    68,    68,
-      68,    68,    68,    68,    68,    68,    68,    68,    68,    68,
-      68,    68,    68,    68,    68,    68,    68,    68,    68,    68,
-      68,    68,    68,    68,    68,    68,    68
+      59,     3,    -8,     5,  -112,  -112,    15,    13,    17,    19,
+      21,    25,  -112,    26,    27,    28,    31,    32,    33,    34,
+      35,    36,  -112,    37,    38,  -112,    39,    40,    42,    45,
+      46,    47,  -112,  -112,    48,    13,    49,  -112,  -112,    51,
+      59,  -112,  -112,  -112,  -112,  -112,  -112,  -112,  -112,    24,
+    -112,  -112,  -112,  -112,  -112,  -112,  -112,  -112,    50,  -112,
+    -112,  -112,    53,  -112,  -112,  -112,  -112,    52,  -112,    54,
+    -112,  -112,    55,    56,  -112,    57,  -112,  -112,  -112,    60,
+    -112,  -112,  -112,    65,  -112,  -112,  -112,  -112,    73,  -112,
+    -112,  -112,  -112,  -112,    94,  -112,   104,  -112,  -112,    61,
+    -112,   105,    13,  -112,    60,    44,  -112,  -112,   106,   107,
+    -112,  -112,  -112,     0,  -112,  -112,  -112,  -112,  -112,  -112,
+    -112,   108,  -112,  -112,   109,    62,  -112,   110,   111,  -112,
+    -112,   112,  -112,  -112,   113,   115,  -112
 };
 
-/* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
 {
-       0,     2,     1,     0,     0,     0,     1,     1,     4,     1,
-       2,     2,     1,     2,     4,     1,     2,     2,     1,     2,
-       2,     0,     2,     0,     2,     2,     1,     3,     2,     2,
-       2,     3,     1,     1,     3,     2,     2,     2,     3,     1,
-       2,     3,    10,     3,     3,     3,     2,     3,     2,     2,
-       1,     2,     3,     1,     5,     3,     4,     3,     3,     5,
-       1,     1,     3,     2,     4,     1,     1
+       0,     0,     0,     0,    33,    34,     0,     3,     0,     0,
+       0,     0,    40,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,    51,     0,     0,    54,     0,     0,     0,     0,
+       0,     0,    62,    63,     0,     3,     0,    67,    68,     0,
+       2,    27,    22,    29,    30,    31,    22,    22,    16,     5,
+      36,    15,    37,    38,    22,    22,    41,    22,     0,    22,
+      22,    22,    47,    49,    50,    52,    22,     0,    22,     0,
+      22,    22,     0,     0,    65,     0,     1,    26,    28,    24,
+      32,    35,     5,     0,    17,    57,    39,    42,     0,    44,
+      45,    46,    48,    53,     0,    56,     0,    59,    60,     0,
+      64,     0,     3,    21,    24,     5,    19,    20,     0,     0,
+      58,    22,    66,     4,    25,     6,     9,     7,    23,    14,
+      18,     0,    55,    61,     4,     0,    10,     0,     4,    12,
+      13,     0,     8,    11,     0,     0,    43
 };
 
-/* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
-   STATE-NUM when YYTABLE doesn't specify something else to do.  Zero
-   means the default is an error.  */
-static const yytype_uint8 yydefact[] =
-{
-       0,     0,     0,     0,    32,    33,     0,     3,     0,     0,
-       0,    39,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,    50,     0,     0,    53,     0,     0,     0,     0,     0,
-       0,    60,    61,     0,     3,     0,    65,    66,     0,     2,
-      26,    21,    28,    29,    30,    21,    21,     5,    35,    15,
-      36,    37,    21,    40,    21,     0,    21,    21,    21,    46,
-      48,    49,    51,    21,     0,    21,     0,    21,    21,     0,
-       0,    63,     0,     1,    25,    27,    23,    31,    34,     5,
-       0,    16,    38,    41,     0,    43,    44,    45,    47,    52,
-       0,    55,     0,    57,    58,     0,    62,     0,     3,    20,
-      23,     5,    18,    19,     0,     0,    56,    21,    64,     4,
-      24,     6,     9,     7,    22,    14,    17,     0,    54,    59,
-       4,     0,    10,     0,     4,    12,    13,     0,     8,    11,
-       0,     0,    42
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
+{
+    -112,  -112,   -60,  -112,  -112,  -112,  -112,  -112,  -112,  -111,
+     -35,  -112,  -112,   -78,   -45,  -112,   -59,  -112,  -112,    20
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int8 yydefgoto[] =
+static const yytype_uint8 yydefgoto[] =
 {
-      -1,    38,    47,   121,    80,   110,   111,   112,   124,   122,
-      48,    49,   101,    81,    75,    76,    99,   100,    39,    40
+       0,    39,    49,   125,    83,   114,   115,   116,   128,   126,
+      50,    51,   105,    84,    78,    79,   103,   104,    40,    41
 };
 
-/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-   STATE-NUM.  */
-#define YYPACT_NINF -116
-static const yytype_int8 yypact[] =
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
 {
-      57,     1,    -3,     3,  -116,  -116,     8,  -116,    15,    17,
-      19,  -116,    23,    24,    25,    26,    28,    29,    30,    31,
-      33,  -116,    34,    35,  -116,    36,    37,    38,    39,    42,
-      43,  -116,  -116,    44,  -116,    45,  -116,  -116,    47,    57,
-    -116,  -116,  -116,  -116,  -116,  -116,  -116,    22,  -116,  -116,
-    -116,  -116,  -116,  -116,  -116,    46,  -116,  -116,  -116,    49,
-    -116,  -116,  -116,  -116,    48,  -116,    50,  -116,  -116,    51,
-      52,  -116,    53,  -116,  -116,  -116,    56,  -116,  -116,  -116,
-      55,  -116,  -116,  -116,    62,  -116,  -116,  -116,  -116,  -116,
-      70,  -116,    90,  -116,  -116,    58,  -116,   100,  -116,  -116,
-      56,    32,  -116,  -116,   101,   102,  -116,  -116,  -116,    11,
-    -116,  -116,  -116,  -116,  -116,  -116,  -116,   103,  -116,  -116,
-     104,    59,  -116,   105,    41,  -116,  -116,   106,  -116,  -116,
-     107,   108,  -116
+      74,    80,    81,    43,   106,    -5,    42,   124,    46,    85,
+      86,    44,    87,   129,    89,    90,    91,   133,    47,    48,
+      52,    93,    53,    95,    54,    97,    98,   120,    55,    56,
+      57,    82,    45,    58,    59,    60,    61,    62,    63,    64,
+      65,    66,   113,    68,    67,   118,   106,    69,    70,    71,
+      72,    76,   119,    73,    75,    88,    92,    94,    99,    96,
+      77,   100,   101,   102,   111,   130,   123,   117,     1,     2,
+     107,     3,     4,     5,     6,     7,     8,     9,   108,    10,
+      11,    12,    13,    14,    15,    16,    17,    18,    19,    20,
+      21,    22,    23,    24,    25,    26,    27,    28,    29,   109,
+      30,    31,    32,    33,    34,    35,    36,    37,    38,   110,
+     112,   121,   122,   127,    -5,   131,     0,   134,   135,   132,
+     136
 };
 
-/* YYPGOTO[NTERM-NUM].  */
-static const yytype_int8 yypgoto[] =
+static const yytype_int16 yycheck[] =
 {
-    -116,  -116,   -42,  -116,  -116,  -116,  -116,  -116,  -116,  -115,
-     -34,  -116,  -116,   -76,   -44,  -116,    14,  -116,  -116,    76
+      35,    46,    47,    11,    82,     5,     3,     7,     3,    54,
+      55,    19,    57,   124,    59,    60,    61,   128,     3,     6,
+       3,    66,     3,    68,     3,    70,    71,   105,     3,     3,
+       3,     7,    40,     5,     3,     3,     3,     3,     3,     3,
+       3,     3,   102,     3,     5,   104,   124,     5,     3,     3,
+       3,     0,     8,     5,     5,     5,     3,     5,     3,     5,
+      40,     5,     5,     3,     3,     3,   111,   102,     9,    10,
+       5,    12,    13,    14,    15,    16,    17,    18,     5,    20,
+      21,    22,    23,    24,    25,    26,    27,    28,    29,    30,
+      31,    32,    33,    34,    35,    36,    37,    38,    39,     5,
+      41,    42,    43,    44,    45,    46,    47,    48,    49,     5,
+       5,     5,     5,     5,     5,     5,    -1,     5,     5,     8,
+       5
 };
 
-/* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
-   positive, shift that token.  If negative, reduce the rule which
-   number is the opposite.  If zero, do what YYDEFACT says.
-   If YYTABLE_NINF, syntax error.  */
-#define YYTABLE_NINF -6
-static const yytype_int16 yytable[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
 {
-      71,    77,    78,   102,    41,   125,    45,    42,    82,   129,
-      83,    46,    85,    86,    87,    43,    -5,   120,    50,    89,
-      51,    91,    52,    93,    94,   116,    53,    54,    79,    56,
-      55,    57,    58,    59,    60,    44,    61,    62,    63,   115,
-      65,    64,    67,    66,   102,    68,    69,    73,   128,    70,
-      72,    84,    88,    90,    95,    92,   109,    96,    97,    98,
-     103,   107,   126,   119,   113,     1,     2,   104,     3,     4,
-       5,     6,     7,     8,     9,   105,    10,    11,    12,    13,
-      14,    15,    16,    17,    18,    19,    20,    21,    22,    23,
-      24,    25,    26,    27,    28,   106,    29,    30,    31,    32,
-      33,    34,    35,    36,    37,   108,   117,   118,   123,    -5,
-     127,   130,   131,   132,   114,    74
+       0,     9,    10,    12,    13,    14,    15,    16,    17,    18,
+      20,    21,    22,    23,    24,    25,    26,    27,    28,    29,
+      30,    31,    32,    33,    34,    35,    36,    37,    38,    39,
+      41,    42,    43,    44,    45,    46,    47,    48,    49,    52,
+      69,    70,     3,    11,    19,    40,     3,     3,     6,    53,
+      61,    62,     3,     3,     3,     3,     3,     3,     5,     3,
+       3,     3,     3,     3,     3,     3,     3,     5,     3,     5,
+       3,     3,     3,     5,    61,     5,     0,    70,    65,    66,
+      65,    65,     7,    55,    64,    65,    65,    65,     5,    65,
+      65,    65,     3,    65,     5,    65,     5,    65,    65,     3,
+       5,     5,     3,    67,    68,    63,    64,     5,     5,     5,
+       5,     3,     5,    53,    56,    57,    58,    61,    67,     8,
+      64,     5,     5,    65,     7,    54,    60,     5,    59,    60,
+       3,     5,     8,    60,     5,     5,     5
 };
 
-static const yytype_uint8 yycheck[] =
-{
-      34,    45,    46,    79,     3,   120,     3,    10,    52,   124,
-      54,     3,    56,    57,    58,    18,     5,     6,     3,    63,
-       3,    65,     3,    67,    68,   101,     3,     3,     6,     3,
-       5,     3,     3,     3,     3,    38,     3,     3,     3,     7,
-       3,     5,     3,     5,   120,     3,     3,     0,     7,     5,
-       5,     5,     3,     5,     3,     5,    98,     5,     5,     3,
-       5,     3,     3,   107,    98,     8,     9,     5,    11,    12,
-      13,    14,    15,    16,    17,     5,    19,    20,    21,    22,
-      23,    24,    25,    26,    27,    28,    29,    30,    31,    32,
-      33,    34,    35,    36,    37,     5,    39,    40,    41,    42,
-      43,    44,    45,    46,    47,     5,     5,     5,     5,     5,
-       5,     5,     5,     5,   100,    39
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    51,    52,    53,    54,    55,    56,    56,    57,    57,
+      58,    59,    59,    60,    61,    61,    61,    62,    63,    63,
+      64,    65,    66,    67,    67,    68,    69,    69,    70,    70,
+      70,    70,    70,    70,    70,    70,    70,    70,    70,    70,
+      70,    70,    70,    70,    70,    70,    70,    70,    70,    70,
+      70,    70,    70,    70,    70,    70,    70,    70,    70,    70,
+      70,    70,    70,    70,    70,    70,    70,    70,    70
 };
 
-/* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-   symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
-{
-       0,     8,     9,    11,    12,    13,    14,    15,    16,    17,
-      19,    20,    21,    22,    23,    24,    25,    26,    27,    28,
-      29,    30,    31,    32,    33,    34,    35,    36,    37,    39,
-      40,    41,    42,    43,    44,    45,    46,    47,    50,    67,
-      68,     3,    10,    18,    38,     3,     3,    51,    59,    60,
-       3,     3,     3,     3,     3,     5,     3,     3,     3,     3,
-       3,     3,     3,     3,     5,     3,     5,     3,     3,     3,
-       5,    59,     5,     0,    68,    63,    64,    63,    63,     6,
-      53,    62,    63,    63,     5,    63,    63,    63,     3,    63,
-       5,    63,     5,    63,    63,     3,     5,     5,     3,    65,
-      66,    61,    62,     5,     5,     5,     5,     3,     5,    51,
-      54,    55,    56,    59,    65,     7,    62,     5,     5,    63,
-       6,    52,    58,     5,    57,    58,     3,     5,     7,    58,
-       5,     5,     5
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     1,     0,     0,     0,     1,     1,     4,     1,
+       2,     2,     1,     2,     4,     1,     1,     2,     2,     1,
+       2,     2,     0,     2,     0,     2,     2,     1,     3,     2,
+       2,     2,     3,     1,     1,     3,     2,     2,     2,     3,
+       1,     2,     3,    10,     3,     3,     3,     2,     3,     2,
+       2,     1,     2,     3,     1,     5,     3,     3,     4,     3,
+       3,     5,     1,     1,     3,     2,     4,     1,     1
 };
 
-#define yyerrok		(yyerrstatus = 0)
-#define yyclearin	(yychar = YYEMPTY)
-#define YYEMPTY		(-2)
-#define YYEOF		0
 
-#define YYACCEPT	goto yyacceptlab
-#define YYABORT		goto yyabortlab
-#define YYERROR		goto yyerrorlab
+enum { YYENOMEM = -2 };
 
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
 
-/* Like YYERROR except do call yyerror.  This remains here temporarily
-   to ease the transition to the new meaning of YYERROR, for GCC.
-   Once GCC version 2 has supplanted version 1, this can go.  */
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
-#define YYFAIL		goto yyerrlab
 
 #define YYRECOVERING()  (!!yyerrstatus)
 
-#define YYBACKUP(Token, Value)					\
-do								\
-  if (yychar == YYEMPTY && yylen == 1)				\
-    {								\
-      yychar = (Token);						\
-      yylval = (Value);						\
-      yytoken = YYTRANSLATE (yychar);				\
-      YYPOPSTACK (1);						\
-      goto yybackup;						\
-    }								\
-  else								\
-    {								\
-      yyerror (YY_("syntax error: cannot back up")); \
-      YYERROR;							\
-    }								\
-while (YYID (0))
-
-
-#define YYTERROR	1
-#define YYERRCODE	256
-
-
-/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
-   If N is 0, then set CURRENT to the empty location which ends
-   the previous symbol: RHS[0] (always defined).  */
-
-#define YYRHSLOC(Rhs, K) ((Rhs)[K])
-#ifndef YYLLOC_DEFAULT
-# define YYLLOC_DEFAULT(Current, Rhs, N)				\
-    do									\
-      if (YYID (N))                                                    \
-	{								\
-	  (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;	\
-	  (Current).first_column = YYRHSLOC (Rhs, 1).first_column;	\
-	  (Current).last_line    = YYRHSLOC (Rhs, N).last_line;		\
-	  (Current).last_column  = YYRHSLOC (Rhs, N).last_column;	\
-	}								\
-      else								\
-	{								\
-	  (Current).first_line   = (Current).last_line   =		\
-	    YYRHSLOC (Rhs, 0).last_line;				\
-	  (Current).first_column = (Current).last_column =		\
-	    YYRHSLOC (Rhs, 0).last_column;				\
-	}								\
-    while (YYID (0))
-#endif
-
-
-/* YY_LOCATION_PRINT -- Print the location on the stream.
-   This macro was not mandated originally: define only if we know
-   we won't break user code: when these are the locations we know.  */
-
-#ifndef YY_LOCATION_PRINT
-# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
-#  define YY_LOCATION_PRINT(File, Loc)			\
-     fprintf (File, "%d.%d-%d.%d",			\
-	      (Loc).first_line, (Loc).first_column,	\
-	      (Loc).last_line,  (Loc).last_column)
-# else
-#  define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-# endif
-#endif
-
-
-/* YYLEX -- calling `yylex' with the right arguments.  */
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
-#ifdef YYLEX_PARAM
-# define YYLEX yylex (YYLEX_PARAM)
-#else
-# define YYLEX yylex ()
-#endif
 
 /* Enable debugging if requested.  */
 #if YYDEBUG
@@ -928,80 +924,58 @@ while (YYID (0))
 #  define YYFPRINTF fprintf
 # endif
 
-# define YYDPRINTF(Args)			\
-do {						\
-  if (yydebug)					\
-    YYFPRINTF Args;				\
-} while (YYID (0))
-
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)			  \
-do {									  \
-  if (yydebug)								  \
-    {									  \
-      YYFPRINTF (stderr, "%s ", Title);					  \
-      yy_symbol_print (stderr,						  \
-		  Type, Value); \
-      YYFPRINTF (stderr, "\n");						  \
-    }									  \
-} while (YYID (0))
-
-
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
-
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep)
-#else
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
 static void
-yy_symbol_value_print (yyoutput, yytype, yyvaluep)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-#endif
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
 {
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyoutput, yytoknum[yytype], *yyvaluep);
-# else
-  YYUSE (yyoutput);
-# endif
-  switch (yytype)
-    {
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep)
-#else
-static void
-yy_symbol_print (yyoutput, yytype, yyvaluep)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-#endif
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
 {
-  if (yytype < YYNTOKENS)
-    YYFPRINTF (yyoutput, "token %s (", yytname[yytype]);
-  else
-    YYFPRINTF (yyoutput, "nterm %s (", yytname[yytype]);
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyoutput, yytype, yyvaluep);
-  YYFPRINTF (yyoutput, ")");
+  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -1009,80 +983,68 @@ yy_symbol_print (yyoutput, yytype, yyvaluep)
 | TOP (included).                                                   |
 `------------------------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yy_stack_print (yytype_int16 *bottom, yytype_int16 *top)
-#else
-static void
-yy_stack_print (bottom, top)
-    yytype_int16 *bottom;
-    yytype_int16 *top;
-#endif
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
   YYFPRINTF (stderr, "Stack now");
-  for (; bottom <= top; ++bottom)
-    YYFPRINTF (stderr, " %d", *bottom);
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
   YYFPRINTF (stderr, "\n");
 }
 
-# define YY_STACK_PRINT(Bottom, Top)				\
-do {								\
-  if (yydebug)							\
-    yy_stack_print ((Bottom), (Top));				\
-} while (YYID (0))
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
 
 
 /*------------------------------------------------.
 | Report that the YYRULE is going to be reduced.  |
 `------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_reduce_print (YYSTYPE *yyvsp, int yyrule)
-#else
 static void
-yy_reduce_print (yyvsp, yyrule)
-    YYSTYPE *yyvsp;
-    int yyrule;
-#endif
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule)
 {
+  int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
   int yyi;
-  unsigned long int yylno = yyrline[yyrule];
-  YYFPRINTF (stderr, "Reducing stack by rule %d (line %lu):\n",
-	     yyrule - 1, yylno);
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
   /* The symbols being reduced.  */
   for (yyi = 0; yyi < yynrhs; yyi++)
     {
-      fprintf (stderr, "   $%d = ", yyi + 1);
-      yy_symbol_print (stderr, yyrhs[yyprhs[yyrule] + yyi],
-		       &(yyvsp[(yyi + 1) - (yynrhs)])
-		       		       );
-      fprintf (stderr, "\n");
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)]);
+      YYFPRINTF (stderr, "\n");
     }
 }
 
-# define YY_REDUCE_PRINT(Rule)		\
-do {					\
-  if (yydebug)				\
-    yy_reduce_print (yyvsp, Rule); \
-} while (YYID (0))
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule); \
+} while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
 
 
 /* YYINITDEPTH -- initial size of the parser's stacks.  */
-#ifndef	YYINITDEPTH
+#ifndef YYINITDEPTH
 # define YYINITDEPTH 200
 #endif
 
@@ -1097,478 +1059,219 @@ int yydebug;
 # define YYMAXDEPTH 10000
 #endif
 
-
-
-#if YYERROR_VERBOSE
-
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen strlen
-#  else
-/* Return the length of YYSTR.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static YYSIZE_T
-yystrlen (const char *yystr)
-#else
-static YYSIZE_T
-yystrlen (yystr)
-    const char *yystr;
-#endif
-{
-  YYSIZE_T yylen;
-  for (yylen = 0; yystr[yylen]; yylen++)
-    continue;
-  return yylen;
-}
-#  endif
-# endif
-
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static char *
-yystpcpy (char *yydest, const char *yysrc)
-#else
-static char *
-yystpcpy (yydest, yysrc)
-    char *yydest;
-    const char *yysrc;
-#endif
-{
-  char *yyd = yydest;
-  const char *yys = yysrc;
-
-  while ((*yyd++ = *yys++) != '\0')
-    continue;
 
-  return yyd - 1;
-}
-#  endif
-# endif
 
-# ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYSIZE_T
-yytnamerr (char *yyres, const char *yystr)
-{
-  if (*yystr == '"')
-    {
-      YYSIZE_T yyn = 0;
-      char const *yyp = yystr;
-
-      for (;;)
-	switch (*++yyp)
-	  {
-	  case '\'':
-	  case ',':
-	    goto do_not_strip_quotes;
-
-	  case '\\':
-	    if (*++yyp != '\\')
-	      goto do_not_strip_quotes;
-	    /* Fall through.  */
-	  default:
-	    if (yyres)
-	      yyres[yyn] = *yyp;
-	    yyn++;
-	    break;
-
-	  case '"':
-	    if (yyres)
-	      yyres[yyn] = '\0';
-	    return yyn;
-	  }
-    do_not_strip_quotes: ;
-    }
 
-  if (! yyres)
-    return yystrlen (yystr);
 
-  return yystpcpy (yyres, yystr) - yyres;
-}
-# endif
-
-/* Copy into YYRESULT an error message about the unexpected token
-   YYCHAR while in state YYSTATE.  Return the number of bytes copied,
-   including the terminating null byte.  If YYRESULT is null, do not
-   copy anything; just return the number of bytes that would be
-   copied.  As a special case, return 0 if an ordinary "syntax error"
-   message will do.  Return YYSIZE_MAXIMUM if overflow occurs during
-   size calculation.  */
-static YYSIZE_T
-yysyntax_error (char *yyresult, int yystate, int yychar)
-{
-  int yyn = yypact[yystate];
-
-  if (! (YYPACT_NINF < yyn && yyn <= YYLAST))
-    return 0;
-  else
-    {
-      int yytype = YYTRANSLATE (yychar);
-      YYSIZE_T yysize0 = yytnamerr (0, yytname[yytype]);
-      YYSIZE_T yysize = yysize0;
-      YYSIZE_T yysize1;
-      int yysize_overflow = 0;
-      enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-      char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-      int yyx;
-
-# if 0
-      /* This is so xgettext sees the translatable formats that are
-	 constructed on the fly.  */
-      YY_("syntax error, unexpected %s");
-      YY_("syntax error, unexpected %s, expecting %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s");
-# endif
-      char *yyfmt;
-      char const *yyf;
-      static char const yyunexpected[] = "syntax error, unexpected %s";
-      static char const yyexpecting[] = ", expecting %s";
-      static char const yyor[] = " or %s";
-      char yyformat[sizeof yyunexpected
-		    + sizeof yyexpecting - 1
-		    + ((YYERROR_VERBOSE_ARGS_MAXIMUM - 2)
-		       * (sizeof yyor - 1))];
-      char const *yyprefix = yyexpecting;
-
-      /* Start YYX at -YYN if negative to avoid negative indexes in
-	 YYCHECK.  */
-      int yyxbegin = yyn < 0 ? -yyn : 0;
-
-      /* Stay within bounds of both yycheck and yytname.  */
-      int yychecklim = YYLAST - yyn + 1;
-      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-      int yycount = 1;
-
-      yyarg[0] = yytname[yytype];
-      yyfmt = yystpcpy (yyformat, yyunexpected);
-
-      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-	if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR)
-	  {
-	    if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-	      {
-		yycount = 1;
-		yysize = yysize0;
-		yyformat[sizeof yyunexpected - 1] = '\0';
-		break;
-	      }
-	    yyarg[yycount++] = yytname[yyx];
-	    yysize1 = yysize + yytnamerr (0, yytname[yyx]);
-	    yysize_overflow |= (yysize1 < yysize);
-	    yysize = yysize1;
-	    yyfmt = yystpcpy (yyfmt, yyprefix);
-	    yyprefix = yyor;
-	  }
-
-      yyf = YY_(yyformat);
-      yysize1 = yysize + yystrlen (yyf);
-      yysize_overflow |= (yysize1 < yysize);
-      yysize = yysize1;
-
-      if (yysize_overflow)
-	return YYSIZE_MAXIMUM;
-
-      if (yyresult)
-	{
-	  /* Avoid sprintf, as that infringes on the user's name space.
-	     Don't have undefined behavior even if the translation
-	     produced a string with the wrong number of "%s"s.  */
-	  char *yyp = yyresult;
-	  int yyi = 0;
-	  while ((*yyp = *yyf) != '\0')
-	    {
-	      if (*yyp == '%' && yyf[1] == 's' && yyi < yycount)
-		{
-		  yyp += yytnamerr (yyp, yyarg[yyi++]);
-		  yyf += 2;
-		}
-	      else
-		{
-		  yyp++;
-		  yyf++;
-		}
-	    }
-	}
-      return yysize;
-    }
-}
-#endif /* YYERROR_VERBOSE */
-
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep)
-#else
 static void
-yydestruct (yymsg, yytype, yyvaluep)
-    const char *yymsg;
-    int yytype;
-    YYSTYPE *yyvaluep;
-#endif
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
 {
-  YYUSE (yyvaluep);
-
+  YY_USE (yyvaluep);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
-
-  switch (yytype)
-    {
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
-
 
-/* Prevent warnings from -Wmissing-prototypes.  */
 
-#ifdef YYPARSE_PARAM
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void *YYPARSE_PARAM);
-#else
-int yyparse ();
-#endif
-#else /* ! YYPARSE_PARAM */
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void);
-#else
-int yyparse ();
-#endif
-#endif /* ! YYPARSE_PARAM */
-
-
-
-/* The look-ahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
-/* The semantic value of the look-ahead symbol.  */
+/* The semantic value of the lookahead symbol.  */
 YYSTYPE yylval;
-
 /* Number of syntax errors so far.  */
 int yynerrs;
 
 
 
+
 /*----------.
 | yyparse.  |
 `----------*/
 
-#ifdef YYPARSE_PARAM
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-int
-yyparse (void *YYPARSE_PARAM)
-#else
-int
-yyparse (YYPARSE_PARAM)
-    void *YYPARSE_PARAM;
-#endif
-#else /* ! YYPARSE_PARAM */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 int
 yyparse (void)
-#else
-int
-yyparse ()
-
-#endif
-#endif
 {
-  
-  int yystate;
-  int yyn;
-  int yyresult;
-  /* Number of tokens to shift before error messages enabled.  */
-  int yyerrstatus;
-  /* Look-ahead token as an internal (translated) token number.  */
-  int yytoken = 0;
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
-
-  /* Three stacks and their tools:
-     `yyss': related to states,
-     `yyvs': related to semantic values,
-     `yyls': related to locations.
-
-     Refer to the stacks thru separate pointers, to allow yyoverflow
-     to reallocate them elsewhere.  */
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
 
-  /* The state stack.  */
-  yytype_int16 yyssa[YYINITDEPTH];
-  yytype_int16 *yyss = yyssa;
-  yytype_int16 *yyssp;
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
 
-  /* The semantic value stack.  */
-  YYSTYPE yyvsa[YYINITDEPTH];
-  YYSTYPE *yyvs = yyvsa;
-  YYSTYPE *yyvsp;
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
-#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
-
-  YYSIZE_T yystacksize = YYINITDEPTH;
-
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
 
 
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
   /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
-  yychar = YYEMPTY;		/* Cause a token to be read.  */
-
-  /* Initialize stack pointers.
-     Waste one element of value and location stack
-     so that they stay on the same level as the state stack.
-     The wasted elements are never initialized.  */
-
-  yyssp = yyss;
-  yyvsp = yyvs;
+  yychar = YYEMPTY; /* Cause a token to be read.  */
 
   goto yysetstate;
 
+
 /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
- yynewstate:
+yynewstate:
   /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
   yyssp++;
 
- yysetstate:
-  *yyssp = yystate;
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
     {
       /* Get the current used size of the three stacks, in elements.  */
-      YYSIZE_T yysize = yyssp - yyss + 1;
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
+# if defined yyoverflow
       {
-	/* Give user a chance to reallocate the stack.  Use copies of
-	   these so that the &'s don't force the real ones into
-	   memory.  */
-	YYSTYPE *yyvs1 = yyvs;
-	yytype_int16 *yyss1 = yyss;
-
-
-	/* Each stack pointer address is followed by the size of the
-	   data in use in that stack, in bytes.  This used to be a
-	   conditional around just the two extra args, but that might
-	   be undefined if yyoverflow is a macro.  */
-	yyoverflow (YY_("memory exhausted"),
-		    &yyss1, yysize * sizeof (*yyssp),
-		    &yyvs1, yysize * sizeof (*yyvsp),
-
-		    &yystacksize);
-
-	yyss = yyss1;
-	yyvs = yyvs1;
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
       }
-#else /* no yyoverflow */
-# ifndef YYSTACK_RELOCATE
-      goto yyexhaustedlab;
-# else
+# else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-	goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
-	yystacksize = YYMAXDEPTH;
+        yystacksize = YYMAXDEPTH;
 
       {
-	yytype_int16 *yyss1 = yyss;
-	union yyalloc *yyptr =
-	  (union yyalloc *) YYSTACK_ALLOC (YYSTACK_BYTES (yystacksize));
-	if (! yyptr)
-	  goto yyexhaustedlab;
-	YYSTACK_RELOCATE (yyss);
-	YYSTACK_RELOCATE (yyvs);
-
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
 #  undef YYSTACK_RELOCATE
-	if (yyss1 != yyssa)
-	  YYSTACK_FREE (yyss1);
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
       }
 # endif
-#endif /* no yyoverflow */
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
 
-
-      YYDPRINTF ((stderr, "Stack size increased to %lu\n",
-		  (unsigned long int) yystacksize));
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
 
       if (yyss + yystacksize - 1 <= yyssp)
-	YYABORT;
+        YYABORT;
     }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
 
   goto yybackup;
 
+
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
-
   /* Do appropriate processing given the current state.  Read a
-     look-ahead token if we need one and don't already have one.  */
+     lookahead token if we need one and don't already have one.  */
 
-  /* First try to decide what to do without reference to look-ahead token.  */
+  /* First try to decide what to do without reference to lookahead token.  */
   yyn = yypact[yystate];
-  if (yyn == YYPACT_NINF)
+  if (yypact_value_is_default (yyn))
     goto yydefault;
 
-  /* Not known => get a look-ahead token if don't already have one.  */
+  /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid look-ahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
-      yychar = YYLEX;
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex ();
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1583,30 +1286,26 @@ yybackup:
   yyn = yytable[yyn];
   if (yyn <= 0)
     {
-      if (yyn == 0 || yyn == YYTABLE_NINF)
-	goto yyerrlab;
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
       yyn = -yyn;
       goto yyreduce;
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
   /* Count tokens shifted since error; after three, turn off error
      status.  */
   if (yyerrstatus)
     yyerrstatus--;
 
-  /* Shift the look-ahead token.  */
+  /* Shift the lookahead token.  */
   YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
-
-  /* Discard the shifted token unless it is eof.  */
-  if (yychar != YYEOF)
-    yychar = YYEMPTY;
-
   yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
   goto yynewstate;
 
 
@@ -1621,14 +1320,14 @@ yydefault:
 
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
   /* yyn is the number of a rule to reduce with.  */
   yylen = yyr2[yyn];
 
   /* If YYLEN is nonzero, implement the default value of the action:
-     `$$ = $1'.
+     '$$ = $1'.
 
      Otherwise, the following line sets YYVAL to garbage.
      This behavior is undocumented and Bison
@@ -1641,143 +1340,170 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-        case 2:
-#line 185 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 2: /* start: pbrt_stmt_list  */
+#line 190 "pbrtparse.y"
+{
+}
+#line 1348 "pbrtparse.c"
     break;
 
-  case 3:
-#line 191 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 3: /* array_init: %empty  */
+#line 196 "pbrtparse.y"
+{
     CHECK(pbrt::cur_array == nullptr);
     pbrt::cur_array = new pbrt::ParamArray;
-;}
+}
+#line 1357 "pbrtparse.c"
     break;
 
-  case 4:
-#line 199 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 4: /* string_array_init: %empty  */
+#line 204 "pbrtparse.y"
+{
     pbrt::cur_array->element_size = sizeof(const char *);
     pbrt::cur_array->isString = true;
-;}
+}
+#line 1366 "pbrtparse.c"
     break;
 
-  case 5:
-#line 207 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 5: /* num_array_init: %empty  */
+#line 212 "pbrtparse.y"
+{
     pbrt::cur_array->element_size = sizeof(double);
     pbrt::cur_array->isString = false;
-;}
+}
+#line 1375 "pbrtparse.c"
     break;
 
-  case 6:
-#line 215 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    (yyval.ribarray) = (yyvsp[(1) - (1)].ribarray);
-;}
+  case 6: /* array: string_array  */
+#line 220 "pbrtparse.y"
+{
+    (yyval.ribarray) = (yyvsp[0].ribarray);
+}
+#line 1383 "pbrtparse.c"
     break;
 
-  case 7:
-#line 221 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    (yyval.ribarray) = (yyvsp[(1) - (1)].ribarray);
-;}
+  case 7: /* array: num_array  */
+#line 226 "pbrtparse.y"
+{
+    (yyval.ribarray) = (yyvsp[0].ribarray);
+}
+#line 1391 "pbrtparse.c"
     break;
 
-  case 8:
-#line 228 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 8: /* string_array: array_init LBRACK string_list RBRACK  */
+#line 233 "pbrtparse.y"
+{
     (yyval.ribarray) = pbrt::cur_array;
     pbrt::cur_array = nullptr;
-;}
+}
+#line 1400 "pbrtparse.c"
     break;
 
-  case 9:
-#line 235 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 9: /* string_array: single_element_string_array  */
+#line 240 "pbrtparse.y"
+{
     (yyval.ribarray) = pbrt::cur_array;
     pbrt::cur_array = nullptr;
-;}
+}
+#line 1409 "pbrtparse.c"
     break;
 
-  case 10:
-#line 243 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 10: /* single_element_string_array: array_init string_list_entry  */
+#line 248 "pbrtparse.y"
+{
+}
+#line 1416 "pbrtparse.c"
     break;
 
-  case 11:
-#line 249 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 11: /* string_list: string_list string_list_entry  */
+#line 254 "pbrtparse.y"
+{
+}
+#line 1423 "pbrtparse.c"
     break;
 
-  case 12:
-#line 254 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 12: /* string_list: string_list_entry  */
+#line 259 "pbrtparse.y"
+{
+}
+#line 1430 "pbrtparse.c"
     break;
 
-  case 13:
-#line 260 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    char *to_add = strdup((yyvsp[(2) - (2)].string));
+  case 13: /* string_list_entry: string_array_init STRING  */
+#line 265 "pbrtparse.y"
+{
+    char *to_add = strdup((yyvsp[0].string));
     pbrt::AddArrayElement(&to_add);
-;}
+}
+#line 1439 "pbrtparse.c"
     break;
 
-  case 14:
-#line 268 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 14: /* num_array: array_init LBRACK num_list RBRACK  */
+#line 273 "pbrtparse.y"
+{
     (yyval.ribarray) = pbrt::cur_array;
     pbrt::cur_array = nullptr;
-;}
+}
+#line 1448 "pbrtparse.c"
     break;
 
-  case 15:
-#line 275 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 15: /* num_array: single_element_num_array  */
+#line 280 "pbrtparse.y"
+{
     (yyval.ribarray) = pbrt::cur_array;
     pbrt::cur_array = nullptr;
-;}
+}
+#line 1457 "pbrtparse.c"
     break;
 
-  case 16:
-#line 283 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 16: /* num_array: NUM_ARRAY  */
+#line 287 "pbrtparse.y"
+{
+    (yyval.ribarray) = (yyvsp[0].ribarray);
+}
+#line 1465 "pbrtparse.c"
     break;
 
-  case 17:
-#line 289 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 17: /* single_element_num_array: array_init num_list_entry  */
+#line 294 "pbrtparse.y"
+{
+}
+#line 1472 "pbrtparse.c"
     break;
 
-  case 18:
-#line 294 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 18: /* num_list: num_list num_list_entry  */
+#line 300 "pbrtparse.y"
+{
+}
+#line 1479 "pbrtparse.c"
     break;
 
-  case 19:
-#line 300 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    double to_add = (yyvsp[(2) - (2)].num);
+  case 19: /* num_list: num_list_entry  */
+#line 305 "pbrtparse.y"
+{
+}
+#line 1486 "pbrtparse.c"
+    break;
+
+  case 20: /* num_list_entry: num_array_init NUM  */
+#line 311 "pbrtparse.y"
+{
+    double to_add = (yyvsp[0].num);
     pbrt::AddArrayElement(&to_add);
-;}
+}
+#line 1495 "pbrtparse.c"
     break;
 
-  case 20:
-#line 308 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 21: /* paramlist: paramlist_init paramlist_contents  */
+#line 319 "pbrtparse.y"
+{
+}
+#line 1502 "pbrtparse.c"
     break;
 
-  case 21:
-#line 314 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 22: /* paramlist_init: %empty  */
+#line 325 "pbrtparse.y"
+{
     for (size_t i = 0; i < pbrt::cur_paramlist.size(); ++i) {
         if (pbrt::cur_paramlist[i].isString) {
             for (size_t j = 0; j < pbrt::cur_paramlist[i].size; ++j)
@@ -1785,468 +1511,500 @@ yyreduce:
         }
     }
     pbrt::cur_paramlist.erase(pbrt::cur_paramlist.begin(), pbrt::cur_paramlist.end());
-;}
+}
+#line 1516 "pbrtparse.c"
     break;
 
-  case 22:
-#line 327 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 23: /* paramlist_contents: paramlist_entry paramlist_contents  */
+#line 338 "pbrtparse.y"
+{
+}
+#line 1523 "pbrtparse.c"
     break;
 
-  case 23:
-#line 332 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 24: /* paramlist_contents: %empty  */
+#line 343 "pbrtparse.y"
+{
+}
+#line 1530 "pbrtparse.c"
     break;
 
-  case 24:
-#line 338 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::cur_paramlist.push_back(pbrt::ParamListItem((yyvsp[(1) - (2)].string), (yyvsp[(2) - (2)].ribarray)));
-    pbrt::ArrayFree((yyvsp[(2) - (2)].ribarray));
-;}
+  case 25: /* paramlist_entry: STRING array  */
+#line 349 "pbrtparse.y"
+{
+    pbrt::cur_paramlist.push_back(pbrt::ParamListItem((yyvsp[-1].string), (yyvsp[0].ribarray)));
+    pbrt::ArrayFree((yyvsp[0].ribarray));
+}
+#line 1539 "pbrtparse.c"
     break;
 
-  case 25:
-#line 346 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 26: /* pbrt_stmt_list: pbrt_stmt_list pbrt_stmt  */
+#line 357 "pbrtparse.y"
+{
+}
+#line 1546 "pbrtparse.c"
     break;
 
-  case 26:
-#line 351 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-;}
+  case 27: /* pbrt_stmt_list: pbrt_stmt  */
+#line 362 "pbrtparse.y"
+{
+}
+#line 1553 "pbrtparse.c"
     break;
 
-  case 27:
-#line 357 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 28: /* pbrt_stmt: ACCELERATOR STRING paramlist  */
+#line 368 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtAccelerator((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtAccelerator((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1564 "pbrtparse.c"
     break;
 
-  case 28:
-#line 366 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 29: /* pbrt_stmt: ACTIVETRANSFORM ALL  */
+#line 377 "pbrtparse.y"
+{
     pbrt::pbrtActiveTransformAll();
-;}
+}
+#line 1572 "pbrtparse.c"
     break;
 
-  case 29:
-#line 372 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 30: /* pbrt_stmt: ACTIVETRANSFORM ENDTIME  */
+#line 383 "pbrtparse.y"
+{
     pbrt::pbrtActiveTransformEndTime();
-;}
+}
+#line 1580 "pbrtparse.c"
     break;
 
-  case 30:
-#line 378 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 31: /* pbrt_stmt: ACTIVETRANSFORM STARTTIME  */
+#line 389 "pbrtparse.y"
+{
     pbrt::pbrtActiveTransformStartTime();
-;}
+}
+#line 1588 "pbrtparse.c"
     break;
 
-  case 31:
-#line 384 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 32: /* pbrt_stmt: AREALIGHTSOURCE STRING paramlist  */
+#line 395 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Illuminant);
-    pbrt::pbrtAreaLightSource((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtAreaLightSource((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1599 "pbrtparse.c"
     break;
 
-  case 32:
-#line 393 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 33: /* pbrt_stmt: ATTRIBUTEBEGIN  */
+#line 404 "pbrtparse.y"
+{
     pbrt::pbrtAttributeBegin();
-;}
+}
+#line 1607 "pbrtparse.c"
     break;
 
-  case 33:
-#line 399 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 34: /* pbrt_stmt: ATTRIBUTEEND  */
+#line 410 "pbrtparse.y"
+{
     pbrt::pbrtAttributeEnd();
-;}
+}
+#line 1615 "pbrtparse.c"
     break;
 
-  case 34:
-#line 405 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 35: /* pbrt_stmt: CAMERA STRING paramlist  */
+#line 416 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtCamera((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtCamera((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1626 "pbrtparse.c"
     break;
 
-  case 35:
-#line 414 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    if (pbrt::VerifyArrayLength((yyvsp[(2) - (2)].ribarray), 16, "ConcatTransform")) {
+  case 36: /* pbrt_stmt: CONCATTRANSFORM num_array  */
+#line 426 "pbrtparse.y"
+{
+    if (pbrt::VerifyArrayLength((yyvsp[0].ribarray), 16, "ConcatTransform")) {
         pbrt::Float m[16];
-        double *dm = (double *)(yyvsp[(2) - (2)].ribarray)->array;
+        double *dm = (double *)(yyvsp[0].ribarray)->array;
         std::copy(dm, dm + 16, m);
         pbrt::pbrtConcatTransform(m);
     }
-    pbrt::ArrayFree((yyvsp[(2) - (2)].ribarray));
-;}
+    pbrt::ArrayFree((yyvsp[0].ribarray));
+}
+#line 1640 "pbrtparse.c"
     break;
 
-  case 36:
-#line 426 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtCoordinateSystem((yyvsp[(2) - (2)].string));
-;}
+  case 37: /* pbrt_stmt: COORDINATESYSTEM STRING  */
+#line 438 "pbrtparse.y"
+{
+    pbrt::pbrtCoordinateSystem((yyvsp[0].string));
+}
+#line 1648 "pbrtparse.c"
     break;
 
-  case 37:
-#line 432 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtCoordSysTransform((yyvsp[(2) - (2)].string));
-;}
+  case 38: /* pbrt_stmt: COORDSYSTRANSFORM STRING  */
+#line 444 "pbrtparse.y"
+{
+    pbrt::pbrtCoordSysTransform((yyvsp[0].string));
+}
+#line 1656 "pbrtparse.c"
     break;
 
-  case 38:
-#line 438 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 39: /* pbrt_stmt: FILM STRING paramlist  */
+#line 450 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtFilm((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtFilm((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1667 "pbrtparse.c"
     break;
 
-  case 39:
-#line 447 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 40: /* pbrt_stmt: IDENTITY  */
+#line 459 "pbrtparse.y"
+{
     pbrt::pbrtIdentity();
-;}
+}
+#line 1675 "pbrtparse.c"
     break;
 
-  case 40:
-#line 453 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::include_push((yyvsp[(2) - (2)].string));
-;}
+  case 41: /* pbrt_stmt: INCLUDE STRING  */
+#line 465 "pbrtparse.y"
+{
+    pbrt::IncludeFile((yyvsp[0].string));
+}
+#line 1683 "pbrtparse.c"
     break;
 
-  case 41:
-#line 459 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 42: /* pbrt_stmt: LIGHTSOURCE STRING paramlist  */
+#line 471 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Illuminant);
-    pbrt::pbrtLightSource((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtLightSource((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1694 "pbrtparse.c"
     break;
 
-  case 42:
-#line 468 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtLookAt((yyvsp[(2) - (10)].num), (yyvsp[(3) - (10)].num), (yyvsp[(4) - (10)].num), (yyvsp[(5) - (10)].num), (yyvsp[(6) - (10)].num), (yyvsp[(7) - (10)].num), (yyvsp[(8) - (10)].num), (yyvsp[(9) - (10)].num), (yyvsp[(10) - (10)].num));
-;}
+  case 43: /* pbrt_stmt: LOOKAT NUM NUM NUM NUM NUM NUM NUM NUM NUM  */
+#line 480 "pbrtparse.y"
+{
+    pbrt::pbrtLookAt((yyvsp[-8].num), (yyvsp[-7].num), (yyvsp[-6].num), (yyvsp[-5].num), (yyvsp[-4].num), (yyvsp[-3].num), (yyvsp[-2].num), (yyvsp[-1].num), (yyvsp[0].num));
+}
+#line 1702 "pbrtparse.c"
     break;
 
-  case 43:
-#line 474 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 44: /* pbrt_stmt: MAKENAMEDMATERIAL STRING paramlist  */
+#line 486 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtMakeNamedMaterial((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtMakeNamedMaterial((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1713 "pbrtparse.c"
     break;
 
-  case 44:
-#line 483 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 45: /* pbrt_stmt: MAKENAMEDMEDIUM STRING paramlist  */
+#line 495 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtMakeNamedMedium((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtMakeNamedMedium((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1724 "pbrtparse.c"
     break;
 
-  case 45:
-#line 492 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 46: /* pbrt_stmt: MATERIAL STRING paramlist  */
+#line 504 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtMaterial((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtMaterial((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1735 "pbrtparse.c"
     break;
 
-  case 46:
-#line 501 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtMediumInterface((yyvsp[(2) - (2)].string), (yyvsp[(2) - (2)].string));
-;}
+  case 47: /* pbrt_stmt: MEDIUMINTERFACE STRING  */
+#line 513 "pbrtparse.y"
+{
+    pbrt::pbrtMediumInterface((yyvsp[0].string), (yyvsp[0].string));
+}
+#line 1743 "pbrtparse.c"
     break;
 
-  case 47:
-#line 507 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtMediumInterface((yyvsp[(2) - (3)].string), (yyvsp[(3) - (3)].string));
-;}
+  case 48: /* pbrt_stmt: MEDIUMINTERFACE STRING STRING  */
+#line 519 "pbrtparse.y"
+{
+    pbrt::pbrtMediumInterface((yyvsp[-1].string), (yyvsp[0].string));
+}
+#line 1751 "pbrtparse.c"
     break;
 
-  case 48:
-#line 513 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtNamedMaterial((yyvsp[(2) - (2)].string));
-;}
+  case 49: /* pbrt_stmt: NAMEDMATERIAL STRING  */
+#line 525 "pbrtparse.y"
+{
+    pbrt::pbrtNamedMaterial((yyvsp[0].string));
+}
+#line 1759 "pbrtparse.c"
     break;
 
-  case 49:
-#line 519 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtObjectBegin((yyvsp[(2) - (2)].string));
-;}
+  case 50: /* pbrt_stmt: OBJECTBEGIN STRING  */
+#line 531 "pbrtparse.y"
+{
+    pbrt::pbrtObjectBegin((yyvsp[0].string));
+}
+#line 1767 "pbrtparse.c"
     break;
 
-  case 50:
-#line 525 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 51: /* pbrt_stmt: OBJECTEND  */
+#line 537 "pbrtparse.y"
+{
     pbrt::pbrtObjectEnd();
-;}
+}
+#line 1775 "pbrtparse.c"
     break;
 
-  case 51:
-#line 531 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtObjectInstance((yyvsp[(2) - (2)].string));
-;}
+  case 52: /* pbrt_stmt: OBJECTINSTANCE STRING  */
+#line 543 "pbrtparse.y"
+{
+    pbrt::pbrtObjectInstance((yyvsp[0].string));
+}
+#line 1783 "pbrtparse.c"
     break;
 
-  case 52:
-#line 537 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 53: /* pbrt_stmt: PIXELFILTER STRING paramlist  */
+#line 549 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtPixelFilter((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtPixelFilter((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1794 "pbrtparse.c"
     break;
 
-  case 53:
-#line 546 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 54: /* pbrt_stmt: REVERSEORIENTATION  */
+#line 558 "pbrtparse.y"
+{
     pbrt::pbrtReverseOrientation();
-;}
+}
+#line 1802 "pbrtparse.c"
     break;
 
-  case 54:
-#line 552 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtRotate((yyvsp[(2) - (5)].num), (yyvsp[(3) - (5)].num), (yyvsp[(4) - (5)].num), (yyvsp[(5) - (5)].num));
-;}
+  case 55: /* pbrt_stmt: ROTATE NUM NUM NUM NUM  */
+#line 564 "pbrtparse.y"
+{
+    pbrt::pbrtRotate((yyvsp[-3].num), (yyvsp[-2].num), (yyvsp[-1].num), (yyvsp[0].num));
+}
+#line 1810 "pbrtparse.c"
     break;
 
-  case 55:
-#line 558 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 56: /* pbrt_stmt: SAMPLER STRING paramlist  */
+#line 570 "pbrtparse.y"
+{
+    pbrt::ParamSet params;
+    pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
+    pbrt::pbrtSampler((yyvsp[-1].string), params);
+    pbrt::FreeArgs();
+}
+#line 1821 "pbrtparse.c"
+    break;
+
+  case 57: /* pbrt_stmt: EXTRACTOR STRING paramlist  */
+#line 578 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtSampler((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtExtractor((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1832 "pbrtparse.c"
     break;
 
-  case 56:
-#line 567 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtScale((yyvsp[(2) - (4)].num), (yyvsp[(3) - (4)].num), (yyvsp[(4) - (4)].num));
-;}
+  case 58: /* pbrt_stmt: SCALE NUM NUM NUM  */
+#line 586 "pbrtparse.y"
+{
+    pbrt::pbrtScale((yyvsp[-2].num), (yyvsp[-1].num), (yyvsp[0].num));
+}
+#line 1840 "pbrtparse.c"
     break;
 
-  case 57:
-#line 573 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 59: /* pbrt_stmt: SHAPE STRING paramlist  */
+#line 592 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtShape((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtShape((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1851 "pbrtparse.c"
     break;
 
-  case 58:
-#line 582 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 60: /* pbrt_stmt: INTEGRATOR STRING paramlist  */
+#line 601 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtIntegrator((yyvsp[(2) - (3)].string), params);
+    pbrt::pbrtIntegrator((yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1862 "pbrtparse.c"
     break;
 
-  case 59:
-#line 591 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 61: /* pbrt_stmt: TEXTURE STRING STRING STRING paramlist  */
+#line 610 "pbrtparse.y"
+{
     pbrt::ParamSet params;
     pbrt::InitParamSet(params, pbrt::SpectrumType::Reflectance);
-    pbrt::pbrtTexture((yyvsp[(2) - (5)].string), (yyvsp[(3) - (5)].string), (yyvsp[(4) - (5)].string), params);
+    pbrt::pbrtTexture((yyvsp[-3].string), (yyvsp[-2].string), (yyvsp[-1].string), params);
     pbrt::FreeArgs();
-;}
+}
+#line 1873 "pbrtparse.c"
     break;
 
-  case 60:
-#line 600 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 62: /* pbrt_stmt: TRANSFORMBEGIN  */
+#line 619 "pbrtparse.y"
+{
     pbrt::pbrtTransformBegin();
-;}
+}
+#line 1881 "pbrtparse.c"
     break;
 
-  case 61:
-#line 606 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 63: /* pbrt_stmt: TRANSFORMEND  */
+#line 625 "pbrtparse.y"
+{
     pbrt::pbrtTransformEnd();
-;}
+}
+#line 1889 "pbrtparse.c"
     break;
 
-  case 62:
-#line 612 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtTransformTimes((yyvsp[(2) - (3)].num), (yyvsp[(3) - (3)].num));
-;}
+  case 64: /* pbrt_stmt: TRANSFORMTIMES NUM NUM  */
+#line 631 "pbrtparse.y"
+{
+    pbrt::pbrtTransformTimes((yyvsp[-1].num), (yyvsp[0].num));
+}
+#line 1897 "pbrtparse.c"
     break;
 
-  case 63:
-#line 618 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    if (pbrt::VerifyArrayLength((yyvsp[(2) - (2)].ribarray), 16, "Transform")) {
+  case 65: /* pbrt_stmt: TRANSFORM num_array  */
+#line 637 "pbrtparse.y"
+{
+    if (pbrt::VerifyArrayLength((yyvsp[0].ribarray), 16, "Transform")) {
         pbrt::Float m[16];
-        double *dm = (double *)(yyvsp[(2) - (2)].ribarray)->array;
+        double *dm = (double *)(yyvsp[0].ribarray)->array;
         std::copy(dm, dm + 16, m);
         pbrt::pbrtTransform(m);
     }
-    pbrt::ArrayFree((yyvsp[(2) - (2)].ribarray));
-;}
+    pbrt::ArrayFree((yyvsp[0].ribarray));
+}
+#line 1911 "pbrtparse.c"
     break;
 
-  case 64:
-#line 630 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
-    pbrt::pbrtTranslate((yyvsp[(2) - (4)].num), (yyvsp[(3) - (4)].num), (yyvsp[(4) - (4)].num));
-;}
+  case 66: /* pbrt_stmt: TRANSLATE NUM NUM NUM  */
+#line 649 "pbrtparse.y"
+{
+    pbrt::pbrtTranslate((yyvsp[-2].num), (yyvsp[-1].num), (yyvsp[0].num));
+}
+#line 1919 "pbrtparse.c"
     break;
 
-  case 65:
-#line 636 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 67: /* pbrt_stmt: WORLDBEGIN  */
+#line 655 "pbrtparse.y"
+{
     pbrt::pbrtWorldBegin();
-;}
+}
+#line 1927 "pbrtparse.c"
     break;
 
-  case 66:
-#line 642 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
-    {
+  case 68: /* pbrt_stmt: WORLDEND  */
+#line 661 "pbrtparse.y"
+{
     pbrt::pbrtWorldEnd();
-;}
+}
+#line 1935 "pbrtparse.c"
     break;
 
 
-/* Line 1267 of yacc.c.  */
-#line 2157 "/Users/mmp/build/pbrt-v3/pbrtparse.c"
+#line 1939 "pbrtparse.c"
+
       default: break;
     }
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
 
-
-  /* Now `shift' the result of the reduction.  Determine what state
+  /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
-
-  yyn = yyr1[yyn];
-
-  yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-  if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp)
-    yystate = yytable[yystate];
-  else
-    yystate = yydefgoto[yyn - YYNTOKENS];
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
   goto yynewstate;
 
 
-/*------------------------------------.
-| yyerrlab -- here on detecting error |
-`------------------------------------*/
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
 yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
       yyerror (YY_("syntax error"));
-#else
-      {
-	YYSIZE_T yysize = yysyntax_error (0, yystate, yychar);
-	if (yymsg_alloc < yysize && yymsg_alloc < YYSTACK_ALLOC_MAXIMUM)
-	  {
-	    YYSIZE_T yyalloc = 2 * yysize;
-	    if (! (yysize <= yyalloc && yyalloc <= YYSTACK_ALLOC_MAXIMUM))
-	      yyalloc = YYSTACK_ALLOC_MAXIMUM;
-	    if (yymsg != yymsgbuf)
-	      YYSTACK_FREE (yymsg);
-	    yymsg = (char *) YYSTACK_ALLOC (yyalloc);
-	    if (yymsg)
-	      yymsg_alloc = yyalloc;
-	    else
-	      {
-		yymsg = yymsgbuf;
-		yymsg_alloc = sizeof yymsgbuf;
-	      }
-	  }
-
-	if (0 < yysize && yysize <= yymsg_alloc)
-	  {
-	    (void) yysyntax_error (yymsg, yystate, yychar);
-	    yyerror (yymsg);
-	  }
-	else
-	  {
-	    yyerror (YY_("syntax error"));
-	    if (yysize != 0)
-	      goto yyexhaustedlab;
-	  }
-      }
-#endif
     }
 
-
-
   if (yyerrstatus == 3)
     {
-      /* If just tried and failed to reuse look-ahead token after an
-	 error, discard it.  */
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
 
       if (yychar <= YYEOF)
-	{
-	  /* Return failure if at end of input.  */
-	  if (yychar == YYEOF)
-	    YYABORT;
-	}
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
       else
-	{
-	  yydestruct ("Error: discarding",
-		      yytoken, &yylval);
-	  yychar = YYEMPTY;
-	}
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval);
+          yychar = YYEMPTY;
+        }
     }
 
-  /* Else will try to reuse look-ahead token after shifting the error
+  /* Else will try to reuse lookahead token after shifting the error
      token.  */
   goto yyerrlab1;
 
@@ -2255,14 +2013,13 @@ yyerrlab:
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
-  /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-  if (/*CONSTCOND*/ 0)
-     goto yyerrorlab;
-
-  /* Do not reclaim the symbols of the rule which action triggered
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
   YYPOPSTACK (yylen);
   yylen = 0;
@@ -2275,42 +2032,42 @@ yyerrorlab:
 | yyerrlab1 -- common code for both syntax error and YYERROR.  |
 `-------------------------------------------------------------*/
 yyerrlab1:
-  yyerrstatus = 3;	/* Each real token shifted decrements this.  */
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
-      if (yyn != YYPACT_NINF)
-	{
-	  yyn += YYTERROR;
-	  if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
-	    {
-	      yyn = yytable[yyn];
-	      if (0 < yyn)
-		break;
-	    }
-	}
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
 
       /* Pop the current state because it cannot handle the error token.  */
       if (yyssp == yyss)
-	YYABORT;
+        YYABORT;
 
 
       yydestruct ("Error: popping",
-		  yystos[yystate], yyvsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -2321,57 +2078,71 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
 
-#ifndef yyoverflow
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
+
 
-yyreturn:
-  if (yychar != YYEOF && yychar != YYEMPTY)
-     yydestruct ("Cleanup: discarding lookahead",
-		 yytoken, &yylval);
-  /* Do not reclaim the symbols of the rule which action triggered
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
   YYPOPSTACK (yylen);
   YY_STACK_PRINT (yyss, yyssp);
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-		  yystos[*yyssp], yyvsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
-  if (yymsg != yymsgbuf)
-    YYSTACK_FREE (yymsg);
-#endif
-  /* Make sure YYID is used.  */
-  return YYID (yyresult);
-}
 
+  return yyresult;
+}
 
-#line 647 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
+#line 666 "pbrtparse.y"
 
 
 namespace pbrt {
 
+// Wraps a _malloc()_ed array of numbers scanned ahead by the tokenizer as a
+// _NUM_ARRAY_ token value
+ParamArray *NewNumArray(double *values, int nValues) {
+    ParamArray *array = new ParamArray;
+    array->element_size = sizeof(double);
+    array->allocated = array->nelems = nValues;
+    array->array = values;
+    return array;
+}
+
 static const char *paramTypeToName(int type) {
     switch (type) {
     case PARAM_TYPE_INT: return "int";
@@ -2616,4 +2387,3 @@ static bool lookupType(const char *name, int *type, std::string &sname) {
 }
 
 }  // namespace pbrt
-
@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton interface for Bison's Yacc-like parsers in C
+/* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,126 +31,104 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
-/* Tokens.  */
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YY_PBRTPARSE_H_INCLUDED
+# define YY_YY_PBRTPARSE_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 1
+#endif
+#if YYDEBUG
+extern int yydebug;
+#endif
+
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     STRING = 258,
-     ID = 259,
-     NUM = 260,
-     LBRACK = 261,
-     RBRACK = 262,
-     ACCELERATOR = 263,
-     ACTIVETRANSFORM = 264,
-     ALL = 265,
-     AREALIGHTSOURCE = 266,
-     ATTRIBUTEBEGIN = 267,
-     ATTRIBUTEEND = 268,
-     CAMERA = 269,
-     CONCATTRANSFORM = 270,
-     COORDINATESYSTEM = 271,
-     COORDSYSTRANSFORM = 272,
-     ENDTIME = 273,
-     FILM = 274,
-     IDENTITY = 275,
-     INCLUDE = 276,
-     LIGHTSOURCE = 277,
-     LOOKAT = 278,
-     MAKENAMEDMATERIAL = 279,
-     MAKENAMEDMEDIUM = 280,
-     MATERIAL = 281,
-     MEDIUMINTERFACE = 282,
-     NAMEDMATERIAL = 283,
-     OBJECTBEGIN = 284,
-     OBJECTEND = 285,
-     OBJECTINSTANCE = 286,
-     PIXELFILTER = 287,
-     REVERSEORIENTATION = 288,
-     ROTATE = 289,
-     SAMPLER = 290,
-     SCALE = 291,
-     SHAPE = 292,
-     STARTTIME = 293,
-     INTEGRATOR = 294,
-     TEXTURE = 295,
-     TRANSFORMBEGIN = 296,
-     TRANSFORMEND = 297,
-     TRANSFORMTIMES = 298,
-     TRANSFORM = 299,
-     TRANSLATE = 300,
-     WORLDBEGIN = 301,
-     WORLDEND = 302,
-     HIGH_PRECEDENCE = 303
-   };
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    STRING = 258,                  /* STRING  */
+    ID = 259,                      /* ID  */
+    NUM = 260,                     /* NUM  */
+    NUM_ARRAY = 261,               /* NUM_ARRAY  */
+    LBRACK = 262,                  /* LBRACK  */
+    RBRACK = 263,                  /* RBRACK  */
+    ACCELERATOR = 264,             /* ACCELERATOR  */
+    ACTIVETRANSFORM = 265,         /* ACTIVETRANSFORM  */
+    ALL = 266,                     /* ALL  */
+    AREALIGHTSOURCE = 267,         /* AREALIGHTSOURCE  */
+    ATTRIBUTEBEGIN = 268,          /* ATTRIBUTEBEGIN  */
+    ATTRIBUTEEND = 269,            /* ATTRIBUTEEND  */
+    CAMERA = 270,                  /* CAMERA  */
+    CONCATTRANSFORM = 271,         /* CONCATTRANSFORM  */
+    COORDINATESYSTEM = 272,        /* COORDINATESYSTEM  */
+    COORDSYSTRANSFORM = 273,       /* COORDSYSTRANSFORM  */
+    ENDTIME = 274,                 /* ENDTIME  */
+    EXTRACTOR = 275,               /* EXTRACTOR  */
+    FILM = 276,                    /* FILM  */
+    IDENTITY = 277,                /* IDENTITY  */
+    INCLUDE = 278,                 /* INCLUDE  */
+    LIGHTSOURCE = 279,             /* LIGHTSOURCE  */
+    LOOKAT = 280,                  /* LOOKAT  */
+    MAKENAMEDMATERIAL = 281,       /* MAKENAMEDMATERIAL  */
+    MAKENAMEDMEDIUM = 282,         /* MAKENAMEDMEDIUM  */
+    MATERIAL = 283,                /* MATERIAL  */
+    MEDIUMINTERFACE = 284,         /* MEDIUMINTERFACE  */
+    NAMEDMATERIAL = 285,           /* NAMEDMATERIAL  */
+    OBJECTBEGIN = 286,             /* OBJECTBEGIN  */
+    OBJECTEND = 287,               /* OBJECTEND  */
+    OBJECTINSTANCE = 288,          /* OBJECTINSTANCE  */
+    PIXELFILTER = 289,             /* PIXELFILTER  */
+    REVERSEORIENTATION = 290,      /* REVERSEORIENTATION  */
+    ROTATE = 291,                  /* ROTATE  */
+    SAMPLER = 292,                 /* SAMPLER  */
+    SCALE = 293,                   /* SCALE  */
+    SHAPE = 294,                   /* SHAPE  */
+    STARTTIME = 295,               /* STARTTIME  */
+    INTEGRATOR = 296,              /* INTEGRATOR  */
+    TEXTURE = 297,                 /* TEXTURE  */
+    TRANSFORMBEGIN = 298,          /* TRANSFORMBEGIN  */
+    TRANSFORMEND = 299,            /* TRANSFORMEND  */
+    TRANSFORMTIMES = 300,          /* TRANSFORMTIMES  */
+    TRANSFORM = 301,               /* TRANSFORM  */
+    TRANSLATE = 302,               /* TRANSLATE  */
+    WORLDBEGIN = 303,              /* WORLDBEGIN  */
+    WORLDEND = 304,                /* WORLDEND  */
+    HIGH_PRECEDENCE = 305          /* HIGH_PRECEDENCE  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
-/* Tokens.  */
-#define STRING 258
-#define ID 259
-#define NUM 260
-#define LBRACK 261
-#define RBRACK 262
-#define ACCELERATOR 263
-#define ACTIVETRANSFORM 264
-#define ALL 265
-#define AREALIGHTSOURCE 266
-#define ATTRIBUTEBEGIN 267
-#define ATTRIBUTEEND 268
-#define CAMERA 269
-#define CONCATTRANSFORM 270
-#define COORDINATESYSTEM 271
-#define COORDSYSTRANSFORM 272
-#define ENDTIME 273
-#define FILM 274
-#define IDENTITY 275
-#define INCLUDE 276
-#define LIGHTSOURCE 277
-#define LOOKAT 278
-#define MAKENAMEDMATERIAL 279
-#define MAKENAMEDMEDIUM 280
-#define MATERIAL 281
-#define MEDIUMINTERFACE 282
-#define NAMEDMATERIAL 283
-#define OBJECTBEGIN 284
-#define OBJECTEND 285
-#define OBJECTINSTANCE 286
-#define PIXELFILTER 287
-#define REVERSEORIENTATION 288
-#define ROTATE 289
-#define SAMPLER 290
-#define SCALE 291
-#define SHAPE 292
-#define STARTTIME 293
-#define INTEGRATOR 294
-#define TEXTURE 295
-#define TRANSFORMBEGIN 296
-#define TRANSFORMEND 297
-#define TRANSFORMTIMES 298
-#define TRANSFORM 299
-#define TRANSLATE 300
-#define WORLDBEGIN 301
-#define WORLDEND 302
-#define HIGH_PRECEDENCE 303
-
-
-
 
+/* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 160 "/Users/mmp/pbrt-v3/src/core/pbrtparse.y"
+union YYSTYPE
 {
+#line 164 "pbrtparse.y"
+
 char string[1024];
 double num;
 pbrt::ParamArray *ribarray;
-}
-/* Line 1529 of yacc.c.  */
-#line 151 "/Users/mmp/build/pbrt-v3/pbrtparse.h"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
+
+#line 120 "pbrtparse.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
 #endif
 
+
 extern YYSTYPE yylval;
 
+
+int yyparse (void);
+
+
+#endif /* !YY_YY_PBRTPARSE_H_INCLUDED  */
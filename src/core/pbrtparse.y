@@ -46,11 +46,13 @@ void yyerror(const char *str) {
     pbrt::Error("Parsing error: %s", str);
     exit(1);
 }
-extern int yylex();
 
 namespace pbrt {
 
-extern void include_push(char *filename);
+// Returns the next token from the mapped scene file tokenizer or the flex
+// scanner, depending on where the file being parsed came from
+extern int NextToken();
+extern void IncludeFile(char *filename);
 int line_num = 0;
 std::string current_file;
 
@@ -155,6 +157,8 @@ static bool lookupType(const char *name, int *type, std::string &sname);
 
 }  // namespace pbrt
 
+#define yylex pbrt::NextToken
+
 %}
 
 %union {
@@ -166,6 +170,7 @@ pbrt::ParamArray *ribarray;
 
 %token <string> STRING ID
 %token <num> NUM
+%token <ribarray> NUM_ARRAY
 %token LBRACK RBRACK
 
 %token ACCELERATOR ACTIVETRANSFORM ALL AREALIGHTSOURCE ATTRIBUTEBEGIN
@@ -275,6 +280,12 @@ num_array: array_init LBRACK num_list RBRACK
 {
     $$ = pbrt::cur_array;
     pbrt::cur_array = nullptr;
+}
+
+
+| NUM_ARRAY
+{
+    $$ = $1;
 };
 
 
@@ -452,7 +463,7 @@ pbrt_stmt: ACCELERATOR STRING paramlist
 
 | INCLUDE STRING
 {
-    pbrt::include_push($2);
+    pbrt::IncludeFile($2);
 }
 
 
@@ -656,6 +667,16 @@ pbrt_stmt: ACCELERATOR STRING paramlist
 
 namespace pbrt {
 
+// Wraps a _malloc()_ed array of numbers scanned ahead by the tokenizer as a
+// _NUM_ARRAY_ token value
+ParamArray *NewNumArray(double *values, int nValues) {
+    ParamArray *array = new ParamArray;
+    array->element_size = sizeof(double);
+    array->allocated = array->nelems = nValues;
+    array->array = values;
+    return array;
+}
+
 static const char *paramTypeToName(int type) {
     switch (type) {
     case PARAM_TYPE_INT: return "int";
@@ -41,6 +41,19 @@ namespace pbrt {
 
 // Primitive Method Definitions
 Primitive::~Primitive() {}
+Bounds3f Primitive::ClippedWorldBound(const Bounds3f &clip) const {
+    return pbrt::Intersect(WorldBound(), clip);
+}
+
+void Primitive::IntersectN(const Ray *rays, SurfaceInteraction *isects,
+                           bool *hits, int n) const {
+    for (int i = 0; i < n; ++i) hits[i] = Intersect(rays[i], &isects[i]);
+}
+
+void Primitive::IntersectPN(const Ray *rays, bool *occluded, int n) const {
+    for (int i = 0; i < n; ++i) occluded[i] = IntersectP(rays[i]);
+}
+
 const AreaLight *Aggregate::GetAreaLight() const {
     LOG(FATAL) <<
         "Aggregate::GetAreaLight() method"
@@ -90,6 +103,10 @@ bool TransformedPrimitive::IntersectP(const Ray &r) const {
 // GeometricPrimitive Method Definitions
 Bounds3f GeometricPrimitive::WorldBound() const { return shape->WorldBound(); }
 
+Bounds3f GeometricPrimitive::ClippedWorldBound(const Bounds3f &clip) const {
+    return shape->ClippedWorldBound(clip);
+}
+
 bool GeometricPrimitive::IntersectP(const Ray &r) const {
     return shape->IntersectP(r);
 }
@@ -98,6 +115,12 @@ bool GeometricPrimitive::Intersect(const Ray &r,
                                    SurfaceInteraction *isect) const {
     Float tHit;
     if (!shape->Intersect(r, &tHit, isect)) return false;
+    CompleteIntersection(r, tHit, isect);
+    return true;
+}
+
+void GeometricPrimitive::CompleteIntersection(const Ray &r, Float tHit,
+                                              SurfaceInteraction *isect) const {
     r.tMax = tHit;
     isect->primitive = this;
     CHECK_GE(Dot(isect->n, isect->shading.n), 0.);
@@ -107,7 +130,6 @@ bool GeometricPrimitive::Intersect(const Ray &r,
         isect->mediumInterface = mediumInterface;
     else
         isect->mediumInterface = MediumInterface(r.medium);
-    return true;
 }
 
 const AreaLight *GeometricPrimitive::GetAreaLight() const {
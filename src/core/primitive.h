@@ -52,8 +52,14 @@ class Primitive {
     // Primitive Interface
     virtual ~Primitive();
     virtual Bounds3f WorldBound() const = 0;
+    virtual Bounds3f ClippedWorldBound(const Bounds3f &clip) const;
     virtual bool Intersect(const Ray &r, SurfaceInteraction *) const = 0;
     virtual bool IntersectP(const Ray &r) const = 0;
+    // Batched versions of _Intersect()_ and _IntersectP()_ for _n_ rays;
+    // aggregates override them to trace coherent rays together
+    virtual void IntersectN(const Ray *rays, SurfaceInteraction *isects,
+                            bool *hits, int n) const;
+    virtual void IntersectPN(const Ray *rays, bool *occluded, int n) const;
     virtual const AreaLight *GetAreaLight() const = 0;
     virtual const Material *GetMaterial() const = 0;
     virtual void ComputeScatteringFunctions(SurfaceInteraction *isect,
@@ -67,6 +73,7 @@ class GeometricPrimitive : public Primitive {
   public:
     // GeometricPrimitive Public Methods
     virtual Bounds3f WorldBound() const;
+    virtual Bounds3f ClippedWorldBound(const Bounds3f &clip) const;
     virtual bool Intersect(const Ray &r, SurfaceInteraction *isect) const;
     virtual bool IntersectP(const Ray &r) const;
     GeometricPrimitive(const std::shared_ptr<Shape> &shape,
@@ -79,6 +86,15 @@ class GeometricPrimitive : public Primitive {
           mediumInterface(mediumInterface) {}
     const AreaLight *GetAreaLight() const;
     const Material *GetMaterial() const;
+    const Shape *GetShape() const { return shape.get(); }
+    const MediumInterface &GetMediumInterface() const {
+        return mediumInterface;
+    }
+    // Completes _isect_ for a hit at _tHit_ along _r_ with this primitive's
+    // shape or, for aggregates that store triangles compactly, with another
+    // triangle of its shape's mesh
+    void CompleteIntersection(const Ray &r, Float tHit,
+                              SurfaceInteraction *isect) const;
     void ComputeScatteringFunctions(SurfaceInteraction *isect,
                                     MemoryArena &arena, TransportMode mode,
                                     bool allowMultipleLobes) const;
@@ -94,6 +94,7 @@ class PixelSampler : public Sampler {
     bool SetSampleNumber(int64_t);
     Float Get1D();
     Point2f Get2D();
+    int SampledDimensions() const { return samples1D.size(); }
 
   protected:
     // PixelSampler Protected Data
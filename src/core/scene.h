@@ -63,6 +63,11 @@ class Scene {
     const Bounds3f &WorldBound() const { return worldBound; }
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
     bool IntersectP(const Ray &ray) const;
+    // Intersect _n_ rays at once; coherent rays such as the camera rays of
+    // a pixel are traced faster this way than one at a time
+    void IntersectN(const Ray *rays, SurfaceInteraction *isects, bool *hits,
+                    int n) const;
+    void IntersectPN(const Ray *rays, bool *occluded, int n) const;
     bool IntersectTr(Ray ray, Sampler &sampler, SurfaceInteraction *isect,
                      Spectrum *transmittance) const;
 
@@ -56,6 +56,10 @@ class Shape {
     virtual ~Shape();
     virtual Bounds3f ObjectBound() const = 0;
     virtual Bounds3f WorldBound() const;
+    // Bounds of the part of the shape inside _clip_; empty if none
+    virtual Bounds3f ClippedWorldBound(const Bounds3f &clip) const;
+    // Returns the world space vertices in _p_ if the shape is a triangle
+    virtual bool GetTriangleVertices(Point3f p[3]) const { return false; }
     virtual bool Intersect(const Ray &ray, Float *tHit,
                            SurfaceInteraction *isect,
                            bool testAlphaTexture = true) const = 0;
@@ -0,0 +1,373 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// core/texcache.cpp*
+#include "texcache.h"
+#include "memory.h"
+#include "mipmapfile.h"
+#include <algorithm>
+#include <mutex>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef PBRT_IS_WINDOWS
+#include <unistd.h>
+#endif
+
+namespace pbrt {
+
+STAT_COUNTER("Texture cache/Tiles evicted", nTileEvictions);
+STAT_INT_DISTRIBUTION("Texture cache/Resident megabytes after load",
+                      residentMegabytes);
+
+// TextureCache Local Declarations
+
+// Tiles of all pyramids are appended to a single unnamed scratch file that
+// is removed when pbrt exits.
+static std::once_flag scratchOnce;
+static FILE *scratchFile;
+static std::atomic<int64_t> scratchSize{0};
+#ifdef PBRT_IS_WINDOWS
+static std::mutex scratchMutex;
+#endif
+
+// Each thread that reads tiles publishes the epoch it started reading in,
+// or zero while it isn't reading.  Threads' entries are never removed, but
+// those of exited threads stay zero and don't hold up any evictions.
+struct ReaderEpoch {
+    std::atomic<uint64_t> epoch{0};
+    char pad[PBRT_L1_CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+};
+static std::mutex readersMutex;
+static std::vector<ReaderEpoch *> readers;
+static PBRT_THREAD_LOCAL ReaderEpoch *threadReader;
+static PBRT_THREAD_LOCAL int threadReadDepth;
+
+static std::mutex cacheMutex;
+static std::vector<TextureTile *> resident, evicted;
+static size_t residentBytes;
+
+// Loads of the same tile are serialized by one of these, chosen by the
+// tile's address
+static PBRT_CONSTEXPR int nLoadMutexes = 64;
+static std::mutex loadMutexes[nLoadMutexes];
+
+static void FreeTile(TextureTile *tile) {
+    FreeAligned(tile->texels);
+    delete tile;
+}
+
+// TextureCache Method Definitions
+std::atomic<uint64_t> TextureCache::epoch{1};
+
+void TextureCache::Enter() {
+    if (threadReadDepth++ > 0) return;
+    if (!threadReader) {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        threadReader = new ReaderEpoch;
+        readers.push_back(threadReader);
+    }
+    // Tiles are read after the epoch is published, so any tile this thread
+    // sees was evicted at this epoch or later
+    threadReader->epoch.store(epoch.load(std::memory_order_seq_cst),
+                              std::memory_order_seq_cst);
+}
+
+void TextureCache::Exit() {
+    if (--threadReadDepth > 0) return;
+    threadReader->epoch.store(0, std::memory_order_release);
+}
+
+void TextureCache::Insert(TextureTile *tile) {
+    // Evicted tiles that nobody can be reading are freed after _cacheMutex_
+    // is released
+    std::vector<TextureTile *> freed;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        tile->lastUse.store(++epoch, std::memory_order_relaxed);
+        tile->evictEpoch = 0;
+        tile->residentIndex = resident.size();
+        resident.push_back(tile);
+        residentBytes += tile->bytes;
+        tile->pyramid->Slot(tile).store(tile, std::memory_order_seq_cst);
+
+        size_t budget = size_t(PbrtOptions.textureBudget * (1 << 20));
+        if (budget > 0 && residentBytes > budget) Evict(tile, budget);
+        ReclaimEvicted(&freed);
+        ReportValue(residentMegabytes, residentBytes >> 20);
+    }
+    for (TextureTile *t : freed) FreeTile(t);
+}
+
+void TextureCache::Evict(const TextureTile *keep, size_t budget) {
+    // Evict the least recently used tiles other than _keep_ until the cache
+    // is somewhat under budget, so that this only runs every few loads
+    size_t target = budget - budget / 8;
+    std::vector<std::pair<uint64_t, TextureTile *>> byUse;
+    byUse.reserve(resident.size());
+    for (TextureTile *t : resident)
+        if (t != keep)
+            byUse.push_back(
+                std::make_pair(t->lastUse.load(std::memory_order_relaxed), t));
+    std::sort(byUse.begin(), byUse.end());
+
+    uint64_t evictEpoch = epoch.load(std::memory_order_seq_cst);
+    for (const auto &u : byUse) {
+        if (residentBytes <= target) break;
+        TextureTile *t = u.second;
+        t->pyramid->Slot(t).store(nullptr, std::memory_order_seq_cst);
+        t->evictEpoch = evictEpoch;
+        t->residentIndex = ~size_t(0);
+        residentBytes -= t->bytes;
+        evicted.push_back(t);
+        ++nTileEvictions;
+    }
+    resident.erase(std::remove_if(resident.begin(), resident.end(),
+                                  [](const TextureTile *t) {
+                                      return t->residentIndex == ~size_t(0);
+                                  }),
+                   resident.end());
+    for (size_t i = 0; i < resident.size(); ++i)
+        resident[i]->residentIndex = i;
+
+    // Threads that start reading from now on can't find the evicted tiles
+    ++epoch;
+}
+
+void TextureCache::ReclaimEvicted(std::vector<TextureTile *> *freed) {
+    if (evicted.empty()) return;
+    uint64_t oldestReader = ~uint64_t(0);
+    {
+        std::lock_guard<std::mutex> lock(readersMutex);
+        for (const ReaderEpoch *r : readers) {
+            uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+            if (e != 0) oldestReader = std::min(oldestReader, e);
+        }
+    }
+    // A tile evicted at epoch _e_ may still be used by threads that started
+    // reading at _e_ or earlier.  Readers still holding such a tile may keep
+    // storing older epochs in its _lastUse_, so that can't be used here.
+    auto iter = std::partition(evicted.begin(), evicted.end(),
+                               [=](const TextureTile *t) {
+                                   return t->evictEpoch >= oldestReader;
+                               });
+    freed->insert(freed->end(), iter, evicted.end());
+    evicted.erase(iter, evicted.end());
+}
+
+void TextureCache::Release(const TiledPyramid *pyramid) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (const TiledPyramid::Level &l : pyramid->levels) {
+        for (int i = 0; i < l.layout.NumTiles(); ++i) {
+            TextureTile *tile = l.tiles[i].load(std::memory_order_relaxed);
+            if (!tile) continue;
+            if (!tile->pinned) {
+                resident[tile->residentIndex] = resident.back();
+                resident[tile->residentIndex]->residentIndex =
+                    tile->residentIndex;
+                resident.pop_back();
+                residentBytes -= tile->bytes;
+            }
+            FreeTile(tile);
+        }
+    }
+}
+
+bool TextureCache::WriteScratch(const void *data, size_t bytes,
+                                int64_t *offset) {
+    std::call_once(scratchOnce, []() {
+        scratchFile = tmpfile();
+        if (!scratchFile)
+            Warning("Unable to create a scratch file for texture tiles: %s. "
+                    "Textures will be kept in memory.",
+                    strerror(errno));
+    });
+    if (!scratchFile) return false;
+#ifdef PBRT_IS_WINDOWS
+    std::lock_guard<std::mutex> lock(scratchMutex);
+    *offset = scratchSize;
+    scratchSize += bytes;
+    return _fseeki64(scratchFile, *offset, SEEK_SET) == 0 &&
+           fwrite(data, 1, bytes, scratchFile) == bytes;
+#else
+    *offset = scratchSize.fetch_add(bytes);
+    int fd = fileno(scratchFile);
+    for (size_t done = 0; done < bytes;) {
+        ssize_t n = pwrite(fd, (const char *)data + done, bytes - done,
+                           *offset + done);
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+#endif
+}
+
+bool TextureCache::ReadScratch(int64_t offset, size_t bytes, void *data) {
+#ifdef PBRT_IS_WINDOWS
+    std::lock_guard<std::mutex> lock(scratchMutex);
+    return _fseeki64(scratchFile, offset, SEEK_SET) == 0 &&
+           fread(data, 1, bytes, scratchFile) == bytes;
+#else
+    int fd = fileno(scratchFile);
+    for (size_t done = 0; done < bytes;) {
+        ssize_t n = pread(fd, (char *)data + done, bytes - done, offset + done);
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+#endif
+}
+
+// TileLayout Method Definitions
+TileLayout::TileLayout(const Point2i &resolution, size_t texelBytes)
+    : resolution(resolution),
+      tileResolution(std::min(resolution.x, int(TileSize)),
+                     std::min(resolution.y, int(TileSize))),
+      nTiles((resolution.x + TileSize - 1) / TileSize,
+             (resolution.y + TileSize - 1) / TileSize),
+      texelBytes(texelBytes),
+      tileBytes(tileResolution.x * tileResolution.y * texelBytes) {}
+
+void TileLayout::Tile(const void *texels, void *tiles) const {
+    memset(tiles, 0, Bytes());
+    size_t rowBytes = resolution.x * texelBytes;
+    size_t tileRowBytes = tileResolution.x * texelBytes;
+    for (int t = 0; t < resolution.y; ++t) {
+        int ty = t / TileSize, y = t % TileSize;
+        for (int tx = 0; tx < nTiles.x; ++tx) {
+            size_t start = tx * tileRowBytes;
+            memcpy((char *)tiles + (ty * nTiles.x + tx) * tileBytes +
+                       y * tileRowBytes,
+                   (const char *)texels + t * rowBytes + start,
+                   std::min(tileRowBytes, rowBytes - start));
+        }
+    }
+}
+
+void TileLayout::Untile(const void *tiles, void *texels) const {
+    size_t rowBytes = resolution.x * texelBytes;
+    size_t tileRowBytes = tileResolution.x * texelBytes;
+    for (int t = 0; t < resolution.y; ++t) {
+        int ty = t / TileSize, y = t % TileSize;
+        for (int tx = 0; tx < nTiles.x; ++tx) {
+            size_t start = tx * tileRowBytes;
+            memcpy((char *)texels + t * rowBytes + start,
+                   (const char *)tiles + (ty * nTiles.x + tx) * tileBytes +
+                       y * tileRowBytes,
+                   std::min(tileRowBytes, rowBytes - start));
+        }
+    }
+}
+
+// TiledPyramid Method Definitions
+TiledPyramid::~TiledPyramid() { TextureCache::Release(this); }
+
+void TiledPyramid::AddLevel(const Point2i &resolution, const void *texels) {
+    Level l;
+    l.layout = TileLayout(resolution, texelBytes);
+    int nTiles = l.layout.NumTiles();
+    l.tiles.reset(new std::atomic<TextureTile *>[nTiles]);
+    for (int i = 0; i < nTiles; ++i) l.tiles[i] = nullptr;
+
+    std::unique_ptr<char[]> tiled(new char[l.layout.Bytes()]);
+    l.layout.Tile(texels, tiled.get());
+    if (!TextureCache::WriteScratch(tiled.get(), l.layout.Bytes(),
+                                    &l.scratchOffset)) {
+        // Keep the tiles in memory if they can't be written out
+        size_t tileBytes = l.layout.tileBytes;
+        for (int i = 0; i < nTiles; ++i) {
+            TextureTile *tile = new TextureTile;
+            tile->pyramid = this;
+            tile->level = levels.size();
+            tile->index = i;
+            tile->bytes = tileBytes;
+            tile->texels = AllocAligned<char>(tileBytes);
+            memcpy(tile->texels, &tiled[i * tileBytes], tileBytes);
+            tile->lastUse = 0;
+            tile->evictEpoch = 0;
+            tile->pinned = true;
+            l.tiles[i] = tile;
+        }
+    }
+    levels.push_back(std::move(l));
+}
+
+void TiledPyramid::SetFile(std::unique_ptr<MIPMapFile> f) {
+    CHECK(levels.empty());
+    file = std::move(f);
+    for (int i = 0; i < file->Levels(); ++i) {
+        Level l;
+        l.layout = file->Layout(i);
+        CHECK_EQ(l.layout.texelBytes, texelBytes);
+        int nTiles = l.layout.NumTiles();
+        l.tiles.reset(new std::atomic<TextureTile *>[nTiles]);
+        for (int j = 0; j < nTiles; ++j) l.tiles[j] = nullptr;
+        l.scratchOffset = -1;
+        levels.push_back(std::move(l));
+    }
+}
+
+const char *TiledPyramid::LoadTile(int level, int index) const {
+    const Level &l = levels[level];
+    std::atomic<TextureTile *> &slot = l.tiles[index];
+    std::lock_guard<std::mutex> lock(
+        loadMutexes[(reinterpret_cast<uintptr_t>(&slot) /
+                     sizeof(std::atomic<TextureTile *>)) %
+                    nLoadMutexes]);
+    // Another thread may have loaded the tile in the meantime
+    TextureTile *tile = slot.load(std::memory_order_seq_cst);
+    if (tile) return tile->texels;
+
+    ++nTileMisses;
+    tile = new TextureTile;
+    tile->pyramid = this;
+    tile->level = level;
+    tile->index = index;
+    size_t tileBytes = l.layout.tileBytes;
+    tile->bytes = tileBytes;
+    tile->texels = AllocAligned<char>(tileBytes);
+    tile->pinned = false;
+    if (file)
+        file->ReadTile(level, index, tile->texels);
+    else if (!TextureCache::ReadScratch(
+                 l.scratchOffset + int64_t(index) * tileBytes, tileBytes,
+                 tile->texels)) {
+        Error("Unable to read texture tile from scratch file: %s",
+              strerror(errno));
+        memset(tile->texels, 0, tileBytes);
+    }
+    TextureCache::Insert(tile);
+    return tile->texels;
+}
+
+}  // namespace pbrt
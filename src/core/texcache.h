@@ -0,0 +1,206 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_TEXCACHE_H
+#define PBRT_CORE_TEXCACHE_H
+
+// core/texcache.h*
+#include "pbrt.h"
+#include "geometry.h"
+#include "stats.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace pbrt {
+
+STAT_PERCENT("Texture cache/Tile lookups that missed", nTileMisses,
+             nTileLookups);
+
+class TiledPyramid;
+class MIPMapFile;
+
+// TileLayout Declarations
+
+// How a level of a pyramid is cut into square tiles, which are stored one
+// after the other with the texels of each in row-major order.  Tiles at the
+// right and top edges are padded to the full tile size.
+struct TileLayout {
+    // TileLayout Public Methods
+    TileLayout() = default;
+    TileLayout(const Point2i &resolution, size_t texelBytes);
+    int NumTiles() const { return nTiles.x * nTiles.y; }
+    size_t Bytes() const { return NumTiles() * tileBytes; }
+    // Returns the tile that texel $(s,t)$ is in and its index in the tile
+    int TileIndex(int s, int t) const {
+        return (t >> LogTileSize) * nTiles.x + (s >> LogTileSize);
+    }
+    int TexelIndex(int s, int t) const {
+        return (t & (TileSize - 1)) * tileResolution.x + (s & (TileSize - 1));
+    }
+    // Rearrange row-major texels into tiles and back
+    void Tile(const void *texels, void *tiles) const;
+    void Untile(const void *tiles, void *texels) const;
+
+    // TileLayout Public Data
+    static PBRT_CONSTEXPR int LogTileSize = 6;
+    static PBRT_CONSTEXPR int TileSize = 1 << LogTileSize;
+    Point2i resolution, tileResolution, nTiles;
+    size_t texelBytes = 0, tileBytes = 0;
+};
+
+// TextureTile Declarations
+struct TextureTile {
+    const TiledPyramid *pyramid;
+    int level, index;
+    char *texels;
+    size_t bytes;
+    // Cache epoch of the tile's last use, which readers update without
+    // holding any lock, and of its eviction, which only the cache itself
+    // writes and reads, under its mutex
+    std::atomic<uint64_t> lastUse;
+    uint64_t evictEpoch;
+    size_t residentIndex;
+    // Pinned tiles aren't managed by the cache and are never evicted
+    bool pinned;
+};
+
+// TextureCache Declarations
+
+// Keeps the tiles of all _TiledPyramid_s under the budget given by
+// _Options::textureBudget_, evicting the least recently used ones when a
+// load exceeds it.  As with paged meshes, recency is measured in loads, so
+// a hit only writes to a tile once per load.
+//
+// Lookups don't take any locks; instead, tiles are only accessed inside a
+// _ReadGuard_, and evicted tiles are freed once every thread that was
+// reading when they were evicted has left its guard.
+class TextureCache {
+  public:
+    // TextureCache Public Types
+    class ReadGuard {
+      public:
+        explicit ReadGuard(bool enabled) : enabled(enabled) {
+            if (enabled) Enter();
+        }
+        ~ReadGuard() {
+            if (enabled) Exit();
+        }
+
+      private:
+        const bool enabled;
+    };
+
+    // TextureCache Public Methods
+    static uint64_t Epoch() { return epoch.load(std::memory_order_relaxed); }
+
+  private:
+    // TextureCache Private Methods
+    static void Enter();
+    static void Exit();
+    static void Insert(TextureTile *tile);
+    static void Release(const TiledPyramid *pyramid);
+    static void Evict(const TextureTile *keep, size_t budget);
+    static void ReclaimEvicted(std::vector<TextureTile *> *freed);
+    static bool WriteScratch(const void *data, size_t bytes, int64_t *offset);
+    static bool ReadScratch(int64_t offset, size_t bytes, void *data);
+    friend class TiledPyramid;
+
+    // TextureCache Private Data
+    static std::atomic<uint64_t> epoch;
+};
+
+// TiledPyramid Declarations
+
+// The levels of a MIP pyramid, cut into square tiles that are read into
+// the _TextureCache_ when they're first used.  The tiles are read from a
+// _MIPMapFile_, or else written to a scratch file once when the levels are
+// added.  Texels are only valid inside a _TextureCache::ReadGuard_.
+class TiledPyramid {
+  public:
+    // TiledPyramid Public Methods
+    explicit TiledPyramid(size_t texelBytes) : texelBytes(texelBytes) {}
+    ~TiledPyramid();
+    // Appends a level given by its row-major texels; levels are added from
+    // the finest to the coarsest.
+    void AddLevel(const Point2i &resolution, const void *texels);
+    // Reads all levels from _file_, whose texels must have _texelBytes_
+    // once they're read
+    void SetFile(std::unique_ptr<MIPMapFile> file);
+    int Levels() const { return levels.size(); }
+    const Point2i &LevelResolution(int level) const {
+        return levels[level].layout.resolution;
+    }
+    const void *Texel(int level, int s, int t) const {
+        const TileLayout &l = levels[level].layout;
+        return Tile(level, l.TileIndex(s, t)) + l.TexelIndex(s, t) * texelBytes;
+    }
+
+  private:
+    // TiledPyramid Private Types
+    struct Level {
+        TileLayout layout;
+        int64_t scratchOffset;
+        std::unique_ptr<std::atomic<TextureTile *>[]> tiles;
+    };
+
+    // TiledPyramid Private Methods
+    const char *Tile(int level, int index) const {
+        ++nTileLookups;
+        TextureTile *tile =
+            levels[level].tiles[index].load(std::memory_order_seq_cst);
+        if (!tile) return LoadTile(level, index);
+        uint64_t epoch = TextureCache::Epoch();
+        if (tile->lastUse.load(std::memory_order_relaxed) != epoch)
+            tile->lastUse.store(epoch, std::memory_order_relaxed);
+        return tile->texels;
+    }
+    const char *LoadTile(int level, int index) const;
+    std::atomic<TextureTile *> &Slot(const TextureTile *tile) const {
+        return levels[tile->level].tiles[tile->index];
+    }
+    friend class TextureCache;
+
+    // TiledPyramid Private Data
+    const size_t texelBytes;
+    std::vector<Level> levels;
+    std::unique_ptr<MIPMapFile> file;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_TEXCACHE_H
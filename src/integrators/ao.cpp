@@ -58,7 +58,7 @@ AOIntegrator::AOIntegrator(bool cosSample, int ns,
 Spectrum AOIntegrator::Li(const RayDifferential &r, const Scene &scene,
                           Sampler &sampler, MemoryArena &arena,
                           Extractor &extractor,
-                          int depth) const {
+                          int depth, const PrimaryHit *primary) const {
     ProfilePhase p(Prof::SamplerIntegratorLi);
     Spectrum L(0.f);
     RayDifferential ray(r);
@@ -69,11 +69,12 @@ Spectrum AOIntegrator::Li(const RayDifferential &r, const Scene &scene,
     // Intersect _ray_ with scene and store intersection in _isect_
     SurfaceInteraction isect;
  retry:
-    if (scene.Intersect(ray, &isect)) {
+    if (IntersectPrimary(scene, ray, &isect, primary)) {
         isect.ComputeScatteringFunctions(ray, arena, true);
         if (!isect.bsdf) {
             VLOG(2) << "Skipping intersection due to null bsdf";
             ray = isect.SpawnRay(ray.d);
+            primary = nullptr;
             goto retry;
         }
         // Report intersection data FIXME: Is it the right way to do this ?
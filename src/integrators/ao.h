@@ -54,7 +54,8 @@ class AOIntegrator : public SamplerIntegrator {
                  std::shared_ptr<Extractor> extractor,
                  const Bounds2i &pixelBounds);
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
-                Sampler &sampler, MemoryArena &arena, Extractor &extractor, int depth) const;
+                Sampler &sampler, MemoryArena &arena, Extractor &extractor,
+                int depth, const PrimaryHit *primary) const;
  private:
     bool cosSample;
     int nSamples;
@@ -61,7 +61,9 @@ void DirectLightingIntegrator::Preprocess(const Scene &scene,
 
 Spectrum DirectLightingIntegrator::Li(const RayDifferential &ray,
                                       const Scene &scene, Sampler &sampler,
-                                      MemoryArena &arena, Extractor &extractor, int depth) const {
+                                      MemoryArena &arena, Extractor &extractor,
+                                      int depth,
+                                      const PrimaryHit *primary) const {
     ProfilePhase p(Prof::SamplerIntegratorLi);
     if (depth == 0)
         extractor.AddCameraVertex(ray.o);
@@ -69,7 +71,7 @@ Spectrum DirectLightingIntegrator::Li(const RayDifferential &ray,
     Spectrum L(0.f);
     // Find closest ray intersection or return background radiance
     SurfaceInteraction isect;
-    if (!scene.Intersect(ray, &isect)) {
+    if (!IntersectPrimary(scene, ray, &isect, primary)) {
         for (const auto &light : scene.lights) L += light->Le(ray);
         return L;
     }
@@ -79,7 +81,8 @@ Spectrum DirectLightingIntegrator::Li(const RayDifferential &ray,
 
 
     if (!isect.bsdf)
-        return Li(isect.SpawnRay(ray.d), scene, sampler, arena, extractor, depth);
+        return Li(isect.SpawnRay(ray.d), scene, sampler, arena, extractor,
+                  depth, nullptr);
     Vector3f wo = isect.wo;
     // Compute emitted light if ray hit an area light source
     L += isect.Le(wo);
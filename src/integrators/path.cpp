@@ -64,7 +64,8 @@ void PathIntegrator::Preprocess(const Scene &scene, Sampler &sampler) {
 
 Spectrum PathIntegrator::Li(const RayDifferential &r, const Scene &scene,
                             Sampler &sampler, MemoryArena &arena,
-                            Extractor &extractor, int depth) const {
+                            Extractor &extractor, int depth,
+                            const PrimaryHit *primary) const {
     ProfilePhase p(Prof::SamplerIntegratorLi);
     Spectrum L(0.f), beta(1.f);
     RayDifferential ray(r);
@@ -88,7 +89,10 @@ Spectrum PathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 
         // Intersect _ray_ with scene and store intersection in _isect_
         SurfaceInteraction isect;
-        bool foundIntersection = scene.Intersect(ray, &isect);
+        // The camera ray may already have been traced
+        bool foundIntersection =
+            IntersectPrimary(scene, ray, &isect, primary);
+        primary = nullptr;
 
         // Possibly add emitted light at intersection
         if (bounces == 0 || specularBounce) {
@@ -57,7 +57,8 @@ class PathIntegrator : public SamplerIntegrator {
 
     void Preprocess(const Scene &scene, Sampler &sampler);
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
-                Sampler &sampler, MemoryArena &arena, Extractor &extractor, int depth) const;
+                Sampler &sampler, MemoryArena &arena, Extractor &extractor,
+                int depth, const PrimaryHit *primary) const;
 
   private:
     // PathIntegrator Private Data
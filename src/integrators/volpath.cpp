@@ -54,7 +54,8 @@ void VolPathIntegrator::Preprocess(const Scene &scene, Sampler &sampler) {
 
 Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
                                Sampler &sampler, MemoryArena &arena,
-                               Extractor &extractor, int depth) const {
+                               Extractor &extractor, int depth,
+                               const PrimaryHit *primary) const {
     ProfilePhase p(Prof::SamplerIntegratorLi);
     Spectrum L(0.f), beta(1.f);
     RayDifferential ray(r);
@@ -76,7 +77,9 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 
         // Intersect _ray_ with scene and store intersection in _isect_
         SurfaceInteraction isect;
-        bool foundIntersection = scene.Intersect(ray, &isect);
+        bool foundIntersection =
+            IntersectPrimary(scene, ray, &isect, primary);
+        primary = nullptr;
 
 
         // Sample the participating medium, if present
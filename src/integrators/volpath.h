@@ -60,7 +60,8 @@ class VolPathIntegrator : public SamplerIntegrator {
           lightSampleStrategy(lightSampleStrategy) { }
     void Preprocess(const Scene &scene, Sampler &sampler);
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
-                Sampler &sampler, MemoryArena &arena, Extractor &extractor, int depth) const;
+                Sampler &sampler, MemoryArena &arena, Extractor &extractor,
+                int depth, const PrimaryHit *primary) const;
 
   private:
     // VolPathIntegrator Private Data
@@ -0,0 +1,619 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+// integrators/wavefrontpath.cpp*
+#include "integrators/wavefrontpath.h"
+#include "bssrdf.h"
+#include "camera.h"
+#include "film.h"
+#include "interaction.h"
+#include "light.h"
+#include "paramset.h"
+#include "parallel.h"
+#include "progressreporter.h"
+#include "sampler.h"
+#include "sampling.h"
+#include "scene.h"
+#include "stats.h"
+#include <algorithm>
+
+namespace pbrt {
+
+STAT_COUNTER("Integrator/Camera rays traced", nCameraRays);
+STAT_COUNTER("Integrator/Wavefront queues", nQueues);
+STAT_RATIO("Integrator/Wavefront paths per material run", nShadedPaths,
+           nMaterialRuns);
+
+// Number of consecutive queue entries each task of a stage processes
+static PBRT_CONSTEXPR int queueChunkSize = 64;
+
+// WavefrontPath Declarations
+struct WavefrontPath {
+    // Film sample and radiance gathered so far
+    Point2i pPixel;
+    Point2f pFilm;
+    Float rayWeight;
+    Spectrum L;
+
+    // Ray that extends the path, and the path's throughput up to its origin
+    RayDifferential ray;
+    Spectrum beta;
+    Float etaScale;
+    int bounces;
+    bool active;
+    bool specularBounce;
+    // Whether a light was sampled at _prevIntr_, so that emission found by
+    // _ray_ is weighted against it using the BSDF sample's _prevPdf_
+    bool misEmission;
+    Interaction prevIntr;
+    Float prevPdf;
+
+    // Light sample that is added to _L_ if _shadowRay_ is unoccluded
+    bool hasShadowRay;
+    Ray shadowRay;
+    Spectrum Ld;
+
+    // Source of the path's sample values: the index and next dimension of
+    // a _GlobalSampler_'s sample, or the number of values used so far from
+    // those drawn from a _PixelSampler_ when the path was created
+    int64_t sampleIndex;
+    int dimension;
+    int n1D, n2D;
+    RNG rng;
+};
+
+// WavefrontPathSampler Declarations
+
+// Gives the sample values of a single path through the _Sampler_ interface;
+// global samplers are evaluated directly at the path's sample index.  For
+// other samplers, the values drawn when the path was created are given
+// first and the path's _RNG_ supplies the rest.
+class WavefrontPathSampler : public Sampler {
+  public:
+    WavefrontPathSampler(const GlobalSampler *globalSampler,
+                         WavefrontPath &path, const Float *u1D, int nU1D,
+                         const Point2f *u2D, int nU2D)
+        : Sampler(1),
+          globalSampler(globalSampler),
+          path(path),
+          u1D(u1D),
+          u2D(u2D),
+          nU1D(nU1D),
+          nU2D(nU2D) {}
+    Float Get1D() {
+        if (globalSampler)
+            return globalSampler->SampleDimension(path.sampleIndex,
+                                                  path.dimension++);
+        if (path.n1D < nU1D) return u1D[path.n1D++];
+        return path.rng.UniformFloat();
+    }
+    Point2f Get2D() {
+        if (globalSampler) {
+            Point2f u(globalSampler->SampleDimension(path.sampleIndex,
+                                                     path.dimension),
+                      globalSampler->SampleDimension(path.sampleIndex,
+                                                     path.dimension + 1));
+            path.dimension += 2;
+            return u;
+        }
+        if (path.n2D < nU2D) return u2D[path.n2D++];
+        Float u0 = path.rng.UniformFloat();
+        return Point2f(u0, path.rng.UniformFloat());
+    }
+    std::unique_ptr<Sampler> Clone(int seed) {
+        LOG(FATAL) << "WavefrontPathSampler::Clone() shouldn't be called";
+        return nullptr;
+    }
+
+  private:
+    const GlobalSampler *globalSampler;
+    WavefrontPath &path;
+    const Float *u1D;
+    const Point2f *u2D;
+    int nU1D, nU2D;
+};
+
+// WavefrontPathIntegrator Method Definitions
+WavefrontPathIntegrator::WavefrontPathIntegrator(
+    int maxDepth, std::shared_ptr<const Camera> camera,
+    std::shared_ptr<Sampler> sampler, const Bounds2i &pixelBounds,
+    Float rrThreshold, const std::string &lightSampleStrategy, int queueSize,
+    bool sortByMaterial)
+    : camera(camera),
+      sampler(sampler),
+      pixelBounds(pixelBounds),
+      maxDepth(maxDepth),
+      rrThreshold(rrThreshold),
+      lightSampleStrategy(lightSampleStrategy),
+      queueSize(queueSize),
+      sortByMaterial(sortByMaterial) {
+    // Paths take the values of the dimensions that a _PixelSampler_
+    // stratifies from it, after the camera sample's one 1D and two 2D
+    // dimensions; it would give the rest from its own _RNG_
+    const PixelSampler *pixelSampler =
+        dynamic_cast<const PixelSampler *>(sampler.get());
+    if (pixelSampler) {
+        int nDimensions = pixelSampler->SampledDimensions();
+        nPresampled1D = std::max(nDimensions - 1, 0);
+        nPresampled2D = std::max(nDimensions - 2, 0);
+        replaysSamples = nDimensions >= 2;
+    }
+}
+
+void WavefrontPathIntegrator::Render(const Scene &scene) {
+    ProfilePhase p(Prof::IntegratorRender);
+    lightDistribution =
+        CreateLightSampleDistribution(lightSampleStrategy, scene);
+    for (size_t i = 0; i < scene.lights.size(); ++i)
+        lightToIndex[scene.lights[i].get()] = i;
+
+    // Split the image into queues of at most _queueSize_ paths: bands of
+    // rows, and ranges of each pixel's samples if a row would exceed it
+    Vector2i extent = pixelBounds.Diagonal();
+    int64_t spp = sampler->samplesPerPixel;
+    int64_t samplesPerQueue =
+        Clamp(queueSize / std::max(extent.x, 1), 1, spp);
+    int rowsPerQueue = (int)Clamp(
+        queueSize / (std::max(extent.x, 1) * samplesPerQueue), 1,
+        std::max(extent.y, 1));
+    int nBands = (extent.y + rowsPerQueue - 1) / rowsPerQueue;
+    int64_t nSampleRanges = (spp + samplesPerQueue - 1) / samplesPerQueue;
+    ProgressReporter reporter(nBands * nSampleRanges, "Rendering");
+
+    std::vector<WavefrontPath> paths;
+    std::vector<Float> u1D;
+    std::vector<Point2f> u2D;
+    std::vector<SurfaceInteraction> isects;
+    std::vector<int> active;
+    std::vector<MemoryArena> arenas(MaxThreadIndex());
+    for (int band = 0; band < nBands; ++band) {
+        int y0 = pixelBounds.pMin.y + band * rowsPerQueue;
+        int y1 = std::min(y0 + rowsPerQueue, pixelBounds.pMax.y);
+        Bounds2i queueBounds(Point2i(pixelBounds.pMin.x, y0),
+                             Point2i(pixelBounds.pMax.x, y1));
+        for (int64_t range = 0; range < nSampleRanges; ++range) {
+            ++nQueues;
+            int64_t firstSample = range * samplesPerQueue;
+            int64_t nSamples = std::min(samplesPerQueue, spp - firstSample);
+            generateCameraRays(queueBounds, firstSample, nSamples, paths, u1D,
+                               u2D);
+
+            // Advance all live paths by one bounce per iteration
+            active.clear();
+            for (size_t i = 0; i < paths.size(); ++i)
+                if (paths[i].active) active.push_back(i);
+            while (!active.empty()) {
+                isects.resize(active.size());
+                intersect(scene, paths, active, isects);
+                shade(scene, paths, active, isects, u1D, u2D, arenas);
+                traceShadowRays(scene, paths, active);
+                active.erase(std::remove_if(active.begin(), active.end(),
+                                            [&](int i) {
+                                                return !paths[i].active;
+                                            }),
+                             active.end());
+            }
+
+            // Add the queue's radiance estimates to the film
+            std::unique_ptr<FilmTile> filmTile =
+                camera->film->GetFilmTile(queueBounds);
+            for (const WavefrontPath &path : paths) {
+                Spectrum L = path.L;
+                if (L.HasNaNs()) {
+                    LOG(ERROR) << StringPrintf(
+                        "Not-a-number radiance value returned for pixel "
+                        "(%d, %d). Setting to black.",
+                        path.pPixel.x, path.pPixel.y);
+                    L = Spectrum(0.f);
+                } else if (L.y() < -1e-5) {
+                    LOG(ERROR) << StringPrintf(
+                        "Negative luminance value, %f, returned for pixel "
+                        "(%d, %d). Setting to black.",
+                        L.y(), path.pPixel.x, path.pPixel.y);
+                    L = Spectrum(0.f);
+                } else if (std::isinf(L.y())) {
+                    LOG(ERROR) << StringPrintf(
+                        "Infinite luminance value returned for pixel "
+                        "(%d, %d). Setting to black.",
+                        path.pPixel.x, path.pPixel.y);
+                    L = Spectrum(0.f);
+                }
+                filmTile->AddSample(path.pFilm, L, path.rayWeight);
+            }
+            camera->film->MergeFilmTile(std::move(filmTile));
+            reporter.Update();
+        }
+    }
+    reporter.Done();
+    LOG(INFO) << "Rendering finished";
+    camera->film->WriteImage();
+}
+
+void WavefrontPathIntegrator::generateCameraRays(
+    const Bounds2i &queueBounds, int64_t firstSample, int64_t nSamples,
+    std::vector<WavefrontPath> &paths, std::vector<Float> &u1D,
+    std::vector<Point2f> &u2D) const {
+    Vector2i extent = queueBounds.Diagonal();
+    paths.resize(extent.x * extent.y * nSamples);
+    u1D.resize(paths.size() * nPresampled1D);
+    u2D.resize(paths.size() * nPresampled2D);
+    // Each row clones the sampler.  A pixel sampler cloned with the row's
+    // seed generates the same stratified set of samples for a pixel in
+    // every sample range, of which each range takes its own.  Others, like
+    // the random sampler, give values from a random number generator that
+    // _SetSampleNumber()_ doesn't replay, so the clone of each range needs
+    // its own seed instead; their values aren't stratified across samples
+    // in any case.
+    ParallelFor([&](int64_t row) {
+        int y = queueBounds.pMin.y + row;
+        int64_t seed = y - pixelBounds.pMin.y;
+        if (!replaysSamples)
+            seed = seed * sampler->samplesPerPixel + firstSample;
+        std::unique_ptr<Sampler> rowSampler = sampler->Clone((int)seed);
+        const GlobalSampler *globalSampler =
+            dynamic_cast<const GlobalSampler *>(rowSampler.get());
+        for (int x = queueBounds.pMin.x; x < queueBounds.pMax.x; ++x) {
+            Point2i pixel(x, y);
+            rowSampler->StartPixel(pixel);
+            int64_t pixelIndex =
+                (int64_t)(y - pixelBounds.pMin.y) *
+                    (pixelBounds.pMax.x - pixelBounds.pMin.x) +
+                (x - pixelBounds.pMin.x);
+            for (int64_t s = 0; s < nSamples; ++s) {
+                int64_t pathIndex =
+                    (row * extent.x + x - queueBounds.pMin.x) * nSamples + s;
+                WavefrontPath &path = paths[pathIndex];
+                int64_t sampleNum = firstSample + s;
+                rowSampler->SetSampleNumber(sampleNum);
+
+                // Generate camera ray for current sample
+                CameraSample cameraSample = rowSampler->GetCameraSample(pixel);
+                path.pPixel = pixel;
+                path.pFilm = cameraSample.pFilm;
+                path.rayWeight =
+                    camera->GenerateRayDifferential(cameraSample, &path.ray);
+                path.ray.ScaleDifferentials(
+                    1 / std::sqrt((Float)rowSampler->samplesPerPixel));
+                ++nCameraRays;
+
+                // Initialize the rest of the path's state
+                path.L = Spectrum(0.f);
+                path.beta = Spectrum(1.f);
+                path.etaScale = 1;
+                path.bounces = 0;
+                path.active = path.rayWeight > 0;
+                path.specularBounce = path.misEmission = false;
+                path.prevPdf = 0;
+                path.hasShadowRay = false;
+                if (globalSampler) {
+                    // _GetCameraSample()_ used the first five dimensions
+                    path.sampleIndex =
+                        globalSampler->GetIndexForSample(sampleNum);
+                    path.dimension = 5;
+                } else {
+                    for (int i = 0; i < nPresampled1D; ++i)
+                        u1D[pathIndex * nPresampled1D + i] = rowSampler->Get1D();
+                    for (int i = 0; i < nPresampled2D; ++i)
+                        u2D[pathIndex * nPresampled2D + i] = rowSampler->Get2D();
+                    path.n1D = path.n2D = 0;
+                    path.rng.SetSequence(pixelIndex * rowSampler->samplesPerPixel +
+                                         sampleNum);
+                }
+            }
+        }
+    }, extent.y);
+}
+
+void WavefrontPathIntegrator::intersect(
+    const Scene &scene, std::vector<WavefrontPath> &paths,
+    const std::vector<int> &active,
+    std::vector<SurfaceInteraction> &isects) const {
+    // Trace the rays of consecutive queue entries together; camera rays of a
+    // pixel are adjacent, which makes them coherent
+    int64_t nChunks = (active.size() + queueChunkSize - 1) / queueChunkSize;
+    ParallelFor([&](int64_t chunk) {
+        int start = chunk * queueChunkSize;
+        int n = std::min<int>(queueChunkSize, active.size() - start);
+        Ray rays[queueChunkSize];
+        bool hits[queueChunkSize];
+        for (int j = 0; j < n; ++j) rays[j] = paths[active[start + j]].ray;
+        scene.IntersectN(rays, &isects[start], hits, n);
+
+        for (int j = 0; j < n; ++j) {
+            WavefrontPath &path = paths[active[start + j]];
+            path.ray.tMax = rays[j].tMax;
+            const Distribution1D *prevDistrib =
+                (path.misEmission && !path.specularBounce)
+                    ? lightDistribution->Lookup(path.prevIntr.p)
+                    : nullptr;
+            if (!hits[j]) {
+                // Add light from the environment and terminate the path
+                for (const auto &light : scene.infiniteLights) {
+                    Spectrum Le = light->Le(path.ray);
+                    if (path.bounces == 0 || path.specularBounce)
+                        path.L += path.beta * Le;
+                    else if (prevDistrib && !Le.IsBlack()) {
+                        Float lightPdf =
+                            prevDistrib->DiscretePDF(
+                                lightToIndex.find(light.get())->second) *
+                            light->Pdf_Li(path.prevIntr, path.ray.d);
+                        path.L += path.beta * Le *
+                                  PowerHeuristic(1, path.prevPdf, 1, lightPdf);
+                    }
+                }
+                path.active = false;
+                continue;
+            }
+
+            // Add emitted light at path vertex
+            const SurfaceInteraction &isect = isects[start + j];
+            if (path.bounces == 0 || path.specularBounce)
+                path.L += path.beta * isect.Le(-path.ray.d);
+            else if (prevDistrib) {
+                const AreaLight *area = isect.primitive->GetAreaLight();
+                if (area) {
+                    Spectrum Le = isect.Le(-path.ray.d);
+                    Float lightPdf =
+                        prevDistrib->DiscretePDF(lightToIndex.find(area)->second) *
+                        area->Pdf_Li(path.prevIntr, path.ray.d);
+                    path.L += path.beta * Le *
+                              PowerHeuristic(1, path.prevPdf, 1, lightPdf);
+                }
+            }
+            if (path.bounces >= maxDepth) path.active = false;
+        }
+    }, nChunks);
+}
+
+void WavefrontPathIntegrator::shade(const Scene &scene,
+                                    std::vector<WavefrontPath> &paths,
+                                    std::vector<int> &active,
+                                    std::vector<SurfaceInteraction> &isects,
+                                    const std::vector<Float> &u1D,
+                                    const std::vector<Point2f> &u2D,
+                                    std::vector<MemoryArena> &arenas) const {
+    // Order the live paths by material, so that consecutive paths run the
+    // same material and BSDF code
+    std::vector<int> order;
+    order.reserve(active.size());
+    for (size_t k = 0; k < active.size(); ++k)
+        if (paths[active[k]].active) order.push_back(k);
+    auto material = [&](int k) { return isects[k].primitive->GetMaterial(); };
+    if (sortByMaterial)
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return std::less<const Material *>()(material(a), material(b));
+        });
+    nShadedPaths += order.size();
+    for (size_t i = 0; i < order.size(); ++i)
+        if (i == 0 || material(order[i]) != material(order[i - 1]))
+            ++nMaterialRuns;
+
+    const GlobalSampler *globalSampler =
+        dynamic_cast<const GlobalSampler *>(sampler.get());
+    int64_t nChunks = (order.size() + queueChunkSize - 1) / queueChunkSize;
+    ParallelFor([&](int64_t chunk) {
+        MemoryArena &arena = arenas[ThreadIndex];
+        int start = chunk * queueChunkSize;
+        int end = std::min<int>(start + queueChunkSize, order.size());
+        for (int o = start; o < end; ++o) {
+            int pathIndex = active[order[o]];
+            WavefrontPath &path = paths[pathIndex];
+            SurfaceInteraction &isect = isects[order[o]];
+            WavefrontPathSampler pathSampler(
+                globalSampler, path, u1D.data() + pathIndex * nPresampled1D,
+                nPresampled1D, u2D.data() + pathIndex * nPresampled2D,
+                nPresampled2D);
+
+            // Compute scattering functions and skip over medium boundaries
+            isect.ComputeScatteringFunctions(path.ray, arena, true);
+            if (!isect.bsdf) {
+                path.ray = isect.SpawnRay(path.ray.d);
+                arena.Reset();
+                continue;
+            }
+
+            // Sample a light; its shadow ray is traced in the next stage
+            Vector3f wo = -path.ray.d;
+            bool sampledLight = false;
+            const BxDFType nonSpecular = BxDFType(BSDF_ALL & ~BSDF_SPECULAR);
+            if (!scene.lights.empty() &&
+                isect.bsdf->NumComponents(nonSpecular) > 0) {
+                const Distribution1D *distrib =
+                    lightDistribution->Lookup(isect.p);
+                Float lightChoicePdf;
+                int lightNum =
+                    distrib->SampleDiscrete(pathSampler.Get1D(), &lightChoicePdf);
+                Point2f uLight = pathSampler.Get2D();
+                if (lightChoicePdf > 0) {
+                    sampledLight = true;
+                    const Light &light = *scene.lights[lightNum];
+                    Vector3f wi;
+                    Float lightPdf;
+                    VisibilityTester visibility;
+                    Spectrum Li = light.Sample_Li(isect, uLight, &wi,
+                                                  &lightPdf, &visibility);
+                    if (lightPdf > 0 && !Li.IsBlack()) {
+                        Spectrum f = isect.bsdf->f(wo, wi, nonSpecular) *
+                                     AbsDot(wi, isect.shading.n);
+                        // The weight is against the BSDF sample that
+                        // continues the path, which may also reach the light
+                        Float scatteringPdf = isect.bsdf->Pdf(wo, wi);
+                        if (!f.IsBlack()) {
+                            Float weight =
+                                IsDeltaLight(light.flags)
+                                    ? 1
+                                    : PowerHeuristic(1,
+                                                     lightChoicePdf * lightPdf,
+                                                     1, scatteringPdf);
+                            path.Ld = path.beta * f * Li * weight /
+                                      (lightPdf * lightChoicePdf);
+                            path.shadowRay =
+                                visibility.P0().SpawnRayTo(visibility.P1());
+                            path.hasShadowRay = true;
+                        }
+                    }
+                }
+            }
+
+            // Sample BSDF to get new path direction
+            Vector3f wi;
+            Float pdf;
+            BxDFType flags;
+            Spectrum f = isect.bsdf->Sample_f(wo, &wi, pathSampler.Get2D(),
+                                              &pdf, BSDF_ALL, &flags);
+            if (f.IsBlack() || pdf == 0.f) {
+                path.active = false;
+                arena.Reset();
+                continue;
+            }
+            path.beta *= f * AbsDot(wi, isect.shading.n) / pdf;
+            DCHECK(!std::isinf(path.beta.y()));
+            path.specularBounce = (flags & BSDF_SPECULAR) != 0;
+            path.misEmission = sampledLight;
+            path.prevIntr = isect;
+            path.prevPdf = pdf;
+            if ((flags & BSDF_SPECULAR) && (flags & BSDF_TRANSMISSION)) {
+                Float eta = isect.bsdf->eta;
+                path.etaScale *=
+                    (Dot(wo, isect.n) > 0) ? (eta * eta) : 1 / (eta * eta);
+            }
+            path.ray = isect.SpawnRay(wi);
+
+            // Account for subsurface scattering, if applicable
+            if (isect.bssrdf && (flags & BSDF_TRANSMISSION)) {
+                SurfaceInteraction pi;
+                Spectrum S = isect.bssrdf->Sample_S(
+                    scene, pathSampler.Get1D(), pathSampler.Get2D(), arena,
+                    &pi, &pdf);
+                if (S.IsBlack() || pdf == 0) {
+                    path.active = false;
+                    arena.Reset();
+                    continue;
+                }
+                path.beta *= S / pdf;
+
+                // Light the exit point right away, since it can't also
+                // have a shadow ray in the queue; this includes lights
+                // reached by BSDF sampling, so emission found by the
+                // continuation isn't counted again
+                path.L += path.beta *
+                          UniformSampleOneLight(pi, scene, arena, pathSampler,
+                                                false,
+                                                lightDistribution->Lookup(pi.p));
+                Spectrum f = pi.bsdf->Sample_f(pi.wo, &wi, pathSampler.Get2D(),
+                                               &pdf, BSDF_ALL, &flags);
+                if (f.IsBlack() || pdf == 0) {
+                    path.active = false;
+                    arena.Reset();
+                    continue;
+                }
+                path.beta *= f * AbsDot(wi, pi.shading.n) / pdf;
+                DCHECK(!std::isinf(path.beta.y()));
+                path.specularBounce = (flags & BSDF_SPECULAR) != 0;
+                path.misEmission = false;
+                path.ray = pi.SpawnRay(wi);
+            }
+            arena.Reset();
+
+            // Possibly terminate the path with Russian roulette.
+            // Factor out radiance scaling due to refraction in rrBeta.
+            Spectrum rrBeta = path.beta * path.etaScale;
+            if (rrBeta.MaxComponentValue() < rrThreshold && path.bounces > 3) {
+                Float q = std::max((Float).05, 1 - rrBeta.MaxComponentValue());
+                if (pathSampler.Get1D() < q) {
+                    path.active = false;
+                    continue;
+                }
+                path.beta /= 1 - q;
+                DCHECK(!std::isinf(path.beta.y()));
+            }
+            ++path.bounces;
+        }
+    }, nChunks);
+}
+
+void WavefrontPathIntegrator::traceShadowRays(
+    const Scene &scene, std::vector<WavefrontPath> &paths,
+    const std::vector<int> &active) const {
+    std::vector<int> shadowed;
+    for (int i : active)
+        if (paths[i].hasShadowRay) shadowed.push_back(i);
+    int64_t nChunks = (shadowed.size() + queueChunkSize - 1) / queueChunkSize;
+    ParallelFor([&](int64_t chunk) {
+        int start = chunk * queueChunkSize;
+        int n = std::min<int>(queueChunkSize, shadowed.size() - start);
+        Ray rays[queueChunkSize];
+        bool occluded[queueChunkSize];
+        for (int j = 0; j < n; ++j) rays[j] = paths[shadowed[start + j]].shadowRay;
+        scene.IntersectPN(rays, occluded, n);
+        for (int j = 0; j < n; ++j) {
+            WavefrontPath &path = paths[shadowed[start + j]];
+            if (!occluded[j]) path.L += path.Ld;
+            path.hasShadowRay = false;
+        }
+    }, nChunks);
+}
+
+WavefrontPathIntegrator *CreateWavefrontPathIntegrator(
+    const ParamSet &params, std::shared_ptr<Sampler> sampler,
+    std::shared_ptr<const Camera> camera) {
+    int maxDepth = params.FindOneInt("maxdepth", 5);
+    int np;
+    const int *pb = params.FindInt("pixelbounds", &np);
+    Bounds2i pixelBounds = camera->film->GetSampleBounds();
+    if (pb) {
+        if (np != 4)
+            Error("Expected four values for \"pixelbounds\" parameter. Got %d.",
+                  np);
+        else {
+            pixelBounds = Intersect(pixelBounds,
+                                    Bounds2i{{pb[0], pb[2]}, {pb[1], pb[3]}});
+            if (pixelBounds.Area() == 0)
+                Error("Degenerate \"pixelbounds\" specified.");
+        }
+    }
+    Float rrThreshold = params.FindOneFloat("rrthreshold", 1.);
+    std::string lightStrategy =
+        params.FindOneString("lightsamplestrategy", "spatial");
+    int queueSize = params.FindOneInt("queuesize", 1 << 16);
+    if (queueSize < 1) {
+        Warning("Wavefront queue size %d is invalid.  Using 65536.",
+                queueSize);
+        queueSize = 1 << 16;
+    }
+    bool sortByMaterial = params.FindOneBool("sortbymaterial", true);
+    return new WavefrontPathIntegrator(maxDepth, camera, sampler, pixelBounds,
+                                       rrThreshold, lightStrategy, queueSize,
+                                       sortByMaterial);
+}
+
+}  // namespace pbrt
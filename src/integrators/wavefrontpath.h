@@ -0,0 +1,110 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_INTEGRATORS_WAVEFRONTPATH_H
+#define PBRT_INTEGRATORS_WAVEFRONTPATH_H
+
+// integrators/wavefrontpath.h*
+#include "pbrt.h"
+#include "integrator.h"
+#include "lightdistrib.h"
+#include <unordered_map>
+
+namespace pbrt {
+struct WavefrontPath;
+
+// WavefrontPathIntegrator Declarations
+
+// Path tracer that advances a large queue of paths one stage at a time
+// (camera ray generation, intersection, shading, shadow rays) instead of
+// following each path to its end, so that each stage runs the same code
+// over many paths.  Paths are shaded in order of their material.  Direct
+// lighting combines light sampling with the BSDF-sampled path continuation
+// through multiple importance sampling, so images converge to those of
+// _PathIntegrator_ without matching them sample for sample.
+class WavefrontPathIntegrator : public Integrator {
+  public:
+    // WavefrontPathIntegrator Public Methods
+    WavefrontPathIntegrator(int maxDepth, std::shared_ptr<const Camera> camera,
+                            std::shared_ptr<Sampler> sampler,
+                            const Bounds2i &pixelBounds, Float rrThreshold,
+                            const std::string &lightSampleStrategy,
+                            int queueSize, bool sortByMaterial);
+    void Render(const Scene &scene);
+
+  private:
+    // WavefrontPathIntegrator Private Methods
+    void generateCameraRays(const Bounds2i &waveBounds, int64_t firstSample,
+                            int64_t nSamples, std::vector<WavefrontPath> &paths,
+                            std::vector<Float> &u1D,
+                            std::vector<Point2f> &u2D) const;
+    void intersect(const Scene &scene, std::vector<WavefrontPath> &paths,
+                   const std::vector<int> &active,
+                   std::vector<SurfaceInteraction> &isects) const;
+    void shade(const Scene &scene, std::vector<WavefrontPath> &paths,
+               std::vector<int> &active,
+               std::vector<SurfaceInteraction> &isects,
+               const std::vector<Float> &u1D, const std::vector<Point2f> &u2D,
+               std::vector<MemoryArena> &arenas) const;
+    void traceShadowRays(const Scene &scene, std::vector<WavefrontPath> &paths,
+                         const std::vector<int> &active) const;
+
+    // WavefrontPathIntegrator Private Data
+    std::shared_ptr<const Camera> camera;
+    std::shared_ptr<Sampler> sampler;
+    const Bounds2i pixelBounds;
+    const int maxDepth;
+    const Float rrThreshold;
+    const std::string lightSampleStrategy;
+    const int queueSize;
+    const bool sortByMaterial;
+    // Number of sample values of each path drawn from a _PixelSampler_ when
+    // it is created, and whether the sampler gives a pixel the same samples
+    // whenever it is cloned with the same seed
+    int nPresampled1D = 0, nPresampled2D = 0;
+    bool replaysSamples = false;
+    std::unique_ptr<LightDistribution> lightDistribution;
+    std::unordered_map<const Light *, size_t> lightToIndex;
+};
+
+WavefrontPathIntegrator *CreateWavefrontPathIntegrator(
+    const ParamSet &params, std::shared_ptr<Sampler> sampler,
+    std::shared_ptr<const Camera> camera);
+
+}  // namespace pbrt
+
+#endif  // PBRT_INTEGRATORS_WAVEFRONTPATH_H
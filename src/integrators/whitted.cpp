@@ -43,14 +43,15 @@ namespace pbrt {
 // WhittedIntegrator Method Definitions
 Spectrum WhittedIntegrator::Li(const RayDifferential &ray, const Scene &scene,
                                Sampler &sampler, MemoryArena &arena,
-                               Extractor &extractor, int depth) const {
+                               Extractor &extractor, int depth,
+                               const PrimaryHit *primary) const {
     Spectrum L(0.);
     if (depth == 0)
         extractor.AddCameraVertex(ray.o);
 
     // Find closest ray intersection or return background radiance
     SurfaceInteraction isect;
-    if (!scene.Intersect(ray, &isect)) {
+    if (!IntersectPrimary(scene, ray, &isect, primary)) {
         for (const auto &light : scene.lights) L += light->Le(ray);
         return L;
     }
@@ -67,7 +68,8 @@ Spectrum WhittedIntegrator::Li(const RayDifferential &ray, const Scene &scene,
     // Report intersection data to extractor
 
     if (!isect.bsdf)
-        return Li(isect.SpawnRay(ray.d), scene, sampler, arena, extractor, depth);
+        return Li(isect.SpawnRay(ray.d), scene, sampler, arena, extractor,
+                  depth, nullptr);
 
     // Compute emitted light if ray hit an area light source
     L += isect.Le(wo);
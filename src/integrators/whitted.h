@@ -55,7 +55,8 @@ class WhittedIntegrator : public SamplerIntegrator {
                       const Bounds2i &pixelBounds)
         : SamplerIntegrator(camera, sampler, extractor, pixelBounds), maxDepth(maxDepth) {}
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
-                Sampler &sampler, MemoryArena &arena, Extractor &extractor, int depth) const;
+                Sampler &sampler, MemoryArena &arena, Extractor &extractor,
+                int depth, const PrimaryHit *primary) const;
 
   private:
     // WhittedIntegrator Private Data
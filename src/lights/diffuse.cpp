@@ -135,11 +135,19 @@ void DiffuseAreaLight::Pdf_Le(const Ray &ray, const Normal3f &n, Float *pdfPos,
 std::shared_ptr<AreaLight> CreateDiffuseAreaLight(
     const Transform &light2world, const Medium *medium,
     const ParamSet &paramSet, const std::shared_ptr<Shape> &shape) {
-    Spectrum L = paramSet.FindOneSpectrum("L", Spectrum(1.0));
-    Spectrum sc = paramSet.FindOneSpectrum("scale", Spectrum(1.0));
-    int nSamples = paramSet.FindOneInt("samples",
-                                       paramSet.FindOneInt("nsamples", 1));
-    bool twoSided = paramSet.FindOneBool("twosided", false);
+    static const ParamSymbol *const LName = ParamSymbol::Intern("L");
+    static const ParamSymbol *const scaleName = ParamSymbol::Intern("scale");
+    static const ParamSymbol *const samplesName =
+        ParamSymbol::Intern("samples");
+    static const ParamSymbol *const nsamplesName =
+        ParamSymbol::Intern("nsamples");
+    static const ParamSymbol *const twosidedName =
+        ParamSymbol::Intern("twosided");
+    Spectrum L = paramSet.FindOneSpectrum(LName, Spectrum(1.0));
+    Spectrum sc = paramSet.FindOneSpectrum(scaleName, Spectrum(1.0));
+    int nSamples = paramSet.FindOneInt(samplesName,
+                                       paramSet.FindOneInt(nsamplesName, 1));
+    bool twoSided = paramSet.FindOneBool(twosidedName, false);
     if (PbrtOptions.quickRender) nSamples = std::max(1, nSamples / 4);
     return std::make_shared<DiffuseAreaLight>(light2world, medium, L * sc,
                                               nSamples, shape, twoSided);
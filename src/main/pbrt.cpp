@@ -46,12 +46,30 @@ static void usage(const char *msg = nullptr) {
 
     fprintf(stderr, R"(usage: pbrt [<options>] <filename.pbrt...>
 Rendering options:
+  --accelcache <dir>   Store built acceleration structures in the given
+                       directory and reuse them when the same geometry is
+                       rendered again.
+  --geometrybudget <MB>
+                       Load PLY meshes on demand when rays first reach them
+                       and keep at most the given amount of their geometry
+                       in memory.
   --help               Print this help text.
+  --mipmapcache <dir>  Store the filtered MIP map levels of image textures in
+                       the given directory and reuse them when the same
+                       textures are rendered again.
   --nthreads <num>     Use specified number of threads for rendering.
   --outfile <filename> Write the final image to the given filename.
+  --ptexbudget <MB>    Keep at most the given amount of Ptex texture data in
+                       memory. Default: no limit.
+  --ptexmaxfiles <num> Keep at most the given number of Ptex files open.
+                       Default: 100.
   --quick              Automatically reduce a number of quality settings to
                        render more quickly.
   --quiet              Suppress all text output other than error messages.
+  --texturebudget <MB>
+                       Read image textures when they're first looked up and
+                       keep at most the given amount of their MIP map tiles
+                       in memory.
 
 Logging options:
   --logdir <dir>       Specify directory that log files should be written to.
@@ -67,6 +85,11 @@ Reformatting options:
   --toply              Print a reformatted version of the input file(s) to
                        standard output and convert all triangle meshes to
                        PLY files. Does not render an image.
+  --tobinary <filename>
+                       Write the input file(s) to a binary scene file that
+                       pbrt reads without parsing text. Relative filenames
+                       in the scene are resolved against the directory of
+                       the binary file. Does not render an image.
 )");
 }
 
@@ -91,6 +114,48 @@ int main(int argc, char *argv[]) {
             options.imageFile = argv[++i];
         } else if (!strncmp(argv[i], "--outfile=", 10)) {
             options.imageFile = &argv[i][10];
+        } else if (!strcmp(argv[i], "--accelcache") ||
+                   !strcmp(argv[i], "-accelcache")) {
+            if (i + 1 == argc)
+                usage("missing value after --accelcache argument");
+            options.accelCacheDir = argv[++i];
+        } else if (!strncmp(argv[i], "--accelcache=", 13)) {
+            options.accelCacheDir = &argv[i][13];
+        } else if (!strcmp(argv[i], "--mipmapcache") ||
+                   !strcmp(argv[i], "-mipmapcache")) {
+            if (i + 1 == argc)
+                usage("missing value after --mipmapcache argument");
+            options.mipmapCacheDir = argv[++i];
+        } else if (!strncmp(argv[i], "--mipmapcache=", 14)) {
+            options.mipmapCacheDir = &argv[i][14];
+        } else if (!strcmp(argv[i], "--geometrybudget") ||
+                   !strcmp(argv[i], "-geometrybudget")) {
+            if (i + 1 == argc)
+                usage("missing value after --geometrybudget argument");
+            options.geometryBudget = atof(argv[++i]);
+        } else if (!strncmp(argv[i], "--geometrybudget=", 17)) {
+            options.geometryBudget = atof(&argv[i][17]);
+        } else if (!strcmp(argv[i], "--texturebudget") ||
+                   !strcmp(argv[i], "-texturebudget")) {
+            if (i + 1 == argc)
+                usage("missing value after --texturebudget argument");
+            options.textureBudget = atof(argv[++i]);
+        } else if (!strncmp(argv[i], "--texturebudget=", 16)) {
+            options.textureBudget = atof(&argv[i][16]);
+        } else if (!strcmp(argv[i], "--ptexbudget") ||
+                   !strcmp(argv[i], "-ptexbudget")) {
+            if (i + 1 == argc)
+                usage("missing value after --ptexbudget argument");
+            options.ptexBudget = atof(argv[++i]);
+        } else if (!strncmp(argv[i], "--ptexbudget=", 13)) {
+            options.ptexBudget = atof(&argv[i][13]);
+        } else if (!strcmp(argv[i], "--ptexmaxfiles") ||
+                   !strcmp(argv[i], "-ptexmaxfiles")) {
+            if (i + 1 == argc)
+                usage("missing value after --ptexmaxfiles argument");
+            options.ptexMaxFiles = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "--ptexmaxfiles=", 15)) {
+            options.ptexMaxFiles = atoi(&argv[i][15]);
         } else if (!strcmp(argv[i], "--logdir") || !strcmp(argv[i], "-logdir")) {
             if (i + 1 == argc)
                 usage("missing value after --logdir argument");
@@ -112,6 +177,13 @@ int main(int argc, char *argv[]) {
             options.cat = true;
         } else if (!strcmp(argv[i], "--toply") || !strcmp(argv[i], "-toply")) {
             options.toPly = true;
+        } else if (!strcmp(argv[i], "--tobinary") ||
+                   !strcmp(argv[i], "-tobinary")) {
+            if (i + 1 == argc)
+                usage("missing value after --tobinary argument");
+            options.toBinary = argv[++i];
+        } else if (!strncmp(argv[i], "--tobinary=", 11)) {
+            options.toBinary = &argv[i][11];
         } else if (!strcmp(argv[i], "--v") || !strcmp(argv[i], "-v")) {
             if (i + 1 == argc)
                 usage("missing value after --v argument");
@@ -130,7 +202,8 @@ int main(int argc, char *argv[]) {
     }
 
     // Print welcome banner
-    if (!options.quiet && !options.cat && !options.toPly) {
+    if (!options.quiet && !options.cat && !options.toPly &&
+        options.toBinary.empty()) {
         printf("pbrt version 3 (built %s at %s) [Detected %d cores]\n",
                __DATE__, __TIME__, NumSystemCores());
 #ifndef NDEBUG
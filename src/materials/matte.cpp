@@ -62,11 +62,15 @@ void MatteMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
 }
 
 MatteMaterial *CreateMatteMaterial(const TextureParams &mp) {
+    static const ParamSymbol *const KdName = ParamSymbol::Intern("Kd");
+    static const ParamSymbol *const sigmaName = ParamSymbol::Intern("sigma");
+    static const ParamSymbol *const bumpmapName =
+        ParamSymbol::Intern("bumpmap");
     std::shared_ptr<Texture<Spectrum>> Kd =
-        mp.GetSpectrumTexture("Kd", Spectrum(0.5f));
-    std::shared_ptr<Texture<Float>> sigma = mp.GetFloatTexture("sigma", 0.f);
+        mp.GetSpectrumTexture(KdName, Spectrum(0.5f));
+    std::shared_ptr<Texture<Float>> sigma = mp.GetFloatTexture(sigmaName, 0.f);
     std::shared_ptr<Texture<Float>> bumpMap =
-        mp.GetFloatTextureOrNull("bumpmap");
+        mp.GetFloatTextureOrNull(bumpmapName);
     return new MatteMaterial(Kd, sigma, bumpMap);
 }
 
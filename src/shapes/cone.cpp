@@ -211,9 +211,12 @@ std::shared_ptr<Cone> CreateConeShape(const Transform *o2w,
                                       const Transform *w2o,
                                       bool reverseOrientation,
                                       const ParamSet &params) {
-    Float radius = params.FindOneFloat("radius", 1);
-    Float height = params.FindOneFloat("height", 1);
-    Float phimax = params.FindOneFloat("phimax", 360);
+    static const ParamSymbol *const radiusName = ParamSymbol::Intern("radius");
+    static const ParamSymbol *const heightName = ParamSymbol::Intern("height");
+    static const ParamSymbol *const phimaxName = ParamSymbol::Intern("phimax");
+    Float radius = params.FindOneFloat(radiusName, 1);
+    Float height = params.FindOneFloat(heightName, 1);
+    Float phimax = params.FindOneFloat(phimaxName, 360);
     return std::make_shared<Cone>(o2w, w2o, reverseOrientation, height, radius,
                                   phimax);
 }
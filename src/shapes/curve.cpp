@@ -382,12 +382,20 @@ std::vector<std::shared_ptr<Shape>> CreateCurveShape(const Transform *o2w,
                                                      const Transform *w2o,
                                                      bool reverseOrientation,
                                                      const ParamSet &params) {
-    Float width = params.FindOneFloat("width", 1.f);
-    Float width0 = params.FindOneFloat("width0", width);
-    Float width1 = params.FindOneFloat("width1", width);
+    static const ParamSymbol *const widthName = ParamSymbol::Intern("width");
+    static const ParamSymbol *const width0Name = ParamSymbol::Intern("width0");
+    static const ParamSymbol *const width1Name = ParamSymbol::Intern("width1");
+    static const ParamSymbol *const PName = ParamSymbol::Intern("P");
+    static const ParamSymbol *const typeName = ParamSymbol::Intern("type");
+    static const ParamSymbol *const NName = ParamSymbol::Intern("N");
+    static const ParamSymbol *const splitdepthName =
+        ParamSymbol::Intern("splitdepth");
+    Float width = params.FindOneFloat(widthName, 1.f);
+    Float width0 = params.FindOneFloat(width0Name, width);
+    Float width1 = params.FindOneFloat(width1Name, width);
 
     int ncp;
-    const Point3f *cp = params.FindPoint3f("P", &ncp);
+    const Point3f *cp = params.FindPoint3f(PName, &ncp);
     if (ncp != 4) {
         Error(
             "Must provide 4 control points for \"curve\" primitive. "
@@ -397,7 +405,7 @@ std::vector<std::shared_ptr<Shape>> CreateCurveShape(const Transform *o2w,
     }
 
     CurveType type;
-    std::string curveType = params.FindOneString("type", "flat");
+    std::string curveType = params.FindOneString(typeName, "flat");
     if (curveType == "flat")
         type = CurveType::Flat;
     else if (curveType == "ribbon")
@@ -409,7 +417,7 @@ std::vector<std::shared_ptr<Shape>> CreateCurveShape(const Transform *o2w,
         type = CurveType::Cylinder;
     }
     int nnorm;
-    const Normal3f *n = params.FindNormal3f("N", &nnorm);
+    const Normal3f *n = params.FindNormal3f(NName, &nnorm);
     if (n != nullptr) {
         if (type != CurveType::Ribbon) {
             Warning("Curve normals are only used with \"ribbon\" type curves.");
@@ -424,7 +432,7 @@ std::vector<std::shared_ptr<Shape>> CreateCurveShape(const Transform *o2w,
         }
     }
 
-    int sd = params.FindOneFloat("splitdepth", 3);
+    int sd = params.FindOneFloat(splitdepthName, 3);
 
     if (type == CurveType::Ribbon && !n) {
         Error(
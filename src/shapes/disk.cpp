@@ -141,10 +141,15 @@ std::shared_ptr<Disk> CreateDiskShape(const Transform *o2w,
                                       const Transform *w2o,
                                       bool reverseOrientation,
                                       const ParamSet &params) {
-    Float height = params.FindOneFloat("height", 0.);
-    Float radius = params.FindOneFloat("radius", 1);
-    Float inner_radius = params.FindOneFloat("innerradius", 0);
-    Float phimax = params.FindOneFloat("phimax", 360);
+    static const ParamSymbol *const heightName = ParamSymbol::Intern("height");
+    static const ParamSymbol *const radiusName = ParamSymbol::Intern("radius");
+    static const ParamSymbol *const innerradiusName =
+        ParamSymbol::Intern("innerradius");
+    static const ParamSymbol *const phimaxName = ParamSymbol::Intern("phimax");
+    Float height = params.FindOneFloat(heightName, 0.);
+    Float radius = params.FindOneFloat(radiusName, 1);
+    Float inner_radius = params.FindOneFloat(innerradiusName, 0);
+    Float phimax = params.FindOneFloat(phimaxName, 360);
     return std::make_shared<Disk>(o2w, w2o, reverseOrientation, height, radius,
                                   inner_radius, phimax);
 }
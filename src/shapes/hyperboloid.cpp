@@ -253,9 +253,12 @@ std::shared_ptr<Shape> CreateHyperboloidShape(const Transform *o2w,
                                               const Transform *w2o,
                                               bool reverseOrientation,
                                               const ParamSet &params) {
-    Point3f p1 = params.FindOnePoint3f("p1", Point3f(0, 0, 0));
-    Point3f p2 = params.FindOnePoint3f("p2", Point3f(1, 1, 1));
-    Float phimax = params.FindOneFloat("phimax", 360);
+    static const ParamSymbol *const p1Name = ParamSymbol::Intern("p1");
+    static const ParamSymbol *const p2Name = ParamSymbol::Intern("p2");
+    static const ParamSymbol *const phimaxName = ParamSymbol::Intern("phimax");
+    Point3f p1 = params.FindOnePoint3f(p1Name, Point3f(0, 0, 0));
+    Point3f p2 = params.FindOnePoint3f(p2Name, Point3f(1, 1, 1));
+    Float phimax = params.FindOneFloat(phimaxName, 360);
     return std::make_shared<Hyperboloid>(o2w, w2o, reverseOrientation, p1, p2,
                                          phimax);
 }
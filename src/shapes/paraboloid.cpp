@@ -217,10 +217,14 @@ std::shared_ptr<Paraboloid> CreateParaboloidShape(const Transform *o2w,
                                                   const Transform *w2o,
                                                   bool reverseOrientation,
                                                   const ParamSet &params) {
-    Float radius = params.FindOneFloat("radius", 1);
-    Float zmin = params.FindOneFloat("zmin", 0);
-    Float zmax = params.FindOneFloat("zmax", 1);
-    Float phimax = params.FindOneFloat("phimax", 360);
+    static const ParamSymbol *const radiusName = ParamSymbol::Intern("radius");
+    static const ParamSymbol *const zminName = ParamSymbol::Intern("zmin");
+    static const ParamSymbol *const zmaxName = ParamSymbol::Intern("zmax");
+    static const ParamSymbol *const phimaxName = ParamSymbol::Intern("phimax");
+    Float radius = params.FindOneFloat(radiusName, 1);
+    Float zmin = params.FindOneFloat(zminName, 0);
+    Float zmax = params.FindOneFloat(zmaxName, 1);
+    Float phimax = params.FindOneFloat(phimaxName, 360);
     return std::make_shared<Paraboloid>(o2w, w2o, reverseOrientation, radius,
                                         zmin, zmax, phimax);
 }
@@ -32,12 +32,15 @@
 
 
 // shapes/plymesh.cpp*
-#include "shapes/triangle.h"
+#include "shapes/plymesh.h"
 #include "textures/constant.h"
 #include "paramset.h"
+#include "fileutil.h"
 #include "ext/rply.h"
 
 #include <iostream>
+#include <limits>
+#include <sstream>
 
 namespace pbrt {
 using namespace std;
@@ -69,6 +72,12 @@ struct CallbackContext {
     }
 };
 
+struct BoundsContext {
+    Bounds3f bounds;
+    Point3f p;
+    int nComponents = 0;
+};
+
 void rply_message_callback(p_ply ply, const char *message) {
     Warning("rply: %s", message);
 }
@@ -137,11 +146,503 @@ int rply_face_callback(p_ply_argument argument) {
     return 1;
 }
 
-std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
+static std::vector<std::shared_ptr<Shape>> CreatePLYTriangles(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
-    const ParamSet &params,
-    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures) {
-    const std::string filename = params.FindOneFilename("filename", "");
+    int nIndices, const int *indices, int nVertices, const Point3f *p,
+    const Normal3f *n, const Point2f *uv,
+    const std::shared_ptr<Texture<Float>> &alphaTex,
+    const std::shared_ptr<Texture<Float>> &shadowAlphaTex,
+    size_t *meshBytes) {
+    if (meshBytes)
+        *meshBytes = nIndices / 3 * sizeof(Triangle) + nIndices * sizeof(int) +
+                     nVertices * (sizeof(Point3f) + (n ? sizeof(Normal3f) : 0) +
+                                  (uv ? sizeof(Point2f) : 0));
+    return CreateTriangleMesh(o2w, w2o, reverseOrientation, nIndices / 3,
+                              indices, nVertices, p, nullptr, n, uv, alphaTex,
+                              shadowAlphaTex);
+}
+
+// Binary PLY Fast Path
+
+// Binary little-endian files are mapped into memory and their vertex and
+// face elements converted in bulk instead of one value per RPly callback.
+// Anything else, or any file whose layout the fast path doesn't handle,
+// goes through RPly.
+enum class PLYType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+struct PLYProperty {
+    std::string name;
+    PLYType type;
+    bool isList = false;
+    PLYType countType;
+    // Offset in the element's records; only used for fixed-size records
+    size_t offset = 0;
+};
+
+struct PLYElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PLYProperty> properties;
+    // Size of each record, or 0 if it has list properties
+    size_t recordSize = 0;
+};
+
+struct BinaryPLY {
+    std::unique_ptr<MappedFile> file;
+    std::vector<PLYElement> elements;
+    const char *data, *end;
+
+    const PLYElement *Element(const char *name, const char **start) const;
+};
+
+static bool ParsePLYType(const std::string &name, PLYType *type) {
+    static const struct {
+        const char *name;
+        PLYType type;
+    } types[] = {{"char", PLYType::Int8},      {"int8", PLYType::Int8},
+                 {"uchar", PLYType::UInt8},    {"uint8", PLYType::UInt8},
+                 {"short", PLYType::Int16},    {"int16", PLYType::Int16},
+                 {"ushort", PLYType::UInt16},  {"uint16", PLYType::UInt16},
+                 {"int", PLYType::Int32},      {"int32", PLYType::Int32},
+                 {"uint", PLYType::UInt32},    {"uint32", PLYType::UInt32},
+                 {"float", PLYType::Float32},  {"float32", PLYType::Float32},
+                 {"double", PLYType::Float64}, {"float64", PLYType::Float64}};
+    for (const auto &t : types)
+        if (name == t.name) {
+            *type = t.type;
+            return true;
+        }
+    return false;
+}
+
+static size_t PLYTypeSize(PLYType type) {
+    switch (type) {
+    case PLYType::Int8:
+    case PLYType::UInt8:
+        return 1;
+    case PLYType::Int16:
+    case PLYType::UInt16:
+        return 2;
+    case PLYType::Int32:
+    case PLYType::UInt32:
+    case PLYType::Float32:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+template <typename T>
+static inline T LoadUnaligned(const char *p) {
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+static double ReadPLYValue(const char *p, PLYType type) {
+    switch (type) {
+    case PLYType::Int8:
+        return LoadUnaligned<int8_t>(p);
+    case PLYType::UInt8:
+        return LoadUnaligned<uint8_t>(p);
+    case PLYType::Int16:
+        return LoadUnaligned<int16_t>(p);
+    case PLYType::UInt16:
+        return LoadUnaligned<uint16_t>(p);
+    case PLYType::Int32:
+        return LoadUnaligned<int32_t>(p);
+    case PLYType::UInt32:
+        return LoadUnaligned<uint32_t>(p);
+    case PLYType::Float32:
+        return LoadUnaligned<float>(p);
+    default:
+        return LoadUnaligned<double>(p);
+    }
+}
+
+// Maps _filename_ and parses its header if it's a binary little-endian PLY
+// file that the fast path can read on this machine.
+static bool OpenBinaryPLY(const std::string &filename, BinaryPLY *ply) {
+    uint16_t one = 1;
+    uint8_t firstByte;
+    memcpy(&firstByte, &one, 1);
+    if (firstByte != 1) return false;
+
+    std::unique_ptr<MappedFile> file = MappedFile::Open(filename);
+    if (!file) return false;
+    const char *p = file->Data(), *end = p + file->Size();
+    auto nextLine = [&](std::string *line) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (!eol) return false;
+        line->assign(p, eol);
+        if (!line->empty() && line->back() == '\r') line->pop_back();
+        p = eol + 1;
+        return true;
+    };
+
+    std::string line;
+    if (!nextLine(&line) || line != "ply") return false;
+    bool binaryLittleEndian = false;
+    while (true) {
+        if (!nextLine(&line)) return false;
+        std::istringstream in(line);
+        std::string keyword;
+        in >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            in >> format;
+            binaryLittleEndian = format == "binary_little_endian";
+        } else if (keyword == "element") {
+            PLYElement element;
+            in >> element.name >> element.count;
+            if (!in) return false;
+            ply->elements.push_back(element);
+        } else if (keyword == "property") {
+            if (ply->elements.empty()) return false;
+            PLYProperty prop;
+            std::string type;
+            in >> type;
+            if (type == "list") {
+                prop.isList = true;
+                in >> type;
+                if (!ParsePLYType(type, &prop.countType)) return false;
+                in >> type;
+            }
+            in >> prop.name;
+            if (!in || !ParsePLYType(type, &prop.type)) return false;
+            ply->elements.back().properties.push_back(prop);
+        } else if (keyword == "end_header")
+            break;
+        else if (keyword != "comment" && keyword != "obj_info" &&
+                 !keyword.empty())
+            return false;
+    }
+    if (!binaryLittleEndian) return false;
+
+    for (PLYElement &element : ply->elements) {
+        size_t offset = 0;
+        bool fixedSize = true;
+        for (PLYProperty &prop : element.properties) {
+            prop.offset = offset;
+            if (prop.isList)
+                fixedSize = false;
+            else
+                offset += PLYTypeSize(prop.type);
+        }
+        element.recordSize = fixedSize ? offset : 0;
+    }
+    ply->data = p;
+    ply->end = end;
+    ply->file = std::move(file);
+    return true;
+}
+
+// Returns the element with the given name and sets _*start_ to its first
+// record, skipping the records of the elements before it.  Returns
+// _nullptr_ if there's no such element or the file is truncated.
+const PLYElement *BinaryPLY::Element(const char *name,
+                                     const char **start) const {
+    const char *p = data;
+    for (const PLYElement &element : elements) {
+        if (element.name == name) {
+            if (element.recordSize > 0 &&
+                size_t(end - p) / element.recordSize < element.count)
+                return nullptr;
+            *start = p;
+            return &element;
+        }
+        if (element.recordSize > 0) {
+            if (size_t(end - p) / element.recordSize < element.count)
+                return nullptr;
+            p += element.count * element.recordSize;
+            continue;
+        }
+        for (size_t i = 0; i < element.count; ++i)
+            for (const PLYProperty &prop : element.properties) {
+                size_t bytes = PLYTypeSize(prop.isList ? prop.countType
+                                                       : prop.type);
+                if (size_t(end - p) < bytes) return nullptr;
+                if (prop.isList) {
+                    double n = ReadPLYValue(p, prop.countType);
+                    p += bytes;
+                    if (n < 0) return nullptr;
+                    bytes = size_t(n) * PLYTypeSize(prop.type);
+                    if (size_t(end - p) < bytes) return nullptr;
+                }
+                p += bytes;
+            }
+    }
+    return nullptr;
+}
+
+template <typename T>
+static void GatherPLYColumn(const char *p, size_t stride, size_t n,
+                            Float *out, int outStride) {
+    for (size_t i = 0; i < n; ++i)
+        out[i * outStride] = Float(LoadUnaligned<T>(p + i * stride));
+}
+
+// Converts the named properties of _n_ vertex records starting at _data_
+// to _Float_s, stored interleaved in _out_.  Returns false if one of them is
+// missing.
+static bool ReadPLYVertexProperties(const PLYElement &vertex,
+                                    const char *data, size_t n,
+                                    const std::vector<const char *> &names,
+                                    Float *out) {
+    std::vector<const PLYProperty *> props;
+    for (const char *name : names) {
+        auto iter = std::find_if(
+            vertex.properties.begin(), vertex.properties.end(),
+            [&](const PLYProperty &p) { return !p.isList && p.name == name; });
+        if (iter == vertex.properties.end()) return false;
+        props.push_back(&*iter);
+    }
+    int nc = props.size();
+    size_t stride = vertex.recordSize;
+
+    // Copy runs of consecutive 32-bit floats as they are
+    bool consecutive = sizeof(Float) == sizeof(float);
+    for (int c = 0; c < nc; ++c)
+        consecutive &= props[c]->type == PLYType::Float32 &&
+                       props[c]->offset == props[0]->offset + c * sizeof(float);
+    if (consecutive) {
+        const char *p = data + props[0]->offset;
+        if (stride == nc * sizeof(float))
+            memcpy(out, p, n * stride);
+        else
+            for (size_t i = 0; i < n; ++i)
+                memcpy(out + i * nc, p + i * stride, nc * sizeof(float));
+        return true;
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        const char *p = data + props[c]->offset;
+        switch (props[c]->type) {
+        case PLYType::Int8:
+            GatherPLYColumn<int8_t>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::UInt8:
+            GatherPLYColumn<uint8_t>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::Int16:
+            GatherPLYColumn<int16_t>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::UInt16:
+            GatherPLYColumn<uint16_t>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::Int32:
+            GatherPLYColumn<int32_t>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::UInt32:
+            GatherPLYColumn<uint32_t>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::Float32:
+            GatherPLYColumn<float>(p, stride, n, out + c, nc);
+            break;
+        case PLYType::Float64:
+            GatherPLYColumn<double>(p, stride, n, out + c, nc);
+            break;
+        }
+    }
+    return true;
+}
+
+// Reads the faces starting at _p_ into _indices_, splitting quads the same
+// way as _rply_face_callback()_.  Returns false if the file is invalid.
+static bool ReadPLYFaces(const PLYElement &face, const PLYProperty &list,
+                         const char *p, const char *end, int vertexCount,
+                         std::vector<int> *indices) {
+    size_t countSize = PLYTypeSize(list.countType);
+    size_t indexSize = PLYTypeSize(list.type);
+    bool int32Indices =
+        list.type == PLYType::Int32 || list.type == PLYType::UInt32;
+    indices->reserve(3 * face.count);
+    for (size_t i = 0; i < face.count; ++i)
+        for (const PLYProperty &prop : face.properties) {
+            if (!prop.isList) {
+                if (size_t(end - p) < PLYTypeSize(prop.type)) return false;
+                p += PLYTypeSize(prop.type);
+                continue;
+            }
+            if (size_t(end - p) < countSize) return false;
+            double length = ReadPLYValue(p, prop.countType);
+            p += countSize;
+            if (length < 0 ||
+                size_t(end - p) / PLYTypeSize(prop.type) < size_t(length))
+                return false;
+            if (&prop != &list) {
+                p += size_t(length) * PLYTypeSize(prop.type);
+                continue;
+            }
+
+            int n = int(length);
+            if (n != 3 && n != 4) {
+                Warning(
+                    "plymesh: Ignoring face with %i vertices (only triangles "
+                    "and quads are supported!)",
+                    n);
+                p += n * indexSize;
+                continue;
+            }
+            int v[4];
+            if (int32Indices)
+                memcpy(v, p, n * sizeof(int));
+            else
+                for (int j = 0; j < n; ++j)
+                    v[j] = int(ReadPLYValue(p + j * indexSize, list.type));
+            p += n * indexSize;
+            for (int j = 0; j < n; ++j)
+                if (v[j] < 0 || v[j] >= vertexCount) {
+                    Error(
+                        "plymesh: Vertex reference %i is out of bounds! "
+                        "Valid range is [0..%i)",
+                        v[j], vertexCount);
+                    return false;
+                }
+            indices->insert(indices->end(), {v[0], v[1], v[2]});
+            if (n == 4) indices->insert(indices->end(), {v[3], v[0], v[2]});
+        }
+    return true;
+}
+
+// Reads the mesh of a binary little-endian PLY file.  Returns false if the
+// file needs to be read with RPly instead; otherwise _*error_ is set if the
+// file turned out to be invalid.
+static bool ReadBinaryPLYMesh(const std::string &filename,
+                              std::vector<Point3f> *p,
+                              std::vector<Normal3f> *n,
+                              std::vector<Point2f> *uv,
+                              std::vector<int> *indices, bool *error) {
+    BinaryPLY ply;
+    if (!OpenBinaryPLY(filename, &ply)) return false;
+    const char *vertexData, *faceData;
+    const PLYElement *vertex = ply.Element("vertex", &vertexData);
+    const PLYElement *face = ply.Element("face", &faceData);
+    if (!vertex || !face || vertex->count == 0 || face->count == 0 ||
+        vertex->recordSize == 0 ||
+        vertex->count > size_t(std::numeric_limits<int>::max()))
+        return false;
+    auto list = std::find_if(
+        face->properties.begin(), face->properties.end(),
+        [](const PLYProperty &p) {
+            return p.isList && p.name == "vertex_indices";
+        });
+    if (list == face->properties.end()) return false;
+
+    p->resize(vertex->count);
+    if (!ReadPLYVertexProperties(*vertex, vertexData, vertex->count,
+                                 {"x", "y", "z"}, &(*p)[0].x))
+        return false;
+    n->resize(vertex->count);
+    if (!ReadPLYVertexProperties(*vertex, vertexData, vertex->count,
+                                 {"nx", "ny", "nz"}, &(*n)[0].x))
+        n->clear();
+    // Same UV coordinate names as the RPly path
+    uv->resize(vertex->count);
+    if (!ReadPLYVertexProperties(*vertex, vertexData, vertex->count,
+                                 {"u", "v"}, &(*uv)[0].x) &&
+        !ReadPLYVertexProperties(*vertex, vertexData, vertex->count,
+                                 {"s", "t"}, &(*uv)[0].x) &&
+        !ReadPLYVertexProperties(*vertex, vertexData, vertex->count,
+                                 {"texture_u", "texture_v"}, &(*uv)[0].x) &&
+        !ReadPLYVertexProperties(*vertex, vertexData, vertex->count,
+                                 {"texture_s", "texture_t"}, &(*uv)[0].x))
+        uv->clear();
+
+    if (!ReadPLYFaces(*face, *list, faceData, ply.end, vertex->count,
+                      indices)) {
+        Error("Unable to read the contents of PLY file \"%s\"",
+              filename.c_str());
+        *error = true;
+    }
+    return true;
+}
+
+// Computes the bounds of a binary little-endian PLY file's vertices.
+// Returns false if the file needs to be read with RPly instead.
+static bool ReadBinaryPLYBounds(const std::string &filename,
+                                Bounds3f *bounds) {
+    BinaryPLY ply;
+    if (!OpenBinaryPLY(filename, &ply)) return false;
+    const char *vertexData;
+    const PLYElement *vertex = ply.Element("vertex", &vertexData);
+    if (!vertex || vertex->recordSize == 0) return false;
+    // Convert the positions in batches that stay in the cache
+    PBRT_CONSTEXPR size_t batchSize = 1024;
+    Point3f p[batchSize];
+    Bounds3f b;
+    for (size_t first = 0; first < vertex->count; first += batchSize) {
+        size_t n = std::min(batchSize, vertex->count - first);
+        if (!ReadPLYVertexProperties(
+                *vertex, vertexData + first * vertex->recordSize, n,
+                {"x", "y", "z"}, &p[0].x))
+            return false;
+        for (size_t i = 0; i < n; ++i) b = Union(b, p[i]);
+    }
+    *bounds = b;
+    return true;
+}
+
+/* Callback that grows the bounds by each vertex position without storing
+ * it; RPly reports all properties of a vertex before the next one */
+int rply_bounds_callback(p_ply_argument argument) {
+    BoundsContext *context;
+    long offset;
+    ply_get_argument_user_data(argument, (void **)&context, &offset);
+    context->p[offset] = (Float)ply_get_argument_value(argument);
+    if (++context->nComponents == 3) {
+        context->bounds = Union(context->bounds, context->p);
+        context->nComponents = 0;
+    }
+    return 1;
+}
+
+bool ReadPLYBounds(const std::string &filename, Bounds3f *bounds) {
+    if (ReadBinaryPLYBounds(filename, bounds)) return true;
+    p_ply ply = ply_open(filename.c_str(), rply_message_callback, 0, nullptr);
+    if (!ply) {
+        Error("Couldn't open PLY file \"%s\"", filename.c_str());
+        return false;
+    }
+    BoundsContext context;
+    if (!ply_read_header(ply) ||
+        !ply_set_read_cb(ply, "vertex", "x", rply_bounds_callback, &context,
+                         0) ||
+        !ply_set_read_cb(ply, "vertex", "y", rply_bounds_callback, &context,
+                         1) ||
+        !ply_set_read_cb(ply, "vertex", "z", rply_bounds_callback, &context,
+                         2) ||
+        !ply_read(ply)) {
+        Error("Unable to read the vertex positions of PLY file \"%s\"",
+              filename.c_str());
+        ply_close(ply);
+        return false;
+    }
+    ply_close(ply);
+    *bounds = context.bounds;
+    return true;
+}
+
+std::vector<std::shared_ptr<Shape>> ReadPLYMesh(
+    const std::string &filename, const Transform *o2w, const Transform *w2o,
+    bool reverseOrientation,
+    const std::shared_ptr<Texture<Float>> &alphaTex,
+    const std::shared_ptr<Texture<Float>> &shadowAlphaTex,
+    size_t *meshBytes) {
+    std::vector<Point3f> p;
+    std::vector<Normal3f> n;
+    std::vector<Point2f> uv;
+    std::vector<int> indices;
+    bool error = false;
+    if (ReadBinaryPLYMesh(filename, &p, &n, &uv, &indices, &error)) {
+        if (error) return std::vector<std::shared_ptr<Shape>>();
+        return CreatePLYTriangles(o2w, w2o, reverseOrientation, indices.size(),
+                                  indices.data(), p.size(), p.data(),
+                                  n.empty() ? nullptr : n.data(),
+                                  uv.empty() ? nullptr : uv.data(), alphaTex,
+                                  shadowAlphaTex, meshBytes);
+    }
+
     p_ply ply = ply_open(filename.c_str(), rply_message_callback, 0, nullptr);
     if (!ply) {
         Error("Couldn't open PLY file \"%s\"", filename.c_str());
@@ -235,36 +736,51 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
 
     if (context.error) return std::vector<std::shared_ptr<Shape>>();
 
+    return CreatePLYTriangles(o2w, w2o, reverseOrientation, context.indexCtr,
+                              context.indices, vertexCount, context.p,
+                              context.n, context.uv, alphaTex, shadowAlphaTex,
+                              meshBytes);
+}
+
+void FindPLYAlphaTextures(
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    std::shared_ptr<Texture<Float>> *alphaTex,
+    std::shared_ptr<Texture<Float>> *shadowAlphaTex) {
     // Look up an alpha texture, if applicable
-    std::shared_ptr<Texture<Float>> alphaTex;
     std::string alphaTexName = params.FindTexture("alpha");
     if (alphaTexName != "") {
         if (floatTextures->find(alphaTexName) != floatTextures->end())
-            alphaTex = (*floatTextures)[alphaTexName];
+            *alphaTex = (*floatTextures)[alphaTexName];
         else
             Error("Couldn't find float texture \"%s\" for \"alpha\" parameter",
                   alphaTexName.c_str());
     } else if (params.FindOneFloat("alpha", 1.f) == 0.f) {
-        alphaTex.reset(new ConstantTexture<Float>(0.f));
+        alphaTex->reset(new ConstantTexture<Float>(0.f));
     }
 
-    std::shared_ptr<Texture<Float>> shadowAlphaTex;
     std::string shadowAlphaTexName = params.FindTexture("shadowalpha");
     if (shadowAlphaTexName != "") {
         if (floatTextures->find(shadowAlphaTexName) != floatTextures->end())
-            shadowAlphaTex = (*floatTextures)[shadowAlphaTexName];
+            *shadowAlphaTex = (*floatTextures)[shadowAlphaTexName];
         else
             Error(
                 "Couldn't find float texture \"%s\" for \"shadowalpha\" "
                 "parameter",
                 shadowAlphaTexName.c_str());
     } else if (params.FindOneFloat("shadowalpha", 1.f) == 0.f)
-        shadowAlphaTex.reset(new ConstantTexture<Float>(0.f));
+        shadowAlphaTex->reset(new ConstantTexture<Float>(0.f));
+}
 
-    return CreateTriangleMesh(o2w, w2o, reverseOrientation,
-                              context.indexCtr / 3, context.indices,
-                              vertexCount, context.p, nullptr, context.n,
-                              context.uv, alphaTex, shadowAlphaTex);
+std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures) {
+    const std::string filename = params.FindOneFilename("filename", "");
+    std::shared_ptr<Texture<Float>> alphaTex, shadowAlphaTex;
+    FindPLYAlphaTextures(params, floatTextures, &alphaTex, &shadowAlphaTex);
+    return ReadPLYMesh(filename, o2w, w2o, reverseOrientation, alphaTex,
+                       shadowAlphaTex);
 }
 
 }  // namespace pbrt
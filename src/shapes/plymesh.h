@@ -49,6 +49,26 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
     std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures =
         nullptr);
 
+// Reads the triangles of the given PLY file.  If _meshBytes_ is non-null, it
+// is set to the size of the mesh's vertex and index data.
+std::vector<std::shared_ptr<Shape>> ReadPLYMesh(
+    const std::string &filename, const Transform *o2w, const Transform *w2o,
+    bool reverseOrientation,
+    const std::shared_ptr<Texture<Float>> &alphaTex,
+    const std::shared_ptr<Texture<Float>> &shadowAlphaTex,
+    size_t *meshBytes = nullptr);
+
+// Looks up the "alpha" and "shadowalpha" textures of a "plymesh" shape.
+void FindPLYAlphaTextures(
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    std::shared_ptr<Texture<Float>> *alphaTex,
+    std::shared_ptr<Texture<Float>> *shadowAlphaTex);
+
+// Computes the object space bounds of the PLY file's vertices in a single
+// pass that doesn't keep them in memory.
+bool ReadPLYBounds(const std::string &filename, Bounds3f *bounds);
+
 }  // namespace pbrt
 
 #endif  // PBRT_SHAPES_PLYMESH_H
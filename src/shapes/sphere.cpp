@@ -318,10 +318,14 @@ std::shared_ptr<Shape> CreateSphereShape(const Transform *o2w,
                                          const Transform *w2o,
                                          bool reverseOrientation,
                                          const ParamSet &params) {
-    Float radius = params.FindOneFloat("radius", 1.f);
-    Float zmin = params.FindOneFloat("zmin", -radius);
-    Float zmax = params.FindOneFloat("zmax", radius);
-    Float phimax = params.FindOneFloat("phimax", 360.f);
+    static const ParamSymbol *const radiusName = ParamSymbol::Intern("radius");
+    static const ParamSymbol *const zminName = ParamSymbol::Intern("zmin");
+    static const ParamSymbol *const zmaxName = ParamSymbol::Intern("zmax");
+    static const ParamSymbol *const phimaxName = ParamSymbol::Intern("phimax");
+    Float radius = params.FindOneFloat(radiusName, 1.f);
+    Float zmin = params.FindOneFloat(zminName, -radius);
+    Float zmax = params.FindOneFloat(zmaxName, radius);
+    Float phimax = params.FindOneFloat(phimaxName, 360.f);
     return std::make_shared<Sphere>(o2w, w2o, reverseOrientation, radius, zmin,
                                     zmax, phimax);
 }
@@ -179,7 +179,43 @@ Bounds3f Triangle::WorldBound() const {
     return Union(Bounds3f(p0, p1), p2);
 }
 
-bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
+Bounds3f Triangle::ClippedWorldBound(const Bounds3f &clip) const {
+    // Clip the triangle polygon against the six planes of _clip_; each
+    // plane adds at most one vertex
+    Point3f poly[9], clipped[9];
+    poly[0] = mesh->p[v[0]];
+    poly[1] = mesh->p[v[1]];
+    poly[2] = mesh->p[v[2]];
+    int nVertices = 3;
+    for (int axis = 0; axis < 3; ++axis)
+        for (int side = 0; side < 2 && nVertices > 0; ++side) {
+            Float plane = side == 0 ? clip.pMin[axis] : clip.pMax[axis];
+            auto inside = [&](const Point3f &p) {
+                return side == 0 ? p[axis] >= plane : p[axis] <= plane;
+            };
+            int nClipped = 0;
+            for (int i = 0; i < nVertices; ++i) {
+                const Point3f &a = poly[i], &b = poly[(i + 1) % nVertices];
+                if (inside(a)) clipped[nClipped++] = a;
+                if (inside(a) != inside(b)) {
+                    Point3f p = Lerp((plane - a[axis]) / (b[axis] - a[axis]),
+                                     a, b);
+                    p[axis] = plane;
+                    clipped[nClipped++] = p;
+                }
+            }
+            for (int i = 0; i < nClipped; ++i) poly[i] = clipped[i];
+            nVertices = nClipped;
+        }
+
+    // Bound the clipped polygon, guarding against round-off outside _clip_
+    Bounds3f bounds;
+    for (int i = 0; i < nVertices; ++i) bounds = Union(bounds, poly[i]);
+    return pbrt::Intersect(bounds, clip);
+}
+
+bool Triangle::intersect(const int *v, int faceIndex, const Ray &ray,
+                         Float *tHit, SurfaceInteraction *isect,
                          bool testAlphaTexture) const {
     ProfilePhase p(Prof::TriIntersect);
     ++nTests;
@@ -287,7 +323,7 @@ bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
     // Compute triangle partial derivatives
     Vector3f dpdu, dpdv;
     Point2f uv[3];
-    GetUVs(uv);
+    GetUVs(v, uv);
 
     // Compute deltas for triangle partial derivatives
     Vector2f duv02 = uv[0] - uv[2], duv12 = uv[1] - uv[2];
@@ -396,7 +432,8 @@ bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
     return true;
 }
 
-bool Triangle::IntersectP(const Ray &ray, bool testAlphaTexture) const {
+bool Triangle::intersectP(const int *v, const Ray &ray,
+                          bool testAlphaTexture) const {
     ProfilePhase p(Prof::TriIntersectP);
     ++nTests;
     // Get triangle vertices in _p0_, _p1_, and _p2_
@@ -505,7 +542,7 @@ bool Triangle::IntersectP(const Ray &ray, bool testAlphaTexture) const {
         // Compute triangle partial derivatives
         Vector3f dpdu, dpdv;
         Point2f uv[3];
-        GetUVs(uv);
+        GetUVs(v, uv);
 
         // Compute deltas for triangle partial derivatives
         Vector2f duv02 = uv[0] - uv[2], duv12 = uv[1] - uv[2];
@@ -614,15 +651,27 @@ std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     const ParamSet &params,
     std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures) {
+    static const ParamSymbol *const indicesName =
+        ParamSymbol::Intern("indices");
+    static const ParamSymbol *const PName = ParamSymbol::Intern("P");
+    static const ParamSymbol *const uvName = ParamSymbol::Intern("uv");
+    static const ParamSymbol *const stName = ParamSymbol::Intern("st");
+    static const ParamSymbol *const SName = ParamSymbol::Intern("S");
+    static const ParamSymbol *const NName = ParamSymbol::Intern("N");
+    static const ParamSymbol *const faceIndicesName =
+        ParamSymbol::Intern("faceIndices");
+    static const ParamSymbol *const alphaName = ParamSymbol::Intern("alpha");
+    static const ParamSymbol *const shadowalphaName =
+        ParamSymbol::Intern("shadowalpha");
     int nvi, npi, nuvi, nsi, nni;
-    const int *vi = params.FindInt("indices", &nvi);
-    const Point3f *P = params.FindPoint3f("P", &npi);
-    const Point2f *uvs = params.FindPoint2f("uv", &nuvi);
-    if (!uvs) uvs = params.FindPoint2f("st", &nuvi);
+    const int *vi = params.FindInt(indicesName, &nvi);
+    const Point3f *P = params.FindPoint3f(PName, &npi);
+    const Point2f *uvs = params.FindPoint2f(uvName, &nuvi);
+    if (!uvs) uvs = params.FindPoint2f(stName, &nuvi);
     std::vector<Point2f> tempUVs;
     if (!uvs) {
-        const Float *fuv = params.FindFloat("uv", &nuvi);
-        if (!fuv) fuv = params.FindFloat("st", &nuvi);
+        const Float *fuv = params.FindFloat(uvName, &nuvi);
+        if (!fuv) fuv = params.FindFloat(stName, &nuvi);
         if (fuv) {
             nuvi /= 2;
             tempUVs.reserve(nuvi);
@@ -653,12 +702,12 @@ std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
         Error("Vertex positions \"P\" not provided with triangle mesh shape");
         return std::vector<std::shared_ptr<Shape>>();
     }
-    const Vector3f *S = params.FindVector3f("S", &nsi);
+    const Vector3f *S = params.FindVector3f(SName, &nsi);
     if (S && nsi != npi) {
         Error("Number of \"S\"s for triangle mesh must match \"P\"s");
         S = nullptr;
     }
-    const Normal3f *N = params.FindNormal3f("N", &nni);
+    const Normal3f *N = params.FindNormal3f(NName, &nni);
     if (N && nni != npi) {
         Error("Number of \"N\"s for triangle mesh must match \"P\"s");
         N = nullptr;
@@ -673,7 +722,7 @@ std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
         }
 
     int nfi;
-    const int *faceIndices = params.FindInt("faceIndices", &nfi);
+    const int *faceIndices = params.FindInt(faceIndicesName, &nfi);
     if (faceIndices && nfi != nvi / 3) {
         Error("Number of face indices, %d, doesn't match number of faces, %d",
               nfi, nvi / 3);
@@ -681,18 +730,18 @@ std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
     }
 
     std::shared_ptr<Texture<Float>> alphaTex;
-    std::string alphaTexName = params.FindTexture("alpha");
+    std::string alphaTexName = params.FindTexture(alphaName);
     if (alphaTexName != "") {
         if (floatTextures->find(alphaTexName) != floatTextures->end())
             alphaTex = (*floatTextures)[alphaTexName];
         else
             Error("Couldn't find float texture \"%s\" for \"alpha\" parameter",
                   alphaTexName.c_str());
-    } else if (params.FindOneFloat("alpha", 1.f) == 0.f)
+    } else if (params.FindOneFloat(alphaName, 1.f) == 0.f)
         alphaTex.reset(new ConstantTexture<Float>(0.f));
 
     std::shared_ptr<Texture<Float>> shadowAlphaTex;
-    std::string shadowAlphaTexName = params.FindTexture("shadowalpha");
+    std::string shadowAlphaTexName = params.FindTexture(shadowalphaName);
     if (shadowAlphaTexName != "") {
         if (floatTextures->find(shadowAlphaTexName) != floatTextures->end())
             shadowAlphaTex = (*floatTextures)[shadowAlphaTexName];
@@ -701,7 +750,7 @@ std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
                 "Couldn't find float texture \"%s\" for \"shadowalpha\" "
                 "parameter",
                 shadowAlphaTexName.c_str());
-    } else if (params.FindOneFloat("shadowalpha", 1.f) == 0.f)
+    } else if (params.FindOneFloat(shadowalphaName, 1.f) == 0.f)
         shadowAlphaTex.reset(new ConstantTexture<Float>(0.f));
 
     return CreateTriangleMesh(o2w, w2o, reverseOrientation, nvi / 3, vi, npi, P,
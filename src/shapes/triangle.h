@@ -81,9 +81,39 @@ class Triangle : public Shape {
     }
     Bounds3f ObjectBound() const;
     Bounds3f WorldBound() const;
+    Bounds3f ClippedWorldBound(const Bounds3f &clip) const;
+    bool GetTriangleVertices(Point3f p[3]) const {
+        p[0] = mesh->p[v[0]];
+        p[1] = mesh->p[v[1]];
+        p[2] = mesh->p[v[2]];
+        return true;
+    }
     bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
-                   bool testAlphaTexture = true) const;
-    bool IntersectP(const Ray &ray, bool testAlphaTexture = true) const;
+                   bool testAlphaTexture = true) const {
+        return intersect(v, faceIndex, ray, tHit, isect, testAlphaTexture);
+    }
+    bool IntersectP(const Ray &ray, bool testAlphaTexture = true) const {
+        return intersectP(v, ray, testAlphaTexture);
+    }
+    // Versions of _Intersect()_ and _IntersectP()_ for the _triNumber_th
+    // triangle of this triangle's mesh, for aggregates that store a mesh's
+    // triangles as indices; interactions refer to this triangle as their
+    // shape, so it must share the other triangle's orientation
+    bool IntersectMeshTriangle(int triNumber, const Ray &ray, Float *tHit,
+                               SurfaceInteraction *isect,
+                               bool testAlphaTexture = true) const {
+        return intersect(&mesh->vertexIndices[3 * triNumber],
+                         mesh->faceIndices.size() ? mesh->faceIndices[triNumber]
+                                                  : 0,
+                         ray, tHit, isect, testAlphaTexture);
+    }
+    bool IntersectPMeshTriangle(int triNumber, const Ray &ray,
+                                bool testAlphaTexture = true) const {
+        return intersectP(&mesh->vertexIndices[3 * triNumber], ray,
+                          testAlphaTexture);
+    }
+    const TriangleMesh *GetMesh() const { return mesh.get(); }
+    int GetTriangleNumber() const { return (v - &mesh->vertexIndices[0]) / 3; }
     Float Area() const;
 
     using Shape::Sample;  // Bring in the other Sample() overload.
@@ -95,7 +125,11 @@ class Triangle : public Shape {
 
   private:
     // Triangle Private Methods
-    void GetUVs(Point2f uv[3]) const {
+    bool intersect(const int *v, int faceIndex, const Ray &ray, Float *tHit,
+                   SurfaceInteraction *isect, bool testAlphaTexture) const;
+    bool intersectP(const int *v, const Ray &ray,
+                    bool testAlphaTexture) const;
+    void GetUVs(const int *v, Point2f uv[3]) const {
         if (mesh->uv) {
             uv[0] = mesh->uv[v[0]];
             uv[1] = mesh->uv[v[1]];
@@ -0,0 +1,679 @@
+
+#include "tests/gtest/gtest.h"
+#include "tests/testutil.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "parallel.h"
+#include "primitive.h"
+#include "sampling.h"
+#include "accelerators/accelcache.h"
+#include "accelerators/bvh.h"
+#include "accelerators/kdtreeaccel.h"
+#include "accelerators/pagedmesh.h"
+#include "materials/matte.h"
+#include "paramset.h"
+#include "shapes/plymesh.h"
+#include "shapes/sphere.h"
+#include "shapes/triangle.h"
+#include "textures/constant.h"
+#ifndef PBRT_IS_WINDOWS
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace pbrt;
+
+// Random triangle soup inside [-1,1]^3; sliver triangles span the whole
+// volume diagonally.
+static std::vector<std::shared_ptr<Primitive>> RandomTriangles(
+    RNG &rng, int nTris, bool slivers = false) {
+    static Transform identity;
+    std::vector<Point3f> p;
+    std::vector<int> indices;
+    for (int i = 0; i < nTris; ++i) {
+        Point3f c(Lerp(rng.UniformFloat(), -1, 1),
+                  Lerp(rng.UniformFloat(), -1, 1),
+                  Lerp(rng.UniformFloat(), -1, 1));
+        Float size = Lerp(rng.UniformFloat(), .01, .2);
+        for (int v = 0; v < 3; ++v) {
+            Vector3f d(rng.UniformFloat() - .5f, rng.UniformFloat() - .5f,
+                       rng.UniformFloat() - .5f);
+            indices.push_back(p.size());
+            if (slivers && v == 2)
+                p.push_back(Point3f(-c.x, -c.y, -c.z) + size * d);
+            else
+                p.push_back(c + size * d);
+        }
+    }
+    std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+        &identity, &identity, false, nTris, &indices[0], p.size(), &p[0],
+        nullptr, nullptr, nullptr, nullptr, nullptr);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const auto &t : tris)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            t, nullptr, nullptr, MediumInterface()));
+    return prims;
+}
+
+TEST(BVH, WideMatchesBinary) {
+    ScopedThreads threads(1);
+    RNG rng;
+    std::vector<std::shared_ptr<Primitive>> prims = RandomTriangles(rng, 5000);
+
+    for (BVHAccel::SplitMethod sm :
+         {BVHAccel::SplitMethod::SAH, BVHAccel::SplitMethod::HLBVH,
+          BVHAccel::SplitMethod::Middle, BVHAccel::SplitMethod::EqualCounts}) {
+        BVHAccel bvh2(prims, 4, sm, 2);
+        BVHAccel bvh4(prims, 4, sm, 4);
+        BVHAccel bvh8(prims, 4, sm, 8);
+        EXPECT_EQ(bvh2.WorldBound(), bvh4.WorldBound());
+        EXPECT_EQ(bvh2.WorldBound(), bvh8.WorldBound());
+
+        for (int i = 0; i < 10000; ++i) {
+            // Rays from a sphere around the scene towards points inside it
+            Point2f u(rng.UniformFloat(), rng.UniformFloat());
+            Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+            Point3f target(Lerp(rng.UniformFloat(), -1.2, 1.2),
+                           Lerp(rng.UniformFloat(), -1.2, 1.2),
+                           Lerp(rng.UniformFloat(), -1.2, 1.2));
+            Ray r2(o, target - o), r4 = r2, r8 = r2;
+
+            SurfaceInteraction isect2, isect4, isect8;
+            bool hit2 = bvh2.Intersect(r2, &isect2);
+            EXPECT_EQ(hit2, bvh4.Intersect(r4, &isect4));
+            EXPECT_EQ(hit2, bvh8.Intersect(r8, &isect8));
+            if (hit2) {
+                EXPECT_EQ(r2.tMax, r4.tMax);
+                EXPECT_EQ(r2.tMax, r8.tMax);
+            }
+
+            Ray s(o, target - o);
+            EXPECT_EQ(hit2, bvh4.IntersectP(s));
+            EXPECT_EQ(hit2, bvh8.IntersectP(s));
+        }
+    }
+}
+
+TEST(BVH, ParallelBuildMatchesSerial) {
+    RNG rng;
+    // Enough primitives that the top nodes are binned and partitioned in
+    // parallel as well.
+    std::vector<std::shared_ptr<Primitive>> prims =
+        RandomTriangles(rng, 150000);
+    std::unique_ptr<BVHAccel> serial, parallel;
+    {
+        ScopedThreads threads(1);
+        serial.reset(new BVHAccel(prims, 4, BVHAccel::SplitMethod::SAH));
+    }
+    {
+        ScopedThreads threads(4);
+        parallel.reset(new BVHAccel(prims, 4, BVHAccel::SplitMethod::SAH));
+    }
+
+    EXPECT_EQ(serial->WorldBound(), parallel->WorldBound());
+    for (int i = 0; i < 10000; ++i) {
+        Point2f u(rng.UniformFloat(), rng.UniformFloat());
+        Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+        Point3f target(Lerp(rng.UniformFloat(), -1.2, 1.2),
+                       Lerp(rng.UniformFloat(), -1.2, 1.2),
+                       Lerp(rng.UniformFloat(), -1.2, 1.2));
+        Ray rs(o, target - o), rp = rs;
+
+        SurfaceInteraction isects, isectp;
+        bool hit = serial->Intersect(rs, &isects);
+        EXPECT_EQ(hit, parallel->Intersect(rp, &isectp));
+        if (hit) EXPECT_EQ(rs.tMax, rp.tMax);
+    }
+}
+
+TEST(BVH, SpatialSplitsMatchSAH) {
+    RNG rng;
+    std::vector<std::shared_ptr<Primitive>> prims =
+        RandomTriangles(rng, 2000, true);
+    BVHAccel sah(prims, 4, BVHAccel::SplitMethod::SAH);
+    BVHAccel sbvh(prims, 4, BVHAccel::SplitMethod::SBVH);
+    BVHAccel sbvh8(prims, 4, BVHAccel::SplitMethod::SBVH, 8);
+
+    for (int i = 0; i < 10000; ++i) {
+        Point2f u(rng.UniformFloat(), rng.UniformFloat());
+        Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+        Point3f target(Lerp(rng.UniformFloat(), -1.2, 1.2),
+                       Lerp(rng.UniformFloat(), -1.2, 1.2),
+                       Lerp(rng.UniformFloat(), -1.2, 1.2));
+        Ray r(o, target - o), rs = r, rs8 = r;
+
+        SurfaceInteraction isect, isects, isects8;
+        bool hit = sah.Intersect(r, &isect);
+        EXPECT_EQ(hit, sbvh.Intersect(rs, &isects));
+        EXPECT_EQ(hit, sbvh8.Intersect(rs8, &isects8));
+        if (hit) {
+            EXPECT_EQ(r.tMax, rs.tMax);
+            EXPECT_EQ(r.tMax, rs8.tMax);
+        }
+        Ray s(o, target - o);
+        EXPECT_EQ(hit, sbvh.IntersectP(s));
+    }
+}
+
+TEST(BVH, TriangleBlocksMatchPrimitives) {
+    // A bumpy grid mesh, whose shared edges and vertices exercise the
+    // watertightness of the packed triangle tests
+    static Transform identity;
+    const int res = 40;
+    RNG rng;
+    std::vector<Point3f> p;
+    for (int y = 0; y <= res; ++y)
+        for (int x = 0; x <= res; ++x)
+            p.push_back(Point3f(Lerp(Float(x) / res, -1, 1),
+                                Lerp(Float(y) / res, -1, 1),
+                                .1f * rng.UniformFloat()));
+    std::vector<int> indices;
+    for (int y = 0; y < res; ++y)
+        for (int x = 0; x < res; ++x) {
+            int v = y * (res + 1) + x;
+            for (int i : {v, v + 1, v + res + 2, v, v + res + 2, v + res + 1})
+                indices.push_back(i);
+        }
+    std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+        &identity, &identity, false, indices.size() / 3, &indices[0],
+        p.size(), &p[0], nullptr, nullptr, nullptr, nullptr, nullptr);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const auto &t : tris)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            t, nullptr, nullptr, MediumInterface()));
+
+    for (int width : {2, 4}) {
+        BVHAccel bvh(prims, 4, BVHAccel::SplitMethod::SAH, width);
+        for (int i = 0; i < 2000; ++i) {
+            // Aim at vertices, edge midpoints and random points
+            Point3f target;
+            int v = std::min<int>(rng.UniformFloat() * p.size(), p.size() - 1);
+            int w = std::min<int>(rng.UniformFloat() * p.size(), p.size() - 1);
+            if (i % 3 == 0)
+                target = p[v];
+            else if (i % 3 == 1)
+                target = .5f * (p[indices[3 * (v % (indices.size() / 3))]] +
+                                p[indices[3 * (v % (indices.size() / 3)) + 1]]);
+            else
+                target = Lerp(rng.UniformFloat(), p[v], p[w]);
+            Point2f u(rng.UniformFloat(), rng.UniformFloat());
+            Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+            Ray r(o, target - o), rb = r;
+
+            bool hit = false;
+            for (const std::shared_ptr<Primitive> &prim : prims) {
+                SurfaceInteraction isect;
+                if (prim->Intersect(r, &isect)) hit = true;
+            }
+            SurfaceInteraction isect;
+            EXPECT_EQ(hit, bvh.Intersect(rb, &isect));
+            // Neighboring triangles may report hits at a shared edge that
+            // differ in the last bit, so which one wins depends on the order
+            // they are tested in
+            if (hit) EXPECT_LE(std::abs(r.tMax - rb.tMax), 1e-6f * r.tMax);
+            EXPECT_EQ(hit, bvh.IntersectP(Ray(o, target - o)));
+        }
+    }
+}
+
+TEST(BVH, TriangleBlocksReplacePrimitives) {
+    // Triangles of two meshes with alternating materials, and a sphere whose
+    // leaf keeps its triangles' primitives
+    static Transform identity;
+    RNG rng;
+    std::shared_ptr<Texture<Float>> sigma =
+        std::make_shared<ConstantTexture<Float>>(0.f);
+    std::shared_ptr<Material> materials[2];
+    for (int m = 0; m < 2; ++m)
+        materials[m] = std::make_shared<MatteMaterial>(
+            std::make_shared<ConstantTexture<Spectrum>>(Spectrum(.25f * m)),
+            sigma, nullptr);
+    const int nTris = 1000;
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (int mesh = 0; mesh < 2; ++mesh) {
+        std::vector<Point3f> p;
+        std::vector<int> indices;
+        std::vector<Point2f> uv;
+        for (int i = 0; i < nTris; ++i) {
+            Point3f c(Lerp(rng.UniformFloat(), -1, 1),
+                      Lerp(rng.UniformFloat(), -1, 1),
+                      Lerp(rng.UniformFloat(), -1, 1));
+            for (int v = 0; v < 3; ++v) {
+                Vector3f d(rng.UniformFloat() - .5f, rng.UniformFloat() - .5f,
+                           rng.UniformFloat() - .5f);
+                indices.push_back(p.size());
+                p.push_back(c + .2f * d);
+                uv.push_back(Point2f(rng.UniformFloat(), rng.UniformFloat()));
+            }
+        }
+        std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+            &identity, &identity, mesh == 1, nTris, &indices[0], p.size(),
+            &p[0], nullptr, nullptr, &uv[0], nullptr, nullptr);
+        for (size_t i = 0; i < tris.size(); ++i)
+            prims.push_back(std::make_shared<GeometricPrimitive>(
+                tris[i], materials[i % 2], nullptr, MediumInterface()));
+    }
+    prims.push_back(std::make_shared<GeometricPrimitive>(
+        std::make_shared<Sphere>(&identity, &identity, false, .1f, -.1f, .1f,
+                                 360.f),
+        materials[0], nullptr, MediumInterface()));
+
+    // Find the closest hits of random rays among the primitives
+    struct Hit {
+        Ray ray;
+        bool hit;
+        SurfaceInteraction isect;
+        const Material *material;
+    };
+    std::vector<Hit> hits(2000);
+    for (Hit &h : hits) {
+        Point2f u(rng.UniformFloat(), rng.UniformFloat());
+        Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+        Point3f target(Lerp(rng.UniformFloat(), -.5, .5),
+                       Lerp(rng.UniformFloat(), -.5, .5),
+                       Lerp(rng.UniformFloat(), -.5, .5));
+        h.ray = Ray(o, target - o);
+        h.hit = false;
+        Ray r = h.ray;
+        for (const std::shared_ptr<Primitive> &prim : prims)
+            if (prim->Intersect(r, &h.isect)) h.hit = true;
+        h.ray.tMax = r.tMax;
+        h.material = h.hit ? h.isect.primitive->GetMaterial() : nullptr;
+    }
+
+    // The BVHs hold the only references to the primitives they keep
+    std::vector<std::weak_ptr<Primitive>> weakPrims(prims.begin(),
+                                                    prims.end());
+    BVHAccel binary(prims, 4), wide(prims, 4, BVHAccel::SplitMethod::SAH, 4);
+    prims.clear();
+    size_t nAlive = std::count_if(
+        weakPrims.begin(), weakPrims.end(),
+        [](const std::weak_ptr<Primitive> &p) { return !p.expired(); });
+    EXPECT_LE(nAlive, binary.NumPrimitives() + wide.NumPrimitives());
+    EXPECT_LT(nAlive, weakPrims.size() / 20);
+    EXPECT_FALSE(weakPrims.back().expired());
+
+    for (const BVHAccel *bvh : {&binary, &wide})
+        for (const Hit &h : hits) {
+            Ray r(h.ray.o, h.ray.d);
+            SurfaceInteraction isect;
+            ASSERT_EQ(h.hit, bvh->Intersect(r, &isect));
+            EXPECT_EQ(h.hit, bvh->IntersectP(Ray(h.ray.o, h.ray.d)));
+            if (!h.hit) continue;
+            EXPECT_EQ(h.ray.tMax, r.tMax);
+            EXPECT_EQ(h.isect.p, isect.p);
+            EXPECT_EQ(h.isect.n, isect.n);
+            EXPECT_EQ(h.isect.shading.n, isect.shading.n);
+            EXPECT_EQ(h.isect.uv, isect.uv);
+            EXPECT_EQ(h.material, isect.primitive->GetMaterial());
+        }
+}
+
+TEST(BVH, RefitMatchesRebuild) {
+    RNG rng;
+    std::shared_ptr<Primitive> object =
+        std::make_shared<BVHAccel>(RandomTriangles(rng, 200), 4);
+
+    // Instances of _object_ scattered over [-10,10]^3, moved a little and
+    // then shuffled completely
+    const int nInstances = 300;
+    std::vector<Transform> transforms;
+    transforms.reserve(3 * nInstances);
+    std::vector<std::vector<std::shared_ptr<Primitive>>> frames(3);
+    for (int frame = 0; frame < 3; ++frame)
+        for (int i = 0; i < nInstances; ++i) {
+            Vector3f offset(Lerp(rng.UniformFloat(), -10, 10),
+                            Lerp(rng.UniformFloat(), -10, 10),
+                            Lerp(rng.UniformFloat(), -10, 10));
+            if (frame == 1)
+                offset = Vector3f(transforms[i](Point3f(0, 0, 0))) +
+                         .05f * offset;
+            transforms.push_back(Translate(offset));
+            AnimatedTransform instanceToWorld(&transforms.back(), 0,
+                                              &transforms.back(), 1);
+            frames[frame].push_back(
+                std::make_shared<TransformedPrimitive>(object, instanceToWorld));
+        }
+
+    for (int width : {2, 8}) {
+        std::shared_ptr<BVHAccel> bvh = std::make_shared<BVHAccel>(
+            frames[0], 1, BVHAccel::SplitMethod::SAH, width);
+        for (int frame = 1; frame < 3; ++frame) {
+            std::shared_ptr<BVHAccel> refit =
+                bvh->Refit(frames[frame - 1], frames[frame]);
+            // Small motion keeps the tree usable; shuffling doesn't
+            if (frame == 1) ASSERT_TRUE(refit != nullptr);
+            if (frame == 2) EXPECT_TRUE(refit == nullptr);
+            if (!refit) break;
+            BVHAccel rebuilt(frames[frame], 1, BVHAccel::SplitMethod::SAH,
+                             width);
+            EXPECT_EQ(rebuilt.WorldBound(), refit->WorldBound());
+
+            for (int i = 0; i < 10000; ++i) {
+                Point2f u(rng.UniformFloat(), rng.UniformFloat());
+                Point3f o = Point3f(0, 0, 0) + 30 * UniformSampleSphere(u);
+                Point3f target(Lerp(rng.UniformFloat(), -12, 12),
+                               Lerp(rng.UniformFloat(), -12, 12),
+                               Lerp(rng.UniformFloat(), -12, 12));
+                Ray r(o, target - o), rr = r;
+                SurfaceInteraction isect, isectr;
+                bool hit = rebuilt.Intersect(r, &isect);
+                EXPECT_EQ(hit, refit->Intersect(rr, &isectr));
+                if (hit) EXPECT_EQ(r.tMax, rr.tMax);
+                EXPECT_EQ(hit, refit->IntersectP(Ray(o, target - o)));
+            }
+            bvh = refit;
+        }
+    }
+}
+
+TEST(BVH, PacketsMatchSingleRays) {
+    RNG rng;
+    std::vector<std::shared_ptr<Primitive>> prims = RandomTriangles(rng, 2000);
+    for (int width : {2, 4}) {
+        BVHAccel bvh(prims, 4, BVHAccel::SplitMethod::SAH, width);
+        for (int batch = 0; batch < 200; ++batch) {
+            // Alternate between coherent batches, like the camera rays of a
+            // pixel, and batches of unrelated rays in all directions
+            const int n = 1 + batch % 37;
+            bool coherent = batch % 2 == 0;
+            Point2f u(rng.UniformFloat(), rng.UniformFloat());
+            Point3f eye = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+            std::vector<Ray> rays, single;
+            for (int i = 0; i < n; ++i) {
+                Point3f o = coherent ? eye
+                                     : Point3f(0, 0, 0) +
+                                           3 * UniformSampleSphere(Point2f(
+                                                   rng.UniformFloat(),
+                                                   rng.UniformFloat()));
+                Float spread = coherent ? .3f : 1;
+                Point3f target(spread * Lerp(rng.UniformFloat(), -1, 1),
+                               spread * Lerp(rng.UniformFloat(), -1, 1),
+                               spread * Lerp(rng.UniformFloat(), -1, 1));
+                // Some rays end before reaching the scene's center
+                Float tMax = i % 5 == 0 ? .8f : Infinity;
+                rays.push_back(Ray(o, target - o, tMax));
+            }
+            single = rays;
+
+            std::unique_ptr<SurfaceInteraction[]> isects(
+                new SurfaceInteraction[n]);
+            std::unique_ptr<bool[]> hits(new bool[n]), occluded(new bool[n]);
+            bvh.IntersectPN(&rays[0], occluded.get(), n);
+            bvh.IntersectN(&rays[0], isects.get(), hits.get(), n);
+            for (int i = 0; i < n; ++i) {
+                EXPECT_EQ(bvh.IntersectP(single[i]), occluded[i]);
+                SurfaceInteraction isect;
+                bool hit = bvh.Intersect(single[i], &isect);
+                // Packets visit nodes in the order of a single ray, so the
+                // results are identical
+                EXPECT_EQ(hit, hits[i]);
+                EXPECT_EQ(single[i].tMax, rays[i].tMax);
+                if (hit && hits[i]) {
+                    EXPECT_EQ(isect.primitive, isects[i].primitive);
+                    EXPECT_EQ(isect.p, isects[i].p);
+                }
+            }
+        }
+    }
+}
+
+#ifndef PBRT_IS_WINDOWS
+// Creates an empty directory for accelerator cache files and points
+// _PbrtOptions.accelCacheDir_ at it; removes it again when destroyed.
+class ScopedCacheDir {
+  public:
+    ScopedCacheDir() {
+        char dir[] = "/tmp/pbrt_accelcache_XXXXXX";
+        CHECK(mkdtemp(dir) != nullptr);
+        PbrtOptions.accelCacheDir = dir;
+    }
+    ~ScopedCacheDir() {
+        for (const std::string &f : Files()) remove(f.c_str());
+        rmdir(PbrtOptions.accelCacheDir.c_str());
+        PbrtOptions.accelCacheDir.clear();
+    }
+    std::vector<std::string> Files() const {
+        std::vector<std::string> files;
+        DIR *dir = opendir(PbrtOptions.accelCacheDir.c_str());
+        while (struct dirent *entry = readdir(dir))
+            if (entry->d_name[0] != '.')
+                files.push_back(PbrtOptions.accelCacheDir + "/" +
+                                entry->d_name);
+        closedir(dir);
+        return files;
+    }
+};
+
+static ino_t FileId(const std::string &filename) {
+    struct stat st;
+    EXPECT_EQ(0, stat(filename.c_str(), &st));
+    return st.st_ino;
+}
+
+TEST(KdTree, ParallelBuildAndLayoutsMatchSerial) {
+    RNG rng;
+    // Enough primitives that the edges of the top nodes are sorted and
+    // swept in parallel as well.
+    std::vector<std::shared_ptr<Primitive>> prims =
+        RandomTriangles(rng, 100000);
+    std::unique_ptr<KdTreeAccel> serial, parallel, clustered;
+    {
+        ScopedThreads threads(1);
+        serial.reset(new KdTreeAccel(prims));
+    }
+    {
+        ScopedThreads threads(4);
+        parallel.reset(new KdTreeAccel(prims));
+        clustered.reset(new KdTreeAccel(prims, 80, 1, 0.5, 1, -1,
+                                        KdTreeAccel::Layout::Clustered));
+    }
+
+    EXPECT_EQ(serial->WorldBound(), parallel->WorldBound());
+    EXPECT_EQ(serial->WorldBound(), clustered->WorldBound());
+    for (int i = 0; i < 10000; ++i) {
+        Point2f u(rng.UniformFloat(), rng.UniformFloat());
+        Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+        Point3f target(Lerp(rng.UniformFloat(), -1.2, 1.2),
+                       Lerp(rng.UniformFloat(), -1.2, 1.2),
+                       Lerp(rng.UniformFloat(), -1.2, 1.2));
+        Ray rs(o, target - o), rp = rs, rc = rs;
+
+        SurfaceInteraction isects, isectp, isectc;
+        bool hit = serial->Intersect(rs, &isects);
+        EXPECT_EQ(hit, parallel->Intersect(rp, &isectp));
+        EXPECT_EQ(hit, clustered->Intersect(rc, &isectc));
+        if (hit) {
+            EXPECT_EQ(rs.tMax, rp.tMax);
+            EXPECT_EQ(rs.tMax, rc.tMax);
+        }
+        Ray s(o, target - o);
+        EXPECT_EQ(hit, clustered->IntersectP(s));
+    }
+}
+
+TEST(AccelCache, RoundTrip) {
+    ScopedCacheDir cacheDir;
+    std::vector<int> a = {1, 2, 3, 4, 5};
+    std::vector<double> b(1000);
+    for (size_t i = 0; i < b.size(); ++i) b[i] = std::sqrt(double(i));
+    EXPECT_TRUE(AccelCacheFile::Write(
+        "test", 42, {{a.data(), a.size() * sizeof(int)},
+                     {nullptr, 0},
+                     {b.data(), b.size() * sizeof(double)}}));
+    EXPECT_EQ(1, cacheDir.Files().size());
+
+    std::unique_ptr<AccelCacheFile> file = AccelCacheFile::Open("test", 42);
+    ASSERT_TRUE(file != nullptr);
+    ASSERT_EQ(3, file->NumSections());
+    EXPECT_EQ(a.size() * sizeof(int), file->Section(0).bytes);
+    EXPECT_EQ(0, memcmp(a.data(), file->Section(0).data, file->Section(0).bytes));
+    EXPECT_EQ(0, file->Section(1).bytes);
+    EXPECT_EQ(b.size() * sizeof(double), file->Section(2).bytes);
+    EXPECT_EQ(0, memcmp(b.data(), file->Section(2).data, file->Section(2).bytes));
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(0, (uintptr_t)file->Section(i).data % 64);
+
+    EXPECT_TRUE(AccelCacheFile::Open("test", 43) == nullptr);
+    EXPECT_TRUE(AccelCacheFile::Open("other", 42) == nullptr);
+}
+
+TEST(AccelCache, CachedTreesMatch) {
+    ScopedThreads threads(1);
+    RNG rng;
+    std::vector<std::shared_ptr<Primitive>> prims = RandomTriangles(rng, 5000);
+    std::vector<std::shared_ptr<Aggregate>> reference = {
+        std::make_shared<BVHAccel>(prims, 4, BVHAccel::SplitMethod::SAH),
+        std::make_shared<BVHAccel>(prims, 4, BVHAccel::SplitMethod::SAH, 8),
+        std::make_shared<KdTreeAccel>(prims),
+        std::make_shared<KdTreeAccel>(prims, 80, 1, 0.5, 1, -1,
+                                      KdTreeAccel::Layout::Clustered)};
+
+    ScopedCacheDir cacheDir;
+    auto build = [&](int i) -> std::shared_ptr<Aggregate> {
+        if (i == 0)
+            return std::make_shared<BVHAccel>(prims, 4,
+                                              BVHAccel::SplitMethod::SAH);
+        else if (i == 1)
+            return std::make_shared<BVHAccel>(prims, 4,
+                                              BVHAccel::SplitMethod::SAH, 8);
+        else if (i == 2)
+            return std::make_shared<KdTreeAccel>(prims);
+        return std::make_shared<KdTreeAccel>(prims, 80, 1, 0.5, 1, -1,
+                                             KdTreeAccel::Layout::Clustered);
+    };
+    for (int i = 0; i < 4; ++i) {
+        // The first build writes a cache file; the second one maps it
+        // instead of writing it again
+        build(i);
+        std::vector<std::string> files = cacheDir.Files();
+        ASSERT_EQ(i + 1, files.size());
+        std::vector<ino_t> ids;
+        for (const std::string &f : files) ids.push_back(FileId(f));
+        std::shared_ptr<Aggregate> cached = build(i);
+        for (size_t j = 0; j < files.size(); ++j)
+            EXPECT_EQ(ids[j], FileId(files[j]));
+
+        EXPECT_EQ(reference[i]->WorldBound(), cached->WorldBound());
+        for (int j = 0; j < 10000; ++j) {
+            Point2f u(rng.UniformFloat(), rng.UniformFloat());
+            Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+            Point3f target(Lerp(rng.UniformFloat(), -1.2, 1.2),
+                           Lerp(rng.UniformFloat(), -1.2, 1.2),
+                           Lerp(rng.UniformFloat(), -1.2, 1.2));
+            Ray r(o, target - o), rc = r;
+            SurfaceInteraction isect, isectc;
+            bool hit = reference[i]->Intersect(r, &isect);
+            EXPECT_EQ(hit, cached->Intersect(rc, &isectc));
+            if (hit) EXPECT_EQ(r.tMax, rc.tMax);
+            EXPECT_EQ(hit, cached->IntersectP(Ray(o, target - o)));
+        }
+    }
+
+    // Different geometry doesn't pick up the cached trees
+    prims.pop_back();
+    BVHAccel smaller(prims, 4, BVHAccel::SplitMethod::SAH);
+    EXPECT_EQ(5, cacheDir.Files().size());
+}
+
+TEST(PagedMesh, MatchesLoadedMeshes) {
+    // Write a PLY file of random triangles for each octant of [-1,1]^3
+    char dir[] = "/tmp/pbrt_pagedmesh_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    static Transform identity;
+    RNG rng;
+    std::vector<std::string> filenames;
+    std::vector<std::shared_ptr<Primitive>> loaded, paged;
+    std::vector<std::shared_ptr<PagedMeshPrimitive>> meshes;
+    const int nTris = 500;
+    for (int octant = 0; octant < 8; ++octant) {
+        Vector3f offset(octant & 1 ? .5 : -.5, octant & 2 ? .5 : -.5,
+                        octant & 4 ? .5 : -.5);
+        std::vector<Point3f> p;
+        std::vector<int> indices;
+        Bounds3f bounds;
+        for (int i = 0; i < 3 * nTris; ++i) {
+            Vector3f d(rng.UniformFloat() - .5f, rng.UniformFloat() - .5f,
+                       rng.UniformFloat() - .5f);
+            indices.push_back(p.size());
+            p.push_back(Point3f(0, 0, 0) + offset + .9f * d);
+            bounds = Union(bounds, p.back());
+        }
+        std::string filename = std::string(dir) + "/mesh" +
+                               std::to_string(octant) + ".ply";
+        ASSERT_TRUE(WritePlyFile(filename, nTris, &indices[0], p.size(),
+                                 &p[0], nullptr, nullptr, nullptr));
+        filenames.push_back(filename);
+
+        for (const auto &s : ReadPLYMesh(filename, &identity, &identity,
+                                         false, nullptr, nullptr))
+            loaded.push_back(std::make_shared<GeometricPrimitive>(
+                s, nullptr, nullptr, MediumInterface()));
+
+        // Give half of the meshes their bounds up front
+        ParamSet params;
+        params.AddString("filename", std::unique_ptr<std::string[]>(
+                                         new std::string[1]{filename}),
+                         1);
+        if (octant & 1) {
+            std::unique_ptr<Float[]> b(new Float[6]);
+            for (int c = 0; c < 3; ++c) {
+                b[c] = bounds.pMin[c];
+                b[c + 3] = bounds.pMax[c];
+            }
+            params.AddFloat("bounds", std::move(b), 6);
+        }
+        std::shared_ptr<Primitive> mesh =
+            CreatePagedPLYMesh(&identity, &identity, false, params, nullptr,
+                               nullptr, MediumInterface());
+        ASSERT_TRUE(mesh != nullptr);
+        EXPECT_EQ(bounds, mesh->WorldBound());
+        paged.push_back(mesh);
+        meshes.push_back(std::dynamic_pointer_cast<PagedMeshPrimitive>(mesh));
+    }
+    BVHAccel loadedBVH(loaded, 4), pagedBVH(paged, 4);
+    EXPECT_EQ(loadedBVH.WorldBound(), pagedBVH.WorldBound());
+    for (const auto &m : meshes) EXPECT_FALSE(m->IsResident());
+
+    auto traceRays = [&](int nRays) {
+        for (int i = 0; i < nRays; ++i) {
+            Point2f u(rng.UniformFloat(), rng.UniformFloat());
+            Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+            Point3f target(Lerp(rng.UniformFloat(), -1.2, 1.2),
+                           Lerp(rng.UniformFloat(), -1.2, 1.2),
+                           Lerp(rng.UniformFloat(), -1.2, 1.2));
+            Ray r(o, target - o), rp = r;
+            SurfaceInteraction isect, isectp;
+            bool hit = loadedBVH.Intersect(r, &isect);
+            EXPECT_EQ(hit, pagedBVH.Intersect(rp, &isectp));
+            if (hit) {
+                EXPECT_EQ(r.tMax, rp.tMax);
+                EXPECT_EQ(isect.p, isectp.p);
+                EXPECT_TRUE(std::find_if(meshes.begin(), meshes.end(),
+                                         [&](const std::shared_ptr<
+                                             PagedMeshPrimitive> &m) {
+                                             return m.get() ==
+                                                    isectp.primitive;
+                                         }) != meshes.end());
+            }
+            EXPECT_EQ(hit, pagedBVH.IntersectP(Ray(o, target - o)));
+        }
+    };
+
+    // With a tiny budget, each load evicts all of the other meshes
+    PbrtOptions.geometryBudget = 1e-6;
+    traceRays(1000);
+    int nResident = 0;
+    for (const auto &m : meshes) nResident += m->IsResident();
+    EXPECT_EQ(1, nResident);
+
+    // Without a budget, meshes stay resident once they've been hit
+    PbrtOptions.geometryBudget = 0;
+    traceRays(2000);
+    for (const auto &m : meshes) EXPECT_TRUE(m->IsResident());
+
+    for (const std::string &f : filenames) remove(f.c_str());
+    rmdir(dir);
+}
+#endif  // !PBRT_IS_WINDOWS
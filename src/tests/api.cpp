@@ -0,0 +1,127 @@
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "api.h"
+#include "imageio.h"
+#include "parser.h"
+#include "shapes/triangle.h"
+#ifndef PBRT_IS_WINDOWS
+#include <unistd.h>
+#endif
+
+using namespace pbrt;
+
+#ifndef PBRT_IS_WINDOWS
+// Renders a scene of quads, each given as a "trianglemesh" or, if
+// _deferred_ is set, every other one as a "plymesh", which is only created
+// once the world block or object instance needs it, and returns the image.
+static std::unique_ptr<RGBSpectrum[]> RenderQuads(const std::string &dir,
+                                                  bool deferred,
+                                                  Point2i *resolution) {
+    const char *quadShapes[] = {
+        // Area lights, between point lights
+        "-1.5 -1.5 0  -.5 -1.5 0  -.5 -.5 0  -1.5 -.5 0",
+        "-1.5 .5 0  -.5 .5 0  -.5 1.5 0  -1.5 1.5 0",
+        // Two coincident quads with different materials, so the one that's
+        // hit depends on the order of the primitives
+        ".2 -1.5 0  1.5 -1.5 0  1.5 1.5 0  .2 1.5 0",
+        ".2 -1.5 0  1.5 -1.5 0  1.5 1.5 0  .2 1.5 0",
+        // The same, in an object that is instanced twice
+        "-.4 -.4 -.5  .4 -.4 -.5  .4 .4 -.5  -.4 .4 -.5",
+        "-.4 -.4 -.5  .4 -.4 -.5  .4 .4 -.5  -.4 .4 -.5"};
+    std::vector<std::string> quads;
+    for (int i = 0; i < 6; ++i) {
+        std::vector<Point3f> p(4);
+        const char *s = quadShapes[i];
+        char *end;
+        for (int j = 0; j < 12; ++j, s = end)
+            p[j / 3][j % 3] = strtod(s, &end);
+        int indices[6] = {0, 1, 2, 0, 2, 3};
+        if (deferred && i % 2 == 0) {
+            std::string filename =
+                dir + "/quad" + std::to_string(i) + ".ply";
+            EXPECT_TRUE(WritePlyFile(filename, 2, indices, 4, &p[0], nullptr,
+                                     nullptr, nullptr));
+            quads.push_back("Shape \"plymesh\" \"string filename\" \"" +
+                            filename + "\"\n");
+        } else
+            quads.push_back(
+                std::string("Shape \"trianglemesh\" "
+                            "\"integer indices\" [0 1 2 0 2 3] \"point P\" [") +
+                quadShapes[i] + "]\n");
+    }
+
+    std::string sceneFile = dir + "/scene.pbrt", imageFile = dir + "/image.pfm";
+    FILE *f = fopen(sceneFile.c_str(), "w");
+    fprintf(f,
+            "LookAt 0 0 5  0 0 0  0 1 0\n"
+            "Camera \"perspective\" \"float fov\" 50\n"
+            "Sampler \"halton\" \"integer pixelsamples\" 4\n"
+            "Integrator \"path\" \"integer maxdepth\" 2\n"
+            "  \"string lightsamplestrategy\" \"uniform\"\n"
+            "Film \"image\" \"integer xresolution\" 24 "
+            "\"integer yresolution\" 24 \"string filename\" \"%s\"\n"
+            "WorldBegin\n"
+            "LightSource \"point\" \"point from\" [0 0 3] \"rgb I\" [4 4 4]\n"
+            "AttributeBegin\n"
+            "AreaLightSource \"diffuse\" \"rgb L\" [2 0 0]\n"
+            "%s"
+            "AttributeEnd\n"
+            "LightSource \"point\" \"point from\" [2 2 3] \"rgb I\" [0 4 0]\n"
+            "AttributeBegin\n"
+            "AreaLightSource \"diffuse\" \"rgb L\" [0 0 2]\n"
+            "%s"
+            "AttributeEnd\n"
+            "Material \"matte\" \"rgb Kd\" [.8 .2 .2]\n"
+            "%s"
+            "Material \"matte\" \"rgb Kd\" [.2 .8 .2]\n"
+            "%s"
+            "ObjectBegin \"pair\"\n"
+            "Material \"matte\" \"rgb Kd\" [.2 .2 .8]\n"
+            "%s"
+            "Material \"matte\" \"rgb Kd\" [.8 .8 .2]\n"
+            "%s"
+            "ObjectEnd\n"
+            "AttributeBegin\n"
+            "Translate -.5 0 0\n"
+            "ObjectInstance \"pair\"\n"
+            "AttributeEnd\n"
+            "Translate .5 0 0\n"
+            "ObjectInstance \"pair\"\n"
+            "WorldEnd\n",
+            imageFile.c_str(), quads[0].c_str(), quads[1].c_str(),
+            quads[2].c_str(), quads[3].c_str(), quads[4].c_str(),
+            quads[5].c_str());
+    fclose(f);
+
+    Options opt;
+    opt.quiet = true;
+    opt.nThreads = 4;
+    pbrtInit(opt);
+    EXPECT_TRUE(ParseFile(sceneFile));
+    pbrtCleanup();
+
+    std::unique_ptr<RGBSpectrum[]> image = ReadImage(imageFile, resolution);
+    for (int i = 0; i < 6; i += 2)
+        remove((dir + "/quad" + std::to_string(i) + ".ply").c_str());
+    EXPECT_EQ(0, remove(sceneFile.c_str()));
+    EXPECT_EQ(0, remove(imageFile.c_str()));
+    return image;
+}
+
+TEST(API, DeferredShapesKeepSceneOrder) {
+    // Primitives and area lights of shapes created after the fact go where
+    // they would have if the shapes had been created right away, so the
+    // image is the same down to the bit
+    char dir[] = "/tmp/pbrt_api_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    Point2i res, deferredRes;
+    std::unique_ptr<RGBSpectrum[]> image = RenderQuads(dir, false, &res);
+    std::unique_ptr<RGBSpectrum[]> deferred =
+        RenderQuads(dir, true, &deferredRes);
+    rmdir(dir);
+    ASSERT_TRUE(image && deferred);
+    ASSERT_EQ(res, deferredRes);
+    for (int i = 0; i < res.x * res.y; ++i)
+        EXPECT_TRUE(image[i] == deferred[i]) << i;
+}
+#endif  // !PBRT_IS_WINDOWS
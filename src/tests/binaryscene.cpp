@@ -0,0 +1,92 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "binaryscene.h"
+#include "paramset.h"
+
+using namespace pbrt;
+
+TEST(BinaryScene, RoundTrip) {
+    const char *filename = "binaryscenetest.pbrb";
+    ParamSet ps;
+    std::unique_ptr<int[]> indices(new int[6]{0, 1, 2, 2, 1, 3});
+    ps.AddInt("indices", std::move(indices), 6);
+    std::unique_ptr<Point3f[]> p(new Point3f[4]{
+        Point3f(0, 0, 0), Point3f(1, 0, 0), Point3f(0, 1, 0),
+        Point3f(1, 1, .5)});
+    ps.AddPoint3f("P", std::move(p), 4);
+    std::unique_ptr<bool[]> b(new bool[2]{true, false});
+    ps.AddBool("flags", std::move(b), 2);
+    std::unique_ptr<Float[]> rgb(new Float[3]{.25, .5, .75});
+    ps.AddRGBSpectrum("Kd", std::move(rgb), 3);
+    std::unique_ptr<std::string[]> s(new std::string[1]{"mesh.ply"});
+    ps.AddString("filename", std::move(s), 1);
+    ps.AddTexture("roughness", "bumps");
+
+    {
+        std::unique_ptr<BinarySceneWriter> writer =
+            BinarySceneWriter::Create(filename);
+        ASSERT_TRUE(writer != nullptr);
+        writer->Write(SceneCall::Translate, {}, {1, 2, 3});
+        writer->Write(SceneCall::Shape, {"trianglemesh"}, {}, &ps);
+        writer->Write(SceneCall::Texture, {"bumps", "float", "fbm"});
+        writer->Write(SceneCall::WorldEnd);
+    }
+
+    std::vector<SceneCall> calls;
+    EXPECT_TRUE(ReadBinaryScene(filename, [&](const SceneCallRecord &r) {
+        calls.push_back(r.call);
+        switch (r.call) {
+        case SceneCall::Translate:
+            EXPECT_EQ(std::vector<Float>({1, 2, 3}), r.values);
+            break;
+        case SceneCall::Shape: {
+            ASSERT_EQ(1, r.strings.size());
+            EXPECT_EQ("trianglemesh", r.strings[0]);
+            int n;
+            const int *ri = r.params.FindInt("indices", &n);
+            ASSERT_EQ(6, n);
+            EXPECT_EQ(3, ri[5]);
+            const Point3f *rp = r.params.FindPoint3f("P", &n);
+            ASSERT_EQ(4, n);
+            EXPECT_EQ(Point3f(1, 1, .5), rp[3]);
+            const bool *rb = r.params.FindBool("flags", &n);
+            ASSERT_EQ(2, n);
+            EXPECT_TRUE(rb[0]);
+            EXPECT_FALSE(rb[1]);
+            Float kd[3];
+            r.params.FindOneSpectrum("Kd", Spectrum(0)).ToRGB(kd);
+            EXPECT_FLOAT_EQ(.75, kd[2]);
+            EXPECT_EQ("mesh.ply", r.params.FindOneString("filename", ""));
+            EXPECT_EQ("bumps", r.params.FindTexture("roughness"));
+            break;
+        }
+        case SceneCall::Texture:
+            EXPECT_EQ(std::vector<std::string>({"bumps", "float", "fbm"}),
+                      r.strings);
+            break;
+        default:
+            break;
+        }
+    }));
+    EXPECT_EQ(std::vector<SceneCall>({SceneCall::Translate, SceneCall::Shape,
+                                      SceneCall::Texture, SceneCall::WorldEnd}),
+              calls);
+    EXPECT_TRUE(IsBinarySceneFile(filename));
+
+    // A truncated file is reported as corrupt after replaying the calls
+    // before the truncation point
+    FILE *f = fopen(filename, "rb");
+    std::vector<char> data(1 << 16);
+    data.resize(fread(data.data(), 1, data.size(), f));
+    fclose(f);
+    f = fopen(filename, "wb");
+    fwrite(data.data(), 1, data.size() - 2, f);
+    fclose(f);
+    calls.clear();
+    EXPECT_FALSE(ReadBinaryScene(
+        filename, [&](const SceneCallRecord &r) { calls.push_back(r.call); }));
+    EXPECT_EQ(3, calls.size());
+
+    EXPECT_EQ(0, remove(filename));
+}
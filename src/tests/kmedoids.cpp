@@ -0,0 +1,55 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "tools/classification/src/kmedoids.h"
+
+using namespace pbrt;
+using namespace Kmedoids;
+
+// Returns a random string of _length_ characters from the first _nChars_
+// letters; small alphabets give many partial matches
+static std::string RandomString(RNG &rng, int length, int nChars) {
+    std::string s;
+    for (int i = 0; i < length; ++i) s += char('A' + rng.UniformUInt32(nChars));
+    return s;
+}
+
+TEST(Levenshtein, Basics) {
+    EXPECT_EQ(0, LevenshteinEditDistance("", ""));
+    EXPECT_EQ(3, LevenshteinEditDistance("", "LDE"));
+    EXPECT_EQ(3, LevenshteinEditDistance("LDE", ""));
+    EXPECT_EQ(3, LevenshteinEditDistance("kitten", "sitting"));
+    EXPECT_EQ(3, LevenshteinBitParallel("kitten", "sitting"));
+    EXPECT_EQ(3, LevenshteinDP("kitten", "sitting"));
+}
+
+TEST(Levenshtein, BitParallelMatchesDP) {
+    RNG rng;
+    for (int i = 0; i < 5000; ++i) {
+        int nChars = 1 + rng.UniformUInt32(6);
+        std::string a = RandomString(rng, rng.UniformUInt32(65), nChars);
+        std::string b = RandomString(rng, rng.UniformUInt32(100), nChars);
+        int expected = LevenshteinDP(a, b);
+        EXPECT_EQ(expected, LevenshteinDP(b, a));
+        EXPECT_EQ(expected, LevenshteinBitParallel(a, b)) << a << " " << b;
+        EXPECT_EQ(expected, LevenshteinEditDistance(a, b)) << a << " " << b;
+        EXPECT_EQ(expected, LevenshteinEditDistance(b, a)) << a << " " << b;
+    }
+}
+
+TEST(Levenshtein, LongPatterns) {
+    // Strings with both lengths above 64 take the dynamic programming
+    // fallback; around the boundary, the shorter one decides
+    RNG rng;
+    for (int i = 0; i < 500; ++i) {
+        int nChars = 1 + rng.UniformUInt32(6);
+        std::string a = RandomString(rng, 60 + rng.UniformUInt32(100), nChars);
+        std::string b = RandomString(rng, 60 + rng.UniformUInt32(100), nChars);
+        // Share a prefix now and then so that distances aren't all large
+        if (rng.UniformUInt32(2)) b = a.substr(0, a.size() / 2) + b;
+        int expected = LevenshteinDP(a, b);
+        EXPECT_EQ(expected, LevenshteinEditDistance(a, b)) << a << " " << b;
+        EXPECT_EQ(expected, LevenshteinEditDistance(b, a)) << a << " " << b;
+    }
+}
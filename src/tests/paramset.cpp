@@ -0,0 +1,52 @@
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "paramset.h"
+#include "parallel.h"
+
+using namespace pbrt;
+
+TEST(ParamSet, SymbolLookup) {
+    ParamSet ps;
+    std::unique_ptr<Float[]> radius(new Float[1]{2.5});
+    ps.AddFloat("radius", std::move(radius), 1);
+    std::unique_ptr<int[]> indices(new int[3]{0, 1, 2});
+    ps.AddInt("indices", std::move(indices), 3);
+
+    const ParamSymbol *r = ParamSymbol::Find("radius");
+    ASSERT_TRUE(r != nullptr);
+    EXPECT_EQ(r, ParamSymbol::Intern("radius"));
+    EXPECT_EQ("radius", r->name);
+    EXPECT_EQ(2.5, ps.FindOneFloat(r, 1));
+    EXPECT_EQ(2.5, ps.FindOneFloat("radius", 1));
+
+    // Names that were never added to any ParamSet have no symbol and take
+    // the default
+    EXPECT_TRUE(ParamSymbol::Find("paramset test unused name") == nullptr);
+    EXPECT_EQ(7, ps.FindOneInt("paramset test unused name", 7));
+
+    // Same name, different type
+    EXPECT_EQ(3, ps.FindOneInt("radius", 3));
+    int n;
+    const int *idx = ps.FindInt("indices", &n);
+    ASSERT_TRUE(idx != nullptr);
+    EXPECT_EQ(3, n);
+    EXPECT_EQ(2, idx[2]);
+
+    EXPECT_TRUE(ps.EraseInt("indices"));
+    EXPECT_FALSE(ps.EraseInt("indices"));
+    EXPECT_TRUE(ps.FindInt("indices", &n) == nullptr);
+}
+
+TEST(ParamSet, ConcurrentIntern) {
+    ParallelInit();
+    std::vector<const ParamSymbol *> symbols(4096);
+    ParallelFor([&](int64_t i) {
+        symbols[i] = ParamSymbol::Intern("concurrent" + std::to_string(i % 64));
+    }, symbols.size(), 16);
+    ParallelCleanup();
+
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        EXPECT_EQ(symbols[i % 64], symbols[i]);
+        EXPECT_EQ("concurrent" + std::to_string(i % 64), symbols[i]->name);
+    }
+}
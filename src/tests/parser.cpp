@@ -0,0 +1,117 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "api.h"
+#include "binaryscene.h"
+#include "parser.h"
+#include "rng.h"
+
+using namespace pbrt;
+
+static double ParseAll(const char *s, int *nParsed = nullptr) {
+    double v = -1;
+    const char *end = ParseNumber(s, s + strlen(s), &v);
+    if (nParsed) *nParsed = end - s;
+    return v;
+}
+
+TEST(Parser, Numbers) {
+    int n;
+    EXPECT_EQ(0., ParseAll("0"));
+    EXPECT_EQ(-12., ParseAll("-12"));
+    EXPECT_EQ(.5, ParseAll("+.5"));
+    EXPECT_EQ(3., ParseAll("3."));
+    EXPECT_EQ(1.5e-7, ParseAll("1.5e-7"));
+    EXPECT_EQ(2e300, ParseAll("2E300"));
+    EXPECT_EQ(12345678901234567890., ParseAll("12345678901234567890"));
+    EXPECT_EQ(0.12345678901234567, ParseAll("0.12345678901234567"));
+    EXPECT_TRUE(std::signbit(ParseAll("-0")));
+
+    // Only the part matching the number syntax is consumed
+    EXPECT_EQ(1., ParseAll("1e", &n));
+    EXPECT_EQ(1, n);
+    EXPECT_EQ(1.5, ParseAll("1.5.3", &n));
+    EXPECT_EQ(3, n);
+    EXPECT_EQ(2., ParseAll("2]", &n));
+    EXPECT_EQ(1, n);
+    for (const char *s : {"", "-", ".", "+.e5", "e5", "abc"}) {
+        ParseAll(s, &n);
+        EXPECT_EQ(0, n) << s;
+    }
+
+    // Random values printed with varying precision round trip exactly
+    RNG rng;
+    for (int i = 0; i < 100000; ++i) {
+        char buf[64];
+        double v = (rng.UniformFloat() - .5) *
+                   std::pow(10., int(rng.UniformUInt32(40)) - 20);
+        snprintf(buf, sizeof(buf), "%.*g", 1 + rng.UniformUInt32(17), v);
+        EXPECT_EQ(strtod(buf, nullptr), ParseAll(buf)) << buf;
+    }
+}
+
+TEST(Parser, MappedScene) {
+    FILE *f = fopen("parsertest_include.pbrt", "w");
+    fprintf(f, "Shape \"sphere\" \"float radius\" 2 # trailing comment\n");
+    fclose(f);
+    // Empty files can't be mapped and are read instead
+    f = fopen("parsertest_empty.pbrt", "w");
+    fclose(f);
+    f = fopen("parsertest.pbrt", "w");
+    fprintf(f,
+            "# A comment\n"
+            "LookAt 0 0 5 0 0 0 0 1 0\n"
+            "WorldBegin\n"
+            "Translate 1 -2 .5e1\n"
+            "Material \"matte\" \"rgb Kd\" [ .1 .2 .3 ] \"string name\" "
+            "\"a \\\"b\\\"\\n\" \"string escaped\" \"\\101\\089\\12x\"\n"
+            "Shape \"trianglemesh\" \"integer indices\" [0 1 2\n 2 1 3]\n"
+            "  \"point P\" [0 0 0 1 0 0 # comment in an array\n"
+            "              0 1 0 1 1 0]\n"
+            "Include \"parsertest_empty.pbrt\"\n"
+            "Include \"parsertest_include.pbrt\"\n"
+            "WorldEnd\n");
+    fclose(f);
+
+    Options opt;
+    opt.quiet = true;
+    opt.toBinary = "parsertest.pbrb";
+    pbrtInit(opt);
+    EXPECT_TRUE(ParseFile("parsertest.pbrt"));
+    pbrtCleanup();
+
+    std::vector<SceneCallRecord> calls;
+    EXPECT_TRUE(ReadBinaryScene(
+        "parsertest.pbrb",
+        [&](const SceneCallRecord &r) { calls.push_back(r); }));
+    ASSERT_EQ(7, calls.size());
+    EXPECT_EQ(SceneCall::LookAt, calls[0].call);
+    EXPECT_EQ(std::vector<Float>({0, 0, 5, 0, 0, 0, 0, 1, 0}), calls[0].values);
+    EXPECT_EQ(std::vector<Float>({1, -2, 5}), calls[2].values);
+
+    EXPECT_EQ(SceneCall::Material, calls[3].call);
+    EXPECT_EQ("a \"b\"\n", calls[3].params.FindOneString("name", ""));
+    // Three digits make a decimal character code
+    EXPECT_EQ("eY12x", calls[3].params.FindOneString("escaped", ""));
+    Float rgb[3];
+    calls[3].params.FindOneSpectrum("Kd", Spectrum(0)).ToRGB(rgb);
+    EXPECT_FLOAT_EQ(.2, rgb[1]);
+
+    EXPECT_EQ(SceneCall::Shape, calls[4].call);
+    int n;
+    const int *indices = calls[4].params.FindInt("indices", &n);
+    ASSERT_EQ(6, n);
+    EXPECT_EQ(3, indices[5]);
+    const Point3f *P = calls[4].params.FindPoint3f("P", &n);
+    ASSERT_EQ(4, n);
+    EXPECT_EQ(Point3f(1, 1, 0), P[3]);
+
+    EXPECT_EQ(SceneCall::Shape, calls[5].call);
+    EXPECT_EQ(2, calls[5].params.FindOneFloat("radius", 0));
+    EXPECT_EQ(SceneCall::WorldEnd, calls[6].call);
+
+    EXPECT_EQ(0, remove("parsertest.pbrt"));
+    EXPECT_EQ(0, remove("parsertest_include.pbrt"));
+    EXPECT_EQ(0, remove("parsertest_empty.pbrt"));
+    EXPECT_EQ(0, remove("parsertest.pbrb"));
+}
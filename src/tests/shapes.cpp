@@ -1,6 +1,7 @@
 
 #include "tests/gtest/gtest.h"
 #include <cmath>
+#include <fstream>
 #include <functional>
 #include "pbrt.h"
 #include "rng.h"
@@ -11,6 +12,7 @@
 #include "shapes/cylinder.h"
 #include "shapes/disk.h"
 #include "shapes/paraboloid.h"
+#include "shapes/plymesh.h"
 #include "shapes/sphere.h"
 #include "shapes/triangle.h"
 
@@ -271,6 +273,41 @@ TEST(Triangle, Sampling) {
 
 // Checks the closed-form solid angle computation for triangles against a
 // Monte Carlo estimate of it.
+TEST(Triangle, ClippedWorldBound) {
+    for (int i = 0; i < 100; ++i) {
+        const Float range = 10;
+        RNG rng(i);
+        std::shared_ptr<Triangle> tri =
+            GetRandomTriangle([&]() { return pUnif(rng, range); });
+        if (!tri) continue;
+
+        Bounds3f clip(Point3f(pUnif(rng, range), pUnif(rng, range),
+                              pUnif(rng, range)),
+                      Point3f(pUnif(rng, range), pUnif(rng, range),
+                              pUnif(rng, range)));
+        Bounds3f clipped = tri->ClippedWorldBound(clip);
+        bool empty = clipped.pMin.x > clipped.pMax.x ||
+                     clipped.pMin.y > clipped.pMax.y ||
+                     clipped.pMin.z > clipped.pMax.z;
+        if (!empty) {
+            EXPECT_TRUE(Inside(clipped.pMin, clip));
+            EXPECT_TRUE(Inside(clipped.pMax, clip));
+        }
+
+        // Points of the triangle inside _clip_ must be inside the clipped
+        // bounds, up to round-off
+        Bounds3f expanded = Expand(clipped, 1e-4f * range);
+        for (int j = 0; j < 1000; ++j) {
+            Float pdf;
+            Point2f u(rng.UniformFloat(), rng.UniformFloat());
+            Point3f p = tri->Sample(u, &pdf).p;
+            if (!InsideExclusive(p, clip)) continue;
+            EXPECT_FALSE(empty);
+            EXPECT_TRUE(Inside(p, expanded)) << p << " " << clipped;
+        }
+    }
+}
+
 TEST(Triangle, SolidAngle) {
     for (int i = 0; i < 50; ++i) {
         const Float range = 10;
@@ -541,3 +578,111 @@ TEST(Paraboloid, Reintersect) {
     }
 }
 #endif
+
+// Writes the same mesh as an ASCII PLY file, which is read with RPly, and as
+// binary little-endian files, which are mapped and converted in bulk.
+TEST(PLYMesh, BinaryMatchesASCII) {
+    struct Vertex {
+        float x;
+        double y;
+        float z;
+        uint8_t red;
+        float nx, ny, nz, s, t;
+    } vertices[5] = {{0, 0, 0, 1, 0, 0, 1, 0, 0},
+                     {1, 0, 0, 2, 0, .6, .8, 1, 0},
+                     {1, 1, 0, 3, .6, 0, .8, 1, 1},
+                     {0, 1, .5, 4, 0, 0, 1, 0, 1},
+                     {-1, .5, .25, 5, 0, .8, .6, .5, .5}};
+    // A triangle, a quad, and a pentagon that's ignored
+    std::vector<std::vector<uint32_t>> faces = {
+        {0, 1, 2}, {0, 2, 3, 4}, {0, 1, 2, 3, 4}};
+
+    const char *header = R"(element vertex 5
+property float x
+property double y
+property float z
+property uchar red
+property float nx
+property float ny
+property float nz
+property float s
+property float t
+element face 3
+property uchar flags
+property list uchar uint vertex_indices
+end_header
+)";
+    std::ofstream ascii("plytest_ascii.ply");
+    ascii << "ply\nformat ascii 1.0\ncomment test mesh\n" << header;
+    for (const Vertex &v : vertices)
+        ascii << v.x << " " << v.y << " " << v.z << " " << int(v.red) << " "
+              << v.nx << " " << v.ny << " " << v.nz << " " << v.s << " " << v.t
+              << "\n";
+    for (const auto &f : faces) {
+        ascii << "7 " << f.size();
+        for (uint32_t i : f) ascii << " " << i;
+        ascii << "\n";
+    }
+    ascii.close();
+
+    std::string binary = std::string("ply\nformat binary_little_endian 1.0\n") +
+                         header;
+    auto append = [&](const void *data, size_t size) {
+        binary.append((const char *)data, size);
+    };
+    for (const Vertex &v : vertices) {
+        append(&v.x, 4);
+        append(&v.y, 8);
+        append(&v.z, 4);
+        append(&v.red, 1);
+        append(&v.nx, 20);
+    }
+    for (const auto &f : faces) {
+        uint8_t flags = 7, n = f.size();
+        append(&flags, 1);
+        append(&n, 1);
+        append(f.data(), 4 * f.size());
+    }
+    std::ofstream("plytest_binary.ply", std::ios::binary) << binary;
+    // Truncated in the middle of the last face
+    std::ofstream("plytest_truncated.ply", std::ios::binary)
+        << binary.substr(0, binary.size() - 6);
+
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> reference = ReadPLYMesh(
+        "plytest_ascii.ply", &identity, &identity, false, nullptr, nullptr);
+    std::vector<std::shared_ptr<Shape>> mapped = ReadPLYMesh(
+        "plytest_binary.ply", &identity, &identity, false, nullptr, nullptr);
+    ASSERT_EQ(3, reference.size());
+    ASSERT_EQ(reference.size(), mapped.size());
+    for (size_t i = 0; i < reference.size(); ++i) {
+        Point3f pr[3], pm[3];
+        ASSERT_TRUE(reference[i]->GetTriangleVertices(pr));
+        ASSERT_TRUE(mapped[i]->GetTriangleVertices(pm));
+        for (int j = 0; j < 3; ++j) EXPECT_EQ(pr[j], pm[j]);
+
+        // Normals and uvs are interpolated at the triangle's centroid
+        Point3f c = (pr[0] + pr[1] + pr[2]) / 3;
+        Ray r(c + Vector3f(0, 0, 2), Vector3f(0, 0, -1));
+        Float tr, tm;
+        SurfaceInteraction ir, im;
+        ASSERT_TRUE(reference[i]->Intersect(r, &tr, &ir));
+        ASSERT_TRUE(mapped[i]->Intersect(r, &tm, &im));
+        EXPECT_EQ(ir.uv, im.uv);
+        EXPECT_EQ(ir.shading.n, im.shading.n);
+    }
+
+    Bounds3f br, bm;
+    EXPECT_TRUE(ReadPLYBounds("plytest_ascii.ply", &br));
+    EXPECT_TRUE(ReadPLYBounds("plytest_binary.ply", &bm));
+    EXPECT_EQ(br, bm);
+    EXPECT_EQ(Bounds3f(Point3f(-1, 0, 0), Point3f(1, 1, .5)), bm);
+
+    EXPECT_TRUE(ReadPLYMesh("plytest_truncated.ply", &identity, &identity,
+                            false, nullptr, nullptr)
+                    .empty());
+
+    remove("plytest_ascii.ply");
+    remove("plytest_binary.ply");
+    remove("plytest_truncated.ply");
+}
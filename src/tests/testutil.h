@@ -0,0 +1,31 @@
+#ifndef PBRT_TESTS_TESTUTIL_H
+#define PBRT_TESTS_TESTUTIL_H
+
+// tests/testutil.h*
+#include "pbrt.h"
+#include "parallel.h"
+
+namespace pbrt {
+
+// Sets _PbrtOptions.nThreads_ and starts the worker threads for as long as
+// it is in scope.  pbrt_test doesn't start the thread pool itself, which
+// ParallelFor() needs on multicore machines; with a count of one, loops
+// run serially.
+class ScopedThreads {
+  public:
+    explicit ScopedThreads(int nThreads) : savedThreads(PbrtOptions.nThreads) {
+        PbrtOptions.nThreads = nThreads;
+        ParallelInit();
+    }
+    ~ScopedThreads() {
+        ParallelCleanup();
+        PbrtOptions.nThreads = savedThreads;
+    }
+
+  private:
+    int savedThreads;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_TESTS_TESTUTIL_H
@@ -0,0 +1,226 @@
+#include "tests/gtest/gtest.h"
+#include "tests/testutil.h"
+#include "pbrt.h"
+#include "mipmap.h"
+#include "parallel.h"
+#include "rng.h"
+#ifndef PBRT_IS_WINDOWS
+#include <unistd.h>
+#endif
+
+using namespace pbrt;
+
+TEST(TextureCache, MatchesInMemoryMIPMap) {
+    // Use several threads even on a single core so that evictions happen
+    // while other threads are reading
+    ScopedThreads threads(4);
+    Point2i res(300, 200);
+    RNG rng;
+    std::unique_ptr<Float[]> image(new Float[res.x * res.y]);
+    for (int i = 0; i < res.x * res.y; ++i) image[i] = rng.UniformFloat();
+    MIPMap<Float> mipmap(res, image.get());
+
+    // Keep only a handful of tiles resident so that most lookups evict
+    Float textureBudget = PbrtOptions.textureBudget;
+    PbrtOptions.textureBudget = .05f;
+    MIPMap<Float> tiled([&](Point2i *resolution) {
+        *resolution = res;
+        std::unique_ptr<Float[]> texels(new Float[res.x * res.y]);
+        std::copy(image.get(), image.get() + res.x * res.y, texels.get());
+        return texels;
+    });
+    EXPECT_EQ(mipmap.Levels(), tiled.Levels());
+    EXPECT_EQ(mipmap.Width(), tiled.Width());
+    EXPECT_EQ(mipmap.Height(), tiled.Height());
+
+    std::atomic<int> mismatches{0};
+    ParallelFor([&](int64_t i) {
+        RNG rng(i);
+        for (int j = 0; j < 100; ++j) {
+            Point2f st(rng.UniformFloat(), rng.UniformFloat());
+            Vector2f dst0(.01f * rng.UniformFloat(), .01f * rng.UniformFloat());
+            Vector2f dst1(-.01f * rng.UniformFloat(),
+                          .01f * rng.UniformFloat());
+            if (mipmap.Lookup(st, dst0, dst1) != tiled.Lookup(st, dst0, dst1))
+                ++mismatches;
+            Float width = .1f * rng.UniformFloat();
+            if (mipmap.Lookup(st, width) != tiled.Lookup(st, width))
+                ++mismatches;
+        }
+    }, 256, 4);
+    PbrtOptions.textureBudget = textureBudget;
+    EXPECT_EQ(0, mismatches);
+}
+
+TEST(MIPMapFile, HalfConversion) {
+    for (float f : {0.f, 1.f, -2.f, .5f, 65504.f, 6.1035156e-05f})
+        EXPECT_EQ(f, HalfToFloat(FloatToHalf(f)));
+    EXPECT_TRUE(std::isinf(HalfToFloat(FloatToHalf(1e6f))));
+    RNG rng;
+    for (int i = 0; i < 1000; ++i) {
+        float f = 100 * rng.UniformFloat();
+        EXPECT_LE(std::abs(HalfToFloat(FloatToHalf(f)) - f), f / 2048);
+    }
+}
+
+TEST(MIPMapFile, SRGB8Conversion) {
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(i, LinearToSRGB8(SRGB8ToLinear[i]));
+        EXPECT_NEAR(InverseGammaCorrect(i / 255.f), SRGB8ToLinear[i], 1e-6);
+    }
+    EXPECT_EQ(0, LinearToSRGB8(-1));
+    EXPECT_EQ(255, LinearToSRGB8(2));
+}
+
+TEST(MIPMapFile, CompactTexels) {
+    ScopedThreads threads(1);
+    // Resampling to a power of two would take texels outside of [0,1]
+    Point2i res(256, 128);
+    RNG rng;
+    std::unique_ptr<RGBSpectrum[]> image(new RGBSpectrum[res.x * res.y]);
+    for (int i = 0; i < res.x * res.y; ++i) {
+        Float rgb[3] = {rng.UniformFloat(), rng.UniformFloat(),
+                        rng.UniformFloat()};
+        image[i] = RGBSpectrum::FromRGB(rgb);
+    }
+    MIPMap<RGBSpectrum> mipmap(res, image.get());
+
+    for (TexelFormat format : {TexelFormat::Half, TexelFormat::SRGB8}) {
+        // Compact texels should be close to the _Float_ ones, and the same
+        // whether they're kept in memory or paged through the cache
+        MIPMap<RGBSpectrum> compact(res, image.get(), false, 8.f,
+                                    ImageWrap::Repeat, format);
+        Float textureBudget = PbrtOptions.textureBudget;
+        PbrtOptions.textureBudget = .05f;
+        MIPMap<RGBSpectrum> tiled(
+            [&](Point2i *resolution) {
+                *resolution = res;
+                std::unique_ptr<RGBSpectrum[]> texels(
+                    new RGBSpectrum[res.x * res.y]);
+                std::copy(image.get(), image.get() + res.x * res.y,
+                          texels.get());
+                return texels;
+            },
+            false, 8.f, ImageWrap::Repeat, format);
+        EXPECT_EQ(mipmap.Levels(), compact.Levels());
+        EXPECT_EQ(mipmap.Levels(), tiled.Levels());
+        Float tolerance = format == TexelFormat::Half ? 1e-3f : 5e-3f;
+        for (int i = 0; i < 1000; ++i) {
+            Point2f st(rng.UniformFloat(), rng.UniformFloat());
+            Vector2f dst0(.01f * rng.UniformFloat(), .01f * rng.UniformFloat());
+            Vector2f dst1(-.01f * rng.UniformFloat(),
+                          .01f * rng.UniformFloat());
+            RGBSpectrum expected = mipmap.Lookup(st, dst0, dst1);
+            RGBSpectrum value = compact.Lookup(st, dst0, dst1);
+            for (int c = 0; c < 3; ++c)
+                EXPECT_LE(std::abs(expected[c] - value[c]), tolerance);
+            EXPECT_TRUE(value == tiled.Lookup(st, dst0, dst1));
+        }
+        PbrtOptions.textureBudget = textureBudget;
+    }
+}
+
+#ifndef PBRT_IS_WINDOWS
+TEST(MIPMapFile, RoundTrip) {
+    ScopedThreads threads(1);
+    char dir[] = "/tmp/pbrt_mipmapfile_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    Point2i res(300, 200);
+    RNG rng;
+    std::unique_ptr<Float[]> image(new Float[res.x * res.y]);
+    for (int i = 0; i < res.x * res.y; ++i) image[i] = rng.UniformFloat();
+
+    for (TexelFormat format :
+         {TexelFormat::Float, TexelFormat::Half, TexelFormat::SRGB8}) {
+        MIPMap<Float> mipmap(res, image.get(), false, 8.f, ImageWrap::Repeat,
+                             format);
+        MIPMapFileKey key;
+        key.filename = std::string(dir) + "/test.mip";
+        key.key = 0x1234;
+        key.format = format;
+        ASSERT_TRUE(mipmap.Write(key));
+        std::unique_ptr<MIPMapFile> file = MIPMapFile::Open(key, 1);
+        ASSERT_TRUE(file != nullptr);
+        EXPECT_TRUE(MIPMapFile::Open(key, 3) == nullptr);
+        MIPMapFileKey staleKey = key;
+        ++staleKey.key;
+        EXPECT_TRUE(MIPMapFile::Open(staleKey, 1) == nullptr);
+
+        // Both the in-memory MIPMap read from the file and the tiled one
+        // that pages tiles from it should match the original
+        MIPMap<Float> loaded(*file);
+        Float textureBudget = PbrtOptions.textureBudget;
+        PbrtOptions.textureBudget = .05f;
+        MIPMap<Float> tiled(
+            [&](Point2i *resolution) -> std::unique_ptr<Float[]> {
+                ADD_FAILURE() << "Image read despite MIP map file";
+                return nullptr;
+            },
+            false, 8.f, ImageWrap::Repeat, format, key);
+        EXPECT_EQ(mipmap.Levels(), loaded.Levels());
+        for (int i = 0; i < 1000; ++i) {
+            Point2f st(rng.UniformFloat(), rng.UniformFloat());
+            Float width = .1f * rng.UniformFloat();
+            Float expected = mipmap.Lookup(st, width);
+            EXPECT_EQ(expected, loaded.Lookup(st, width));
+            EXPECT_EQ(expected, tiled.Lookup(st, width));
+        }
+        PbrtOptions.textureBudget = textureBudget;
+        EXPECT_EQ(0, remove(key.filename.c_str()));
+    }
+    rmdir(dir);
+}
+#endif  // !PBRT_IS_WINDOWS
+
+template <typename T>
+static void TestSIMDEWA(const MIPMap<T> &mipmap) {
+    RNG rng;
+    for (int i = 0; i < 10000; ++i) {
+        // Include footprints that wrap around the edges and that are
+        // narrower than four texels
+        Point2f st(1.2f * rng.UniformFloat() - .1f,
+                   1.2f * rng.UniformFloat() - .1f);
+        Float width = std::pow(10.f, -4 * rng.UniformFloat());
+        Vector2f dst0(width * (rng.UniformFloat() - .5f),
+                      width * (rng.UniformFloat() - .5f));
+        Vector2f dst1(width * (rng.UniformFloat() - .5f),
+                      width * (rng.UniformFloat() - .5f));
+        MIPMap<T>::simdEWA = false;
+        T expected = mipmap.Lookup(st, dst0, dst1);
+        MIPMap<T>::simdEWA = true;
+        T value = mipmap.Lookup(st, dst0, dst1);
+        // The same operations run in the same order, so the results are
+        // identical unless FMA instructions are enabled and the compiler
+        // fuses the scalar filter's multiply-adds
+#if defined(__FMA__) || defined(__AVX2__)
+        const Float tolerance = 1e-5f;
+#else
+        const Float tolerance = 0;
+#endif
+        for (int c = 0; c < sizeof(T) / sizeof(Float); ++c)
+            EXPECT_NEAR(((const Float *)&expected)[c],
+                        ((const Float *)&value)[c], tolerance)
+                << st << " " << dst0 << " " << dst1;
+    }
+}
+
+TEST(MIPMap, SIMDEWA) {
+    ScopedThreads threads(1);
+    RNG rng;
+    for (Point2i res : {Point2i(64, 64), Point2i(300, 200)}) {
+        std::unique_ptr<Float[]> image(new Float[res.x * res.y]);
+        std::unique_ptr<RGBSpectrum[]> rgbImage(new RGBSpectrum[res.x * res.y]);
+        for (int i = 0; i < res.x * res.y; ++i) {
+            Float rgb[3] = {rng.UniformFloat(), rng.UniformFloat(),
+                            rng.UniformFloat()};
+            image[i] = rgb[0];
+            rgbImage[i] = RGBSpectrum::FromRGB(rgb);
+        }
+        for (ImageWrap wrap : {ImageWrap::Repeat, ImageWrap::Black,
+                               ImageWrap::Clamp}) {
+            TestSIMDEWA(MIPMap<Float>(res, image.get(), false, 8.f, wrap));
+            TestSIMDEWA(MIPMap<RGBSpectrum>(res, rgbImage.get(), false, 16.f,
+                                            wrap, TexelFormat::Half));
+        }
+    }
+}
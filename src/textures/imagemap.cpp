@@ -35,6 +35,7 @@
 #include "textures/imagemap.h"
 #include "imageio.h"
 #include "stats.h"
+#include "stringprint.h"
 
 namespace pbrt {
 
@@ -43,29 +44,72 @@ template <typename Tmemory, typename Treturn>
 ImageTexture<Tmemory, Treturn>::ImageTexture(
     std::unique_ptr<TextureMapping2D> mapping, const std::string &filename,
     bool doTrilinear, Float maxAniso, ImageWrap wrapMode, Float scale,
-    bool gamma)
+    bool gamma, TexelFormat format)
     : mapping(std::move(mapping)) {
-    mipmap =
-        GetTexture(filename, doTrilinear, maxAniso, wrapMode, scale, gamma);
+    mipmap = GetTexture(filename, doTrilinear, maxAniso, wrapMode, scale,
+                        gamma, format);
 }
 
 template <typename Tmemory, typename Treturn>
 MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
     const std::string &filename, bool doTrilinear, Float maxAniso,
-    ImageWrap wrap, Float scale, bool gamma) {
+    ImageWrap wrap, Float scale, bool gamma, TexelFormat format) {
     // Return _MIPMap_ from texture cache if present
-    TexInfo texInfo(filename, doTrilinear, maxAniso, wrap, scale, gamma);
+    TexInfo texInfo(filename, doTrilinear, maxAniso, wrap, scale, gamma,
+                    format);
     if (textures.find(texInfo) != textures.end())
         return textures[texInfo].get();
 
+    // Find the file that the filtered levels are cached in, if any
+    MIPMapFileKey fileKey;
+    if (MIPMapFile::Enabled())
+        fileKey = MIPMapFile::Key(
+            filename,
+            StringPrintf("channels %d scale %.9g gamma %d wrap %d",
+                         int(sizeof(Tmemory) / sizeof(Float)), scale,
+                         int(gamma), int(wrap)),
+            format);
+    int nChannels = sizeof(Tmemory) / sizeof(Float);
+
     // Create _MIPMap_ for _filename_
+    MIPMap<Tmemory> *mipmap = nullptr;
+    if (PbrtOptions.textureBudget > 0)
+        // Read the image when the texture is first looked up and keep its
+        // levels in the texture cache
+        mipmap = new MIPMap<Tmemory>(
+            [=](Point2i *resolution) {
+                return ReadTexels(filename, scale, gamma, resolution);
+            },
+            doTrilinear, maxAniso, wrap, format, fileKey);
+    else {
+        std::unique_ptr<MIPMapFile> file;
+        if (!fileKey.filename.empty())
+            file = MIPMapFile::Open(fileKey, nChannels);
+        if (file)
+            mipmap = new MIPMap<Tmemory>(*file, doTrilinear, maxAniso, wrap);
+        else {
+            Point2i resolution;
+            std::unique_ptr<Tmemory[]> texels =
+                ReadTexels(filename, scale, gamma, &resolution);
+            mipmap = new MIPMap<Tmemory>(resolution, texels.get(),
+                                         doTrilinear, maxAniso, wrap, format);
+            if (!fileKey.filename.empty()) mipmap->Write(fileKey);
+        }
+    }
+    textures[texInfo].reset(mipmap);
+    return mipmap;
+}
+
+template <typename Tmemory, typename Treturn>
+std::unique_ptr<Tmemory[]> ImageTexture<Tmemory, Treturn>::ReadTexels(
+    const std::string &filename, Float scale, bool gamma,
+    Point2i *resolution) {
     ProfilePhase _(Prof::TextureLoading);
-    Point2i resolution;
-    std::unique_ptr<RGBSpectrum[]> texels = ReadImage(filename, &resolution);
+    std::unique_ptr<RGBSpectrum[]> texels = ReadImage(filename, resolution);
     if (!texels) {
         Warning("Creating a constant grey texture to replace \"%s\".",
                 filename.c_str());
-        resolution.x = resolution.y = 1;
+        resolution->x = resolution->y = 1;
         RGBSpectrum *rgb = new RGBSpectrum[1];
         *rgb = RGBSpectrum(0.5f);
         texels.reset(rgb);
@@ -73,34 +117,37 @@ MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
 
     // Flip image in y; texture coordinate space has (0,0) at the lower
     // left corner.
-    for (int y = 0; y < resolution.y / 2; ++y)
-        for (int x = 0; x < resolution.x; ++x) {
-            int o1 = y * resolution.x + x;
-            int o2 = (resolution.y - 1 - y) * resolution.x + x;
+    for (int y = 0; y < resolution->y / 2; ++y)
+        for (int x = 0; x < resolution->x; ++x) {
+            int o1 = y * resolution->x + x;
+            int o2 = (resolution->y - 1 - y) * resolution->x + x;
             std::swap(texels[o1], texels[o2]);
         }
 
-    MIPMap<Tmemory> *mipmap = nullptr;
-    if (texels) {
-        // Convert texels to type _Tmemory_ and create _MIPMap_
-        std::unique_ptr<Tmemory[]> convertedTexels(
-            new Tmemory[resolution.x * resolution.y]);
-        for (int i = 0; i < resolution.x * resolution.y; ++i)
-            convertIn(texels[i], &convertedTexels[i], scale, gamma);
-        mipmap = new MIPMap<Tmemory>(resolution, convertedTexels.get(),
-                                     doTrilinear, maxAniso, wrap);
-    } else {
-        // Create one-valued _MIPMap_
-        Tmemory oneVal = scale;
-        mipmap = new MIPMap<Tmemory>(Point2i(1, 1), &oneVal);
-    }
-    textures[texInfo].reset(mipmap);
-    return mipmap;
+    // Convert texels to type _Tmemory_
+    std::unique_ptr<Tmemory[]> convertedTexels(
+        new Tmemory[resolution->x * resolution->y]);
+    for (int i = 0; i < resolution->x * resolution->y; ++i)
+        convertIn(texels[i], &convertedTexels[i], scale, gamma);
+    return convertedTexels;
 }
 
 template <typename Tmemory, typename Treturn>
 std::map<TexInfo, std::unique_ptr<MIPMap<Tmemory>>>
     ImageTexture<Tmemory, Treturn>::textures;
+
+// Returns the "texelformat" that MIP map levels are stored in, both in
+// memory and in cached MIP map files
+static TexelFormat FindTexelFormat(const TextureParams &tp) {
+    std::string format = tp.FindString("texelformat", "float");
+    if (format == "half") return TexelFormat::Half;
+    if (format == "srgb8") return TexelFormat::SRGB8;
+    if (format != "float")
+        Error("Texel format \"%s\" unknown. Using \"float\".",
+              format.c_str());
+    return TexelFormat::Float;
+}
+
 ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
                                                     const TextureParams &tp) {
     // Initialize 2D texture mapping _map_ from _tp_
@@ -140,7 +187,8 @@ ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
     bool gamma = tp.FindBool("gamma", HasExtension(filename, ".tga") ||
                                           HasExtension(filename, ".png"));
     return new ImageTexture<Float, Float>(std::move(map), filename, trilerp,
-                                          maxAniso, wrapMode, scale, gamma);
+                                          maxAniso, wrapMode, scale, gamma,
+                                          FindTexelFormat(tp));
 }
 
 ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
@@ -182,7 +230,8 @@ ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
     bool gamma = tp.FindBool("gamma", HasExtension(filename, ".tga") ||
                                           HasExtension(filename, ".png"));
     return new ImageTexture<RGBSpectrum, Spectrum>(
-        std::move(map), filename, trilerp, maxAniso, wrapMode, scale, gamma);
+        std::move(map), filename, trilerp, maxAniso, wrapMode, scale, gamma,
+        FindTexelFormat(tp));
 }
 
 }  // namespace pbrt
@@ -50,25 +50,28 @@ namespace pbrt {
 // TexInfo Declarations
 struct TexInfo {
     TexInfo(const std::string &f, bool dt, Float ma, ImageWrap wm, Float sc,
-            bool gamma)
+            bool gamma, TexelFormat format)
         : filename(f),
           doTrilinear(dt),
           maxAniso(ma),
           wrapMode(wm),
           scale(sc),
-          gamma(gamma) {}
+          gamma(gamma),
+          format(format) {}
     std::string filename;
     bool doTrilinear;
     Float maxAniso;
     ImageWrap wrapMode;
     Float scale;
     bool gamma;
+    TexelFormat format;
     bool operator<(const TexInfo &t2) const {
         if (filename != t2.filename) return filename < t2.filename;
         if (doTrilinear != t2.doTrilinear) return doTrilinear < t2.doTrilinear;
         if (maxAniso != t2.maxAniso) return maxAniso < t2.maxAniso;
         if (scale != t2.scale) return scale < t2.scale;
         if (gamma != t2.gamma) return !gamma;
+        if (format != t2.format) return format < t2.format;
         return wrapMode < t2.wrapMode;
     }
 };
@@ -80,7 +83,8 @@ class ImageTexture : public Texture<Treturn> {
     // ImageTexture Public Methods
     ImageTexture(std::unique_ptr<TextureMapping2D> m,
                  const std::string &filename, bool doTri, Float maxAniso,
-                 ImageWrap wm, Float scale, bool gamma);
+                 ImageWrap wm, Float scale, bool gamma,
+                 TexelFormat format = TexelFormat::Float);
     static void ClearCache() {
         textures.erase(textures.begin(), textures.end());
     }
@@ -97,7 +101,11 @@ class ImageTexture : public Texture<Treturn> {
     // ImageTexture Private Methods
     static MIPMap<Tmemory> *GetTexture(const std::string &filename,
                                        bool doTrilinear, Float maxAniso,
-                                       ImageWrap wm, Float scale, bool gamma);
+                                       ImageWrap wm, Float scale, bool gamma,
+                                       TexelFormat format);
+    static std::unique_ptr<Tmemory[]> ReadTexels(const std::string &filename,
+                                                 Float scale, bool gamma,
+                                                 Point2i *resolution);
     static void convertIn(const RGBSpectrum &from, RGBSpectrum *to, Float scale,
                           bool gamma) {
         for (int i = 0; i < RGBSpectrum::nSamples; ++i)
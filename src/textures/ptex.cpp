@@ -35,6 +35,7 @@
 
 #include "error.h"
 #include "interaction.h"
+#include "parallel.h"
 #include "paramset.h"
 #include "stats.h"
 
@@ -50,7 +51,10 @@ int nActiveTextures;
 Ptex::PtexCache *cache;
 
 STAT_COUNTER("Texture/Ptex lookups", nLookups);
+STAT_COUNTER("Texture/Ptex filters created", nFiltersCreated);
 STAT_COUNTER("Texture/Ptex files accessed", nFilesAccessed);
+STAT_COUNTER("Texture/Ptex file reopens", nFileReopens);
+STAT_COUNTER("Texture/Ptex peak open files", peakFilesOpen);
 STAT_COUNTER("Texture/Ptex block reads", nBlockReads);
 STAT_MEMORY_COUNTER("Memory/Ptex peak memory used", peakMemoryUsed);
 
@@ -60,13 +64,27 @@ struct : public PtexErrorHandler {
 
 }  // anonymous namespace
 
+// A filter and the texture it was created for.  The cache only ever hands
+// out one _Ptex::PtexTexture_ per file, which it keeps until the cache is
+// released, so a thread's filter stays valid across lookups as long as the
+// lookup holds a reference to the texture while evaluating it.  Holding
+// references between lookups would keep the cache from closing files and
+// freeing texture data.
+struct PtexThreadFilter {
+    Ptex::PtexTexture *texture = nullptr;
+    Ptex::PtexFilter *filter = nullptr;
+};
+
 // PtexTexture Method Definitions
 template <typename T>
-PtexTexture<T>::PtexTexture(const std::string &filename) : filename(filename) {
+PtexTexture<T>::PtexTexture(const std::string &filename)
+    : filename(filename),
+      filters(new PtexThreadFilter[MaxThreadIndex()]),
+      nFilters(MaxThreadIndex()) {
     if (!cache) {
         CHECK_EQ(nActiveTextures, 0);
-        int maxFiles = 100;
-        size_t maxMem = 0;  // unlimited. TODO: FIXME?
+        int maxFiles = std::max(1, PbrtOptions.ptexMaxFiles);
+        size_t maxMem = size_t(PbrtOptions.ptexBudget * 1024 * 1024);
         bool premultiply = true;
 
         cache = Ptex::PtexCache::create(maxFiles, maxMem, premultiply, nullptr,
@@ -96,11 +114,15 @@ PtexTexture<T>::PtexTexture(const std::string &filename) : filename(filename) {
 
 template <typename T>
 PtexTexture<T>::~PtexTexture() {
+    for (int i = 0; i < nFilters; ++i)
+        if (filters[i].filter) filters[i].filter->release();
     if (--nActiveTextures == 0) {
         LOG(INFO) << "Releasing ptex cache";
         Ptex::PtexCache::Stats stats;
         cache->getStats(stats);
         nFilesAccessed += stats.filesAccessed;
+        nFileReopens += stats.fileReopens;
+        peakFilesOpen = stats.peakFilesOpen;
         nBlockReads += stats.blockReads;
         peakMemoryUsed = stats.peakMemUsed;
 
@@ -142,16 +164,25 @@ T PtexTexture<T>::Evaluate(const SurfaceInteraction &si) const {
     Ptex::String error;
     Ptex::PtexTexture *texture = cache->get(filename.c_str(), error);
     CHECK_NOTNULL(texture);
-    // TODO: make the filter an option?
-    Ptex::PtexFilter::Options opts(Ptex::PtexFilter::FilterType::f_bspline);
-    Ptex::PtexFilter *filter = Ptex::PtexFilter::getFilter(texture, opts);
+
+    // Reuse this thread's filter if it was created for the same texture
+    CHECK_LT(ThreadIndex, nFilters);
+    PtexThreadFilter &tf = filters[ThreadIndex];
+    if (tf.texture != texture) {
+        if (tf.filter) tf.filter->release();
+        // TODO: make the filter an option?
+        Ptex::PtexFilter::Options opts(
+            Ptex::PtexFilter::FilterType::f_bspline);
+        tf.filter = Ptex::PtexFilter::getFilter(texture, opts);
+        tf.texture = texture;
+        ++nFiltersCreated;
+    }
     int nc = texture->numChannels();
 
     float result[3];
     int firstChan = 0;
-    filter->eval(result, firstChan, nc, si.faceIndex, si.uv[0],
-                 si.uv[1], si.dudx, si.dvdx, si.dudy, si.dvdy);
-    filter->release();
+    tf.filter->eval(result, firstChan, nc, si.faceIndex, si.uv[0],
+                    si.uv[1], si.dudx, si.dvdx, si.dudy, si.dvdy);
     texture->release();
 
     return fromResult<T>(nc, result);
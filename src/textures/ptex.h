@@ -47,6 +47,8 @@
 namespace pbrt {
 
 // PtexTexture Declarations
+struct PtexThreadFilter;
+
 template <typename T>
 class PtexTexture : public Texture<T> {
   public:
@@ -56,8 +58,13 @@ class PtexTexture : public Texture<T> {
     T Evaluate(const SurfaceInteraction &) const;
 
   private:
+    // PtexTexture Private Data
     bool valid;
     const std::string filename;
+    // Each thread's filter for the texture, which is reused by all of the
+    // thread's lookups
+    std::unique_ptr<PtexThreadFilter[]> filters;
+    int nFilters;
 };
 
 PtexTexture<Float> *CreatePtexFloatTexture(const Transform &tex2world,
@@ -0,0 +1,212 @@
+// bvhbench.cpp
+//
+// Traversal microbenchmark for the binary and wide BVH layouts: builds the
+// same random triangle soup with each node width and reports the number of
+// rays traced per second for closest hit and shadow queries, both for
+// incoherent rays traced one at a time and for batches of coherent rays, like
+// the camera rays of a pixel, traced one at a time and as a batch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "pbrt.h"
+#include "api.h"
+#include "rng.h"
+#include "primitive.h"
+#include "sampling.h"
+#include "accelerators/bvh.h"
+#include "shapes/triangle.h"
+
+using namespace pbrt;
+
+static void usage() {
+    fprintf(stderr,
+            "usage: bvhbench [--tris <n>] [--rays <n>] [--nthreads <n>] "
+            "[--splitmethod <sah|hlbvh|middle|equal|sbvh>]\n");
+    exit(1);
+}
+
+static std::vector<std::shared_ptr<Primitive>> RandomTriangles(RNG &rng,
+                                                               int nTris) {
+    static Transform identity;
+    std::vector<Point3f> p;
+    std::vector<int> indices;
+    for (int i = 0; i < nTris; ++i) {
+        Point3f c(Lerp(rng.UniformFloat(), -1, 1),
+                  Lerp(rng.UniformFloat(), -1, 1),
+                  Lerp(rng.UniformFloat(), -1, 1));
+        Float size = Lerp(rng.UniformFloat(), .005, .05);
+        for (int v = 0; v < 3; ++v) {
+            Vector3f d(rng.UniformFloat() - .5f, rng.UniformFloat() - .5f,
+                       rng.UniformFloat() - .5f);
+            indices.push_back(p.size());
+            p.push_back(c + size * d);
+        }
+    }
+    std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+        &identity, &identity, false, nTris, &indices[0], p.size(), &p[0],
+        nullptr, nullptr, nullptr, nullptr, nullptr);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const auto &t : tris)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            t, nullptr, nullptr, MediumInterface()));
+    return prims;
+}
+
+int main(int argc, char *argv[]) {
+    int nTris = 1000000, nRays = 1000000, nThreads = 0;
+    BVHAccel::SplitMethod splitMethod = BVHAccel::SplitMethod::SAH;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 == argc) usage();
+        if (!strcmp(argv[i], "--tris"))
+            nTris = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rays"))
+            nRays = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--nthreads"))
+            nThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--splitmethod")) {
+            std::string sm = argv[++i];
+            if (sm == "sah")
+                splitMethod = BVHAccel::SplitMethod::SAH;
+            else if (sm == "hlbvh")
+                splitMethod = BVHAccel::SplitMethod::HLBVH;
+            else if (sm == "middle")
+                splitMethod = BVHAccel::SplitMethod::Middle;
+            else if (sm == "equal")
+                splitMethod = BVHAccel::SplitMethod::EqualCounts;
+            else if (sm == "sbvh")
+                splitMethod = BVHAccel::SplitMethod::SBVH;
+            else
+                usage();
+        } else
+            usage();
+    }
+    if (nTris <= 0 || nRays <= 0) usage();
+
+    Options opt;
+    opt.quiet = true;
+    opt.nThreads = nThreads;
+    pbrtInit(opt);
+
+    RNG rng;
+    std::vector<std::shared_ptr<Primitive>> prims = RandomTriangles(rng, nTris);
+
+    // Incoherent rays from a sphere around the scene towards points inside
+    std::vector<Ray> rays;
+    rays.reserve(nRays);
+    for (int i = 0; i < nRays; ++i) {
+        Point2f u(rng.UniformFloat(), rng.UniformFloat());
+        Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+        Point3f target(Lerp(rng.UniformFloat(), -1, 1),
+                       Lerp(rng.UniformFloat(), -1, 1),
+                       Lerp(rng.UniformFloat(), -1, 1));
+        rays.push_back(Ray(o, target - o));
+    }
+
+    // Batches of rays from a common origin through a small window, like the
+    // camera rays of one pixel
+    const int batchSize = 16;
+    std::vector<Ray> coherentRays;
+    coherentRays.reserve(nRays);
+    while (coherentRays.size() < nRays) {
+        Point2f u(rng.UniformFloat(), rng.UniformFloat());
+        Point3f o = Point3f(0, 0, 0) + 3 * UniformSampleSphere(u);
+        Point3f target(Lerp(rng.UniformFloat(), -1, 1),
+                       Lerp(rng.UniformFloat(), -1, 1),
+                       Lerp(rng.UniformFloat(), -1, 1));
+        for (int i = 0; i < batchSize && coherentRays.size() < nRays; ++i) {
+            Vector3f jitter(rng.UniformFloat() - .5f, rng.UniformFloat() - .5f,
+                            rng.UniformFloat() - .5f);
+            coherentRays.push_back(Ray(o, target + .01f * jitter - o));
+        }
+    }
+
+    printf("%d triangles, %d rays\n", nTris, nRays);
+    int referenceHits = -1;
+    for (int width : {2, 4, 8}) {
+        auto start = std::chrono::steady_clock::now();
+        BVHAccel bvh(prims, 4, splitMethod, width);
+        auto built = std::chrono::steady_clock::now();
+
+        int hits = 0;
+        for (const Ray &ray : rays) {
+            Ray r = ray;
+            SurfaceInteraction isect;
+            if (bvh.Intersect(r, &isect)) ++hits;
+        }
+        auto traced = std::chrono::steady_clock::now();
+
+        int shadowHits = 0;
+        for (const Ray &ray : rays)
+            if (bvh.IntersectP(ray)) ++shadowHits;
+        auto shadowTraced = std::chrono::steady_clock::now();
+
+        typedef std::chrono::duration<double> Seconds;
+        double buildTime = Seconds(built - start).count();
+        double traceTime = Seconds(traced - built).count();
+        double shadowTime = Seconds(shadowTraced - traced).count();
+        printf("width %d: build %.3fs, Intersect %.2f Mrays/s, "
+               "IntersectP %.2f Mrays/s, %d hits\n",
+               width, buildTime, nRays / traceTime * 1e-6,
+               nRays / shadowTime * 1e-6, hits);
+        printf("width %d: %.1f MB, keeps %d of %d primitives\n", width,
+               bvh.MemoryBytes() / (1024. * 1024.), (int)bvh.NumPrimitives(),
+               nTris);
+
+        // Coherent rays, one at a time and in batches
+        auto coherentStart = std::chrono::steady_clock::now();
+        int coherentHits = 0;
+        for (const Ray &ray : coherentRays) {
+            Ray r = ray;
+            SurfaceInteraction isect;
+            if (bvh.Intersect(r, &isect)) ++coherentHits;
+        }
+        auto coherentTraced = std::chrono::steady_clock::now();
+        int batchHits = 0;
+        for (size_t first = 0; first < coherentRays.size();
+             first += batchSize) {
+            int n = std::min<int>(batchSize, coherentRays.size() - first);
+            Ray r[batchSize];
+            SurfaceInteraction isects[batchSize];
+            bool hit[batchSize];
+            std::copy(&coherentRays[first], &coherentRays[first] + n, r);
+            bvh.IntersectN(r, isects, hit, n);
+            for (int i = 0; i < n; ++i) batchHits += hit[i];
+        }
+        auto batchTraced = std::chrono::steady_clock::now();
+        int batchShadowHits = 0;
+        for (size_t first = 0; first < coherentRays.size();
+             first += batchSize) {
+            int n = std::min<int>(batchSize, coherentRays.size() - first);
+            bool occluded[batchSize];
+            bvh.IntersectPN(&coherentRays[first], occluded, n);
+            for (int i = 0; i < n; ++i) batchShadowHits += occluded[i];
+        }
+        auto batchShadowTraced = std::chrono::steady_clock::now();
+        printf("width %d coherent: Intersect %.2f Mrays/s, IntersectN %.2f "
+               "Mrays/s, IntersectPN %.2f Mrays/s\n",
+               width,
+               nRays / Seconds(coherentTraced - coherentStart).count() * 1e-6,
+               nRays / Seconds(batchTraced - coherentTraced).count() * 1e-6,
+               nRays / Seconds(batchShadowTraced - batchTraced).count() *
+                   1e-6);
+        if (batchHits != coherentHits || batchShadowHits != coherentHits)
+            fprintf(stderr, "width %d: batched rays found %d / %d hits, "
+                    "single rays %d\n", width, batchHits, batchShadowHits,
+                    coherentHits);
+
+        if (hits != shadowHits)
+            fprintf(stderr, "width %d: Intersect and IntersectP disagree "
+                    "(%d vs %d hits)\n", width, hits, shadowHits);
+        if (referenceHits == -1)
+            referenceHits = hits;
+        else if (hits != referenceHits)
+            fprintf(stderr, "width %d: %d hits, binary BVH found %d\n",
+                    width, hits, referenceHits);
+    }
+
+    pbrtCleanup();
+    return 0;
+}
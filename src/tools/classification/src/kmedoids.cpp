@@ -6,6 +6,9 @@
 #include "pbrt.h"
 #include "core/parallel.h"
 #include <random>
+#include <map>
+#include <fstream>
+#include <numeric>
 
 /*template <typename T>
 T Label::geometricMean(const std::vector<pbrt::Point3f> &dataset) const {
@@ -30,6 +33,26 @@ T Label::geometricMean(const std::vector<pbrt::Point3f> &dataset) const {
 
 namespace Kmedoids {
 
+void Label::merge(const LabelAccumulator &acc) {
+  if (acc.elements.empty())
+    return;
+
+  if (elements.empty()) {
+    meanlength = acc.mean;
+    sigma_sq = acc.m2;
+    currentcost = acc.cost;
+  } else {
+    // Pairwise update of the running mean/variance
+    const double n = elements.size(), m = acc.elements.size();
+    const double delta = acc.mean - meanlength;
+    meanlength += delta * m / (n + m);
+    sigma_sq += acc.m2 + delta * delta * n * m / (n + m);
+    currentcost += acc.cost;
+  }
+
+  elements.insert(elements.end(), acc.elements.begin(), acc.elements.end());
+}
+
 void Classifier::run() {
   std::cerr << "Kmedoids Classifier k = " << k << std::endl;
 
@@ -73,10 +96,8 @@ void Classifier::run() {
       sortElement(i);
     }
     */
-    while(!sampleset.empty()) {
-      sortElement(sampleset[0]);
-      sampleset.erase(sampleset.begin());
-    }
+    sortElements(sampleset);
+    sampleset.clear();
 
     // Sum up all label costs
     cost = 0;
@@ -100,9 +121,17 @@ void Classifier::run() {
   }
 
   std::cerr << "Assign remaining paths" << std::endl;
-  for(int64_t i = 0; i < paths.size(); ++i) {
+  // Assign by blocks to bound the size of the id list
+  constexpr uint64_t blocksize = 1 << 20;
+  std::vector<uint64_t> block;
+  block.reserve(blocksize);
+  for(uint64_t i = 0; i < paths.size(); ++i) {
     if(samples.find(i) == samples.end()) {
-      sortElement(i);
+      block.push_back(i);
+    }
+    if(block.size() == blocksize || i + 1 == paths.size()) {
+      sortElements(block);
+      block.clear();
     }
   }
 }
@@ -112,18 +141,67 @@ std::vector<std::shared_ptr<Label>> Classifier::getLabels() {
   return labels;
 }
 
-void Classifier::sortElement(int i) {
+void Classifier::sortElements(const std::vector<uint64_t> &ids) {
+  AssignElements(labels, paths, ids);
+}
+
+// Closest label of a path and its distance
+static int ClosestLabel(const std::vector<std::shared_ptr<Label>> &labels, const pbrt::path_entry &p,
+                        float *min_dist) {
   int min_id = 0;
-  float min_dist = labels[0]->distance(paths[i]);
-  //pbrt::ParallelFor([&](uint64_t j) {
+  *min_dist = labels[0]->distance(p);
   for (int j = 1; j < labels.size(); ++j) {
-    if (labels[j]->distance(paths[i]) < min_dist) {
-      min_dist = labels[j]->distance(paths[i]);
+    float dist = labels[j]->distance(p);
+    if (dist < *min_dist) {
+      *min_dist = dist;
       min_id = j;
     }
-  } //, labels.size());
+  }
+  return min_id;
+}
+
+void AssignElements(const std::vector<std::shared_ptr<Label>> &labels, const PathFile &paths,
+                    const std::vector<uint64_t> &ids) {
+  // One accumulator per thread and label, merged once all elements are sorted
+  std::vector<std::vector<LabelAccumulator>> accumulators(pbrt::MaxThreadIndex(),
+                                                          std::vector<LabelAccumulator>(labels.size()));
+  constexpr int64_t chunksize = 256;
+  const int64_t nchunks = (ids.size() + chunksize - 1) / chunksize;
+
+  pbrt::ParallelFor([&](int64_t chunk) {
+    std::vector<LabelAccumulator> &acc = accumulators[pbrt::ThreadIndex];
+    const uint64_t last = std::min<uint64_t>(ids.size(), (chunk + 1) * chunksize);
+    for (uint64_t n = chunk * chunksize; n < last; ++n) {
+      const pbrt::path_entry p = paths[ids[n]];
+      float min_dist;
+      int min_id = ClosestLabel(labels, p, &min_dist);
+      acc[min_id].add(ids[n], labels[min_id]->sample_value(p, min_dist));
+    }
+  }, nchunks);
 
-  labels[min_id]->label_element(paths[i], i);
+  for (int j = 0; j < labels.size(); ++j) {
+    for (const std::vector<LabelAccumulator> &acc : accumulators) {
+      labels[j]->merge(acc[j]);
+    }
+  }
+}
+
+double AssignmentCost(const std::vector<std::shared_ptr<Label>> &labels, const PathFile &paths,
+                      const std::vector<uint64_t> &ids) {
+  std::vector<double> costs(pbrt::MaxThreadIndex(), 0.);
+  constexpr int64_t chunksize = 256;
+  const int64_t nchunks = (ids.size() + chunksize - 1) / chunksize;
+
+  pbrt::ParallelFor([&](int64_t chunk) {
+    const uint64_t last = std::min<uint64_t>(ids.size(), (chunk + 1) * chunksize);
+    for (uint64_t n = chunk * chunksize; n < last; ++n) {
+      float min_dist;
+      ClosestLabel(labels, paths[ids[n]], &min_dist);
+      costs[pbrt::ThreadIndex] += min_dist;
+    }
+  }, nchunks);
+
+  return std::accumulate(costs.begin(), costs.end(), 0.);
 }
 
 void Classifier::recalculateCentroids() {
@@ -169,6 +247,146 @@ bool Classifier::end() {
   */
 }
 
+std::vector<std::shared_ptr<Label>> CentroidGenerator::seedCentroids(int k, const std::vector<uint64_t> &ids) {
+  std::vector<std::shared_ptr<Label>> labels;
+  if (ids.empty())
+    return labels;
+
+  // First medoid uniformly, then weighted by the squared distance to the closest one
+  std::vector<double> weights(ids.size(), std::numeric_limits<double>::max()), cdf(ids.size());
+  uint64_t next = std::min<uint64_t>(ids.size() - 1, rng(generator) * ids.size());
+  while (labels.size() < k) {
+    std::shared_ptr<Label> label = generateCentroid(paths[ids[next]]);
+    labels.push_back(label);
+    if (labels.size() == k)
+      break;
+
+    pbrt::ParallelFor([&](int64_t i) {
+      const double d = label->distance(paths[ids[i]]);
+      weights[i] = std::min(weights[i], d * d);
+    }, ids.size(), 256);
+
+    std::partial_sum(weights.begin(), weights.end(), cdf.begin());
+    if (cdf.back() > 0) {
+      next = std::upper_bound(cdf.begin(), cdf.end(), rng(generator) * cdf.back()) - cdf.begin();
+      next = std::min<uint64_t>(next, ids.size() - 1);
+    } else {
+      // All samples already match a medoid
+      next = std::min<uint64_t>(ids.size() - 1, rng(generator) * ids.size());
+    }
+  }
+
+  return labels;
+}
+
+void SampledClassifier::run() {
+  std::cerr << "Sampled Kmedoids Classifier k = " << k << std::endl;
+  const uint64_t nchunks = std::max<uint64_t>(1, (paths.size() + chunksize - 1) / chunksize);
+
+  // Candidate medoid sets are compared on the same uniform sample of the file
+  std::vector<uint64_t> evaluation = drawSample(0, paths.size(), samplesize);
+  double bestcost = std::numeric_limits<double>::max();
+
+  for (int s = 0; s < nsamples; ++s) {
+    // Spread the draws over the file, each one reads a single chunk
+    const uint64_t chunk = (uint64_t(s) * nchunks) / nsamples;
+    const uint64_t first = chunk * chunksize;
+    const uint64_t last = std::min<uint64_t>(paths.size(), first + chunksize);
+    std::vector<uint64_t> sample = drawSample(first, last, samplesize);
+
+    std::vector<std::shared_ptr<Label>> candidates = generator->seedCentroids(k, sample);
+    if (candidates.empty())
+      continue;
+    refine(candidates, sample);
+
+    const double cost = AssignmentCost(candidates, paths, evaluation);
+    std::cerr << "Sample " << s << " (paths " << first << "-" << last << ") cost = " << cost << std::endl;
+    if (cost < bestcost) {
+      bestcost = cost;
+      labels = candidates;
+    }
+  }
+}
+
+std::vector<uint64_t> SampledClassifier::assign(const std::string &filename) {
+  std::ofstream out;
+  if (!filename.empty()) {
+    out.open(filename, std::ios::out | std::ios::binary);
+    if (!out) {
+      std::cerr << "Output file error " << filename << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<std::vector<uint64_t>> counts(pbrt::MaxThreadIndex(), std::vector<uint64_t>(labels.size(), 0));
+  std::vector<uint32_t> chunklabels;
+  for (uint64_t first = 0; first < paths.size(); first += chunksize) {
+    const uint64_t last = std::min<uint64_t>(paths.size(), first + chunksize);
+    chunklabels.resize(last - first);
+    pbrt::ParallelFor([&](int64_t i) {
+      float min_dist;
+      chunklabels[i] = ClosestLabel(labels, paths[first + i], &min_dist);
+      ++counts[pbrt::ThreadIndex][chunklabels[i]];
+    }, last - first, 256);
+
+    if (out.is_open())
+      out.write((const char *)chunklabels.data(), chunklabels.size() * sizeof(uint32_t));
+    std::cerr << "[" << (last / (float)paths.size()) * 100.f << "%] \t" << last << " paths labelled" << std::endl;
+  }
+
+  std::vector<uint64_t> sizes(labels.size(), 0);
+  for (const std::vector<uint64_t> &c : counts) {
+    for (int j = 0; j < labels.size(); ++j) {
+      sizes[j] += c[j];
+    }
+  }
+  return sizes;
+}
+
+std::vector<uint64_t> SampledClassifier::drawSample(uint64_t first, uint64_t last, uint64_t n) {
+  std::vector<uint64_t> sample;
+  if (last - first <= n) {
+    sample.resize(last - first);
+    std::iota(sample.begin(), sample.end(), first);
+    return sample;
+  }
+
+  std::uniform_int_distribution<uint64_t> dist(first, last - 1);
+  std::set<uint64_t> ids;
+  while (ids.size() < n) {
+    ids.insert(dist(rng));
+  }
+  sample.assign(ids.begin(), ids.end());
+  return sample;
+}
+
+void SampledClassifier::refine(std::vector<std::shared_ptr<Label>> &candidates, const std::vector<uint64_t> &sample) {
+  for (int iteration = 0; iteration < maxiterations; ++iteration) {
+    AssignElements(candidates, paths, sample);
+
+    int updated = 0;
+    for (int i = 0; i < candidates.size(); ++i) {
+      if (candidates[i]->size() == 0) {
+        candidates[i] = generator->generateRandomCentroid();
+        ++updated;
+        continue;
+      }
+      candidates[i]->recompute_centroid(paths);
+      updated += candidates[i]->fixed_medoid() ? 0 : 1;
+    }
+
+    // Start the next assignment from empty labels
+    std::vector<uint64_t> unused;
+    for (std::shared_ptr<Label> label : candidates) {
+      label->getElementsToSort(unused);
+      label->elements.clear();
+    }
+
+    if (!updated)
+      break;
+  }
+}
+
 // ray origin -> destination
 
 
@@ -193,10 +411,18 @@ std::shared_ptr<Label> DistanceGenerator::generateRandomCentroid() {
   return std::shared_ptr<Label>(new DistanceLabel(v));
 }
 
-float DistanceLabel::distance(const pbrt::path_entry &p) {
+std::shared_ptr<Label> DistanceGenerator::generateCentroid(const pbrt::path_entry &p) {
+  return std::shared_ptr<Label>(new DistanceLabel(pbrt::FromArray(p.vertices.back().v) - pbrt::FromArray(p.vertices.front().v)));
+}
+
+float DistanceLabel::distance(const pbrt::path_entry &p) const {
   return distance(p, length);
 }
 
+float DistanceLabel::sample_value(const pbrt::path_entry &p, float dist) const {
+  return pbrt::Vector3f(pbrt::FromArray(p.vertices.back().v) - pbrt::FromArray(p.vertices.front().v)).Length();
+}
+
 void DistanceLabel::recompute_centroid(const PathFile &pathfile) {
   std::cerr << "Centroid recomputation";
   std::atomic<float> min_dist;
@@ -243,21 +469,6 @@ void DistanceLabel::recompute_centroid(const PathFile &pathfile) {
             " variance = " << sigma_sq << std::endl;
 }
 
-void DistanceLabel::update_mean(const pbrt::path_entry &p) {
-  const float length = pbrt::Vector3f(pbrt::FromArray(p.vertices.back().v) - pbrt::FromArray(p.vertices.front().v)).Length();
-  if (!elements.empty()) {
-    const float m_old = meanlength;
-    meanlength += (length - meanlength) / elements.size();
-    sigma_sq += (length-m_old)*(length-meanlength);
-    currentcost += length;
-  }
-  else {
-    meanlength = length;
-    sigma_sq = 0;
-    currentcost = 0;
-  }
-}
-
 float DistanceLabel::distance(const pbrt::path_entry &p, float centroidlength) const {
   return std::fabs(pbrt::Vector3f(pbrt::FromArray(p.vertices.back().v) - pbrt::FromArray(p.vertices.front().v)).Length()
                    - centroidlength);
@@ -282,7 +493,12 @@ std::shared_ptr<Label> LevenshteinGenerator::generateRandomCentroid() {
   return std::shared_ptr<Label>(new LevenshteinDistance(paths[random_id].path));
 }
 
-int LevenshteinDistance::distance(const std::string &s1, const std::string &s2) const {
+std::shared_ptr<Label> LevenshteinGenerator::generateCentroid(const pbrt::path_entry &p) {
+  return std::shared_ptr<Label>(new LevenshteinDistance(p.path));
+}
+
+// Classic dynamic programming edit distance, one column at a time
+int LevenshteinDP(const std::string &s1, const std::string &s2) {
 	// To change the type this function manipulates and returns, change
 	// the return type and the types of the two variables below.
 	int s1len = s1.size();
@@ -312,35 +528,95 @@ int LevenshteinDistance::distance(const std::string &s1, const std::string &s2)
 	return result;
 }
 
-float LevenshteinDistance::distance(const pbrt::path_entry &p) {
-  return last_distance = distance(centroid, p.path);
+// Myers/Hyyrö bit-vector edit distance; the pattern must fit in 64 bits
+int LevenshteinBitParallel(const std::string &pattern, const std::string &text) {
+	const int m = pattern.size();
+	if (m == 0)
+		return text.size();
+
+	// Match masks: only the entries of characters in use are cleared
+	uint64_t peq[256];
+	for (unsigned char c : text)
+		peq[c] = 0;
+	for (unsigned char c : pattern)
+		peq[c] = 0;
+	for (int i = 0; i < m; ++i)
+		peq[(unsigned char)pattern[i]] |= uint64_t(1) << i;
+
+	const uint64_t last = uint64_t(1) << (m - 1);
+	uint64_t pv = ~uint64_t(0), mv = 0;
+	int score = m;
+	for (unsigned char c : text) {
+		const uint64_t eq = peq[c];
+		const uint64_t xv = eq | mv;
+		const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+		if (ph & last)
+			++score;
+		else if (mh & last)
+			--score;
+		// First row of the table grows by one per text character
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+	}
+	return score;
+}
+
+int LevenshteinEditDistance(const std::string &s1, const std::string &s2) {
+	const std::string &shortest = s1.size() <= s2.size() ? s1 : s2;
+	const std::string &longest = s1.size() <= s2.size() ? s2 : s1;
+	if (shortest.size() <= 64)
+		return LevenshteinBitParallel(shortest, longest);
+	return LevenshteinDP(s1, s2);
+}
+
+int LevenshteinDistance::distance(const std::string &s1, const std::string &s2) const {
+	return LevenshteinEditDistance(s1, s2);
+}
+
+float LevenshteinDistance::distance(const pbrt::path_entry &p) const {
+  return distance(centroid, p.path);
 }
 
 void LevenshteinDistance::recompute_centroid(const PathFile &p) {
   std::cerr << "Centroid recomputation";
-  std::atomic<uint64_t> min_dist;
-  min_dist.store(std::numeric_limits<unsigned long>::max());
-  std::atomic<uint64_t> best_candidate;
-  best_candidate.store(0);
 
-  //pbrt::ParallelInit();
-  pbrt::ParallelFor([&](uint64_t i) {
-    std::string s(p[elements[i]].path);
-    uint64_t localdistsum = distance(s, centroid); // Account for distance to current mean
-    for (int j = 0; j < elements.size(); ++j) {
-      localdistsum += distance(s, p[elements[j]].path);
-      /*
-      if (localdistsum > min_dist)
-        break;
-      */
-    }
+  // Elements sharing an expression have the same distance sum: compare each
+  // pair of distinct expressions once, weighted by their element counts
+  std::map<std::string, std::pair<uint64_t, uint64_t>> groups; // expression -> (count, first element)
+  for (uint64_t i = 0; i < elements.size(); ++i) {
+    ++groups.insert(std::make_pair(p.expression(elements[i]), std::make_pair(uint64_t(0), i))).first->second.first;
+  }
 
-    if (localdistsum < min_dist) {
-      min_dist = localdistsum;
-      best_candidate = i;
-    }
+  std::vector<const std::string *> exprs;
+  std::vector<uint64_t> counts, firsts;
+  for (const auto &g : groups) {
+    exprs.push_back(&g.first);
+    counts.push_back(g.second.first);
+    firsts.push_back(g.second.second);
+  }
 
-  }, elements.size());
+  std::vector<uint64_t> distsums(exprs.size());
+  pbrt::ParallelFor([&](int64_t i) {
+    uint64_t localdistsum = distance(*exprs[i], centroid); // Account for distance to current mean
+    for (size_t j = 0; j < exprs.size(); ++j) {
+      if (j != i)
+        localdistsum += counts[j] * distance(*exprs[i], *exprs[j]);
+    }
+    distsums[i] = localdistsum;
+  }, exprs.size());
+
+  uint64_t min_dist = std::numeric_limits<uint64_t>::max();
+  uint64_t best_candidate = 0;
+  for (size_t i = 0; i < distsums.size(); ++i) {
+    if (distsums[i] < min_dist) {
+      min_dist = distsums[i];
+      best_candidate = firsts[i];
+    }
+  }
 
   if(min_dist < currentcost) {
     // Update medoid
@@ -365,23 +641,8 @@ void LevenshteinDistance::getElementsToSort(std::vector<uint64_t> &sampleset) {
   resortelements = false;
 }
 
-void LevenshteinDistance::update_mean(const pbrt::path_entry &p) {
-  if (!elements.empty()) {
-    const float m_old = meanlength;
-    meanlength += (last_distance - meanlength) / elements.size();
-    sigma_sq += (last_distance-m_old)*(last_distance-meanlength);
-  }
-  else {
-    meanlength = last_distance;
-    sigma_sq = 0;
-    currentcost = 0;
-  }
-
-  currentcost += last_distance;
-}
-
-float PathDistance::distance(const pbrt::path_entry &p) {
-  return last_distance = distance(centroid, p);
+float PathDistance::distance(const pbrt::path_entry &p) const {
+  return distance(centroid, p);
 }
 
 // todo: generic centroid recomputation
@@ -419,7 +680,7 @@ void PathDistance::recompute_centroid(const PathFile &p) {
             " variance = " << sigma_sq << std::endl;
 }
 
-float PathDistance::distance(const pbrt::path_entry &p1, const pbrt::path_entry &p2) {
+float PathDistance::distance(const pbrt::path_entry &p1, const pbrt::path_entry &p2) const {
   // find the closest match between paths
   const pbrt::path_entry &s_path = p1.pathlen < p2.pathlen ? p1 : p2;
   const pbrt::path_entry &l_path = p1.pathlen >= p2.pathlen ? p1 : p2;
@@ -448,22 +709,11 @@ void PathDistance::getElementsToSort(std::vector<uint64_t> &sampleset) {
   currentcost = 0;
 }
 
-void PathDistance::update_mean(const pbrt::path_entry &p) {
-  if (!elements.empty()) {
-    const float m_old = meanlength;
-    meanlength += (last_distance - meanlength) / elements.size();
-    sigma_sq += (last_distance-m_old)*(last_distance-meanlength);
-  }
-  else {
-    meanlength = last_distance;
-    sigma_sq = 0;
-    currentcost = 0;
-  }
-
-  currentcost += last_distance;
-}
-
 std::shared_ptr<Label> PathDistanceGenerator::generateRandomCentroid() {
   uint64_t random_id(rng(generator) * paths.size());
   return std::shared_ptr<Label>(new PathDistance(paths[random_id]));}
+
+std::shared_ptr<Label> PathDistanceGenerator::generateCentroid(const pbrt::path_entry &p) {
+  return std::shared_ptr<Label>(new PathDistance(p));
+}
 } // namespace Kmeans
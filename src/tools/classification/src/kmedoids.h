@@ -12,18 +12,36 @@
 
 namespace Kmedoids {
 
+// Elements assigned to a label by one thread, with their running statistics
+struct LabelAccumulator {
+    void add(uint64_t path_id, float value) {
+      elements.push_back(path_id);
+      const double delta = value - mean;
+      mean += delta / elements.size();
+      m2 += delta * (value - mean);
+      cost += value;
+    }
+
+    std::vector<uint64_t> elements;
+    double mean = 0;
+    double m2 = 0;
+    double cost = 0;
+};
+
 class Label {
   public:
     Label(bool resortelements = false) : resortelements(resortelements) {}
 
-    virtual float distance(const pbrt::path_entry &p) = 0;
+    // Must not modify the label: called concurrently during assignment
+    virtual float distance(const pbrt::path_entry &p) const = 0;
 
     virtual void recompute_centroid(const PathFile &p) = 0;
 
-    void label_element(const pbrt::path_entry &p, uint64_t path_id) {
-      update_mean(p);
-      elements.push_back(path_id);
-    }
+    // Value accumulated in the label mean/cost for an element at distance dist
+    virtual float sample_value(const pbrt::path_entry &p, float dist) const { return dist; }
+
+    // Appends elements sorted by a thread, merging their statistics
+    void merge(const LabelAccumulator &acc);
 
     virtual bool operator ==(const Label &b) const = 0;
 
@@ -36,9 +54,8 @@ class Label {
   protected:
     size_t currentcost;
     bool resortelements;
-
-  private:
-    virtual void update_mean(const pbrt::path_entry &p) = 0;
+    float meanlength;
+    float sigma_sq; // Variance
 };
 
 
@@ -49,6 +66,13 @@ class CentroidGenerator {
 
     virtual std::shared_ptr<Label> generateRandomCentroid() = 0;
 
+    // Label whose medoid is the given path
+    virtual std::shared_ptr<Label> generateCentroid(const pbrt::path_entry &p) = 0;
+
+    // k-means++ seeding: each new medoid is drawn among ids with probability
+    // proportional to its squared distance to the closest medoid so far
+    std::vector<std::shared_ptr<Label>> seedCentroids(int k, const std::vector<uint64_t> &ids);
+
   protected:
     PathFile paths;
     std::uniform_real_distribution<float> rng;
@@ -57,6 +81,14 @@ class CentroidGenerator {
   private:
 };
 
+// Assigns each id to its closest label, in parallel
+void AssignElements(const std::vector<std::shared_ptr<Label>> &labels, const PathFile &paths,
+                    const std::vector<uint64_t> &ids);
+
+// Sum over ids of the distance to the closest label
+double AssignmentCost(const std::vector<std::shared_ptr<Label>> &labels, const PathFile &paths,
+                      const std::vector<uint64_t> &ids);
+
 class Classifier {
   public:
     Classifier(int k, PathFile &f, std::shared_ptr<CentroidGenerator> g, int samplesize, int maxiterations = -1) :
@@ -74,7 +106,7 @@ class Classifier {
 
   private:
 
-    void sortElement(int i);
+    void sortElements(const std::vector<uint64_t> &ids);
 
     void recalculateCentroids();
 
@@ -92,6 +124,47 @@ class Classifier {
     std::vector<std::shared_ptr<Label>> labels;
 };
 
+// CLARA-style classifier for files too large to cluster whole: medoids are
+// searched on random samples drawn from chunks spread over the file, the set
+// with the lowest cost on a shared evaluation sample is kept, and assign()
+// labels every path in a second pass streaming the file chunk by chunk.
+class SampledClassifier {
+  public:
+    SampledClassifier(int k, PathFile &f, std::shared_ptr<CentroidGenerator> g, int samplesize, int nsamples,
+                      uint64_t chunksize, int maxiterations = 20) :
+            k(k), paths(f), generator(g), samplesize(samplesize), nsamples(nsamples), chunksize(chunksize),
+            maxiterations(maxiterations), rng(std::random_device()()) {
+      pbrt::ParallelInit();
+    }
+
+    void run();
+
+    // Labels the whole file; writes one uint32 label id per path to filename
+    // when it is not empty. Returns the number of paths of each label.
+    std::vector<uint64_t> assign(const std::string &filename);
+
+    std::vector<std::shared_ptr<Label>> getLabels() { return labels; }
+
+    ~SampledClassifier() {
+      pbrt::ParallelCleanup();
+    }
+
+  private:
+    std::vector<uint64_t> drawSample(uint64_t first, uint64_t last, uint64_t n);
+
+    void refine(std::vector<std::shared_ptr<Label>> &candidates, const std::vector<uint64_t> &sample);
+
+    int k;
+    PathFile &paths;
+    std::shared_ptr<CentroidGenerator> generator;
+    uint64_t samplesize;
+    int nsamples;
+    uint64_t chunksize;
+    int maxiterations;
+    std::mt19937 rng;
+    std::vector<std::shared_ptr<Label>> labels;
+};
+
 // Test class; euclidean distance in 3D space
 
 class DistanceLabel : public Label {
@@ -101,7 +174,8 @@ class DistanceLabel : public Label {
       std::cerr << "New Distance Label generated; length = " << length << std::endl;
     }
 
-    float distance(const pbrt::path_entry &p);
+    float distance(const pbrt::path_entry &p) const;
+    float sample_value(const pbrt::path_entry &p, float dist) const;
     void recompute_centroid(const PathFile &p);
     void getElementsToSort(std::vector<uint64_t> &sampleset);
     bool operator ==(const DistanceLabel &b) const {
@@ -115,12 +189,9 @@ class DistanceLabel : public Label {
 
   private:
     float distance(const pbrt::path_entry &p, float centroidlength) const;
-    void update_mean(const pbrt::path_entry &p);
 
     pbrt::Vector3f centroid;
     float length;
-    float meanlength;
-    float sigma_sq; // Variance
 };
 
 class DistanceGenerator : public CentroidGenerator {
@@ -128,11 +199,19 @@ class DistanceGenerator : public CentroidGenerator {
     DistanceGenerator(const PathFile &p);
 
     std::shared_ptr<Label> generateRandomCentroid();
+    std::shared_ptr<Label> generateCentroid(const pbrt::path_entry &p);
 
   private:
     pbrt::Bounds3f b;
 };
 
+// Edit distances between strings: by dynamic programming, by the
+// bit-parallel algorithm for patterns of at most 64 characters, and by
+// whichever of the two applies to the strings
+int LevenshteinDP(const std::string &s1, const std::string &s2);
+int LevenshteinBitParallel(const std::string &pattern, const std::string &text);
+int LevenshteinEditDistance(const std::string &s1, const std::string &s2);
+
 // Test class; Levenshtein distance between path notations
 
 class LevenshteinDistance : public Label {
@@ -141,7 +220,7 @@ class LevenshteinDistance : public Label {
       std::cerr << "New Distance Label generated; string = " << centroid << std::endl;
     }
 
-    float distance(const pbrt::path_entry &p);
+    float distance(const pbrt::path_entry &p) const;
 
     bool operator ==(const Label &b) const {
       const LevenshteinDistance *label_ptr = dynamic_cast<const LevenshteinDistance *>(&b);
@@ -154,16 +233,12 @@ class LevenshteinDistance : public Label {
 
     void recompute_centroid(const PathFile &p);
     void getElementsToSort(std::vector<uint64_t> &elements);
-    void update_mean(const pbrt::path_entry &p);
 
   private:
     int distance(const std::string &s1, const std::string &s2) const;
     std::string centroid;
     // uint64_t distsum;
-    uint64_t last_distance;
     float length;
-    float meanlength;
-    float sigma_sq; // Variance
 };
 
 class LevenshteinGenerator : public CentroidGenerator {
@@ -171,6 +246,7 @@ class LevenshteinGenerator : public CentroidGenerator {
     LevenshteinGenerator(const PathFile &p) : CentroidGenerator(p) {}
 
     std::shared_ptr<Label> generateRandomCentroid();
+    std::shared_ptr<Label> generateCentroid(const pbrt::path_entry &p);
 
   private:
 
@@ -182,7 +258,7 @@ class PathDistance : public Label {
       std::cerr << "New PathDistance label generated; path " << centroid.path << std::endl;
     }
 
-    float distance(const pbrt::path_entry &p);
+    float distance(const pbrt::path_entry &p) const;
 
     bool operator ==(const Label &b) const {
       const PathDistance *label_ptr = dynamic_cast<const PathDistance *>(&b);
@@ -195,16 +271,12 @@ class PathDistance : public Label {
 
     void recompute_centroid(const PathFile &p);
     void getElementsToSort(std::vector<uint64_t> &elements);
-    void update_mean(const pbrt::path_entry &p);
 
   private:
-    float distance(const pbrt::path_entry &p1, const pbrt::path_entry &p2);
+    float distance(const pbrt::path_entry &p1, const pbrt::path_entry &p2) const;
 
     pbrt::path_entry centroid;
-    float last_distance;
     float length;
-    float meanlength;
-    float sigma_sq; // Variance
 };
 
 class PathDistanceGenerator : public CentroidGenerator {
@@ -212,6 +284,7 @@ class PathDistanceGenerator : public CentroidGenerator {
     PathDistanceGenerator(const PathFile &p) : CentroidGenerator(p) {}
 
     std::shared_ptr<Label> generateRandomCentroid();
+    std::shared_ptr<Label> generateCentroid(const pbrt::path_entry &p);
 
   private:
 };
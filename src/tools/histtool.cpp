@@ -4,6 +4,7 @@
 // Error/Usage fct from imgtool.cpp
 
 #include "tools/pathtool.h"
+#include "tools/pathindex.h"
 #include <fstream>
 #include <iomanip>
 #include <cstdarg>
@@ -59,6 +60,7 @@ commands: makehistogram
 
 makehistogram option:
     syntax: histtool makehistogram inputvalues.txt infile [outfile.txt]
+    Uses infile.eidx (see pathtool exprindex) when it exists and matches infile.
 
 )");
   exit(1);
@@ -86,19 +88,36 @@ ssize_t lengthival_select(const std::vector<int> &values, const pbrt::path_entry
 }
 
 // Populate methods
-void val_populate(std::vector<int> &values, const PathFile &file, const EType &e) {
+void val_populate(std::vector<int> &values, const PathFile &file, const PathExpressionIndex *index, const EType &e) {
   std::set<int> valueset;
-  for(const pbrt::path_entry &p: file) {
-    if(e == EType::ELengthIval || e == EType::ELength) {
-      valueset.insert(int(p.pathlen));
+  if(index) {
+    for(size_t i = 0; i < index->size(); ++i) {
+      if(e == EType::ELengthIval || e == EType::ELength) {
+        valueset.insert(int(index->expression(i).size()));
+      }
+    }
+  } else {
+    for(const pbrt::path_entry &p: file) {
+      if(e == EType::ELengthIval || e == EType::ELength) {
+        valueset.insert(int(p.pathlen));
+      }
     }
   }
   values.assign(valueset.begin(), valueset.end());
   std::sort(values.begin(), values.end());
 }
 
-void val_populate(std::vector<std::string> &values, const PathFile &file, const EType &e) {
+void val_populate(std::vector<std::string> &values, const PathFile &file, const PathExpressionIndex *index, const EType &e) {
   std::set<std::string> valueset;
+  // Regexes are not indexed, only expressions
+  if(index && e == EType::Expr) {
+    for(size_t i = 0; i < index->size(); ++i) {
+      valueset.insert(index->expression(i));
+    }
+    values.assign(valueset.begin(), valueset.end());
+    return;
+  }
+
   for(const pbrt::path_entry &p: file) {
     if (e == EType::RMatch) {
       valueset.insert(p.regex);
@@ -128,13 +147,14 @@ void fun_dispatcher(const EType &e, std::function<ssize_t(const std::vector<int>
 }
 
 template <typename T>
-std::vector<int> HistogramGenerator(const EType &e, std::vector<T> &values, const PathFile &file) {
-  std::vector<int> hist;
+std::vector<uint64_t> HistogramGenerator(const EType &e, std::vector<T> &values, const PathFile &file,
+                                         const PathExpressionIndex *index) {
+  std::vector<uint64_t> hist;
   // If no values, populate w/ file data
   // TODO: populate and find frequencies in one pass
   if(values.empty()) {
     std::cout << "No values provided, populating from path file...";
-    val_populate(values, file, e);
+    val_populate(values, file, index, e);
     std::cout << " done. " << values.size() << " distinct values found." << std::endl;
   }
 
@@ -144,8 +164,18 @@ std::vector<int> HistogramGenerator(const EType &e, std::vector<T> &values, cons
   std::function<ssize_t(const std::vector<T>&, const pbrt::path_entry&)> f;
   fun_dispatcher(e, f);
 
-  for(const pbrt::path_entry &p : file) {
-      ++hist[f(values, p)];
+  if(index) {
+    // Selectors only look at the expression; classify each distinct one once
+    pbrt::path_entry p;
+    for(size_t i = 0; i < index->size(); ++i) {
+      p.path = index->expression(i);
+      p.pathlen = p.regexlen = p.path.size();
+      hist[f(values, p)] += index->count(i);
+    }
+  } else {
+    for(const pbrt::path_entry &p : file) {
+        ++hist[f(values, p)];
+    }
   }
 
   return hist;
@@ -165,7 +195,7 @@ EType typeParser(std::ifstream &is) {
 }
 
 
-void simple_histogram_output(std::ostream &os, const std::vector<std::string> &labels, const std::vector<int> &values) {
+void simple_histogram_output(std::ostream &os, const std::vector<std::string> &labels, const std::vector<uint64_t> &values) {
   os << "Histogram:" << std::endl;
 
   // Find maximum length for labels
@@ -188,7 +218,7 @@ void simple_histogram_output(std::ostream &os, const std::vector<std::string> &l
 }
 
 void histogram_generator(int argc, char* argv[]) {
-  std::vector<int> histogram;
+  std::vector<uint64_t> histogram;
   // input file parsing
   std::ifstream paramfile;
 
@@ -200,6 +230,8 @@ void histogram_generator(int argc, char* argv[]) {
   // TODO: one vector ?
   std::vector<std::string> strvalues;
   PathFile infile(argv[3]);
+  PathExpressionIndex index;
+  const PathExpressionIndex *indexptr = index.load(PathExpressionIndex::index_name(argv[3]), infile) ? &index : nullptr;
 
   // Type
   EType type = typeParser(paramfile);
@@ -210,13 +242,13 @@ void histogram_generator(int argc, char* argv[]) {
   if(type == ELength || type == ELengthIval) {
     std::vector<int> intvalues;
     std::copy(std::istream_iterator<int>(paramfile), std::istream_iterator<int>(), std::back_inserter(intvalues));
-    histogram = HistogramGenerator(type, intvalues, infile);
+    histogram = HistogramGenerator(type, intvalues, infile, indexptr);
     // Conversion for labels (after b/c of label generation)
     std::for_each(intvalues.begin(), intvalues.end(), [&](int v) { strvalues.push_back(std::to_string(v)); });
   } else {
     std::copy(std::istream_iterator<std::string>(paramfile), std::istream_iterator<std::string>(),
               std::back_inserter(strvalues));
-    histogram = HistogramGenerator(type, strvalues, infile);
+    histogram = HistogramGenerator(type, strvalues, infile, indexptr);
   }
 
   if(argc == 5) {
@@ -0,0 +1,102 @@
+// parsebench.cpp
+//
+// Scene parsing throughput benchmark: writes a scene with a large inline
+// triangle mesh, parses it with the memory-mapped tokenizer and with the
+// flex scanner (by reading it from standard input), and reports how fast
+// each gets through the text.  Both parses are recorded to binary scene
+// files, which are checked to be identical.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+#include "pbrt.h"
+#include "api.h"
+#include "parser.h"
+#include "rng.h"
+
+using namespace pbrt;
+
+static void usage() {
+    fprintf(stderr, "usage: parsebench [--tris <n>] [--digits <n>]\n");
+    exit(1);
+}
+
+static double TimeParse(const std::string &filename,
+                        const std::string &binaryFile) {
+    Options opt;
+    opt.quiet = true;
+    opt.toBinary = binaryFile;
+    pbrtInit(opt);
+    auto start = std::chrono::steady_clock::now();
+    ParseFile(filename);
+    auto end = std::chrono::steady_clock::now();
+    pbrtCleanup();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static std::string ReadFile(const std::string &filename) {
+    std::ifstream in(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[]) {
+    int nTris = 1000000, digits = 7;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 == argc) usage();
+        if (!strcmp(argv[i], "--tris"))
+            nTris = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--digits"))
+            digits = atoi(argv[++i]);
+        else
+            usage();
+    }
+    if (nTris <= 0 || digits <= 0) usage();
+
+    const char *sceneFile = "parsebench.pbrt";
+    FILE *f = fopen(sceneFile, "w");
+    if (!f) {
+        perror(sceneFile);
+        return 1;
+    }
+    RNG rng;
+    int nVertices = nTris;
+    fprintf(f, "WorldBegin\nShape \"trianglemesh\"\n  \"integer indices\" [");
+    for (int i = 0; i < 3 * nTris; ++i)
+        fprintf(f, "%s%d", (i % 16) ? " " : "\n    ",
+                rng.UniformUInt32(nVertices));
+    fprintf(f, "\n  ]\n  \"point P\" [");
+    for (int i = 0; i < 3 * nVertices; ++i)
+        fprintf(f, "%s%.*g", (i % 9) ? " " : "\n    ", digits,
+                Lerp(rng.UniformFloat(), -100, 100));
+    fprintf(f, "\n  ]\n  \"normal N\" [");
+    for (int i = 0; i < 3 * nVertices; ++i)
+        fprintf(f, "%s%.*g", (i % 9) ? " " : "\n    ", digits,
+                2 * rng.UniformFloat() - 1);
+    fprintf(f, "\n  ]\nWorldEnd\n");
+    long size = ftell(f);
+    fclose(f);
+    printf("%d triangles, %.1f MB of scene text\n", nTris, size / 1e6);
+
+    double mappedTime = TimeParse(sceneFile, "parsebench_mapped.pbrb");
+    if (!freopen(sceneFile, "r", stdin)) {
+        perror(sceneFile);
+        return 1;
+    }
+    double flexTime = TimeParse("-", "parsebench_flex.pbrb");
+    printf("mapped tokenizer: %.3fs, %.1f MB/s\n", mappedTime,
+           size / mappedTime * 1e-6);
+    printf("flex scanner: %.3fs, %.1f MB/s\n", flexTime,
+           size / flexTime * 1e-6);
+
+    if (ReadFile("parsebench_mapped.pbrb") != ReadFile("parsebench_flex.pbrb"))
+        fprintf(stderr, "Mapped and flex parses of the scene differ!\n");
+    remove(sceneFile);
+    remove("parsebench_mapped.pbrb");
+    remove("parsebench_flex.pbrb");
+    return 0;
+}
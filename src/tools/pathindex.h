@@ -0,0 +1,424 @@
+//
+// Persistent side indices over path files
+//
+
+#ifndef PBRT_EXTLIB_PATHINDEX_H
+#define PBRT_EXTLIB_PATHINDEX_H
+
+#include "tools/pathtool.h"
+#include "core/geometry.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Spatial index file structure (<pathfile>.sidx)
+ * - Header (PathSpatialIndex::Header):
+ *    - Magic/version, path count and size of the indexed path file
+ *    - Vertex bounds and grid resolution
+ * - Cell table: (ncells + 1) uint64 offsets into the id table
+ * - Id table: for each cell, sorted ids of the paths with a vertex inside it
+ */
+class PathSpatialIndex {
+  public:
+    struct Header {
+      char magic[4];
+      uint32_t version;
+      uint64_t pathcount;
+      uint64_t filesize;
+      float pMin[3];
+      float pMax[3];
+      int32_t res[3];
+      uint32_t pad;
+    };
+
+    PathSpatialIndex() : fd(-1), filemap(nullptr), mapsize(0), header(nullptr), offsets(nullptr), ids(nullptr) {}
+
+    ~PathSpatialIndex() {
+      unmap();
+    }
+
+    static std::string index_name(const std::string &pathfile) {
+      return pathfile + ".sidx";
+    }
+
+    // Builds the index of a path file and writes it to indexfile
+    static bool build(const PathFile &paths, const std::string &indexfile) {
+      Header h;
+      memcpy(h.magic, "PIDX", 4);
+      h.version = 1;
+      h.pathcount = paths.size();
+      h.filesize = paths.file_size();
+      h.pad = 0;
+
+      // First pass: vertex bounds
+      pbrt::Bounds3f bounds;
+      uint64_t vertexcount = 0;
+      for (const pbrt::path_entry &p : paths) {
+        for (const pbrt::vertex_entry &v : p.vertices) {
+          bounds = pbrt::Union(bounds, pbrt::FromArray(v.v));
+        }
+        vertexcount += p.pathlen;
+      }
+      if (vertexcount == 0) {
+        bounds = pbrt::Bounds3f(pbrt::Point3f(0, 0, 0));
+      }
+
+      // Aim for a handful of vertices per cell, the grid follows the bounds aspect
+      const int maxres = 128;
+      pbrt::Vector3f diag = bounds.Diagonal();
+      float maxdiag = std::max(diag[bounds.MaximumExtent()], 1e-6f);
+      int baseres = std::min(maxres, std::max(1, int(std::cbrt(vertexcount / 16.0))));
+      for (int i = 0; i < 3; ++i) {
+        h.pMin[i] = bounds.pMin[i];
+        h.pMax[i] = bounds.pMax[i];
+        h.res[i] = std::max(1, int(baseres * diag[i] / maxdiag));
+      }
+      const uint64_t ncells = uint64_t(h.res[0]) * h.res[1] * h.res[2];
+
+      // Second pass: per cell path counts
+      std::vector<uint64_t> counts(ncells + 1, 0);
+      std::vector<uint64_t> pathcells;
+      for (const pbrt::path_entry &p : paths) {
+        path_cells(h, p, pathcells);
+        for (uint64_t c : pathcells) {
+          ++counts[c + 1];
+        }
+      }
+      for (uint64_t c = 0; c < ncells; ++c) {
+        counts[c + 1] += counts[c];
+      }
+
+      // Size the output file and fill it in place
+      const uint64_t refcount = counts[ncells];
+      const size_t total = sizeof(Header) + (ncells + 1) * sizeof(uint64_t) + refcount * sizeof(uint64_t);
+      int outfd = open(indexfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (outfd < 0) {
+        std::cerr << "Index file error " << std::strerror(errno) << std::endl;
+        return false;
+      }
+      if (ftruncate(outfd, total) != 0) {
+        std::cerr << "Index file error " << std::strerror(errno) << std::endl;
+        close(outfd);
+        return false;
+      }
+      int8_t *out = (int8_t *)mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, outfd, 0);
+      if (out == MAP_FAILED) {
+        std::cerr << "mmap error " << std::strerror(errno) << std::endl;
+        close(outfd);
+        return false;
+      }
+
+      memcpy(out, &h, sizeof(Header));
+      uint64_t *outoffsets = (uint64_t *)(out + sizeof(Header));
+      uint64_t *outids = outoffsets + ncells + 1;
+      memcpy(outoffsets, &counts[0], (ncells + 1) * sizeof(uint64_t));
+
+      // Third pass: path ids, in increasing order inside each cell
+      uint64_t id = 0;
+      for (const pbrt::path_entry &p : paths) {
+        path_cells(h, p, pathcells);
+        for (uint64_t c : pathcells) {
+          outids[counts[c]++] = id;
+        }
+        ++id;
+      }
+
+      munmap(out, total);
+      close(outfd);
+      std::cout << "Spatial index: " << h.res[0] << "x" << h.res[1] << "x" << h.res[2] << " cells, "
+                << refcount << " references written to " << indexfile << std::endl;
+      return true;
+    }
+
+    // Maps an index file; fails if it does not match the given path file
+    bool load(const std::string &indexfile, const PathFile &paths) {
+      unmap();
+      if ((fd = open(indexfile.c_str(), O_RDONLY)) < 0)
+        return false;
+
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+        unmap();
+        return false;
+      }
+      mapsize = st.st_size;
+      if ((filemap = (int8_t *)mmap(nullptr, mapsize, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        filemap = nullptr;
+        unmap();
+        return false;
+      }
+
+      header = (const Header *)filemap;
+      if (memcmp(header->magic, "PIDX", 4) || header->version != 1 || header->pathcount != paths.size() ||
+          header->filesize != paths.file_size()) {
+        std::cerr << "Spatial index " << indexfile << " is stale, ignoring it" << std::endl;
+        unmap();
+        return false;
+      }
+      offsets = (const uint64_t *)(filemap + sizeof(Header));
+      ids = offsets + ncells() + 1;
+      return true;
+    }
+
+    bool valid() const { return header != nullptr; }
+
+    // Sorted ids of the paths that may have a vertex inside the sphere
+    std::vector<uint64_t> sphere_candidates(const float pos[3], float r) const {
+      std::vector<uint64_t> result;
+      int lo[3], hi[3];
+      for (int i = 0; i < 3; ++i) {
+        lo[i] = cell_coord(*header, pos[i] - r, i);
+        hi[i] = cell_coord(*header, pos[i] + r, i);
+      }
+
+      const pbrt::Point3f center(pos[0], pos[1], pos[2]);
+      for (int z = lo[2]; z <= hi[2]; ++z) {
+        for (int y = lo[1]; y <= hi[1]; ++y) {
+          for (int x = lo[0]; x <= hi[0]; ++x) {
+            if (pbrt::DistanceSquared(center, cell_bounds(x, y, z)) > r * r)
+              continue;
+            uint64_t c = (uint64_t(z) * header->res[1] + y) * header->res[0] + x;
+            result.insert(result.end(), ids + offsets[c], ids + offsets[c + 1]);
+          }
+        }
+      }
+
+      std::sort(result.begin(), result.end());
+      result.erase(std::unique(result.begin(), result.end()), result.end());
+      return result;
+    }
+
+  private:
+    uint64_t ncells() const {
+      return uint64_t(header->res[0]) * header->res[1] * header->res[2];
+    }
+
+    static int cell_coord(const Header &h, float v, int axis) {
+      float extent = h.pMax[axis] - h.pMin[axis];
+      float c = extent > 0 ? (v - h.pMin[axis]) / extent * h.res[axis] : 0.f;
+      return int(pbrt::Clamp(c, 0.f, float(h.res[axis] - 1)));
+    }
+
+    pbrt::Bounds3f cell_bounds(int x, int y, int z) const {
+      const int c[3] = {x, y, z};
+      pbrt::Point3f pMin, pMax;
+      for (int i = 0; i < 3; ++i) {
+        float w = (header->pMax[i] - header->pMin[i]) / header->res[i];
+        pMin[i] = header->pMin[i] + c[i] * w;
+        pMax[i] = header->pMin[i] + (c[i] + 1) * w;
+      }
+      return pbrt::Bounds3f(pMin, pMax);
+    }
+
+    // Distinct cells touched by the vertices of a path
+    static void path_cells(const Header &h, const pbrt::path_entry &p, std::vector<uint64_t> &cells) {
+      cells.clear();
+      for (const pbrt::vertex_entry &v : p.vertices) {
+        uint64_t x = cell_coord(h, v.v[0], 0), y = cell_coord(h, v.v[1], 1), z = cell_coord(h, v.v[2], 2);
+        cells.push_back((z * h.res[1] + y) * h.res[0] + x);
+      }
+      std::sort(cells.begin(), cells.end());
+      cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    }
+
+    void unmap() {
+      if (filemap)
+        munmap(filemap, mapsize);
+      if (fd >= 0)
+        close(fd);
+      fd = -1;
+      filemap = nullptr;
+      header = nullptr;
+      offsets = ids = nullptr;
+    }
+
+    PathSpatialIndex(const PathSpatialIndex &) = delete;
+    PathSpatialIndex &operator=(const PathSpatialIndex &) = delete;
+
+    int fd;
+    int8_t *filemap;
+    size_t mapsize;
+    const Header *header;
+    const uint64_t *offsets;
+    const uint64_t *ids;
+};
+
+/*
+ * Expression index file structure (<pathfile>.eidx)
+ * - Header (PathExpressionIndex::Header):
+ *    - Magic/version, path count and size of the indexed path file
+ *    - Number of distinct expressions, size of the string table
+ * - Expression table: for each distinct expression, its string offset and
+ *   length, its path count and the offset of its path list
+ * - String table: concatenated expressions, padded to 8 bytes
+ * - Id table: path ids grouped by expression, increasing inside each group
+ */
+class PathExpressionIndex {
+  public:
+    struct Header {
+      char magic[4];
+      uint32_t version;
+      uint64_t pathcount;
+      uint64_t filesize;
+      uint64_t exprcount;
+      uint64_t stringsize;
+    };
+
+    struct Entry {
+      uint64_t stroffset;
+      uint64_t strlen;
+      uint64_t count;
+      uint64_t idoffset;
+    };
+
+    PathExpressionIndex() : fd(-1), filemap(nullptr), mapsize(0), header(nullptr), entries(nullptr), strings(nullptr), ids(nullptr) {}
+
+    ~PathExpressionIndex() {
+      unmap();
+    }
+
+    static std::string index_name(const std::string &pathfile) {
+      return pathfile + ".eidx";
+    }
+
+    // Builds the index of a path file and writes it to indexfile
+    static bool build(const PathFile &paths, const std::string &indexfile) {
+      // First pass: distinct expressions and their counts
+      std::map<std::string, uint64_t> exprs;
+      for (PathFile::size_type i = 0; i < paths.size(); ++i) {
+        ++exprs[paths.expression(i)];
+      }
+
+      Header h;
+      memcpy(h.magic, "PEXI", 4);
+      h.version = 1;
+      h.pathcount = paths.size();
+      h.filesize = paths.file_size();
+      h.exprcount = exprs.size();
+      h.stringsize = 0;
+
+      std::vector<Entry> table;
+      table.reserve(exprs.size());
+      uint64_t idoffset = 0;
+      for (std::pair<const std::string, uint64_t> &e : exprs) {
+        table.push_back(Entry{h.stringsize, e.first.size(), e.second, idoffset});
+        h.stringsize += e.first.size();
+        idoffset += e.second;
+        e.second = table.size() - 1; // Reuse the map as expression -> entry lookup
+      }
+      h.stringsize = (h.stringsize + 7) & ~uint64_t(7);
+
+      const size_t total = sizeof(Header) + table.size() * sizeof(Entry) + h.stringsize + h.pathcount * sizeof(uint64_t);
+      int outfd = open(indexfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (outfd < 0) {
+        std::cerr << "Index file error " << std::strerror(errno) << std::endl;
+        return false;
+      }
+      if (ftruncate(outfd, total) != 0) {
+        std::cerr << "Index file error " << std::strerror(errno) << std::endl;
+        close(outfd);
+        return false;
+      }
+      int8_t *out = (int8_t *)mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, outfd, 0);
+      if (out == MAP_FAILED) {
+        std::cerr << "mmap error " << std::strerror(errno) << std::endl;
+        close(outfd);
+        return false;
+      }
+
+      memcpy(out, &h, sizeof(Header));
+      Entry *outentries = (Entry *)(out + sizeof(Header));
+      char *outstrings = (char *)(outentries + table.size());
+      uint64_t *outids = (uint64_t *)(outstrings + h.stringsize);
+      if (!table.empty())
+        memcpy(outentries, &table[0], table.size() * sizeof(Entry));
+      for (const std::pair<const std::string, uint64_t> &e : exprs) {
+        memcpy(outstrings + table[e.second].stroffset, e.first.data(), e.first.size());
+      }
+
+      // Second pass: path ids per expression
+      for (PathFile::size_type i = 0; i < paths.size(); ++i) {
+        Entry &e = table[exprs[paths.expression(i)]];
+        outids[e.idoffset++] = i;
+      }
+
+      munmap(out, total);
+      close(outfd);
+      std::cout << "Expression index: " << h.exprcount << " distinct expressions for " << h.pathcount
+                << " paths written to " << indexfile << std::endl;
+      return true;
+    }
+
+    // Maps an index file; fails if it does not match the given path file
+    bool load(const std::string &indexfile, const PathFile &paths) {
+      unmap();
+      if ((fd = open(indexfile.c_str(), O_RDONLY)) < 0)
+        return false;
+
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+        unmap();
+        return false;
+      }
+      mapsize = st.st_size;
+      if ((filemap = (int8_t *)mmap(nullptr, mapsize, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        filemap = nullptr;
+        unmap();
+        return false;
+      }
+
+      header = (const Header *)filemap;
+      if (memcmp(header->magic, "PEXI", 4) || header->version != 1 || header->pathcount != paths.size() ||
+          header->filesize != paths.file_size()) {
+        std::cerr << "Expression index " << indexfile << " is stale, ignoring it" << std::endl;
+        unmap();
+        return false;
+      }
+      entries = (const Entry *)(filemap + sizeof(Header));
+      strings = (const char *)(entries + header->exprcount);
+      ids = (const uint64_t *)(strings + header->stringsize);
+      return true;
+    }
+
+    // Number of distinct expressions
+    size_t size() const { return header->exprcount; }
+
+    std::string expression(size_t i) const {
+      return std::string(strings + entries[i].stroffset, entries[i].strlen);
+    }
+
+    uint64_t count(size_t i) const { return entries[i].count; }
+
+    // Ids of the paths sharing expression i, in file order
+    const uint64_t *begin(size_t i) const { return ids + entries[i].idoffset; }
+    const uint64_t *end(size_t i) const { return ids + entries[i].idoffset + entries[i].count; }
+
+  private:
+    void unmap() {
+      if (filemap)
+        munmap(filemap, mapsize);
+      if (fd >= 0)
+        close(fd);
+      fd = -1;
+      filemap = nullptr;
+      header = nullptr;
+      entries = nullptr;
+      strings = nullptr;
+      ids = nullptr;
+    }
+
+    PathExpressionIndex(const PathExpressionIndex &) = delete;
+    PathExpressionIndex &operator=(const PathExpressionIndex &) = delete;
+
+    int fd;
+    int8_t *filemap;
+    size_t mapsize;
+    const Header *header;
+    const Entry *entries;
+    const char *strings;
+    const uint64_t *ids;
+};
+
+#endif //PBRT_EXTLIB_PATHINDEX_H
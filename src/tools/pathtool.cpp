@@ -8,6 +8,7 @@
 #include <regex>
 #include <fstream>
 #include "tools/pathtool.h"
+#include "tools/pathindex.h"
 #include "tools/classification/src/kmgen.h"
 #include "tools/classification/src/kmedoids.h"
 #include <vector>
@@ -44,7 +45,7 @@ namespace pbrt {
         }
         fprintf(stderr, R"(usage: pathtool <command> [options] <filenames...>
 
-commands: cat, aligncheck, spherefilter, regexfilter, lengthfilter, kmeans, kmedoids, leveinstein, toimg
+commands: cat, aligncheck, spherefilter, spatialindex, regexfilter, exprindex, lengthfilter, kmeans, kmedoids, clara, leveinstein, toimg
 
 cat option:
     --outfile          Output file name
@@ -54,9 +55,19 @@ lengthfilter option:
 
 regexfilter option:
     syntax: pathtool regexfilter <regex> <filename> <out_image>
+    Uses <filename>.eidx when it exists and matches the path file.
+
+exprindex option:
+    syntax: pathtool exprindex <filename>
+    Writes the expression index <filename>.eidx used by regexfilter and histtool.
 
 spherefilter option:
-    syntax: pathtool spherefilter <radius> <x> <y> <z> <filename>
+    syntax: pathtool spherefilter <x> <y> <z> <radius> <filename>
+    Uses <filename>.sidx when it exists and matches the path file.
+
+spatialindex option:
+    syntax: pathtool spatialindex <filename>
+    Writes the vertex grid index <filename>.sidx used by spherefilter.
 
 kmeans option:
     syntax: pathtool kmeans <k> <filename>
@@ -64,6 +75,10 @@ kmeans option:
 kmedoids option:
     syntax: pathtool kmedoids <k> <filename>
 
+clara option:
+    syntax: pathtool clara <k> <filename> [<out_labels>]
+    Sampled k-medoids for large files; <out_labels> receives one uint32 label per path.
+
 leveinstein option:
     syntax: pathtool leveinstein <k> <filename>
 
@@ -267,12 +282,36 @@ void filter_by_location(int argc, char *argv[]) {
               << " and radius " << radius << std::endl;
     PathFile file((std::string(argv[6])));
     std::vector<pbrt::path_entry> resultpaths;
-    std::copy_if(file.begin(), file.end(), std::back_inserter(resultpaths),
-                 [&](const pbrt::path_entry &p) { return sphereSearch(p, radius, pos); });
+
+    PathSpatialIndex index;
+    if (index.load(PathSpatialIndex::index_name(argv[6]), file)) {
+        // Only test the paths referenced by the grid cells overlapping the sphere
+        std::vector<uint64_t> candidates = index.sphere_candidates(pos, radius);
+        std::cout << "Spatial index found, " << candidates.size() << " candidate paths" << std::endl;
+        for (uint64_t id : candidates) {
+            pbrt::path_entry p = file[id];
+            if (sphereSearch(p, radius, pos))
+                resultpaths.push_back(p);
+        }
+    } else {
+        std::copy_if(file.begin(), file.end(), std::back_inserter(resultpaths),
+                     [&](const pbrt::path_entry &p) { return sphereSearch(p, radius, pos); });
+    }
 
     std::cout << "Number of paths matching : " << resultpaths.size() << std::endl;
 }
 
+void build_spatial_index(int argc, char *argv[]) {
+    if (argc != 3) {
+        pbrt::usage("Error: no file provided");
+    }
+
+    PathFile file((std::string(argv[2])));
+    if (!PathSpatialIndex::build(file, PathSpatialIndex::index_name(argv[2]))) {
+        exit(EXIT_FAILURE);
+    }
+}
+
 
 // Regex match
 static bool regMatch(const pbrt::path_entry &path, const std::string &regexstr) {
@@ -290,8 +329,25 @@ void filter_by_regex(int argc, char *argv[]) {
 
     PathFile file((std::string(argv[3])));
     std::vector<pbrt::path_entry> resultpaths;
-    std::copy_if(file.begin(), file.end(), std::back_inserter(resultpaths),
-                 [&](const pbrt::path_entry &p) { return regMatch(p, regex); });
+
+    PathExpressionIndex index;
+    if (index.load(PathExpressionIndex::index_name(argv[3]), file)) {
+        // Match the distinct expressions only, then fetch their paths in file order
+        std::regex reg(regex);
+        std::vector<uint64_t> ids;
+        for (size_t i = 0; i < index.size(); ++i) {
+            if (std::regex_match(index.expression(i), reg))
+                ids.insert(ids.end(), index.begin(i), index.end(i));
+        }
+        std::sort(ids.begin(), ids.end());
+        resultpaths.reserve(ids.size());
+        for (uint64_t id : ids) {
+            resultpaths.push_back(file[id]);
+        }
+    } else {
+        std::copy_if(file.begin(), file.end(), std::back_inserter(resultpaths),
+                     [&](const pbrt::path_entry &p) { return regMatch(p, regex); });
+    }
 
 //  std::cout << "Number of paths matching : " << resultpaths.size() << std::endl;
 
@@ -321,6 +377,18 @@ void filter_by_regex(int argc, char *argv[]) {
 }
 
 
+void build_expression_index(int argc, char *argv[]) {
+    if (argc != 3) {
+        pbrt::usage("Error: no file provided");
+    }
+
+    PathFile file((std::string(argv[2])));
+    if (!PathExpressionIndex::build(file, PathExpressionIndex::index_name(argv[2]))) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+
 void kmeans_classification(int argc, char *argv[]) {
     // argv[2] = numclusters
     // argv[3] = pathfile
@@ -429,6 +497,33 @@ void kmedoids_classification(int argc, char *argv[]) {
 
 }
 
+void clara_classification(int argc, char *argv[]) {
+    // argv[2] = numclusters
+    // argv[3] = pathfile
+    // argv[4] = optional label file
+    if (argc < 4) {
+        pbrt::usage("Missing arguments");
+        return;
+    }
+
+    const int samplesize = 10000;
+    const int nsamples = 5;
+    const uint64_t chunksize = 1 << 22;
+    const int iterations = 20;
+    const int k = std::atoi(argv[2]);
+    PathFile file(argv[3]);
+    std::shared_ptr<Kmedoids::CentroidGenerator> generator(new Kmedoids::LevenshteinGenerator(file));
+    Kmedoids::SampledClassifier classifier(k, file, generator, samplesize, nsamples, chunksize, iterations);
+
+    classifier.run();
+    std::vector<uint64_t> sizes = classifier.assign(argc > 4 ? argv[4] : "");
+
+    std::cout << "Classification results:" << std::endl;
+    for (uint64_t size : sizes) {
+        std::cout << "New label. Size " << size << std::endl;
+    }
+}
+
 
 void path_to_img(int argc, char *argv[]) {
     PathFile paths(argv[2]);
@@ -481,14 +576,20 @@ int main(int argc, char *argv[]) {
         filter_by_length(argc, argv);
     } else if (!strcmp(argv[1], "regexfilter")) {
         filter_by_regex(argc, argv);
+    } else if (!strcmp(argv[1], "exprindex")) {
+        build_expression_index(argc, argv);
     } else if (!strcmp(argv[1], "spherefilter")) {
         filter_by_location(argc, argv);
+    } else if (!strcmp(argv[1], "spatialindex")) {
+        build_spatial_index(argc, argv);
     } else if (!strcmp(argv[1], "cat2")) {
         pbrt::bin_to_txt2(argc, argv);
     } else if (!strcmp(argv[1], "kmeans")) {
         kmeans_classification(argc, argv);
     } else if (!strcmp(argv[1], "kmedoids")) {
         kmedoids_classification(argc, argv);
+    } else if (!strcmp(argv[1], "clara")) {
+        clara_classification(argc, argv);
     } else if (!strcmp(argv[1], "leveinstein")) {
         leveinstein_classification(argc, argv);
     } else if (!strcmp(argv[1], "toimg")) {
@@ -171,6 +171,11 @@ class PathFile {
       return pathcount; 
     }
 
+    // Size in bytes of the mapped file
+    size_type file_size() const {
+      return stats.st_size;
+    }
+
     size_type average_length() const {
       uint64_t totallength = 0;
       for(const pbrt::path_entry &p : *this) {
@@ -193,6 +198,14 @@ class PathFile {
       return pbrt::path_entry::path_fromptr((void*)index[pos]);
     }
 
+    // Path expression only, without copying the vertices
+    std::string expression(size_type pos) const {
+      const char *ptr = (const char*)index[pos];
+      uint32_t lens[2]; // regexlen, pathlen
+      memcpy(lens, ptr, sizeof(lens));
+      return std::string(ptr + 2*sizeof(uint32_t) + 5*sizeof(float) + lens[0], lens[1]);
+    }
+
     bool eof() const {
       return current_pos >= pathcount;
     }
@@ -0,0 +1,114 @@
+// texbench.cpp
+//
+// Texture filtering microbenchmark: builds a MIP map of random texels in
+// each texel format and reports the number of EWA lookups per second with
+// the scalar and the SIMD filter, along with trilinear lookups, for
+// anisotropic footprints like those of textures seen at grazing angles.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "pbrt.h"
+#include "api.h"
+#include "mipmap.h"
+#include "rng.h"
+
+using namespace pbrt;
+
+static void usage() {
+    fprintf(stderr,
+            "usage: texbench [--res <n>] [--lookups <n>] [--width <w>] "
+            "[--maxaniso <a>]\n");
+    exit(1);
+}
+
+struct TexLookup {
+    Point2f st;
+    Vector2f dst0, dst1;
+};
+
+int main(int argc, char *argv[]) {
+    int res = 1024, nLookups = 1000000;
+    Float width = .002f, maxAniso = 8;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 == argc) usage();
+        if (!strcmp(argv[i], "--res"))
+            res = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--lookups"))
+            nLookups = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width"))
+            width = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--maxaniso"))
+            maxAniso = atof(argv[++i]);
+        else
+            usage();
+    }
+    if (res <= 0 || nLookups <= 0 || width <= 0 || maxAniso < 1) usage();
+
+    Options opt;
+    opt.quiet = true;
+    pbrtInit(opt);
+
+    RNG rng;
+    std::unique_ptr<RGBSpectrum[]> image(new RGBSpectrum[res * res]);
+    for (int i = 0; i < res * res; ++i) {
+        Float rgb[3] = {rng.UniformFloat(), rng.UniformFloat(),
+                        rng.UniformFloat()};
+        image[i] = RGBSpectrum::FromRGB(rgb);
+    }
+
+    // Footprints with a random orientation whose major axis is up to
+    // _maxAniso_ times longer than their minor axis
+    std::vector<TexLookup> lookups(nLookups);
+    for (TexLookup &l : lookups) {
+        l.st = Point2f(rng.UniformFloat(), rng.UniformFloat());
+        Float theta = 2 * Pi * rng.UniformFloat();
+        Float aniso = Lerp(rng.UniformFloat(), 1, maxAniso);
+        Vector2f major(std::cos(theta), std::sin(theta));
+        l.dst0 = width * aniso * major;
+        l.dst1 = width * Vector2f(-major.y, major.x);
+    }
+
+    printf("%dx%d texels, %d lookups\n", res, res, nLookups);
+    const char *formatNames[] = {"float", "half", "srgb8"};
+    for (TexelFormat format :
+         {TexelFormat::Float, TexelFormat::Half, TexelFormat::SRGB8}) {
+        MIPMap<RGBSpectrum> mipmap(Point2i(res, res), image.get(), false,
+                                   maxAniso, ImageWrap::Repeat, format);
+        typedef std::chrono::duration<double> Seconds;
+        double ewaRate[2];
+        RGBSpectrum ewaSum[2];
+        for (int simd = 0; simd < 2; ++simd) {
+            MIPMap<RGBSpectrum>::simdEWA = simd;
+            auto start = std::chrono::steady_clock::now();
+            for (const TexLookup &l : lookups)
+                ewaSum[simd] += mipmap.Lookup(l.st, l.dst0, l.dst1);
+            ewaRate[simd] = nLookups /
+                            Seconds(std::chrono::steady_clock::now() - start)
+                                .count() * 1e-6;
+        }
+        MIPMap<RGBSpectrum>::simdEWA = true;
+
+        auto start = std::chrono::steady_clock::now();
+        RGBSpectrum trilinearSum;
+        for (const TexLookup &l : lookups)
+            trilinearSum += mipmap.Lookup(l.st, 2 * l.dst0.Length());
+        double trilinearRate =
+            nLookups /
+            Seconds(std::chrono::steady_clock::now() - start).count() * 1e-6;
+
+        printf("%s: EWA %.2f Mlookups/s, SIMD EWA %.2f Mlookups/s "
+               "(%.2fx), trilinear %.2f Mlookups/s\n",
+               formatNames[int(format)], ewaRate[0], ewaRate[1],
+               ewaRate[1] / ewaRate[0], trilinearRate);
+        if (!(ewaSum[0] == ewaSum[1]))
+            fprintf(stderr, "%s: scalar and SIMD EWA disagree (%s vs %s)\n",
+                    formatNames[int(format)], ewaSum[0].ToString().c_str(),
+                    ewaSum[1].ToString().c_str());
+    }
+
+    pbrtCleanup();
+    return 0;
+}